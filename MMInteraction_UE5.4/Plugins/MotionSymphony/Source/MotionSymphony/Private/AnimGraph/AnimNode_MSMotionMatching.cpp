@@ -10,11 +10,10 @@
 #include "Animation/AnimNode_Inertialization.h"
 #include "Enumerations/EMotionMatchingEnums.h"
 #include "Utility/MotionMatchingUtils.h"
+#include "Utility/MotionMatchingSearchScheduler.h"
 #include "Animation/AnimSyncScope.h"
 #include "Animation/MirrorDataTable.h"
 
-FCriticalSection FAnimNode_MSMotionMatching::CheckValidCriticalSection;
-
 static TAutoConsoleVariable<int32> CVarMMSearchDebug(
 	TEXT("a.AnimNode.MoSymph.MMSearch.Debug"),
 	0,
@@ -46,6 +45,57 @@ static TAutoConsoleVariable<int32> CVarMMAnimDebug(
 	TEXT("<=0: Off \n")
 	TEXT("  2: On - Show Current Anim Info"));
 
+static TAutoConsoleVariable<int32> CVarMMSearchCompareTree(
+	TEXT("a.AnimNode.MoSymph.MMSearch.CompareTree"),
+	0,
+	TEXT("Runs the AABB search alongside every 'Tree' quality search and logs the poses visited and cost found by both. \n")
+	TEXT("<=0: Off \n")
+	TEXT("  1: On - Log every search\n")
+	TEXT("  2: On - Only log searches where the tree found a different cost\n"));
+
+static TAutoConsoleVariable<int32> CVarMMSearchCompareLookupTable(
+	TEXT("a.AnimNode.MoSymph.MMSearch.CompareLookupTable"),
+	0,
+	TEXT("Runs a full search alongside every 'Candidate Lookup' quality search and logs how often the candidates contained the lowest cost pose, the average cost relative to the lowest cost and the poses checked by both. \n")
+	TEXT("<=0: Off \n")
+	TEXT(" >0: On - Log a report every N searches of each node\n"));
+
+static TAutoConsoleVariable<int32> CVarMMSearchAABBLevelStats(
+	TEXT("a.AnimNode.MoSymph.MMSearch.AABBLevelStats"),
+	0,
+	TEXT("Logs the average number of boxes tested and the pass rate of each level of the AABB hierarchy for searches of motion data with an AABB hierarchy. \n")
+	TEXT("<=0: Off \n")
+	TEXT(" >0: On - Log a report every N searches of each node\n"));
+
+static TAutoConsoleVariable<int32> CVarMMSearchAsyncLatencyStats(
+	TEXT("a.AnimNode.MoSymph.MMSearch.AsyncLatencyStats"),
+	0,
+	TEXT("Logs the average latency (frames and time from snapshot to use) and search time of async pose searches. \n")
+	TEXT("<=0: Off \n")
+	TEXT(" >0: On - Log a report every N async searches of each node\n"));
+
+void FAsyncPoseSearch::Search()
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	FPoseSearchQuery Query(QueryPoseArray.GetData(), CalibrationArray.GetData(), StartPoseIndex, EndPoseIndex);
+	Query.EvaluationOrder = EvaluationOrder;
+
+	FMotionMatchingSearch::SearchWithQuality(MotionData, Query, SearchSettings, SectionIndex, CurrentPoseId, SearchScratch, Result);
+
+	SearchCycles = FPlatformTime::Cycles64() - StartCycles;
+}
+
+void FAsyncPoseSearch::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObject(MotionData);
+}
+
+FString FAsyncPoseSearch::GetReferencerName() const
+{
+	return TEXT("FAsyncPoseSearch");
+}
+
 void FMotionMatchingInputData::Empty(const int32 Size)
 {
 	DesiredInputArray.Empty(Size);
@@ -57,8 +107,14 @@ FAnimNode_MSMotionMatching::FAnimNode_MSMotionMatching() :
 	PlaybackRate(1.0f),
 	BlendTime(0.3f),
 	OverrideQualityVsResponsivenessRatio(0.5f),
+	SearchTreeEpsilon(0.0f),
+	CompressedRerankCount(32),
+	HighQualityCandidateCount(32),
+	SearchCandidateCount(0),
 	TransitionMethod(ETransitionMethod::Inertialization),
 	PastTrajectoryMode(EPastTrajectoryMode::ActualHistory),
+	bUseSearchScheduler(true),
+	SearchDispatch(EPoseSearchDispatch::Inline),
 	bBlendInputResponse(false),
 	InputResponseBlendMagnitude(1.0f),
 	bFavourCurrentPose(false),
@@ -80,9 +136,37 @@ FAnimNode_MSMotionMatching::FAnimNode_MSMotionMatching() :
 	CurrentChosenPoseId(0),
 	InputArraySize(0),
 	MotionRecorderConfigIndex(-1),
+	FramesSearchDeferred(0),
+	LastSearchPoseCount(0),
+	BatchedSearchTicket(0),
+	BatchedSearchNaturalPoseId(INDEX_NONE),
+	BatchedSearchSectionIndex(INDEX_NONE),
+	bBatchedSearchExpired(false),
+	LookupCompareSearchCount(0),
+	LookupCompareMatchCount(0),
+	LookupComparePosesChecked(0),
+	LookupCompareFullPosesChecked(0),
+	LookupCompareCostRatioSum(0.0),
+	AABBLevelStatsSearchCount(0),
+	AABBLevelStatsPosesChecked(0),
+	AsyncStatsSearchCount(0),
+	AsyncStatsStaleCount(0),
+	AsyncStatsFrames(0),
+	AsyncStatsLatencyCycles(0),
+	AsyncStatsSearchCycles(0),
+	bAsyncSearchPending(false),
 	bValidToEvaluate(false),
 	bInitialized(false),
 	bTriggerTransition(false),
+	CalibrationWeights(nullptr),
+	CustomCalibrationData(nullptr),
+	CustomCalibrationSection(INDEX_NONE),
+	CustomCalibrationSerial(0),
+	CustomCalibrationUser(nullptr),
+	CustomCalibrationRatio(0.5f),
+	CurrentCalibrationIndex(INDEX_NONE),
+	ResolvedMotionTagData(nullptr),
+	ResolvedRequiredTagSection(INDEX_NONE),
 	AnimInstanceProxy(nullptr)
 #if WITH_EDITORONLY_DATA
 	, PosesChecked(0),
@@ -97,11 +181,13 @@ FAnimNode_MSMotionMatching::FAnimNode_MSMotionMatching() :
 #endif
 {
 	InputData.Empty(21);
+	FMemory::Memzero(AABBLevelBoxesChecked);
+	FMemory::Memzero(AABBLevelBoxesPassed);
 }
 
 FAnimNode_MSMotionMatching::~FAnimNode_MSMotionMatching()
 {
-
+	WaitForAsyncSearch();
 }
 
 void FAnimNode_MSMotionMatching::InitializeWithPoseRecorder(const FAnimationUpdateContext& Context)
@@ -141,6 +227,12 @@ void FAnimNode_MSMotionMatching::InitializeMatchedTransition(const FAnimationUpd
 		//We just jump to the default pose because there is no way to match to external nodes.
 		TransitionToPose(0, Context, 0.0f);
 	}
+
+	//Offset the first search so that nodes which initialize on the same frame do not all search on the same frame
+	if(UMotionMatchingSearchScheduler* SearchScheduler = GetSearchScheduler(Context))
+	{
+		TimeSinceMotionUpdate = UpdateInterval * SearchScheduler->AcquireStaggerPhase();
+	}
 }
 
 
@@ -163,6 +255,7 @@ void FAnimNode_MSMotionMatching::UpdateMotionMatchingState(const float DeltaTime
 void FAnimNode_MSMotionMatching::UpdateMotionMatching(const float DeltaTime, const FAnimationUpdateContext& Context)
 {
 	bForcePoseSearch = false;
+	SearchTrace.Reset(SearchQuality);
 	const float PlayRateAdjustedDeltaTime = DeltaTime * PlaybackRate;
 	TimeSinceMotionChosen += PlayRateAdjustedDeltaTime;
 	TimeSinceMotionUpdate += PlayRateAdjustedDeltaTime;
@@ -183,6 +276,7 @@ void FAnimNode_MSMotionMatching::UpdateMotionMatching(const float DeltaTime, con
 	}
 
 	const TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+	ResolveRequiredMotionTags(); //Pose tag checks this update read the resolved tag sections
 	bForcePoseSearch = CheckForcePoseSearch(CurrentMotionData);
 	
 	//Past trajectory mode
@@ -205,11 +299,76 @@ void FAnimNode_MSMotionMatching::UpdateMotionMatching(const float DeltaTime, con
 		}
 	}
 	
+	//A batched search submitted last frame is consumed before deciding whether to search again
+	if(BatchedSearchTicket != 0)
+	{
+		ConsumeBatchedSearch(Context);
+	}
+
+	if(bAsyncSearchPending)
+	{
+		ConsumeAsyncSearch(Context);
+	}
+	
 	if (bForcePoseSearch || TimeSinceMotionUpdate >= UpdateInterval)
 	{
+		UMotionMatchingSearchScheduler* SearchScheduler = GetSearchScheduler(Context);
+		if(SearchScheduler)
+		{
+			const EMotionMatchingSearchPriority Priority = bForcePoseSearch ? EMotionMatchingSearchPriority::Forced
+				: SearchScheduler->ComputePriority(Context.AnimInstanceProxy->GetSkelMeshComponent());
+			
+			if(!SearchScheduler->RequestSearch(Priority, FramesSearchDeferred))
+			{
+				//The search stays due, so it will be requested again next frame
+				++FramesSearchDeferred;
+				TRACE_MOTION_MATCHING_SEARCH(Context, SearchTrace, SearchTraceCounters);
+				return;
+			}
+		}
+
+		FramesSearchDeferred = 0;
+		LastSearchPoseCount = 0;
 		TimeSinceMotionUpdate = 0.0f;
-		PoseSearch(Context);
+		
+		const uint64 SearchStartCycles = FPlatformTime::Cycles64();
+		{
+			FScopeCycleCounter SearchCycleCounter(FMotionMatchingTrace::GetSearchStatId(SearchQuality));
+			PoseSearch(Context);
+		}
+		const uint64 SearchCycles = FPlatformTime::Cycles64() - SearchStartCycles;
+		SearchTrace.SearchCycles += SearchCycles;
+
+		//Batched and async searches are only submitted here. They are counted with their worker time when they are consumed
+		if(SearchTrace.Outcome != EMotionMatchingSearchOutcome::Deferred
+			&& SearchTrace.Outcome != EMotionMatchingSearchOutcome::ToleranceSkip)
+		{
+			++SearchTrace.SearchCount;
+		}
+
+		if(SearchScheduler)
+		{
+			SearchScheduler->ReportSearch(SearchCycles, LastSearchPoseCount);
+		}
 	}
+
+	TRACE_MOTION_MATCHING_SEARCH(Context, SearchTrace, SearchTraceCounters);
+}
+
+UMotionMatchingSearchScheduler* FAnimNode_MSMotionMatching::GetSearchScheduler(const FAnimationUpdateContext& Context) const
+{
+	return bUseSearchScheduler ? FindSearchScheduler(Context) : nullptr;
+}
+
+UMotionMatchingSearchScheduler* FAnimNode_MSMotionMatching::FindSearchScheduler(const FAnimationUpdateContext& Context)
+{
+	if(!Context.AnimInstanceProxy)
+	{
+		return nullptr;
+	}
+
+	const USkeletalMeshComponent* SkelMeshComponent = Context.AnimInstanceProxy->GetSkelMeshComponent();
+	return SkelMeshComponent ? UMotionMatchingSearchScheduler::Get(SkelMeshComponent->GetWorld()) : nullptr;
 }
 
 void FAnimNode_MSMotionMatching::ComputeCurrentPose()
@@ -262,33 +421,35 @@ void FAnimNode_MSMotionMatching::ComputeCurrentPose()
 		NumPosesPassed = FMath::FloorToInt(TimePassed / PoseInterval);
 	}
 
-	CurrentChosenPoseId = PoseIndex = FMath::Clamp(PoseIndex + NumPosesPassed, 0, CurrentMotionData->Poses.Num() - 1);
+	const FPoseHotTable& PoseTable = CurrentMotionData->PoseHotTable;
+	const int32 MaxPoseIndex = PoseTable.Num() - 1;
+	CurrentChosenPoseId = PoseIndex = FMath::Clamp(PoseIndex + NumPosesPassed, 0, MaxPoseIndex);
 
 	//Get the before and after poses and then interpolate
-	FPoseMotionData BeforePose;
-	FPoseMotionData AfterPose;
+	int32 BeforePoseId;
+	int32 AfterPoseId;
 
 	if (TimePassed < UE_SMALL_NUMBER)
 	{
-		AfterPose = CurrentMotionData->Poses[PoseIndex];
-		BeforePose = CurrentMotionData->Poses[FMath::Clamp(AfterPose.LastPoseId, 0, CurrentMotionData->Poses.Num() - 1)];
+		AfterPoseId = PoseIndex;
+		BeforePoseId = FMath::Clamp(PoseTable.LastPoseIds[AfterPoseId], 0, MaxPoseIndex);
 
 		PoseInterpolationValue = 1.0f - FMath::Abs((TimePassed / PoseInterval) - static_cast<float>(NumPosesPassed));
 	}
 	else
 	{
-		BeforePose = CurrentMotionData->Poses[FMath::Min(PoseIndex, CurrentMotionData->Poses.Num() - 2)];
-		AfterPose = CurrentMotionData->Poses[FMath::Clamp(BeforePose.NextPoseId, 0, CurrentMotionData->Poses.Num() -1)];
+		BeforePoseId = FMath::Max(FMath::Min(PoseIndex, MaxPoseIndex - 1), 0);
+		AfterPoseId = FMath::Clamp(PoseTable.NextPoseIds[BeforePoseId], 0, MaxPoseIndex);
 
 		PoseInterpolationValue = (TimePassed / PoseInterval) - static_cast<float>(NumPosesPassed);
 	}
 
-	FMotionMatchingUtils::LerpPose(CurrentInterpolatedPose, BeforePose, AfterPose, PoseInterpolationValue);
+	FMotionMatchingUtils::LerpPose(CurrentInterpolatedPose, PoseTable, BeforePoseId, AfterPoseId, PoseInterpolationValue);
 
 	const FPoseMatrix& PoseMatrix = CurrentMotionData->LookupPoseMatrix;
 	const TArray<float>& PoseArray = PoseMatrix.PoseArray;
-	const int32 BeforePoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * BeforePose.PoseId, 0, PoseArray.Num() - 1);
-	const int32 AfterPoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * AfterPose.PoseId, 0, PoseArray.Num() - 1);
+	const int32 BeforePoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * BeforePoseId, 0, PoseArray.Num() - 1);
+	const int32 AfterPoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * AfterPoseId, 0, PoseArray.Num() - 1);
 	
 	FMotionMatchingUtils::LerpFloatArray(CurrentInterpolatedPoseArray, &PoseArray[BeforePoseArrayStartIndex],
 		&PoseArray[AfterPoseArrayStartIndex], PoseInterpolationValue);
@@ -363,37 +524,37 @@ void FAnimNode_MSMotionMatching::ComputeCurrentPose(const TArray<float>* Current
 		NumPosesPassed = FMath::FloorToInt(TimePassed / PoseInterval);
 	}
 
-	const int32 MaxPoseIndex = CurrentMotionData->Poses.Num() - 1;
+	const FPoseHotTable& PoseTable = CurrentMotionData->PoseHotTable;
+	const int32 MaxPoseIndex = PoseTable.Num() - 1;
 	CurrentChosenPoseId = PoseIndex = FMath::Clamp(PoseIndex + NumPosesPassed, 0, MaxPoseIndex);
 
 	//Get the before and after poses and then interpolate
-	FPoseMotionData BeforePose;
-	FPoseMotionData AfterPose;
+	int32 BeforePoseId;
+	int32 AfterPoseId;
 
 	if (TimePassed < -UE_SMALL_NUMBER)
 	{
-		AfterPose = CurrentMotionData->Poses[PoseIndex];
-		BeforePose = CurrentMotionData->Poses[FMath::Clamp(AfterPose.LastPoseId, 0, MaxPoseIndex)];
+		AfterPoseId = PoseIndex;
+		BeforePoseId = FMath::Clamp(PoseTable.LastPoseIds[AfterPoseId], 0, MaxPoseIndex);
 
 		PoseInterpolationValue = 1.0f - FMath::Abs((TimePassed / PoseInterval) - static_cast<float>(NumPosesPassed));
 	}
 	else
 	{
-		BeforePose = CurrentMotionData->Poses[FMath::Min(PoseIndex, CurrentMotionData->Poses.Num() - 2)];
-		AfterPose = CurrentMotionData->Poses[FMath::Clamp(BeforePose.NextPoseId, 0, MaxPoseIndex)];
+		BeforePoseId = FMath::Max(FMath::Min(PoseIndex, MaxPoseIndex - 1), 0);
+		AfterPoseId = FMath::Clamp(PoseTable.NextPoseIds[BeforePoseId], 0, MaxPoseIndex);
 
 		PoseInterpolationValue = (TimePassed / PoseInterval) - static_cast<float>(NumPosesPassed);
 	}
 
 	PoseInterpolationValue = FMath::Clamp(PoseInterpolationValue, 0.0f, 1.0f);
 	
-	FMotionMatchingUtils::LerpPose(CurrentInterpolatedPose, BeforePose,
-		AfterPose, PoseInterpolationValue);
+	FMotionMatchingUtils::LerpPose(CurrentInterpolatedPose, PoseTable, BeforePoseId, AfterPoseId, PoseInterpolationValue);
 
 	const FPoseMatrix& PoseMatrix = CurrentMotionData->LookupPoseMatrix;
 	const TArray<float>& PoseArray = PoseMatrix.PoseArray;
-	const int32 BeforePoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * BeforePose.PoseId, 0, PoseArray.Num()-1);
-	const int32 AfterPoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * AfterPose.PoseId, 0, PoseArray.Num()-1);
+	const int32 BeforePoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * BeforePoseId, 0, PoseArray.Num()-1);
+	const int32 AfterPoseArrayStartIndex = FMath::Clamp(PoseMatrix.AtomCount * AfterPoseId, 0, PoseArray.Num()-1);
 
 	FMotionMatchingUtils::LerpFloatArray(CurrentInterpolatedPoseArray, &PoseArray[BeforePoseArrayStartIndex], 
 	                                     &PoseArray[AfterPoseArrayStartIndex], PoseInterpolationValue);
@@ -445,28 +606,46 @@ void FAnimNode_MSMotionMatching::PoseSearch(const FAnimationUpdateContext& Conte
 	{
 		return;
 	}
+
+	SearchCandidates.Reset();
 	
-	const int32 MaxPoseId = CurrentMotionData->Poses.Num() - 1;
+	const FPoseHotTable& PoseTable = CurrentMotionData->PoseHotTable;
+	const int32 MaxPoseId = PoseTable.Num() - 1;
 	CurrentChosenPoseId = FMath::Clamp(CurrentChosenPoseId, 0, MaxPoseId);
-	int32 NextPoseId = CurrentMotionData->Poses[CurrentChosenPoseId].NextPoseId;
+	int32 NextPoseId = PoseTable.NextPoseIds[CurrentChosenPoseId];
 	if(NextPoseId < 0)
 	{
 		NextPoseId = CurrentChosenPoseId;
 	}
 
-	const FPoseMotionData& NextPose = CurrentMotionData->Poses[FMath::Clamp(NextPoseId, 0, MaxPoseId)];
-
 	if (!bForcePoseSearch && bEnableToleranceTest)
 	{
-		if (NextPoseToleranceTest(NextPose))
+		if (NextPoseToleranceTest(FMath::Clamp(NextPoseId, 0, MaxPoseId)))
 		{
+			SearchTrace.Outcome = EMotionMatchingSearchOutcome::ToleranceSkip;
 			TimeSinceMotionUpdate = 0.0f;
 			return;
 		}
 	}
+
+	if(SearchDispatch == EPoseSearchDispatch::Batched
+		&& SubmitBatchedSearch(Context))
+	{
+		return;
+	}
+
+	if(SearchDispatch == EPoseSearchDispatch::Async
+		&& SubmitAsyncSearch(Context))
+	{
+		return;
+	}
+	
 	/*----------------XC: Add Brute Search Function------------------*/
 	int32 LowestPoseId = 0;
-	if (SearchQuality == EMotionMatchingSearchQuality::Performance) {
+	if (SearchQuality == EMotionMatchingSearchQuality::Performance
+		|| SearchQuality == EMotionMatchingSearchQuality::Tree
+		|| SearchQuality == EMotionMatchingSearchQuality::CandidateLookup
+		|| SearchQuality == EMotionMatchingSearchQuality::Compressed) {
 		LowestPoseId = GetLowestCostPoseId_Standard();
 	}
 	else if (SearchQuality == EMotionMatchingSearchQuality::Quality) {
@@ -480,7 +659,14 @@ void FAnimNode_MSMotionMatching::PoseSearch(const FAnimationUpdateContext& Conte
 	//	? GetLowestCostPoseId_Standard()
 	//	: GetLowestCostPoseId_HighQuality(Context.GetDeltaTime());
 
-	const FPoseMotionData& BestPose = CurrentMotionData->Poses[LowestPoseId];
+	TransitionToSearchedPose(LowestPoseId, Context);
+}
+
+void FAnimNode_MSMotionMatching::TransitionToSearchedPose(const int32 LowestPoseId, const FAnimationUpdateContext& Context)
+{
+	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+	const FPoseHotTable& PoseTable = CurrentMotionData->PoseHotTable;
+	const int32 CurrentPoseId = CurrentInterpolatedPose.PoseId;
 
 	/*Here we are checking if the chosen pose is at or very close to the same pose that is currently playing.
 	 * If it is, then there is no need to pose transition, just keep playing the animation. There are several criteria.
@@ -488,20 +674,300 @@ void FAnimNode_MSMotionMatching::PoseSearch(const FAnimationUpdateContext& Conte
 	 * is met then the animation either needs to be looping or the pose must be within 'SamePoseTolerance' seconds
 	 * of the current pose to be considered the same. For blend spaces there is an additional criteria.
 	 */
-	const bool bSameAnim = BestPose.AnimId == CurrentInterpolatedPose.AnimId
-					&& BestPose.AnimType == CurrentInterpolatedPose.AnimType
-					&& BestPose.bMirrored == CurrentInterpolatedPose.bMirrored;
+	const bool bSameAnim = PoseTable.IsSameAnim(LowestPoseId, CurrentPoseId);
 
-	TObjectPtr<const UMotionAnimObject> SourceMotion = MotionData->GetSourceAnim(BestPose.AnimId, BestPose.AnimType);
-	
+	TObjectPtr<const UMotionAnimObject> SourceMotion = bSameAnim ? MotionData->GetSourceAnim(PoseTable.AnimIds[LowestPoseId],
+		PoseTable.GetAnimType(LowestPoseId)) : nullptr;
+
+	//The blend space position is cold data so it is only read from the poses once the animation is known to be the same
 	const bool bWinnerAtSameLocation = bSameAnim && ((SourceMotion ? SourceMotion->bLoop : false) ||
-									(FMath::Abs(BestPose.Time - CurrentInterpolatedPose.Time) < SamePoseTolerance
-									&& FVector2D::DistSquared(BestPose.BlendSpacePosition, CurrentInterpolatedPose.BlendSpacePosition) < 1.0f));
+									(FMath::Abs(PoseTable.Times[LowestPoseId] - CurrentInterpolatedPose.Time) < SamePoseTolerance
+									&& FVector2D::DistSquared(CurrentMotionData->Poses[LowestPoseId].BlendSpacePosition,
+										CurrentMotionData->Poses[CurrentPoseId].BlendSpacePosition) < 1.0f));
 	
 	if (!bWinnerAtSameLocation)
 	{
-		TransitionToPose(BestPose.PoseId, Context);
+		SearchTrace.Outcome = EMotionMatchingSearchOutcome::Transition;
+		TransitionToPose(LowestPoseId, Context);
+	}
+	else
+	{
+		SearchTrace.Outcome = LowestPoseId == SearchTrace.NaturalPoseId ? EMotionMatchingSearchOutcome::NextNatural
+			: EMotionMatchingSearchOutcome::SamePose;
+	}
+}
+
+bool FAnimNode_MSMotionMatching::SubmitBatchedSearch(const FAnimationUpdateContext& Context)
+{
+	//A search whose batched result expired is run inline so that a node which rarely updates still gets results
+	const bool bSearchInline = bBatchedSearchExpired;
+	bBatchedSearchExpired = false;
+
+	UMotionMatchingSearchScheduler* SearchScheduler = FindSearchScheduler(Context);
+	if(bForcePoseSearch
+		|| bSearchInline
+		|| SearchQuality != EMotionMatchingSearchQuality::Performance
+		|| !SearchScheduler
+		|| !GenerateCalibrationArray())
+	{
+		return false;
+	}
+
+	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+
+	int32 NaturalPoseId;
+	float CostToBeat;
+	if(ComputeNaturalCostToBeat(CurrentMotionData, NaturalPoseId, CostToBeat))
+	{
+		//The next natural pose passed the tolerance test so there is nothing to search
+		TransitionToSearchedPose(NaturalPoseId, Context);
+		return true;
+	}
+
+	FPoseSearchQuery Query(CurrentInterpolatedPoseArray.GetData(), CalibrationWeights, 0, 0);
+	Query.EvaluationOrder = GetFeatureEvaluationOrder();
+	BatchedSearchSectionIndex = ResolveRequiredMotionTags().ExactSectionIndex;
+	CurrentMotionData->GetMotionTagSectionRange(BatchedSearchSectionIndex, Query.StartPoseIndex, Query.EndPoseIndex);
+
+	BatchedSearchTicket = SearchScheduler->SubmitBatchedSearch(CurrentMotionData, Query, CostToBeat);
+	BatchedSearchNaturalPoseId = NaturalPoseId;
+	SearchTrace.Outcome = EMotionMatchingSearchOutcome::Deferred;
+	return true;
+}
+
+void FAnimNode_MSMotionMatching::ConsumeBatchedSearch(const FAnimationUpdateContext& Context)
+{
+	const uint64 Ticket = BatchedSearchTicket;
+	BatchedSearchTicket = 0;
+
+	UMotionMatchingSearchScheduler* SearchScheduler = FindSearchScheduler(Context);
+
+	//A forced search this frame supersedes the result
+	if(bForcePoseSearch)
+	{
+		if(SearchScheduler)
+		{
+			SearchScheduler->CancelBatchedSearch(Ticket);
+		}
+
+		return;
+	}
+
+	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+
+	FPoseSearchResult SearchResult;
+	uint64 SearchCycles = 0;
+	if(!CurrentMotionData
+		|| !SearchScheduler
+		|| !SearchScheduler->RetrieveBatchedSearch(Ticket, SearchResult, SearchCycles))
+	{
+		//The result expired so search again now, inline since a resubmitted search could expire again
+		TimeSinceMotionUpdate = FMath::Max(TimeSinceMotionUpdate, UpdateInterval);
+		bBatchedSearchExpired = true;
+		return;
+	}
+
+	SearchTrace.AddDeferredSearch(SearchQuality, SearchCycles);
+
+	const int32 LowestPoseId = ResolveDeferredSearchPoseId(CurrentMotionData, SearchResult, BatchedSearchNaturalPoseId);
+	if(!IsDeferredSearchResultValid(CurrentMotionData, BatchedSearchSectionIndex, LowestPoseId))
+	{
+		TimeSinceMotionUpdate = FMath::Max(TimeSinceMotionUpdate, UpdateInterval);
+		return;
+	}
+
+	RecordSearchStatistics(SearchResult);
+	SearchTrace.NaturalPoseId = BatchedSearchNaturalPoseId;
+	TransitionToSearchedPose(LowestPoseId, Context);
+}
+
+bool FAnimNode_MSMotionMatching::SubmitAsyncSearch(const FAnimationUpdateContext& Context)
+{
+	//Like batched searches, async searches are limited to game worlds (i.e. those with a search scheduler) so that a
+	//preview in the editor never searches motion data which is being pre-processed
+	if(bForcePoseSearch
+		|| !FindSearchScheduler(Context)
+		|| SearchQuality == EMotionMatchingSearchQuality::Quality
+		|| SearchQuality == EMotionMatchingSearchQuality::Brute
+		|| !GenerateCalibrationArray())
+	{
+		return false;
+	}
+
+	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+
+	int32 NaturalPoseId;
+	float CostToBeat;
+	if(ComputeNaturalCostToBeat(CurrentMotionData, NaturalPoseId, CostToBeat))
+	{
+		//The next natural pose passed the tolerance test so there is nothing to search
+		TransitionToSearchedPose(NaturalPoseId, Context);
+		return true;
+	}
+
+	//A snapshot whose task is still running (e.g. one shared with a copy of the node) is left to the task
+	if(!AsyncSearch.IsValid()
+		|| !AsyncSearch->Task.IsCompleted())
+	{
+		AsyncSearch = MakeShared<FAsyncPoseSearch, ESPMode::ThreadSafe>();
+	}
+
+	const int32 AtomCount = CurrentMotionData->SearchPoseMatrix.AtomCount;
+	FAsyncPoseSearch& Search = *AsyncSearch;
+	Search.MotionData = CurrentMotionData;
+	Search.QueryPoseArray = CurrentInterpolatedPoseArray;
+	Search.CalibrationArray = TArray<float>(CalibrationWeights, AtomCount - 1);
+	Search.EvaluationOrder = GetFeatureEvaluationOrder();
+	Search.TagSectionIndex = ResolveRequiredMotionTags().ExactSectionIndex;
+	CurrentMotionData->GetMotionTagSectionRange(Search.TagSectionIndex, Search.StartPoseIndex, Search.EndPoseIndex);
+	Search.SearchSettings = GetSearchQualitySettings(Context.GetDeltaTime());
+	Search.SearchSettings.Stages = nullptr; //'Quality' searches are never async and the stages belong to the node
+	Search.CurrentPoseId = CurrentInterpolatedPose.PoseId;
+	Search.SectionIndex = SearchQuality == EMotionMatchingSearchQuality::Tree || SearchQuality == EMotionMatchingSearchQuality::CandidateLookup
+		? CurrentMotionData->GetMotionTagSectionIndex(Search.StartPoseIndex, Search.EndPoseIndex) : INDEX_NONE;
+	Search.NaturalPoseId = NaturalPoseId;
+	Search.Result = FPoseSearchResult(CostToBeat);
+	Search.SubmitCycles = FPlatformTime::Cycles64();
+	Search.SubmitFrame = GFrameCounter;
+
+	Search.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [SearchSnapshot = AsyncSearch]()
+	{
+		SearchSnapshot->Search();
+	});
+
+	bAsyncSearchPending = true;
+	SearchTrace.Outcome = EMotionMatchingSearchOutcome::Deferred;
+	return true;
+}
+
+void FAnimNode_MSMotionMatching::ConsumeAsyncSearch(const FAnimationUpdateContext& Context)
+{
+	bAsyncSearchPending = false;
+
+	FAsyncPoseSearch& Search = *AsyncSearch;
+	Search.Task.Wait(); //Normally the task has completed long before the next update
+	SearchTrace.AddDeferredSearch(Search.SearchSettings.Quality, Search.SearchCycles);
+
+	//A forced search this frame supersedes the result
+	if(bForcePoseSearch)
+	{
+		return;
+	}
+
+	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+	const int32 LowestPoseId = Search.MotionData == CurrentMotionData
+		? ResolveDeferredSearchPoseId(CurrentMotionData, Search.Result, Search.NaturalPoseId) : INDEX_NONE;
+	const bool bStale = !IsDeferredSearchResultValid(CurrentMotionData, Search.TagSectionIndex, LowestPoseId);
+
+	if(CVarMMSearchAsyncLatencyStats.GetValueOnAnyThread() > 0)
+	{
+		RecordAsyncSearchLatency(Search, bStale);
 	}
+
+	if(bStale)
+	{
+		TimeSinceMotionUpdate = FMath::Max(TimeSinceMotionUpdate, UpdateInterval);
+		return;
+	}
+
+	RecordSearchStatistics(Search.Result);
+	SearchTrace.NaturalPoseId = Search.NaturalPoseId;
+	TransitionToSearchedPose(LowestPoseId, Context);
+}
+
+void FAnimNode_MSMotionMatching::WaitForAsyncSearch()
+{
+	if(AsyncSearch.IsValid())
+	{
+		AsyncSearch->Task.Wait();
+	}
+}
+
+void FAnimNode_MSMotionMatching::RecordAsyncSearchLatency(const FAsyncPoseSearch& InSearch, const bool bInStale)
+{
+	++AsyncStatsSearchCount;
+	AsyncStatsStaleCount += bInStale ? 1 : 0;
+	AsyncStatsFrames += GFrameCounter - InSearch.SubmitFrame;
+	AsyncStatsLatencyCycles += FPlatformTime::Cycles64() - InSearch.SubmitCycles;
+	AsyncStatsSearchCycles += InSearch.SearchCycles;
+
+	const int32 ReportInterval = FMath::Max(CVarMMSearchAsyncLatencyStats.GetValueOnAnyThread(), 1);
+	if(AsyncStatsSearchCount < ReportInterval)
+	{
+		return;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Motion Matching Async Search (%s): %d searches, %.2f frames and %.3f ms average latency, %.3f ms average search time, %d stale results discarded"),
+		InSearch.MotionData ? *InSearch.MotionData->GetName() : TEXT("None"), AsyncStatsSearchCount,
+		static_cast<double>(AsyncStatsFrames) / AsyncStatsSearchCount,
+		FPlatformTime::ToMilliseconds64(AsyncStatsLatencyCycles) / AsyncStatsSearchCount,
+		FPlatformTime::ToMilliseconds64(AsyncStatsSearchCycles) / AsyncStatsSearchCount,
+		AsyncStatsStaleCount);
+
+	AsyncStatsSearchCount = 0;
+	AsyncStatsStaleCount = 0;
+	AsyncStatsFrames = 0;
+	AsyncStatsLatencyCycles = 0;
+	AsyncStatsSearchCycles = 0;
+}
+
+int32 FAnimNode_MSMotionMatching::ResolveDeferredSearchPoseId(const UMotionDataAsset* InMotionData,
+	const FPoseSearchResult& InResult, const int32 InNaturalPoseId) const
+{
+	if(InResult.IsValid())
+	{
+		return InMotionData->MatrixPoseIdToDatabasePoseId(InResult.PoseId);
+	}
+
+	return InNaturalPoseId != INDEX_NONE ? InNaturalPoseId : InMotionData->MatrixPoseIdToDatabasePoseId(0);
+}
+
+bool FAnimNode_MSMotionMatching::IsDeferredSearchResultValid(const UMotionDataAsset* InMotionData, const int32 InSectionIndex,
+	const int32 InPoseId)
+{
+	//The result is stale if the required motion tags changed to another section since the search was submitted, or if
+	//the motion data was re-processed so that the pose is no longer usable
+	if(!InMotionData
+		|| !InMotionData->PoseHotTable.AnimIds.IsValidIndex(InPoseId)
+		|| ResolveRequiredMotionTags().ExactSectionIndex != InSectionIndex)
+	{
+		return false;
+	}
+
+	const FPoseHotTable& PoseTable = InMotionData->PoseHotTable;
+	return PoseTable.GetSearchFlag(InPoseId) != EPoseSearchFlag::DoNotUse
+		&& SectionHasRequiredMotionTags(PoseTable.GetTagSectionIndex(InPoseId));
+}
+
+bool FAnimNode_MSMotionMatching::ComputeNaturalCostToBeat(const UMotionDataAsset* InMotionData, int32& OutNaturalPoseId,
+	float& OutCostToBeat, FPoseSearchTopK* OutNextNaturalCandidates)
+{
+	OutNaturalPoseId = INDEX_NONE;
+	OutCostToBeat = UE_MAX_FLT;
+	
+	if(bForcePoseSearch)
+	{
+		return false;
+	}
+
+	//Check cost of current pose first for "Favour Current Pose"
+	if(bFavourCurrentPose)
+	{
+		const int32 AtomCount = InMotionData->LookupPoseMatrix.AtomCount;
+		const float* PoseRow = &InMotionData->LookupPoseMatrix.PoseArray[CurrentInterpolatedPose.PoseId * AtomCount];
+		const float PoseFavour = PoseRow[0]; //Pose cost multiplier is the first atom of a pose array
+
+		OutCostToBeat = FMotionMatchingSearch::ComputePoseCost(PoseRow, CurrentInterpolatedPoseArray.GetData(),
+			CalibrationWeights, AtomCount) * PoseFavour * CurrentPoseFavour;
+	}
+
+	//Next Natural
+	OutNaturalPoseId = GetLowestCostNextNaturalId(CurrentInterpolatedPose.PoseId, OutCostToBeat, InMotionData,
+		OutNextNaturalCandidates); //The returned pose id is in lookup matrix space
+	SearchTrace.NaturalPoseId = OutNaturalPoseId;
+
+	return bNextNaturalToleranceTest
+		&& NextPoseToleranceTest(OutNaturalPoseId);
 }
 
 void FAnimNode_MSMotionMatching::TransitionPoseSearch(const FAnimationUpdateContext& Context)
@@ -516,9 +982,10 @@ bool FAnimNode_MSMotionMatching::CheckForcePoseSearch(const UMotionDataAsset* In
 		return false;
 	}
 	
+	const FPoseHotTable& PoseTable = InMotionData->PoseHotTable;
 	if(bUserForcePoseSearch
 		|| CurrentInterpolatedPose.SearchFlag == EPoseSearchFlag::DoNotUse
-		|| !CurrentInterpolatedPose.MotionTags.HasAllExact(RequiredMotionTags))
+		|| !SectionHasRequiredMotionTags(PoseTable.GetTagSectionIndex(CurrentInterpolatedPose.PoseId)))
 	{
 		return true;
 	}
@@ -533,7 +1000,7 @@ bool FAnimNode_MSMotionMatching::CheckForcePoseSearch(const UMotionDataAsset* In
 	const int32 PoseCountToCheck = CurrentInterpolatedPose.PoseId + FMath::CeilToInt32(BlendTime / InMotionData->GetPoseInterval());
 
 	//End of pose data, pose search must be forced
-	if(PoseCountToCheck >= InMotionData->Poses.Num())
+	if(PoseCountToCheck >= PoseTable.Num())
 	{
 		return true;
 	}
@@ -541,11 +1008,9 @@ bool FAnimNode_MSMotionMatching::CheckForcePoseSearch(const UMotionDataAsset* In
 	//Check ahead to see if there will be a DoNotUse pose within the blend time or a new animation
 	for(int32 i = CurrentInterpolatedPose.PoseId; i < PoseCountToCheck; ++i)
 	{
-		const FPoseMotionData& ThisPose = InMotionData->Poses[i];
-		
-		if(ThisPose.SearchFlag == EPoseSearchFlag::DoNotUse
-			|| ThisPose.AnimId != CurrentInterpolatedPose.AnimId
-			|| ThisPose.AnimType != CurrentInterpolatedPose.AnimType)
+		if(PoseTable.GetSearchFlag(i) == EPoseSearchFlag::DoNotUse
+			|| PoseTable.AnimIds[i] != CurrentInterpolatedPose.AnimId
+			|| PoseTable.GetAnimType(i) != CurrentInterpolatedPose.AnimType)
 		{
 			return true;
 		}
@@ -567,84 +1032,15 @@ int32 FAnimNode_MSMotionMatching::GetLowestCostPoseId_Transition()
 	
 	//Main Loop Search
 	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
-	// int32 PoseCount = CurrentMotionData->SearchPoseMatrix.PoseCount;
-	const int32 AtomCount = CurrentMotionData->SearchPoseMatrix.AtomCount;
-	
-	int32 LowestPoseId_SM = 0;
-	float LowestCost = 10000000.0f;
 
-	int32 MotionTagStartPoseIndex;
-	int32 MotionTagEndPoseIndex;
-	CurrentMotionData->FindMotionTagRangeIndices(RequiredMotionTags, MotionTagStartPoseIndex, MotionTagEndPoseIndex);
-	const int32 OuterAABBStartIndex = FMath::FloorToInt32(MotionTagStartPoseIndex / 64.0f);
-	const int32 OuterAABBEndIndex = FMath::CeilToInt32(MotionTagEndPoseIndex / 64.0f);
-	const TArray<float>& OuterAABBArray = CurrentMotionData->PoseAABBMatrix_Outer.ExtentsArray;
-	const TArray<float>& InnerAABBArray = CurrentMotionData->PoseAABBMatrix_Inner.ExtentsArray;
-	const TArray<float>& PoseArray = CurrentMotionData->SearchPoseMatrix.PoseArray;
-	for(int32 OuterAABBIndex = OuterAABBStartIndex; OuterAABBIndex < OuterAABBEndIndex; ++OuterAABBIndex)
-	{
-		const int32 OuterAABBAtomStartIndex = OuterAABBIndex * AtomCount * 2;
-		
-		float AABBCost = 0.0f;
-		for(int32 DimIndex = 1; DimIndex < AtomCount; ++DimIndex)
-		{
-			const int32 OuterAABBAtomIndex = OuterAABBAtomStartIndex + (DimIndex * 2);
+	FPoseSearchQuery Query(CurrentInterpolatedPoseArray.GetData(), CalibrationWeights, 0, 0);
+	Query.EvaluationOrder = GetFeatureEvaluationOrder();
+	CurrentMotionData->GetMotionTagSectionRange(ResolveRequiredMotionTags().SectionIndex, Query.StartPoseIndex, Query.EndPoseIndex);
 
-			const float ClosestPoint = FMath::Clamp(CurrentInterpolatedPoseArray[DimIndex],
-			                                        OuterAABBArray[OuterAABBAtomIndex],
-			                                        OuterAABBArray[OuterAABBAtomIndex + 1]);
+	FPoseSearchResult SearchResult;
+	FMotionMatchingSearch::SearchAABB(CurrentMotionData, Query, SearchResult);
 
-			AABBCost += FMath::Abs(CurrentInterpolatedPoseArray[DimIndex] - ClosestPoint) * CalibrationArray[DimIndex - 1];
-		}
-
-		if(AABBCost < LowestCost)
-		{
-			//We need to search the inner AABBs
-			const int32 InnerAABBStartIndex = OuterAABBIndex * 4;
-			const int32 InnerAABBEndIndex = FMath::Min(InnerAABBStartIndex + 4, FMath::CeilToInt32(MotionTagEndPoseIndex / 16.0f));
-			for(int32 InnerAABBIndex = InnerAABBStartIndex; InnerAABBIndex < InnerAABBEndIndex; ++InnerAABBIndex)
-			{
-				const int32 InnerAABBAtomStartIndex = InnerAABBIndex * AtomCount * 2;
-
-				AABBCost = 0.0f;
-				for(int32 DimIndex = 1; DimIndex < AtomCount; ++DimIndex)
-				{
-					const int32 InnerAABBAtomIndex = InnerAABBAtomStartIndex + (DimIndex * 2);
-
-					const float ClosestPoint = FMath::Clamp(CurrentInterpolatedPoseArray[DimIndex],
-															InnerAABBArray[InnerAABBAtomIndex],
-															InnerAABBArray[InnerAABBAtomIndex + 1]);
-
-					AABBCost += FMath::Abs(CurrentInterpolatedPoseArray[DimIndex] - ClosestPoint) * CalibrationArray[DimIndex - 1];
-				}
-
-				if(AABBCost < LowestCost)
-				{
-					const int32 StartPoseIndex = FMath::Max(InnerAABBIndex * 16, MotionTagStartPoseIndex);
-					const int32 EndPoseIndex = FMath::Min((InnerAABBIndex * 16) + 16, MotionTagEndPoseIndex);
-					for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
-					{
-						float Cost = 0.0f;
-						const int32 MatrixStartIndex = PoseIndex * AtomCount;
-						const float PoseFavour = PoseArray[MatrixStartIndex]; //Pose cost multiplier is the first atom of a pose array
-						for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
-						{
-							Cost += FMath::Abs(PoseArray[MatrixStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-									* CalibrationArray[AtomIndex - 1] * PoseFavour; 
-						}
-						
-						if(Cost < LowestCost)
-						{
-							LowestCost = Cost;
-							LowestPoseId_SM = PoseIndex;
-						}
-					}
-				}
-			}
-		}
-	}
-
-	return CurrentMotionData->MatrixPoseIdToDatabasePoseId(LowestPoseId_SM);
+	return CurrentMotionData->MatrixPoseIdToDatabasePoseId(SearchResult.IsValid() ? SearchResult.PoseId : 0);
 }
 
 /*----------XC: Brute Search----------*/
@@ -658,343 +1054,241 @@ int32 FAnimNode_MSMotionMatching::GetLowestCostPoseId_Brute()
 	bool bNextNaturalChosen = false;
 
 	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
-	const int32 AtomCount = CurrentMotionData->SearchPoseMatrix.AtomCount;
+	const int32 AtomCount = CurrentMotionData->LookupPoseMatrix.AtomCount;
 	const TArray<float>& LookupPoseArray = CurrentMotionData->LookupPoseMatrix.PoseArray;
+	FPoseSearchTopK NextNaturalCandidates(MaxPoseSearchCandidates);
 
 	//Check cost of current pose first for "Favour Current Pose"
 	int32 LowestPoseId_LM = 0; //_LM stands for Lookup Matrix
-	int32 LowestPoseId_SM = 0; //_SM stands for Search Matrix
 	float LowestCost = UE_MAX_FLT;
 	if (!bForcePoseSearch)
 	{
 		if (bFavourCurrentPose)
 		{
 			LowestPoseId_LM = CurrentInterpolatedPose.PoseId;
-			const int32 PoseStartIndex = LowestPoseId_LM * AtomCount;
-			const float PoseFavour = LookupPoseArray[PoseStartIndex]; //Pose cost multiplier is the first atom of a pose array
+			const float* PoseRow = &LookupPoseArray[LowestPoseId_LM * AtomCount];
+			const float PoseFavour = PoseRow[0]; //Pose cost multiplier is the first atom of a pose array
 
-			for (int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
-			{
-				LowestCost += FMath::Abs(LookupPoseArray[PoseStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-					* CalibrationArray[AtomIndex - 1];
-			}
-			LowestCost *= PoseFavour;
-			LowestCost *= CurrentPoseFavour;
+			LowestCost = FMotionMatchingSearch::ComputePoseCost(PoseRow, CurrentInterpolatedPoseArray.GetData(),
+				CalibrationWeights, AtomCount) * PoseFavour * CurrentPoseFavour;
 		}
 
 		//Next Natural
 		bNextNaturalChosen = true;
-		LowestPoseId_LM = GetLowestCostNextNaturalId(CurrentInterpolatedPose.PoseId, LowestCost, CurrentMotionData); //The returned pose id is in lookup matrix space
+		LowestPoseId_LM = GetLowestCostNextNaturalId(CurrentInterpolatedPose.PoseId, LowestCost, CurrentMotionData,
+			DebugInfo ? &NextNaturalCandidates : nullptr); //The returned pose id is in lookup matrix space
+		SearchTrace.NaturalPoseId = LowestPoseId_LM;
 
 		if (bNextNaturalToleranceTest)
 		{
-			const FPoseMotionData& NextNaturalPose = CurrentMotionData->Poses[LowestPoseId_LM];
-
-			if (NextPoseToleranceTest(NextNaturalPose))
+			if (NextPoseToleranceTest(LowestPoseId_LM))
 			{
 				return LowestPoseId_LM;
 			}
 		}
-
-		LowestPoseId_SM = CurrentMotionData->DatabasePoseIdToMatrixPoseId(LowestPoseId_LM);
 	}
 
-	/*-------------xc: for CandidateCostPoses--------------*/
-	TArray<FPoseCostInfo> LowestPoses;
+	FPoseSearchQuery Query(CurrentInterpolatedPoseArray.GetData(), CalibrationWeights, 0, 0);
+	Query.EvaluationOrder = GetFeatureEvaluationOrder();
+	CurrentMotionData->GetMotionTagSectionRange(ResolveRequiredMotionTags().ExactSectionIndex, Query.StartPoseIndex, Query.EndPoseIndex);
+
+	FPoseSearchResult SearchResult = CreateSearchResult(LowestCost);
+	SearchPoseMatrix(CurrentMotionData, Query, 0.0f, SearchResult);
+	RecordSearchStatistics(SearchResult);
 
-	const TArray<float>& PoseArray = CurrentMotionData->SearchPoseMatrix.PoseArray;
-	int32 MotionTagStartPoseIndex;
-	int32 MotionTagEndPoseIndex;
-	CurrentMotionData->GetMotionTagStartAndEndPoseIndex(RequiredMotionTags, MotionTagStartPoseIndex, MotionTagEndPoseIndex);
 	/*------------XC: Get Searchable Poses Count-----------*/
-	if (DebugInfo) {
-		DebugInfo->TotalPoses = MotionTagEndPoseIndex - MotionTagStartPoseIndex;
-		DebugInfo->SearchCount = DebugInfo->TotalPoses;
-	}
-
-	for (int32 PoseIndex = MotionTagStartPoseIndex; PoseIndex < MotionTagEndPoseIndex; ++PoseIndex) {
-		float Cost = 0.0f;
-		const int32 MatrixStartIndex = PoseIndex * AtomCount;
-		const float PoseFavour = PoseArray[MatrixStartIndex]; //Pose cost multiplier is the first atom of a pose array
-
-		/*-------------------XC:Get every feature's cost----------------*/
-		TArray<float> SingleFeatureCost;
-		TArray<int> SingleFeatureSize;
-		int32 FeatureCostIndex = 0;
-		int32 FeatureSizeIndex = 0;
-
-		TArray<TObjectPtr<UMatchFeatureBase>> CurrentFeatures = MotionData->MotionMatchConfig->Features;
-		for (UMatchFeatureBase* MatchFeature : CurrentFeatures) {
-			if (MatchFeature) {
-				SingleFeatureCost.Add(0.0f);
-				SingleFeatureSize.Add(MatchFeature->Size());
-			}
-		}
+	if (DebugInfo)
+	{
+		DebugInfo->TotalPoses = Query.EndPoseIndex - Query.StartPoseIndex;
+		DebugInfo->SearchCount = SearchResult.PosesChecked;
+		UpdateLowestPoses(CurrentMotionData, NextNaturalCandidates, SearchResult.TopK);
+	}
 
-		for (int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
-		{
-			float  AtomCost = FMath::Abs(PoseArray[MatrixStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-				* CalibrationArray[AtomIndex - 1];
+	ResolveSearchCandidates(CurrentMotionData, SearchResult);
 
-			Cost += AtomCost;
+	if (SearchResult.IsValid())
+	{
+		return CurrentMotionData->MatrixPoseIdToDatabasePoseId(SearchResult.PoseId);
+	}
 
-			/*-----------XC:Get single feature's cost-----------*/
-			if (FeatureSizeIndex >= SingleFeatureSize[FeatureCostIndex]) {
-				FeatureCostIndex++;
-				SingleFeatureCost[FeatureCostIndex] += AtomCost;
-				FeatureSizeIndex = 0;
-			}
-			else {
-				FeatureSizeIndex++;
-				SingleFeatureCost[FeatureCostIndex] += AtomCost;
-			}
-		}
+	return bNextNaturalChosen ? LowestPoseId_LM : CurrentMotionData->MatrixPoseIdToDatabasePoseId(0);
+}
 
-		TMap<FName, float> FeatureCostMap;
-		for (int32 i = 0; i < CurrentFeatures.Num(); i++) {
-			FeatureCostMap.Add(CurrentFeatures[i]->GetFeatureName(), SingleFeatureCost[i]);
-		}
+/** STANDARD QUALITY POSE SEARCH*/
+int32 FAnimNode_MSMotionMatching::GetLowestCostPoseId_Standard()
+{
+	if(!GenerateCalibrationArray())
+	{
+		return CurrentChosenPoseId;
+	}
 
-		Cost *= PoseFavour;
-		if (Cost < LowestCost)
-		{
-			bNextNaturalChosen = false;
-			LowestCost = Cost;
-			LowestPoseId_SM = PoseIndex;
-
-			/*-----------XC:Get Top 5 Lowest Cost PoseID-------------*/
-			if (DebugInfo) {
-				UpdateLowestPoses(CurrentMotionData, LowestPoseId_SM, PoseFavour, Cost, FeatureCostMap, LowestPoses);
-				DebugInfo->LowestCostCandidates = LowestPoses;
-			}
-		}
+	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+	FPoseSearchTopK NextNaturalCandidates(MaxPoseSearchCandidates);
+	
+	int32 LowestPoseId_LM; //_LM stands for Lookup Matrix
+	float LowestCost;
+	if(ComputeNaturalCostToBeat(CurrentMotionData, LowestPoseId_LM, LowestCost, DebugInfo ? &NextNaturalCandidates : nullptr))
+	{
+		return LowestPoseId_LM;
 	}
 
-#if WITH_EDITORONLY_DATA
-	RecordHistoricalPoseSearch(PosesChecked);
-#endif
+	//Search the tag section of the search matrix, pruning with the outer and inner AABBs, the search tree, the lookup table
+	//or the compressed search matrix
+	FPoseSearchQuery Query(CurrentInterpolatedPoseArray.GetData(), CalibrationWeights, 0, 0);
+	Query.EvaluationOrder = GetFeatureEvaluationOrder();
+	CurrentMotionData->GetMotionTagSectionRange(ResolveRequiredMotionTags().ExactSectionIndex, Query.StartPoseIndex, Query.EndPoseIndex);
+
+	FPoseSearchResult SearchResult = CreateSearchResult(LowestCost);
+	SearchPoseMatrix(CurrentMotionData, Query, 0.0f, SearchResult);
+	RecordSearchStatistics(SearchResult);
 
-	if (bNextNaturalChosen)
+	/*------------XC: Get Searchable Poses Count-----------*/
+	if (DebugInfo)
 	{
-		return LowestPoseId_LM;
+		DebugInfo->TotalPoses = Query.EndPoseIndex - Query.StartPoseIndex;
+		DebugInfo->SearchCount = SearchResult.PosesChecked;
+		UpdateLowestPoses(CurrentMotionData, NextNaturalCandidates, SearchResult.TopK);
 	}
-	else
+
+	ResolveSearchCandidates(CurrentMotionData, SearchResult);
+
+	if(SearchResult.IsValid())
 	{
-		return CurrentMotionData->MatrixPoseIdToDatabasePoseId(LowestPoseId_SM);
+		return CurrentMotionData->MatrixPoseIdToDatabasePoseId(SearchResult.PoseId);
 	}
+
+	return LowestPoseId_LM != INDEX_NONE ? LowestPoseId_LM : CurrentMotionData->MatrixPoseIdToDatabasePoseId(0);
 }
 
-/** STANDARD QUALITY POSE SEARCH*/
-int32 FAnimNode_MSMotionMatching::GetLowestCostPoseId_Standard()
+FPoseSearchQualitySettings FAnimNode_MSMotionMatching::GetSearchQualitySettings(const float DeltaTime) const
 {
-	if(!GenerateCalibrationArray())
-	{
-		return CurrentChosenPoseId;
-	}
+	FPoseSearchQualitySettings Settings;
+	Settings.Quality = SearchQuality;
+	Settings.TreeEpsilon = SearchTreeEpsilon;
+	Settings.CompressedRerankCount = CompressedRerankCount;
+	Settings.Stages = &SearchStages;
+	Settings.StagedCandidateCount = HighQualityCandidateCount;
+	Settings.DeltaTime = DeltaTime;
+	return Settings;
+}
 
-	bool bNextNaturalChosen = false;
+void FAnimNode_MSMotionMatching::SearchPoseMatrix(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	const float DeltaTime, FPoseSearchResult& InOutResult)
+{
+	//The tree and lookup table are separated per motion tag section so the section of the query range is needed
+	const int32 SectionIndex = SearchQuality == EMotionMatchingSearchQuality::Tree || SearchQuality == EMotionMatchingSearchQuality::CandidateLookup
+		? InMotionData->GetMotionTagSectionIndex(Query.StartPoseIndex, Query.EndPoseIndex) : INDEX_NONE;
 
-	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
-	const int32 AtomCount = CurrentMotionData->SearchPoseMatrix.AtomCount;
-	const TArray<float>& LookupPoseArray = CurrentMotionData->LookupPoseMatrix.PoseArray;
-	
-	//Check cost of current pose first for "Favour Current Pose"
-	int32 LowestPoseId_LM = 0; //_LM stands for Lookup Matrix
-	int32 LowestPoseId_SM = 0; //_SM stands for Search Matrix
-	float LowestCost = UE_MAX_FLT;
-	if(!bForcePoseSearch)
+	const float CostToBeat = InOutResult.Cost;
+	const EMotionMatchingSearchQuality SearchedQuality = FMotionMatchingSearch::SearchWithQuality(InMotionData, Query,
+		GetSearchQualitySettings(DeltaTime), SectionIndex, CurrentInterpolatedPose.PoseId, SearchScratch, InOutResult);
+
+	switch(SearchedQuality)
 	{
-		if(bFavourCurrentPose)
+		case EMotionMatchingSearchQuality::Tree:
 		{
-			LowestPoseId_LM = CurrentInterpolatedPose.PoseId;
-			const int32 PoseStartIndex = LowestPoseId_LM * AtomCount;
-			const float PoseFavour = LookupPoseArray[PoseStartIndex]; //Pose cost multiplier is the first atom of a pose array
-
-			for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+			const int32 CompareTreeLevel = CVarMMSearchCompareTree.GetValueOnAnyThread();
+			if(CompareTreeLevel <= 0)
 			{
-				LowestCost += FMath::Abs(LookupPoseArray[PoseStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-					* CalibrationArray[AtomIndex - 1];
+				break;
 			}
-			LowestCost *= PoseFavour;
-			LowestCost *= CurrentPoseFavour;
-		}
 
-		//Next Natural
-		bNextNaturalChosen = true;
-		LowestPoseId_LM = GetLowestCostNextNaturalId(CurrentInterpolatedPose.PoseId, LowestCost, CurrentMotionData); //The returned pose id is in lookup matrix space
-	
-		if(bNextNaturalToleranceTest)
-		{
-			const FPoseMotionData& NextNaturalPose = CurrentMotionData->Poses[LowestPoseId_LM];
-		
-			if(NextPoseToleranceTest(NextNaturalPose))
+			FPoseSearchResult AABBResult(CostToBeat);
+			FMotionMatchingSearch::SearchAABB(InMotionData, Query, AABBResult);
+
+			if(CompareTreeLevel == 1
+				|| AABBResult.Cost != InOutResult.Cost)
 			{
-				return LowestPoseId_LM;
+				UE_LOG(LogTemp, Log, TEXT("Motion Matching Tree Search (%s, section %d, %d poses): Tree visited %d poses (%d / %d nodes) cost %f, AABB visited %d poses (%d / %d inner AABBs) cost %f"),
+					*InMotionData->GetName(), SectionIndex, Query.EndPoseIndex - Query.StartPoseIndex,
+					InOutResult.PosesChecked, InOutResult.TreeNodesPassed, InOutResult.TreeNodesChecked, InOutResult.Cost,
+					AABBResult.PosesChecked, AABBResult.InnerAABBsPassed, AABBResult.InnerAABBsChecked, AABBResult.Cost);
 			}
+			break;
 		}
-	
-		LowestPoseId_SM = CurrentMotionData->DatabasePoseIdToMatrixPoseId(LowestPoseId_LM);
-	}
-
-#if WITH_EDITORONLY_DATA		
-	PosesChecked = InnerAABBsChecked = InnerAABBsPassed = OuterAABBsChecked = OuterAABBsPassed = 0;
-#endif
-	/*-------------xc: for CandidateCostPoses--------------*/
-	TArray<FPoseCostInfo> LowestPoses;
-
-	//First go through the OuterAABBs
-	int32 MotionTagStartPoseIndex;
-	int32 MotionTagEndPoseIndex;
-	CurrentMotionData->GetMotionTagStartAndEndPoseIndex(RequiredMotionTags, MotionTagStartPoseIndex, MotionTagEndPoseIndex);
-	
-	const int32 OuterAABBStartIndex = FMath::FloorToInt32(MotionTagStartPoseIndex / 64.0f);
-	const int32 OuterAABBEndIndex = FMath::CeilToInt32(MotionTagEndPoseIndex / 64.0f);
-	const TArray<float>& OuterAABBArray = CurrentMotionData->PoseAABBMatrix_Outer.ExtentsArray;
-	const TArray<float>& InnerAABBArray = CurrentMotionData->PoseAABBMatrix_Inner.ExtentsArray;
-	const TArray<float>& PoseArray = CurrentMotionData->SearchPoseMatrix.PoseArray;
-	for(int32 OuterAABBIndex = OuterAABBStartIndex; OuterAABBIndex < OuterAABBEndIndex; ++OuterAABBIndex)
-	{
-#if WITH_EDITORONLY_DATA	
-		++OuterAABBsChecked;
-#endif
-		
-		const int32 OuterAABBAtomStartIndex = OuterAABBIndex * AtomCount * 2;
-		
-		float AABBCost = 0.0f;
-		for(int32 DimIndex = 1; DimIndex < AtomCount; ++DimIndex)
+		case EMotionMatchingSearchQuality::CandidateLookup:
 		{
-			const int32 OuterAABBAtomIndex = OuterAABBAtomStartIndex + (DimIndex * 2);
-
-			const float ClosestPoint = FMath::Clamp(CurrentInterpolatedPoseArray[DimIndex],
-			                                        OuterAABBArray[OuterAABBAtomIndex],
-			                                        OuterAABBArray[OuterAABBAtomIndex + 1]);
-
-			AABBCost += FMath::Abs(CurrentInterpolatedPoseArray[DimIndex] - ClosestPoint) * CalibrationArray[DimIndex - 1];
+			if(CVarMMSearchCompareLookupTable.GetValueOnAnyThread() > 0)
+			{
+				CompareLookupTableSearch(InMotionData, Query, InOutResult, CostToBeat);
+			}
+			break;
 		}
-
-		if(AABBCost < LowestCost)
+		case EMotionMatchingSearchQuality::Performance:
 		{
-#if WITH_EDITORONLY_DATA	
-			++OuterAABBsPassed;
-#endif
-			
-			//We need to search the inner AABBs
-
-			const int32 InnerAABBStartIndex = OuterAABBIndex * 4;
-			const int32 InnerAABBEndIndex = FMath::Min(InnerAABBStartIndex + 4, FMath::CeilToInt32(MotionTagEndPoseIndex / 16.0f));
-			for(int32 InnerAABBIndex = InnerAABBStartIndex; InnerAABBIndex < InnerAABBEndIndex; ++InnerAABBIndex)
+			if(CVarMMSearchAABBLevelStats.GetValueOnAnyThread() > 0
+				&& InOutResult.LevelBoxesChecked[0] > 0)
 			{
-#if WITH_EDITORONLY_DATA	
-				++InnerAABBsChecked;
-#endif
-				
-				const int32 InnerAABBAtomStartIndex = InnerAABBIndex * AtomCount * 2;
+				RecordAABBLevelStatistics(InMotionData, InOutResult);
+			}
+			break;
+		}
+		default: break;
+	}
+}
 
-				AABBCost = 0.0f;
-				for(int32 DimIndex = 1; DimIndex < AtomCount; ++DimIndex)
-				{
-					const int32 InnerAABBAtomIndex = InnerAABBAtomStartIndex + (DimIndex * 2);
+void FAnimNode_MSMotionMatching::CompareLookupTableSearch(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	const FPoseSearchResult& InLookupResult, const float InCostToBeat)
+{
+	FPoseSearchResult FullResult(InCostToBeat);
+	FMotionMatchingSearch::SearchBrute(InMotionData, Query, FullResult);
 
-					const float ClosestPoint = FMath::Clamp(CurrentInterpolatedPoseArray[DimIndex],
-															InnerAABBArray[InnerAABBAtomIndex],
-															InnerAABBArray[InnerAABBAtomIndex + 1]);
+	//The lowest cost found by either search, including the cost to beat (e.g. the next natural pose)
+	const float LookupCost = FMath::Min(InLookupResult.Cost, InCostToBeat);
+	const float FullCost = FMath::Min(FullResult.Cost, InCostToBeat);
 
-					AABBCost += FMath::Abs(CurrentInterpolatedPoseArray[DimIndex] - ClosestPoint) * CalibrationArray[DimIndex - 1];
-				}
+	++LookupCompareSearchCount;
+	LookupCompareMatchCount += InLookupResult.PoseId == FullResult.PoseId ? 1 : 0;
+	LookupComparePosesChecked += InLookupResult.PosesChecked;
+	LookupCompareFullPosesChecked += FullResult.PosesChecked;
+	LookupCompareCostRatioSum += FullCost > UE_SMALL_NUMBER ? LookupCost / FullCost : 1.0;
 
-				if(AABBCost < LowestCost)
-				{
-#if WITH_EDITORONLY_DATA	
-					++InnerAABBsPassed;
-#endif
-					
-					const int32 StartPoseIndex = FMath::Max(InnerAABBIndex * 16, MotionTagStartPoseIndex);
-					const int32 EndPoseIndex = FMath::Min((InnerAABBIndex * 16) + 16, MotionTagEndPoseIndex);
-					/*------------XC: Get Searchable Poses Count-----------*/
-					if (DebugInfo) {
-						DebugInfo->TotalPoses = MotionTagEndPoseIndex - MotionTagStartPoseIndex;
-						DebugInfo->SearchCount = EndPoseIndex - StartPoseIndex;
-					}
+	const int32 ReportInterval = FMath::Max(CVarMMSearchCompareLookupTable.GetValueOnAnyThread(), 1);
+	if(LookupCompareSearchCount >= ReportInterval)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Motion Matching Candidate Lookup (%s): %d searches, %.1f%% found the lowest cost pose, average cost %.3fx the lowest cost, %.1f poses checked per search vs %.1f for a full search"),
+			*InMotionData->GetName(), LookupCompareSearchCount, 100.0 * LookupCompareMatchCount / LookupCompareSearchCount,
+			LookupCompareCostRatioSum / LookupCompareSearchCount, static_cast<double>(LookupComparePosesChecked) / LookupCompareSearchCount,
+			static_cast<double>(LookupCompareFullPosesChecked) / LookupCompareSearchCount);
 
-					for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
-					{
-#if WITH_EDITORONLY_DATA	
-						++PosesChecked;
-#endif
-						
-						float Cost = 0.0f;
-						const int32 MatrixStartIndex = PoseIndex * AtomCount;
-						const float PoseFavour = PoseArray[MatrixStartIndex]; //Pose cost multiplier is the first atom of a pose array
-						
-						/*-------------------XC:Get every feature's cost----------------*/
-						TArray<float> SingleFeatureCost;
-						TArray<int> SingleFeatureSize;
-						int32 FeatureCostIndex = 0;
-						int32 FeatureSizeIndex = 0;
-
-						TArray<TObjectPtr<UMatchFeatureBase>> CurrentFeatures = MotionData->MotionMatchConfig->Features;
-						for (UMatchFeatureBase* MatchFeature : CurrentFeatures) {
-							if (MatchFeature) {
-								SingleFeatureCost.Add(0.0f);
-								SingleFeatureSize.Add(MatchFeature->Size());
-							}
-						}
-
-						for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
-						{
-							float  AtomCost = FMath::Abs(PoseArray[MatrixStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-								* CalibrationArray[AtomIndex - 1];
-
-							Cost += AtomCost;
-
-							/*-----------XC:Get single feature's cost-----------*/
-							if (FeatureSizeIndex >= SingleFeatureSize[FeatureCostIndex]) {
-								FeatureCostIndex++;
-								SingleFeatureCost[FeatureCostIndex] += AtomCost;
-								FeatureSizeIndex = 0;
-							}
-							else {
-								FeatureSizeIndex++;
-								SingleFeatureCost[FeatureCostIndex] += AtomCost;
-							}
-						}
-
-						TMap<FName, float> FeatureCostMap;
-						for (int32 i = 0; i < CurrentFeatures.Num(); i++) {
-							FeatureCostMap.Add(CurrentFeatures[i]->GetFeatureName(), SingleFeatureCost[i]);
-						}
-						
-						Cost *= PoseFavour;
-						if(Cost < LowestCost)
-						{
-							bNextNaturalChosen = false;
-							LowestCost = Cost;
-							LowestPoseId_SM = PoseIndex;
-
-							/*-----------XC:Get Top 5 Lowest Cost PoseID-------------*/
-							if (DebugInfo) {
-								UpdateLowestPoses(CurrentMotionData, LowestPoseId_SM, PoseFavour, Cost, FeatureCostMap, LowestPoses);
-								DebugInfo->LowestCostCandidates = LowestPoses;
-							}
-						}
-					}
-				}
-			}
-		}
+		LookupCompareSearchCount = LookupCompareMatchCount = 0;
+		LookupComparePosesChecked = LookupCompareFullPosesChecked = 0;
+		LookupCompareCostRatioSum = 0.0;
 	}
+}
 
-#if WITH_EDITORONLY_DATA
-	RecordHistoricalPoseSearch(PosesChecked);
-#endif
+void FAnimNode_MSMotionMatching::RecordAABBLevelStatistics(const UMotionDataAsset* InMotionData, const FPoseSearchResult& InSearchResult)
+{
+	++AABBLevelStatsSearchCount;
+	AABBLevelStatsPosesChecked += InSearchResult.PosesChecked;
+	for(int32 Level = 0; Level < FPoseAABBHierarchy::MaxLevelCount; ++Level)
+	{
+		AABBLevelBoxesChecked[Level] += InSearchResult.LevelBoxesChecked[Level];
+		AABBLevelBoxesPassed[Level] += InSearchResult.LevelBoxesPassed[Level];
+	}
 
-	if(bNextNaturalChosen)
+	const int32 ReportInterval = FMath::Max(CVarMMSearchAABBLevelStats.GetValueOnAnyThread(), 1);
+	if(AABBLevelStatsSearchCount < ReportInterval)
 	{
-		return LowestPoseId_LM;
+		return;
 	}
-	else
+
+	FString LevelReport;
+	for(int32 Level = 0; Level < FPoseAABBHierarchy::MaxLevelCount && AABBLevelBoxesChecked[Level] > 0; ++Level)
 	{
-		return CurrentMotionData->MatrixPoseIdToDatabasePoseId(LowestPoseId_SM);
+		LevelReport += FString::Printf(TEXT(", level %d: %.1f boxes tested (%.1f%% passed)"), Level,
+			static_cast<double>(AABBLevelBoxesChecked[Level]) / AABBLevelStatsSearchCount,
+			100.0 * AABBLevelBoxesPassed[Level] / AABBLevelBoxesChecked[Level]);
 	}
+
+	UE_LOG(LogTemp, Log, TEXT("Motion Matching AABB Hierarchy (%s): %d searches, %.1f poses checked per search%s"),
+		*InMotionData->GetName(), AABBLevelStatsSearchCount, static_cast<double>(AABBLevelStatsPosesChecked) / AABBLevelStatsSearchCount,
+		*LevelReport);
+
+	AABBLevelStatsSearchCount = 0;
+	AABBLevelStatsPosesChecked = 0;
+	FMemory::Memzero(AABBLevelBoxesChecked);
+	FMemory::Memzero(AABBLevelBoxesPassed);
 }
 
 /** HIGH QUALITY POSE SEARCH*/
@@ -1006,201 +1300,89 @@ int32 FAnimNode_MSMotionMatching::GetLowestCostPoseId_HighQuality(const float De
 	}
 
 	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
-	const int32 AtomCount = CurrentMotionData->SearchPoseMatrix.AtomCount;
-	const TArray<float>& LookupPoseArray = CurrentMotionData->LookupPoseMatrix.PoseArray;
-	
-	//Check cost of current pose first for "Favour Current Pose"
-	int32 LowestPoseId_LM = 0; //_LM stands for Lookup Matrix, _SM stands for Search Matrix
-	float LowestCost = 10000000.0f;
-	if(bFavourCurrentPose && !bForcePoseSearch)
-	{
-		LowestPoseId_LM = CurrentInterpolatedPose.PoseId;
-		const int32 PoseStartIndex = LowestPoseId_LM * AtomCount;
-		const float PoseFavour = LookupPoseArray[PoseStartIndex]; //Pose cost multiplier is the first atom of a pose array
+	FPoseSearchTopK NextNaturalCandidates(MaxPoseSearchCandidates);
 
-		for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
-		{
-			LowestCost += FMath::Abs(LookupPoseArray[PoseStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-				* CalibrationArray[AtomIndex - 1];
-		}
-		LowestCost *= PoseFavour;
-		LowestCost *= CurrentPoseFavour;
-	}
-
-	//Next Natural
-	bool bNextNaturalChosen = true;
-	LowestPoseId_LM = GetLowestCostNextNaturalId(CurrentInterpolatedPose.PoseId, LowestCost, CurrentMotionData); //The returned pose id is in lookup matrix space
-	
-	if(bNextNaturalToleranceTest)
+	int32 LowestPoseId_LM; //_LM stands for Lookup Matrix
+	float LowestCost;
+	if(ComputeNaturalCostToBeat(CurrentMotionData, LowestPoseId_LM, LowestCost, DebugInfo ? &NextNaturalCandidates : nullptr))
 	{
-		const FPoseMotionData& NextNaturalPose = CurrentMotionData->Poses[LowestPoseId_LM];
-		
-		if(NextPoseToleranceTest(NextNaturalPose))
-		{
-			return LowestPoseId_LM;
-		}
+		return LowestPoseId_LM;
 	}
-	
-	int32 LowestPoseId_SM = CurrentMotionData->DatabasePoseIdToMatrixPoseId(LowestPoseId_LM);
-
-#if WITH_EDITORONLY_DATA		
-	PosesChecked = InnerAABBsChecked = InnerAABBsPassed = OuterAABBsChecked = OuterAABBsPassed = 0;
-#endif
-	
-	//First go through the OuterAABBs
-	const int32 MotionTagStartPoseIndex = CurrentMotionData->GetMotionTagStartPoseIndex(RequiredMotionTags); //Todo: Combine these two lines into 1
-	const int32 MotionTagEndPoseIndex = CurrentMotionData->GetMotionTagEndPoseIndex(RequiredMotionTags);
-	const int32 OuterAABBStartIndex = FMath::FloorToInt32(MotionTagStartPoseIndex / 64.0f);
-	const int32 OuterAABBEndIndex = FMath::CeilToInt32(MotionTagEndPoseIndex / 64.0f);
-	const TArray<float>& OuterAABBArray = CurrentMotionData->PoseAABBMatrix_Outer.ExtentsArray;
-	const TArray<float>& InnerAABBArray = CurrentMotionData->PoseAABBMatrix_Inner.ExtentsArray;
-	const TArray<float>& PoseArray = CurrentMotionData->SearchPoseMatrix.PoseArray;
-	for(int32 OuterAABBIndex = OuterAABBStartIndex; OuterAABBIndex < OuterAABBEndIndex; ++OuterAABBIndex)
-	{
-#if WITH_EDITORONLY_DATA	
-		++OuterAABBsChecked;
-#endif
-		
-		const int32 OuterAABBAtomStartIndex = OuterAABBIndex * AtomCount * 2;
-		
-		float AABBCost = 0.0f;
-		for(int32 DimIndex = 1; DimIndex < AtomCount; ++DimIndex)
-		{
-			const int32 OuterAABBAtomIndex = OuterAABBAtomStartIndex + (DimIndex * 2);
-
-			const float ClosestPoint = FMath::Clamp(CurrentInterpolatedPoseArray[DimIndex],
-			                                        OuterAABBArray[OuterAABBAtomIndex],
-			                                        OuterAABBArray[OuterAABBAtomIndex + 1]);
-
-			AABBCost += FMath::Abs(CurrentInterpolatedPoseArray[DimIndex] - ClosestPoint) * CalibrationArray[DimIndex - 1];
-		}
 
-		if(AABBCost < LowestCost)
-		{
-#if WITH_EDITORONLY_DATA	
-			++OuterAABBsPassed;
-#endif
-			
-			//We need to search the inner AABBs
+	//Coarse search of the tag section over the coarse features, then refine the best candidates with the other features
+	FPoseSearchQuery Query(CurrentInterpolatedPoseArray.GetData(), CalibrationWeights, 0, 0);
+	CurrentMotionData->GetMotionTagSectionRange(ResolveRequiredMotionTags().ExactSectionIndex, Query.StartPoseIndex, Query.EndPoseIndex);
 
-			const int32 InnerAABBStartIndex = OuterAABBIndex * 4;
-			const int32 InnerAABBEndIndex = FMath::Min(InnerAABBStartIndex + 4, FMath::CeilToInt32(MotionTagEndPoseIndex / 16.0f));
-			for(int32 InnerAABBIndex = InnerAABBStartIndex; InnerAABBIndex < InnerAABBEndIndex; ++InnerAABBIndex)
-			{
-#if WITH_EDITORONLY_DATA	
-				++InnerAABBsChecked;
-#endif
-				
-				const int32 InnerAABBAtomStartIndex = InnerAABBIndex * AtomCount * 2;
+	FPoseSearchResult SearchResult = CreateSearchResult(LowestCost);
+	SearchPoseMatrix(CurrentMotionData, Query, DeltaTime, SearchResult);
+	RecordSearchStatistics(SearchResult);
 
-				AABBCost = 0.0f;
-				for(int32 DimIndex = 1; DimIndex < AtomCount; ++DimIndex)
-				{
-					const int32 InnerAABBAtomIndex = InnerAABBAtomStartIndex + (DimIndex * 2);
+	/*------------XC: Get Searchable Poses Count-----------*/
+	if (DebugInfo)
+	{
+		DebugInfo->TotalPoses = Query.EndPoseIndex - Query.StartPoseIndex;
+		DebugInfo->SearchCount = SearchResult.CoarsePosesChecked;
+		UpdateLowestPoses(CurrentMotionData, NextNaturalCandidates, SearchResult.TopK);
+	}
 
-					const float ClosestPoint = FMath::Clamp(CurrentInterpolatedPoseArray[DimIndex],
-															InnerAABBArray[InnerAABBAtomIndex],
-															InnerAABBArray[InnerAABBAtomIndex + 1]);
+	ResolveSearchCandidates(CurrentMotionData, SearchResult);
 
-					AABBCost += FMath::Abs(CurrentInterpolatedPoseArray[DimIndex] - ClosestPoint) * CalibrationArray[DimIndex - 1];
-				}
+	if(SearchResult.IsValid())
+	{
+		return CurrentMotionData->MatrixPoseIdToDatabasePoseId(SearchResult.PoseId);
+	}
 
-				if(AABBCost < LowestCost)
-				{
-#if WITH_EDITORONLY_DATA	
-					++InnerAABBsPassed;
-#endif
-					const float PoseInterval = CurrentMotionData->PoseInterval;
-					const float ResVelWeight = CurrentMotionData->MotionMatchConfig->ResultantVelocityWeight;
-					const int32 ResIndex = AtomCount - 12;
-					
-					const int32 StartPoseIndex = FMath::Max(InnerAABBIndex * 16, MotionTagStartPoseIndex);
-					const int32 EndPoseIndex = FMath::Min((InnerAABBIndex * 16) + 16, MotionTagEndPoseIndex);
-					for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
-					{
-#if WITH_EDITORONLY_DATA	
-						++PosesChecked;
-#endif
-						
-						float Cost = 0.0f;
-						const int32 MatrixStartIndex = PoseIndex * AtomCount;
-						const float PoseFavour = PoseArray[MatrixStartIndex]; //Pose cost multiplier is the first atom of a pose array
-
-						/** Basic Cost Loop*/
-						for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
-						{
-							Cost += FMath::Abs(PoseArray[MatrixStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-									* CalibrationArray[AtomIndex - 1]; 
-						}
-						
+	return LowestPoseId_LM != INDEX_NONE ? LowestPoseId_LM : CurrentMotionData->MatrixPoseIdToDatabasePoseId(0);
+}
 
-						/** High Quality Cost Loop (I.e. Resultant Velocity Costing */
-						float ResVelX = CurrentInterpolatedPoseArray[ResIndex] - PoseArray[MatrixStartIndex + ResIndex] / DeltaTime;
-						float ResVelY = CurrentInterpolatedPoseArray[ResIndex+1] - PoseArray[MatrixStartIndex + ResIndex+1] / DeltaTime;
-						float ResVelZ = CurrentInterpolatedPoseArray[ResIndex+2] - PoseArray[MatrixStartIndex + ResIndex+2] / DeltaTime;
-
-						float ResVelCost = FMath::Abs(ResVelX - CurrentInterpolatedPoseArray[ResIndex + 3]) * CalibrationArray[ResIndex + 2];
-						ResVelCost += FMath::Abs(ResVelY - CurrentInterpolatedPoseArray[ResIndex + 4]) * CalibrationArray[ResIndex + 3];
-						ResVelCost +=	FMath::Abs(ResVelZ - CurrentInterpolatedPoseArray[ResIndex + 5]) * CalibrationArray[ResIndex + 4];
-
-						ResVelX = CurrentInterpolatedPoseArray[ResIndex+6] - PoseArray[MatrixStartIndex + ResIndex+6] / DeltaTime;
-						ResVelY = CurrentInterpolatedPoseArray[ResIndex+7] - PoseArray[MatrixStartIndex + ResIndex+7] / DeltaTime;
-						ResVelZ = CurrentInterpolatedPoseArray[ResIndex+8] - PoseArray[MatrixStartIndex + ResIndex+8] / DeltaTime;
-
-						ResVelCost += FMath::Abs(ResVelX - CurrentInterpolatedPoseArray[ResIndex + 9]) * CalibrationArray[ResIndex + 8];
-						ResVelCost += FMath::Abs(ResVelY - CurrentInterpolatedPoseArray[ResIndex + 10]) * CalibrationArray[ResIndex + 9];
-						ResVelCost +=	FMath::Abs(ResVelZ - CurrentInterpolatedPoseArray[ResIndex + 11]) * CalibrationArray[ResIndex + 10];
-
-						Cost += ResVelCost * ResVelWeight;
-						Cost *= PoseFavour;
-						if(Cost < LowestCost)
-						{
-							bNextNaturalChosen = false;
-							LowestCost = Cost;
-							LowestPoseId_SM = PoseIndex;
-
-							/*-----------XC:Get Top 5 Lowest Cost PoseID-------------*/
-							//TArray<FPoseCostInfo> LowestPoses;
-							//UpdateLowestPoses(CurrentMotionData, LowestPoseId_SM, PoseFavour, Cost, LowestPoses);
-							//DebugInfo->LowestCostCandidates = LowestPoses;
-						}
-					}
-				}
-			}
-		}
+FPoseSearchResult FAnimNode_MSMotionMatching::CreateSearchResult(const float CostToBeat) const
+{
+	if(SearchCandidateCount > 0)
+	{
+		return FPoseSearchResult(CostToBeat, SearchCandidateCount);
 	}
 
-#if WITH_EDITORONLY_DATA
-	RecordHistoricalPoseSearch(PosesChecked);
-#endif
+	//The debug candidates do not prune so that a search with debug info checks exactly the same poses as one without
+	return FPoseSearchResult(CostToBeat, DebugInfo ? MaxPoseSearchCandidates : 0, false);
+}
 
-	if(bNextNaturalChosen)
+void FAnimNode_MSMotionMatching::ResolveSearchCandidates(const UMotionDataAsset* InMotionData,
+	const FPoseSearchResult& InSearchResult)
+{
+	if(SearchCandidateCount <= 0)
 	{
-		return LowestPoseId_LM;
+		return;
 	}
-	else
+
+	FPoseSearchTopKArray SortedCandidates;
+	InSearchResult.TopK.GetSorted(SortedCandidates);
+
+	const int32 CandidateCount = FMath::Min(SortedCandidates.Num(), SearchCandidateCount);
+	SearchCandidates.Reset(CandidateCount);
+	for(int32 i = 0; i < CandidateCount; ++i)
 	{
-		return CurrentMotionData->MatrixPoseIdToDatabasePoseId(LowestPoseId_SM);
+		const FPoseSearchCandidate& Candidate = SortedCandidates[i];
+		SearchCandidates.Emplace(InMotionData->MatrixPoseIdToDatabasePoseId(Candidate.PoseId), Candidate.Cost, Candidate.PoseFavour);
 	}
 }
 
-int32 FAnimNode_MSMotionMatching::GetLowestCostNextNaturalId(int32 LowestPoseId_LM, float& OutLowestCost, TObjectPtr<const UMotionDataAsset> InMotionData)
+int32 FAnimNode_MSMotionMatching::GetLowestCostNextNaturalId(int32 LowestPoseId_LM, float& OutLowestCost,
+	TObjectPtr<const UMotionDataAsset> InMotionData, FPoseSearchTopK* OutCandidates /*= nullptr*/)
 {
 	//Determine how many valid next naturals there are
 	const int32 NextNaturalStart = CurrentInterpolatedPose.PoseId;
+	const FPoseHotTable& PoseTable = InMotionData->PoseHotTable;
 	const int32 NextNaturalEnd = FMath::Clamp(CurrentInterpolatedPose.PoseId + FMath::CeilToInt32(NextNaturalRange
-		/ InMotionData->PoseInterval), 0, InMotionData->Poses.Num() - 1);
+		/ InMotionData->PoseInterval), 0, PoseTable.Num() - 1);
 	const int32 CurrentAnimId = CurrentInterpolatedPose.AnimId;
 	const EMotionAnimAssetType CurrentAnimType = CurrentInterpolatedPose.AnimType;
 
 	int32 ValidNextNaturalCount = 0;
 	for(int32 i = NextNaturalStart; i < NextNaturalEnd; ++i)
 	{
-		const FPoseMotionData& Pose = InMotionData->Poses[i];
-		
-		if(Pose.SearchFlag == EPoseSearchFlag::DoNotUse
-			|| Pose.AnimId != CurrentAnimId
-			|| Pose.AnimType != CurrentAnimType)
+		if(PoseTable.GetSearchFlag(i) == EPoseSearchFlag::DoNotUse
+			|| PoseTable.AnimIds[i] != CurrentAnimId
+			|| PoseTable.GetAnimType(i) != CurrentAnimType)
 		{
 			break;
 		}
@@ -1209,69 +1391,29 @@ int32 FAnimNode_MSMotionMatching::GetLowestCostNextNaturalId(int32 LowestPoseId_
 	}
 	
 	const int32 AtomCount = InMotionData->LookupPoseMatrix.AtomCount;
-	const TArray<float>& LookupPoseArray = InMotionData->LookupPoseMatrix.PoseArray;
+	const float* LookupPoseArray = InMotionData->LookupPoseMatrix.PoseArray.GetData();
+	const float* QueryPoseArray = CurrentInterpolatedPoseArray.GetData();
+	const float* Calibration = CalibrationWeights;
 
 	const float FinalNextNaturalFavour = bFavourNextNatural ? NextNaturalFavour : 1.0f;
 
-	/*-------------xc: for CandidateCostPoses--------------*/
-	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
-	TArray<FPoseCostInfo> LowestPoses;
-
 	//Search next naturals and determine the lowest cost one.
 	for(int32 PoseIndex = NextNaturalStart; PoseIndex < NextNaturalStart + ValidNextNaturalCount; ++PoseIndex)
 	{
-		/*-------------------XC:Get every feature's cost----------------*/
-		TArray<float> SingleFeatureCost;
-		TArray<int> SingleFeatureSize;
-		int32 FeatureCostIndex = 0;
-		int32 FeatureSizeIndex = 0;
-
-		TArray<TObjectPtr<UMatchFeatureBase>> CurrentFeatures = MotionData->MotionMatchConfig->Features;
-		for (UMatchFeatureBase* MatchFeature : CurrentFeatures) {
-			if (MatchFeature) {
-				SingleFeatureCost.Add(0.0f);
-				SingleFeatureSize.Add(MatchFeature->Size());
-			}
-		}
-
-		float Cost = 0.0f;
-		const int32 MatrixStartIndex = PoseIndex * AtomCount;
-		for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
-		{
-			float AtomCost = FMath::Abs(LookupPoseArray[MatrixStartIndex + AtomIndex] - CurrentInterpolatedPoseArray[AtomIndex])
-				* CalibrationArray[AtomIndex - 1];
-
-			Cost += AtomCost;
-
-			/*-----------XC:Get single feature's cost-----------*/
-			if (FeatureSizeIndex >= SingleFeatureSize[FeatureCostIndex]) {
-				FeatureCostIndex++;
-				SingleFeatureCost[FeatureCostIndex] += AtomCost;
-				FeatureSizeIndex = 0;
-			}
-			else {
-				FeatureSizeIndex++;
-				SingleFeatureCost[FeatureCostIndex] += AtomCost;
-			}
-		}
-
-
-		TMap<FName, float> FeatureCostMap;
-		for (int32 i = 0; i < CurrentFeatures.Num(); i++) {
-			FeatureCostMap.Add(CurrentFeatures[i]->GetFeatureName(), SingleFeatureCost[i]);
-		}
+		const float* PoseRow = LookupPoseArray + PoseIndex * AtomCount;
+		const float PoseFavour = PoseRow[0] * FinalNextNaturalFavour;
+		const float Cost = FMotionMatchingSearch::ComputePoseCost(PoseRow, QueryPoseArray, Calibration, AtomCount) * PoseFavour;
 
-		Cost *= LookupPoseArray[MatrixStartIndex] * FinalNextNaturalFavour;
 		if(Cost < OutLowestCost)
 		{
 			OutLowestCost = Cost;
 			LowestPoseId_LM = PoseIndex;
+		}
 
-			/*-----------XC:Get Top 5 Lowest Cost PoseID-------------*/
-			if (DebugInfo) {
-				UpdateLowestPoses(CurrentMotionData, LowestPoseId_LM, LookupPoseArray[MatrixStartIndex] * FinalNextNaturalFavour, Cost, FeatureCostMap, LowestPoses);
-				DebugInfo->LowestCostCandidates = LowestPoses;
-			}
+		/*-----------XC:Get Top 5 Lowest Cost PoseID-------------*/
+		if(OutCandidates)
+		{
+			OutCandidates->Add(PoseIndex, Cost, PoseFavour);
 		}
 	}
 
@@ -1399,12 +1541,20 @@ void FAnimNode_MSMotionMatching::CheckValidToEvaluate(const FAnimInstanceProxy*
 		return;
 	}
 
-	FScopeLock ScopeLock(&CheckValidCriticalSection); 
+	//Search structures are generated when pre-processing and validated on load. They are never generated at runtime
 	if(!CurrentMotionData->IsSearchPoseMatrixGenerated())
 	{
-		CurrentMotionData->GenerateSearchPoseMatrix();
+		UE_LOG(LogTemp, Warning, TEXT("Motion matching node failed to initialize. The motion data search pose matrix has not been generated. Did you forget to pre-process the motion data?"))
+		bValidToEvaluate = false;
+		return;
+	}
+
+	if(!CurrentMotionData->IsPoseHotTableValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Motion matching node failed to initialize. The motion data pose table does not match the poses. Did you forget to pre-process the motion data?"))
+		bValidToEvaluate = false;
+		return;
 	}
-	ScopeLock.Unlock();
 
 	//Validate Motion Matching Configuration
 	//Todo: Move this somewhere else maybe?
@@ -1415,11 +1565,19 @@ void FAnimNode_MSMotionMatching::CheckValidToEvaluate(const FAnimInstanceProxy*
 
 		CurrentInterpolatedPose = FPoseMotionData();
 		CurrentInterpolatedPoseArray.Empty(PoseArraySize + 1);
-		CalibrationArray.Empty(PoseArraySize + 1);
 
 		CurrentInterpolatedPoseArray.SetNumZeroed(PoseArraySize);
 		InputData.DesiredInputArray.SetNumZeroed(PoseArraySize);
-		CalibrationArray.SetNumZeroed(PoseArraySize);
+
+		CalibrationWeights = nullptr;
+		CustomCalibrationArray.Empty();
+		CustomCalibrationData = nullptr;
+		CustomCalibrationSection = INDEX_NONE;
+		CustomCalibrationUser = nullptr;
+		ResolvedMotionTagData = nullptr;
+		BatchedSearchTicket = 0;
+		WaitForAsyncSearch();
+		bAsyncSearchPending = false;
 	}
 	else
 	{
@@ -1447,11 +1605,43 @@ void FAnimNode_MSMotionMatching::CheckValidToEvaluate(const FAnimInstanceProxy*
 		}
 	}
 
-	FinalCalibrationSets.Empty(CurrentMotionData->FeatureStandardDeviations.Num() + 1);
-	for (auto& FeatureStdDev : CurrentMotionData->FeatureStandardDeviations)
+	FMotionMatchingSearch::BuildFeatureSegments(MMConfig, FeatureSegments);
+	SearchStages.Build(MMConfig, FeatureSegments);
+
+	const int32 AtomCount = CurrentMotionData->SearchPoseMatrix.AtomCount;
+	if(!FMotionMatchingSearch::AreFeatureSegmentsValid(FeatureSegments, AtomCount)
+		|| !SearchStages.IsValid(AtomCount))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Motion matching node failed to initialize. The match feature offsets of the motion config do not match the search pose matrix. Did you change the motion config and forget to pre-process?"));
+		bValidToEvaluate = false;
+		return;
+	}
+
+	//Feature evaluation orders are optional and an invalid order only means that features are evaluated in config order
+	FeatureEvaluationOrderSets.Empty(CurrentMotionData->FeatureStandardDeviations.Num());
+	for(int32 CalibrationIndex = 0; CalibrationIndex < CurrentMotionData->FeatureStandardDeviations.Num(); ++CalibrationIndex)
+	{
+		TArray<FPoseFeatureSegment>& EvaluationOrder = FeatureEvaluationOrderSets.AddDefaulted_GetRef();
+
+		if(CurrentMotionData->FeatureEvaluationOrders.IsValidIndex(CalibrationIndex)
+			&& CurrentMotionData->FeatureEvaluationOrders[CalibrationIndex].IsValidWithConfig(MMConfig))
+		{
+			EvaluationOrder.Reserve(FeatureSegments.Num());
+			for(const int32 FeatureIndex : CurrentMotionData->FeatureEvaluationOrders[CalibrationIndex].FeatureIndices)
+			{
+				if(FeatureSegments[FeatureIndex].Size > 0)
+				{
+					EvaluationOrder.Add(FeatureSegments[FeatureIndex]);
+				}
+			}
+		}
+	}
+
+	if(!CurrentMotionData->AreFinalCalibrationWeightsValid())
 	{
-		FinalCalibrationSets.Emplace(FCalibrationData());
-		FinalCalibrationSets.Last().GenerateFinalWeights(MMConfig, FeatureStdDev);
+		UE_LOG(LogTemp, Warning, TEXT("Motion matching node failed to initialize. The motion data final calibration weights do not match the search pose matrix. Did you forget to pre-process the motion data?"));
+		bValidToEvaluate = false;
+		return;
 	}
 	
 	if (UserCalibration)
@@ -1513,17 +1703,19 @@ float FAnimNode_MSMotionMatching::GetMotionPlayLength(const int32 AnimId, const
 }
 
 
-bool FAnimNode_MSMotionMatching::NextPoseToleranceTest(const FPoseMotionData& NextPose) const
+bool FAnimNode_MSMotionMatching::NextPoseToleranceTest(const int32 NextPoseId) const
 {
-	if (NextPose.SearchFlag == EPoseSearchFlag::DoNotUse 
-	|| NextPose.MotionTags != RequiredMotionTags
+	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
+	const FPoseHotTable& PoseTable = CurrentMotionData->PoseHotTable;
+	if (PoseTable.GetSearchFlag(NextPoseId) == EPoseSearchFlag::DoNotUse 
+	|| PoseTable.GetTagSectionIndex(NextPoseId) != ResolvedRequiredTagSection
+	|| ResolvedRequiredTagSection == INDEX_NONE
 	|| InputData.DesiredInputArray.Num() == 0)
 	{
 		return false;
 	}
 
-	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
-	const int32 NextPoseStartIndex = NextPose.PoseId * CurrentMotionData->LookupPoseMatrix.AtomCount;
+	const int32 NextPoseStartIndex = NextPoseId * CurrentMotionData->LookupPoseMatrix.AtomCount;
 
 	int32 FeatureOffset = 1; //Start with offset one because we don't use the pose favour for next pose tolerance test
 	for(const TObjectPtr<UMatchFeatureBase> Feature : CurrentMotionData->MotionMatchConfig->Features)
@@ -1562,20 +1754,59 @@ void FAnimNode_MSMotionMatching::ApplyTrajectoryBlending()
 bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 {
 	TObjectPtr<const UMotionDataAsset> CurrentMotionData = GetMotionData();
-	const int32 CalibrationIndex = CurrentMotionData->GetMotionTagIndex(RequiredMotionTags);
+	const int32 CalibrationIndex = FMath::Max(ResolveRequiredMotionTags().SectionIndex, 0);
+	const float* SectionWeights = CurrentMotionData->GetSectionCalibrationWeights(CalibrationIndex);
 
-	if(CalibrationIndex < 0
-		|| CalibrationIndex >= FinalCalibrationSets.Num())
+	if(!SectionWeights)
 	{
 		return false;
 	}
 	
+	CurrentCalibrationIndex = CalibrationIndex;
+	
+	TObjectPtr<const UMotionCalibration> OverrideMotionCalibration = GetUserCalibration();
+
+	//The default ratio multiplies every weight by exactly 1 so the cached section weights can be used directly
+	if(!OverrideMotionCalibration
+		&& OverrideQualityVsResponsivenessRatio == 0.5f)
+	{
+		CalibrationWeights = SectionWeights;
+		return true;
+	}
+
+	//User calibrations can be edited while playing in the editor so they are always re-applied there
+#if WITH_EDITOR
+	const bool bCanReuseCustomCalibration = !OverrideMotionCalibration;
+#else
+	const bool bCanReuseCustomCalibration = true;
+#endif
+	
+	if(bCanReuseCustomCalibration
+		&& CustomCalibrationData == CurrentMotionData.Get()
+		&& CustomCalibrationSection == CalibrationIndex
+		&& CustomCalibrationSerial == CurrentMotionData->GetSectionCalibrationSerial()
+		&& CustomCalibrationUser == OverrideMotionCalibration.Get()
+		&& CustomCalibrationRatio == OverrideQualityVsResponsivenessRatio)
+	{
+		CalibrationWeights = CustomCalibrationArray.GetData();
+		return true;
+	}
+
+	const int32 WeightCount = CurrentMotionData->SearchPoseMatrix.AtomCount - 1;
+	CustomCalibrationArray.SetNumZeroed(Align(WeightCount, 4));
+	FMemory::Memcpy(CustomCalibrationArray.GetData(), SectionWeights, WeightCount * sizeof(float));
+	CustomCalibrationData = CurrentMotionData.Get();
+	CustomCalibrationSection = CalibrationIndex;
+	CustomCalibrationSerial = CurrentMotionData->GetSectionCalibrationSerial();
+	CustomCalibrationUser = OverrideMotionCalibration.Get();
+	CustomCalibrationRatio = OverrideQualityVsResponsivenessRatio;
+	CalibrationWeights = CustomCalibrationArray.GetData();
+	
 	const float OverrideQualityMultiplier = (1.0f - OverrideQualityVsResponsivenessRatio) * 2.0f;
 	const float OverrideResponseMultiplier = OverrideQualityVsResponsivenessRatio * 2.0f;
-	CalibrationArray = FinalCalibrationSets[CalibrationIndex].Weights;
 	
 	int32 AtomIndex = 0;
-	if(TObjectPtr<const UMotionCalibration> OverrideMotionCalibration = GetUserCalibration())
+	if(OverrideMotionCalibration)
 	{
 		if(OverrideMotionCalibration->CalibrationType == EMotionCalibrationType::Multiplier)
 		{
@@ -1589,7 +1820,7 @@ bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 				{
 					for(int32 i = 0; i < FeatureSize; ++i)
 					{
-						CalibrationArray[AtomIndex] *= OverrideMotionCalibration->AdjustedCalibrationArray[AtomIndex]
+						CustomCalibrationArray[AtomIndex] *= OverrideMotionCalibration->AdjustedCalibrationArray[AtomIndex]
 							* OverrideQualityMultiplier;
 						
 						++AtomIndex;
@@ -1599,7 +1830,7 @@ bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 				{
 					for(int32 i = 0; i < FeatureSize; ++i)
 					{
-						CalibrationArray[AtomIndex] *= OverrideMotionCalibration->AdjustedCalibrationArray[AtomIndex]
+						CustomCalibrationArray[AtomIndex] *= OverrideMotionCalibration->AdjustedCalibrationArray[AtomIndex]
 							* OverrideResponseMultiplier;
 						
 						++AtomIndex;
@@ -1620,7 +1851,7 @@ bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 				{
 					for(int32 i = 0; i < FeatureSize; ++i)
 					{
-						CalibrationArray[AtomIndex] = NormalizerArray[AtomIndex] *
+						CustomCalibrationArray[AtomIndex] = NormalizerArray[AtomIndex] *
 							OverrideMotionCalibration->AdjustedCalibrationArray[AtomIndex] * OverrideQualityMultiplier;
 						++AtomIndex;
 					}
@@ -1629,7 +1860,7 @@ bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 				{
 					for(int32 i = 0; i < FeatureSize; ++i)
 					{
-						CalibrationArray[AtomIndex] = NormalizerArray[AtomIndex] *
+						CustomCalibrationArray[AtomIndex] = NormalizerArray[AtomIndex] *
 							OverrideMotionCalibration->AdjustedCalibrationArray[AtomIndex] * OverrideResponseMultiplier;
 						++AtomIndex;
 					}
@@ -1649,7 +1880,7 @@ bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 			{
 				for(int32 i = 0; i < FeatureSize; ++i)
 				{
-					CalibrationArray[AtomIndex] *= OverrideQualityMultiplier;
+					CustomCalibrationArray[AtomIndex] *= OverrideQualityMultiplier;
 					++AtomIndex;
 				}
 			}
@@ -1657,7 +1888,7 @@ bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 			{
 				for(int32 i = 0; i < FeatureSize; ++i)
 				{
-					CalibrationArray[AtomIndex] *= OverrideResponseMultiplier;
+					CustomCalibrationArray[AtomIndex] *= OverrideResponseMultiplier;
 					++AtomIndex;
 				}
 			}
@@ -1667,6 +1898,52 @@ bool FAnimNode_MSMotionMatching::GenerateCalibrationArray()
 	return true;
 }
 
+const FMotionTagSectionMatch& FAnimNode_MSMotionMatching::ResolveRequiredMotionTags()
+{
+	const UMotionDataAsset* CurrentMotionData = GetMotionData();
+	//The tag arrays are compared in order, which is a single pass over the tag names rather than a lookup of every tag in
+	//the other container. The same tags in a different order are only resolved again
+	if(ResolvedMotionTagData != CurrentMotionData
+		|| ResolvedMotionTags != RequiredMotionTags.GetGameplayTagArray())
+	{
+		ResolvedMotionTagData = CurrentMotionData;
+		ResolvedMotionTags = RequiredMotionTags.GetGameplayTagArray();
+		ResolvedMotionTagSections = CurrentMotionData ? CurrentMotionData->ResolveMotionTags(RequiredMotionTags)
+			: FMotionTagSectionMatch();
+
+		//Resolve which sections pass the per pose tag checks once so that they are a bit test against the pose hot table
+		ResolvedRequiredTagSection = INDEX_NONE;
+		ResolvedExactTagSections.Init(false, CurrentMotionData ? CurrentMotionData->MotionTagList.Num() : 0);
+		for(int32 SectionIndex = 0; SectionIndex < ResolvedExactTagSections.Num(); ++SectionIndex)
+		{
+			const FGameplayTagContainer& SectionTags = CurrentMotionData->MotionTagList[SectionIndex];
+			ResolvedExactTagSections[SectionIndex] = SectionTags.HasAllExact(RequiredMotionTags);
+			if(SectionTags == RequiredMotionTags)
+			{
+				ResolvedRequiredTagSection = SectionIndex;
+			}
+		}
+	}
+
+	return ResolvedMotionTagSections;
+}
+
+bool FAnimNode_MSMotionMatching::SectionHasRequiredMotionTags(const int32 InSectionIndex) const
+{
+	return ResolvedExactTagSections.IsValidIndex(InSectionIndex)
+		&& ResolvedExactTagSections[InSectionIndex];
+}
+
+TConstArrayView<FPoseFeatureSegment> FAnimNode_MSMotionMatching::GetFeatureEvaluationOrder() const
+{
+	if(FeatureEvaluationOrderSets.IsValidIndex(CurrentCalibrationIndex))
+	{
+		return FeatureEvaluationOrderSets[CurrentCalibrationIndex];
+	}
+
+	return TConstArrayView<FPoseFeatureSegment>();
+}
+
 float FAnimNode_MSMotionMatching::GetCurrentAssetTime() const
 {
 	return InternalTimeAccumulator;
@@ -1845,10 +2122,9 @@ void FAnimNode_MSMotionMatching::UpdateAssetPlayer(const FAnimationUpdateContext
 		//TRACE_ANIM_SEQUENCE_PLAYER()
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("TotalPosesCount"), DebugInfo->TotalPoses);
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("SearchCount"), DebugInfo->SearchCount);
-		float Reduction = float(DebugInfo->TotalPoses - DebugInfo->SearchCount) / float(DebugInfo->TotalPoses);
-		FString Reduction_Str = FString::SanitizeFloat(Reduction);
-		UE_LOG(LogTemp, Warning, TEXT("Reduction: %f"), Reduction);
-		TRACE_ANIM_NODE_VALUE(Context, TEXT("Reduction"), FName(*Reduction_Str));
+		const float Reduction = DebugInfo->TotalPoses > 0
+			? float(DebugInfo->TotalPoses - DebugInfo->SearchCount) / float(DebugInfo->TotalPoses) : 0.0f;
+		TRACE_ANIM_NODE_VALUE(Context, TEXT("Reduction"), Reduction);
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("Name"), CurrentMotionData != nullptr ? CurrentMotionData->GetFName() : NAME_None);
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("Motion Data"), CurrentMotionData);
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("AnimAsset Name"), FName(CurrentMotionData->GetSourceSequenceAtIndex(MMAnimState.AnimId)->AnimAsset->GetName()));
@@ -1857,7 +2133,7 @@ void FAnimNode_MSMotionMatching::UpdateAssetPlayer(const FAnimationUpdateContext
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("Current Pose Id"), CurrentChosenPoseId);
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("Favour"), DebugInfo->Favour);
 	}
-	if (CurrentMotionData->Poses[CurrentChosenPoseId].SearchFlag == EPoseSearchFlag::DoNotUse) {
+	if (CurrentMotionData->PoseHotTable.GetSearchFlag(CurrentChosenPoseId) == EPoseSearchFlag::DoNotUse) {
 		TRACE_ANIM_NODE_VALUE(Context, TEXT("SearchFlag"), FName("DoNotUse"));
 	}
 	else {
@@ -2308,6 +2584,22 @@ void FAnimNode_MSMotionMatching::RecordHistoricalPoseSearch(const int32 InPosesS
 #endif
 }
 
+void FAnimNode_MSMotionMatching::RecordSearchStatistics(const FPoseSearchResult& InSearchResult)
+{
+	LastSearchPoseCount += InSearchResult.PosesChecked;
+	SearchTrace.AddResult(InSearchResult);
+	
+#if WITH_EDITORONLY_DATA
+	PosesChecked = InSearchResult.PosesChecked;
+	InnerAABBsChecked = InSearchResult.InnerAABBsChecked;
+	InnerAABBsPassed = InSearchResult.InnerAABBsPassed;
+	OuterAABBsChecked = InSearchResult.OuterAABBsChecked;
+	OuterAABBsPassed = InSearchResult.OuterAABBsPassed;
+
+	RecordHistoricalPoseSearch(PosesChecked);
+#endif
+}
+
 void FAnimNode_MSMotionMatching::FillCompactPoseAndComponentRefRotations(const FBoneContainer& BoneContainer)
 {
 	if(const UMirrorDataTable* MirrorDataTable = GetMirrorDataTable())
@@ -2324,26 +2616,62 @@ void FAnimNode_MSMotionMatching::FillCompactPoseAndComponentRefRotations(const F
 	}
 }
 
-void FAnimNode_MSMotionMatching::UpdateLowestPoses(TObjectPtr<const UMotionDataAsset> CurrentMotionData, int32 LowestPoseId, float PoseFavour, float Cost, TMap<FName, float>& FeatureCostMap, TArray<FPoseCostInfo>& LowestPoses)
+void FAnimNode_MSMotionMatching::UpdateLowestPoses(TObjectPtr<const UMotionDataAsset> CurrentMotionData,
+	const FPoseSearchTopK& NextNaturalCandidates, const FPoseSearchTopK& MatrixCandidates)
 {
-	int32 DataBasePoseID = CurrentMotionData->MatrixPoseIdToDatabasePoseId(LowestPoseId);
-	const FPoseMotionData& CurrentBestPose = CurrentMotionData->Poses[DataBasePoseID];
-	FString AnimName = "None";
-	int32 AnimID = 0;
-	TObjectPtr<const UMotionSequenceObject> SourceSequence = CurrentMotionData->GetSourceSequenceAtIndex(CurrentBestPose.AnimId);
-	if (SourceSequence) {
-		AnimName = SourceSequence->AnimAsset->GetName();
-		AnimID = SourceSequence->AnimId;
+	if(!DebugInfo || !CurrentMotionData)
+	{
+		return;
 	}
-	FPoseCostInfo CurrentCandidateLowestPose = FPoseCostInfo(DataBasePoseID, AnimName, AnimID, PoseFavour, 1.0f, Cost, FeatureCostMap);
-							
-	if (LowestPoses.Num() <= 5) {
-		LowestPoses.Emplace(CurrentCandidateLowestPose);
+
+	//Merge both heaps in database pose id space. Next natural candidates are already in lookup matrix space
+	FPoseSearchTopK Candidates(MaxPoseSearchCandidates);
+	for(const FPoseSearchCandidate& Candidate : NextNaturalCandidates.Heap)
+	{
+		Candidates.Add(Candidate.PoseId, Candidate.Cost, Candidate.PoseFavour);
 	}
-	else {
-		LowestPoses[4] = CurrentCandidateLowestPose;
+
+	for(const FPoseSearchCandidate& Candidate : MatrixCandidates.Heap)
+	{
+		Candidates.Add(CurrentMotionData->MatrixPoseIdToDatabasePoseId(Candidate.PoseId), Candidate.Cost, Candidate.PoseFavour);
+	}
+
+	FPoseSearchTopKArray SortedCandidates;
+	Candidates.GetSorted(SortedCandidates);
+
+	//The per-feature breakdown is only computed for the winning candidates
+	const FPoseMatrix& LookupMatrix = CurrentMotionData->LookupPoseMatrix;
+	const TArray<TObjectPtr<UMatchFeatureBase>>& Features = CurrentMotionData->MotionMatchConfig->Features;
+	TArray<float, TInlineAllocator<16>> FeatureCosts;
+	FeatureCosts.SetNumZeroed(FeatureSegments.Num());
+
+	TArray<FPoseCostInfo>& LowestPoses = DebugInfo->LowestCostCandidates;
+	LowestPoses.Reset();
+	for(const FPoseSearchCandidate& Candidate : SortedCandidates)
+	{
+		const FPoseMotionData& CandidatePose = CurrentMotionData->Poses[Candidate.PoseId];
+
+		FMotionMatchingSearch::ComputeFeatureCosts(&LookupMatrix.PoseArray[Candidate.PoseId * LookupMatrix.AtomCount],
+			CurrentInterpolatedPoseArray.GetData(), CalibrationWeights, FeatureSegments, FeatureCosts.GetData());
+
+		TMap<FName, float> FeatureCostMap;
+		for(int32 FeatureIndex = 0; FeatureIndex < FeatureSegments.Num() && FeatureIndex < Features.Num(); ++FeatureIndex)
+		{
+			if(Features[FeatureIndex])
+			{
+				FeatureCostMap.Add(Features[FeatureIndex]->GetFeatureName(), FeatureCosts[FeatureIndex]);
+			}
+		}
+
+		FString AnimName = "None";
+		int32 AnimID = 0;
+		TObjectPtr<const UMotionAnimObject> SourceAnim = MotionData->GetSourceAnim(CandidatePose.AnimId, CandidatePose.AnimType);
+		if(SourceAnim && SourceAnim->AnimAsset)
+		{
+			AnimName = SourceAnim->AnimAsset->GetName();
+			AnimID = SourceAnim->AnimId;
+		}
+
+		LowestPoses.Emplace(FPoseCostInfo(Candidate.PoseId, AnimName, AnimID, Candidate.PoseFavour, 1.0f, Candidate.Cost, FeatureCostMap));
 	}
-	LowestPoses.Sort([](const FPoseCostInfo& Info1, const FPoseCostInfo& Info2) {
-		return Info1.TotalCost < Info2.TotalCost;
-		});
 }
@@ -3,6 +3,7 @@
 #include "Data/CalibrationData.h"
 #include "Objects/Assets/MotionDataAsset.h"
 #include "Objects/Assets/MotionMatchConfig.h"
+#include "Algo/StableSort.h"
 
 FCalibrationData::FCalibrationData()
 {
@@ -263,3 +264,55 @@ void FCalibrationData::GenerateFinalWeights(UMotionMatchConfig* MotionMatchConfi
 		}
 	}
 }
+
+void FFeatureEvaluationOrder::Generate(UMotionMatchConfig* MotionMatchConfig, const FCalibrationData& StdDeviationNormalizers)
+{
+	FeatureIndices.Empty();
+	
+	if(!MotionMatchConfig
+		|| StdDeviationNormalizers.Weights.Num() != MotionMatchConfig->TotalDimensionCount)
+	{
+		return;
+	}
+
+	FCalibrationData FinalWeights;
+	FinalWeights.GenerateFinalWeights(MotionMatchConfig, StdDeviationNormalizers);
+
+	//The expected cost contribution of an atom is its final weight multiplied by its standard deviation. The normalizers
+	//store 1 / variance so the standard deviation is recovered with a square root.
+	TArray<float> FeatureImportance;
+	FeatureImportance.SetNumZeroed(MotionMatchConfig->Features.Num());
+	
+	int32 AtomIndex = 0;
+	for(int32 FeatureIndex = 0; FeatureIndex < MotionMatchConfig->Features.Num(); ++FeatureIndex)
+	{
+		const UMatchFeatureBase* Feature = MotionMatchConfig->Features[FeatureIndex].Get();
+		const int32 FeatureSize = Feature ? Feature->Size() : 0;
+
+		float TotalImportance = 0.0f;
+		for(int32 i = 0; i < FeatureSize; ++i)
+		{
+			const float Normalizer = StdDeviationNormalizers.Weights[AtomIndex];
+			if(Normalizer > UE_SMALL_NUMBER)
+			{
+				TotalImportance += FMath::Abs(FinalWeights.Weights[AtomIndex]) * FMath::InvSqrt(Normalizer);
+			}
+			
+			++AtomIndex;
+		}
+
+		//Importance is per atom since it is the cost gained per atom evaluated that matters for early termination
+		FeatureImportance[FeatureIndex] = FeatureSize > 0 ? TotalImportance / FeatureSize : 0.0f;
+		FeatureIndices.Add(FeatureIndex);
+	}
+
+	Algo::StableSort(FeatureIndices, [&FeatureImportance](const int32 A, const int32 B)
+	{
+		return FeatureImportance[A] > FeatureImportance[B];
+	});
+}
+
+bool FFeatureEvaluationOrder::IsValidWithConfig(const UMotionMatchConfig* MotionConfig) const
+{
+	return MotionConfig && FeatureIndices.Num() == MotionConfig->Features.Num();
+}
@@ -0,0 +1,125 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/FeatureMajorPoseMatrix.h"
+#include "Data/PoseMatrix.h"
+#include "Objects/Assets/MotionMatchConfig.h"
+#include "Objects/MatchFeatures/MatchFeatureBase.h"
+
+FFeatureMajorBlock::FFeatureMajorBlock()
+	: AtomOffset(0),
+	AtomCount(0),
+	DataOffset(0)
+{
+}
+
+FFeatureMajorBlock::FFeatureMajorBlock(int32 InAtomOffset, int32 InAtomCount, int32 InDataOffset)
+	: AtomOffset(InAtomOffset),
+	AtomCount(InAtomCount),
+	DataOffset(InDataOffset)
+{
+}
+
+FFeatureMajorPoseMatrix::FFeatureMajorPoseMatrix()
+	: AtomCount(0),
+	PoseCount(0)
+{
+}
+
+void FFeatureMajorPoseMatrix::Build(const FPoseMatrix& InSearchMatrix, const UMotionMatchConfig* InMMConfig)
+{
+	Empty();
+
+	if(InSearchMatrix.AtomCount <= 1)
+	{
+		return;
+	}
+
+	AtomCount = InSearchMatrix.AtomCount;
+	PoseCount = InSearchMatrix.PoseCount;
+
+	//Responsiveness features first, then quality features, each in config order
+	TArray<TPair<int32, int32>> FeatureRanges; //Atom offset and atom count
+	if(InMMConfig)
+	{
+		for(const EPoseCategory PoseCategory : { EPoseCategory::Responsiveness, EPoseCategory::Quality })
+		{
+			int32 FeatureOffset = 1; //Start at offset 1 to skip the pose favour atom
+			for(const TObjectPtr<UMatchFeatureBase> Feature : InMMConfig->Features)
+			{
+				const int32 FeatureSize = Feature ? Feature->Size() : 0;
+				if(FeatureSize > 0
+					&& Feature->PoseCategory == PoseCategory)
+				{
+					FeatureRanges.Emplace(FeatureOffset, FeatureSize);
+				}
+
+				FeatureOffset += FeatureSize;
+			}
+		}
+	}
+
+	int32 FeatureAtomCount = 0;
+	for(const TPair<int32, int32>& FeatureRange : FeatureRanges)
+	{
+		FeatureAtomCount += FeatureRange.Value;
+	}
+
+	if(FeatureAtomCount != AtomCount - 1)
+	{
+		FeatureRanges.Reset();
+		FeatureRanges.Emplace(1, AtomCount - 1);
+	}
+
+	PoseFavours.SetNumUninitialized(PoseCount);
+	for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+	{
+		PoseFavours[PoseIndex] = InSearchMatrix.PoseArray[PoseIndex * AtomCount];
+	}
+
+	Data.SetNumUninitialized(PoseCount * (AtomCount - 1));
+	int32 DataOffset = 0;
+	for(const TPair<int32, int32>& FeatureRange : FeatureRanges)
+	{
+		const FFeatureMajorBlock& Block = Blocks.Emplace_GetRef(FeatureRange.Key, FeatureRange.Value, DataOffset);
+		for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+		{
+			FMemory::Memcpy(Data.GetData() + Block.DataOffset + PoseIndex * Block.AtomCount,
+				InSearchMatrix.PoseArray.GetData() + PoseIndex * AtomCount + Block.AtomOffset, Block.AtomCount * sizeof(float));
+		}
+
+		DataOffset += PoseCount * Block.AtomCount;
+	}
+}
+
+void FFeatureMajorPoseMatrix::Empty()
+{
+	AtomCount = 0;
+	PoseCount = 0;
+	PoseFavours.Empty();
+	Blocks.Empty();
+	Data.Empty();
+}
+
+bool FFeatureMajorPoseMatrix::IsValid(const int32 InAtomCount, const int32 InPoseCount) const
+{
+	return AtomCount == InAtomCount
+		&& PoseCount == InPoseCount
+		&& AtomCount > 1
+		&& Blocks.Num() > 0
+		&& PoseFavours.Num() == PoseCount
+		&& Data.Num() == PoseCount * (AtomCount - 1);
+}
+
+int32 FFeatureMajorPoseMatrix::FindBlock(const int32 InAtomOffset, const int32 InAtomCount) const
+{
+	for(int32 BlockIndex = 0; BlockIndex < Blocks.Num(); ++BlockIndex)
+	{
+		if(Blocks[BlockIndex].AtomOffset == InAtomOffset
+			&& Blocks[BlockIndex].AtomCount == InAtomCount)
+		{
+			return BlockIndex;
+		}
+	}
+
+	return INDEX_NONE;
+}
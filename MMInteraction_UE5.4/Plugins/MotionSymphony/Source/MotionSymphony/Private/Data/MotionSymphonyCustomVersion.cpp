@@ -0,0 +1,10 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/MotionSymphonyCustomVersion.h"
+#include "Serialization/CustomVersion.h"
+
+const FGuid FMotionSymphonyCustomVersion::GUID(0x6C4E2A91, 0x3B7D4F58, 0x9A1E05C3, 0xD28F7B64);
+
+//Register the custom version with core
+FCustomVersionRegistration GRegisterMotionSymphonyCustomVersion(FMotionSymphonyCustomVersion::GUID,
+	FMotionSymphonyCustomVersion::LatestVersion, TEXT("MotionSymphonyVer"));
@@ -0,0 +1,186 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/MotionTagSectionTable.h"
+
+FMotionTagSectionMatch::FMotionTagSectionMatch()
+	: SectionIndex(INDEX_NONE),
+	ExactSectionIndex(INDEX_NONE)
+{
+}
+
+FMotionTagSectionMatch::FMotionTagSectionMatch(int32 InSectionIndex, int32 InExactSectionIndex)
+	: SectionIndex(InSectionIndex),
+	ExactSectionIndex(InExactSectionIndex)
+{
+}
+
+FMotionTagSectionTable::FMotionTagSectionTable()
+	: WordCount(0)
+{
+}
+
+void FMotionTagSectionTable::Build(TConstArrayView<FGameplayTagContainer> InSectionTags)
+{
+	Empty();
+
+	//Assign a bit to every tag and parent tag in section order so that the bits are deterministic
+	TArray<FGameplayTagContainer> SectionParentTags;
+	SectionParentTags.Reserve(InSectionTags.Num());
+	for(const FGameplayTagContainer& SectionTags : InSectionTags)
+	{
+		const FGameplayTagContainer& ParentTags = SectionParentTags.Add_GetRef(SectionTags.GetGameplayTagParents());
+		for(const FGameplayTag& Tag : ParentTags)
+		{
+			if(!TagBits.Contains(Tag))
+			{
+				TagBits.Add(Tag, TagBits.Num());
+			}
+		}
+	}
+
+	WordCount = FMath::Max(1, FMath::DivideAndRoundUp(TagBits.Num(), 64));
+	SectionMasks.SetNumZeroed(InSectionTags.Num() * WordCount);
+	SectionParentMasks.SetNumZeroed(InSectionTags.Num() * WordCount);
+	for(int32 SectionIndex = 0; SectionIndex < InSectionTags.Num(); ++SectionIndex)
+	{
+		uint64* SectionMask = SectionMasks.GetData() + SectionIndex * WordCount;
+		for(const FGameplayTag& Tag : InSectionTags[SectionIndex])
+		{
+			const int32 Bit = TagBits.FindChecked(Tag);
+			SectionMask[Bit / 64] |= 1ull << (Bit % 64);
+		}
+
+		uint64* SectionParentMask = SectionParentMasks.GetData() + SectionIndex * WordCount;
+		for(const FGameplayTag& Tag : SectionParentTags[SectionIndex])
+		{
+			const int32 Bit = TagBits.FindChecked(Tag);
+			SectionParentMask[Bit / 64] |= 1ull << (Bit % 64);
+		}
+	}
+
+	//Pre-resolve the tags of every section. Sections have unique tags so a hash collision only costs a fallback search
+	SectionMatches.SetNum(InSectionTags.Num());
+	for(int32 SectionIndex = 0; SectionIndex < InSectionTags.Num(); ++SectionIndex)
+	{
+		const uint64* SectionMask = SectionMasks.GetData() + SectionIndex * WordCount;
+		FMotionTagSectionMatch& Match = SectionMatches[SectionIndex];
+		for(int32 OtherSectionIndex = 0; OtherSectionIndex < InSectionTags.Num(); ++OtherSectionIndex)
+		{
+			if(Match.SectionIndex == INDEX_NONE
+				&& SectionHasAll(SectionParentMasks, OtherSectionIndex, SectionMask))
+			{
+				Match.SectionIndex = OtherSectionIndex;
+			}
+
+			if(Match.ExactSectionIndex == INDEX_NONE
+				&& SectionHasAll(SectionMasks, OtherSectionIndex, SectionMask))
+			{
+				Match.ExactSectionIndex = OtherSectionIndex;
+			}
+		}
+
+		const uint32 MaskHash = HashMask(SectionMask, WordCount);
+		if(!SectionMaskLookup.Contains(MaskHash))
+		{
+			SectionMaskLookup.Add(MaskHash, SectionIndex);
+		}
+	}
+}
+
+void FMotionTagSectionTable::Empty()
+{
+	TagBits.Empty();
+	WordCount = 0;
+	SectionMasks.Empty();
+	SectionParentMasks.Empty();
+	SectionMatches.Empty();
+	SectionMaskLookup.Empty();
+}
+
+bool FMotionTagSectionTable::IsValid(const int32 InSectionCount) const
+{
+	return WordCount > 0
+		&& SectionMatches.Num() == InSectionCount
+		&& SectionMasks.Num() == InSectionCount * WordCount
+		&& SectionParentMasks.Num() == InSectionCount * WordCount;
+}
+
+FMotionTagSectionMatch FMotionTagSectionTable::Resolve(const FGameplayTagContainer& InTags) const
+{
+	FTagMask Mask;
+	if(!BuildMask(InTags, Mask))
+	{
+		return FMotionTagSectionMatch();
+	}
+
+	if(const int32* SectionIndex = SectionMaskLookup.Find(HashMask(Mask.GetData(), WordCount)))
+	{
+		if(FMemory::Memcmp(SectionMasks.GetData() + *SectionIndex * WordCount, Mask.GetData(), WordCount * sizeof(uint64)) == 0)
+		{
+			return SectionMatches[*SectionIndex];
+		}
+	}
+
+	//The tags are a subset of one or more sections (e.g. only some of the tags of a section)
+	FMotionTagSectionMatch Match;
+	for(int32 SectionIndex = 0; SectionIndex < SectionMatches.Num(); ++SectionIndex)
+	{
+		if(Match.SectionIndex == INDEX_NONE
+			&& SectionHasAll(SectionParentMasks, SectionIndex, Mask.GetData()))
+		{
+			Match.SectionIndex = SectionIndex;
+		}
+
+		if(Match.ExactSectionIndex == INDEX_NONE
+			&& SectionHasAll(SectionMasks, SectionIndex, Mask.GetData()))
+		{
+			Match.ExactSectionIndex = SectionIndex;
+			break; //An exact match is also a match so the section index has already been found
+		}
+	}
+
+	return Match;
+}
+
+bool FMotionTagSectionTable::BuildMask(const FGameplayTagContainer& InTags, FTagMask& OutMask) const
+{
+	OutMask.SetNumZeroed(WordCount);
+	for(const FGameplayTag& Tag : InTags)
+	{
+		const int32* Bit = TagBits.Find(Tag);
+		if(!Bit)
+		{
+			return false;
+		}
+
+		OutMask[*Bit / 64] |= 1ull << (*Bit % 64);
+	}
+
+	return true;
+}
+
+bool FMotionTagSectionTable::SectionHasAll(const TArray<uint64>& InSectionMasks, const int32 InSectionIndex,
+	const uint64* InMask) const
+{
+	const uint64* SectionMask = InSectionMasks.GetData() + InSectionIndex * WordCount;
+	for(int32 WordIndex = 0; WordIndex < WordCount; ++WordIndex)
+	{
+		if((SectionMask[WordIndex] & InMask[WordIndex]) != InMask[WordIndex])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32 FMotionTagSectionTable::HashMask(const uint64* InMask, const int32 InWordCount)
+{
+	uint32 Hash = 0;
+	for(int32 WordIndex = 0; WordIndex < InWordCount; ++WordIndex)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(InMask[WordIndex]));
+	}
+
+	return Hash;
+}
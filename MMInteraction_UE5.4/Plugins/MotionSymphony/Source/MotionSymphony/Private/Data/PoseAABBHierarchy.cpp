@@ -0,0 +1,324 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/PoseAABBHierarchy.h"
+#include "Data/PoseMatrix.h"
+#include "Data/PoseSearchTree.h"
+#include "Utility/MotionMatchingSearch.h"
+#include "Algo/Reverse.h"
+
+namespace PoseAABBHierarchy
+{
+	/** The leaf sizes that are evaluated when the leaf size of a section is chosen automatically */
+	static constexpr int32 CandidateLeafSizes[] = { 8, 16, 32, 64 };
+
+	/** The number of queries sampled from a section to evaluate the candidate leaf sizes with */
+	static constexpr int32 MaxSampleQueryCount = 16;
+
+	/** The estimated cost of testing a group of boxes relative to evaluating a single pose. A group reads twice as much
+	 * data per atom as a pose but has to clamp as well */
+	static constexpr float GroupTestCost = 2.5f;
+
+	/** The leaf size of the KD-tree used to order poses spatially */
+	static constexpr int32 SpatialOrderLeafSize = 4;
+}
+
+FPoseAABBHierarchySection::FPoseAABBHierarchySection()
+	: StartIndex(0),
+	EndIndex(0),
+	LeafSize(0)
+{
+}
+
+int32 FPoseAABBHierarchySection::GetBoxSize(const int32 Level) const
+{
+	int32 BoxSize = LeafSize;
+	for(int32 i = Level + 1; i < GetLevelCount(); ++i)
+	{
+		BoxSize *= FPoseAABBHierarchy::BranchFactor;
+	}
+
+	return BoxSize;
+}
+
+FPoseAABBHierarchy::FPoseAABBHierarchy()
+	: AtomCount(0)
+{
+}
+
+void FPoseAABBHierarchy::Build(const FPoseMatrix& InSearchMatrix, TConstArrayView<FPoseMatrixSection> InSections,
+	const int32 InLeafSize, const int32 InMaxLevelCount)
+{
+	Empty();
+
+	AtomCount = InSearchMatrix.AtomCount;
+	if(AtomCount <= 1)
+	{
+		return;
+	}
+
+	const int32 LevelCountLimit = FMath::Clamp(InMaxLevelCount, 1, MaxLevelCount);
+	for(const FPoseMatrixSection& Section : InSections)
+	{
+		const int32 StartPoseIndex = FMath::Clamp(Section.StartIndex, 0, InSearchMatrix.PoseCount);
+		const int32 EndPoseIndex = FMath::Clamp(Section.EndIndex, StartPoseIndex, InSearchMatrix.PoseCount);
+		const int32 LeafSize = InLeafSize > 0 ? InLeafSize : SelectLeafSize(InSearchMatrix, StartPoseIndex, EndPoseIndex, LevelCountLimit);
+
+		AddSection(InSearchMatrix, StartPoseIndex, EndPoseIndex, LeafSize, LevelCountLimit);
+	}
+
+	GroupExtents.Shrink();
+}
+
+void FPoseAABBHierarchy::Empty()
+{
+	AtomCount = 0;
+	Sections.Empty();
+	GroupExtents.Empty();
+}
+
+bool FPoseAABBHierarchy::IsValid(const int32 InAtomCount, TConstArrayView<FPoseMatrixSection> InSections) const
+{
+	if(AtomCount != InAtomCount
+		|| AtomCount <= 1
+		|| Sections.Num() != InSections.Num())
+	{
+		return false;
+	}
+
+	int32 GroupCount = 0;
+	for(int32 SectionIndex = 0; SectionIndex < Sections.Num(); ++SectionIndex)
+	{
+		const FPoseAABBHierarchySection& Section = Sections[SectionIndex];
+		if(Section.StartIndex != InSections[SectionIndex].StartIndex
+			|| Section.EndIndex != InSections[SectionIndex].EndIndex
+			|| Section.GetLevelCount() > MaxLevelCount
+			|| Section.LevelGroupOffsets.Num() != Section.GetLevelCount())
+		{
+			return false;
+		}
+
+		for(const int32 BoxCount : Section.LevelBoxCounts)
+		{
+			GroupCount += FMath::DivideAndRoundUp(BoxCount, BranchFactor);
+		}
+	}
+
+	return GroupExtents.Num() == GroupCount * GetGroupStride();
+}
+
+const float* FPoseAABBHierarchy::GetGroupExtents(const int32 GroupIndex) const
+{
+	return GroupExtents.GetData() + GroupIndex * GetGroupStride();
+}
+
+void FPoseAABBHierarchy::ComputeSpatialOrder(const FPoseMatrix& InSearchMatrix, TConstArrayView<FPoseMatrixSection> InSections,
+	TArray<int32>& OutOrder)
+{
+	OutOrder.SetNumUninitialized(InSearchMatrix.PoseCount);
+	for(int32 PoseIndex = 0; PoseIndex < InSearchMatrix.PoseCount; ++PoseIndex)
+	{
+		OutOrder[PoseIndex] = PoseIndex;
+	}
+
+	//The poses of every section of a KD-tree are ordered so that every node, and therefore every leaf, is contiguous
+	FPoseSearchTree Tree;
+	Tree.Build(InSearchMatrix, InSections, PoseAABBHierarchy::SpatialOrderLeafSize);
+
+	for(int32 SectionIndex = 0; SectionIndex < InSections.Num(); ++SectionIndex)
+	{
+		const int32 RootNodeIndex = Tree.GetSectionRootNode(SectionIndex);
+		if(RootNodeIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		const FPoseSearchTreeNode& RootNode = Tree.Nodes[RootNodeIndex];
+		const int32 StartPoseIndex = FMath::Clamp(InSections[SectionIndex].StartIndex, 0, InSearchMatrix.PoseCount);
+		for(int32 i = 0; i < RootNode.PoseCount; ++i)
+		{
+			OutOrder[StartPoseIndex + i] = Tree.PoseIndices[RootNode.StartIndex + i];
+		}
+	}
+}
+
+void FPoseAABBHierarchy::AddSection(const FPoseMatrix& InSearchMatrix, const int32 InStartIndex, const int32 InEndIndex,
+	const int32 InLeafSize, const int32 InMaxLevelCount)
+{
+	FPoseAABBHierarchySection& Section = Sections.AddDefaulted_GetRef();
+	Section.StartIndex = InStartIndex;
+	Section.EndIndex = InEndIndex;
+	Section.LeafSize = FMath::Max(InLeafSize, 1);
+
+	const int32 PoseCount = InEndIndex - InStartIndex;
+	if(PoseCount <= 0)
+	{
+		return;
+	}
+
+	//Add levels until the root level fits in a single group or the level limit is reached
+	TArray<int32, TInlineAllocator<MaxLevelCount>> LevelBoxCounts;
+	LevelBoxCounts.Add(FMath::DivideAndRoundUp(PoseCount, Section.LeafSize));
+	while(LevelBoxCounts.Last() > BranchFactor
+		&& LevelBoxCounts.Num() < InMaxLevelCount)
+	{
+		LevelBoxCounts.Add(FMath::DivideAndRoundUp(LevelBoxCounts.Last(), BranchFactor));
+	}
+
+	Algo::Reverse(LevelBoxCounts);
+	Section.LevelBoxCounts = LevelBoxCounts;
+
+	const int32 GroupStride = GetGroupStride();
+	for(const int32 BoxCount : LevelBoxCounts)
+	{
+		Section.LevelGroupOffsets.Add(GroupExtents.Num() / GroupStride);
+		GroupExtents.AddZeroed(FMath::DivideAndRoundUp(BoxCount, BranchFactor) * GroupStride);
+	}
+
+	auto GetBoxExtent = [this, &Section, GroupStride](const int32 Level, const int32 BoxIndex, const int32 AtomIndex, const bool bMax) -> float&
+	{
+		const int32 GroupIndex = Section.LevelGroupOffsets[Level] + BoxIndex / BranchFactor;
+		return GroupExtents[GroupIndex * GroupStride + AtomIndex * BranchFactor * 2 + (bMax ? BranchFactor : 0) + BoxIndex % BranchFactor];
+	};
+
+	//Leaf boxes bound their poses
+	const int32 LeafLevel = Section.GetLevelCount() - 1;
+	for(int32 BoxIndex = 0; BoxIndex < Section.LevelBoxCounts[LeafLevel]; ++BoxIndex)
+	{
+		const int32 StartPoseIndex = InStartIndex + BoxIndex * Section.LeafSize;
+		const int32 EndPoseIndex = FMath::Min(StartPoseIndex + Section.LeafSize, InEndIndex);
+		for(int32 AtomIndex = 0; AtomIndex < AtomCount; ++AtomIndex)
+		{
+			float MinValue = FLT_MAX;
+			float MaxValue = -FLT_MAX;
+			for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
+			{
+				const float Value = InSearchMatrix.PoseArray[PoseIndex * AtomCount + AtomIndex];
+				MinValue = FMath::Min(MinValue, Value);
+				MaxValue = FMath::Max(MaxValue, Value);
+			}
+
+			GetBoxExtent(LeafLevel, BoxIndex, AtomIndex, false) = MinValue;
+			GetBoxExtent(LeafLevel, BoxIndex, AtomIndex, true) = MaxValue;
+		}
+	}
+
+	//Every other box bounds its children
+	for(int32 Level = LeafLevel - 1; Level >= 0; --Level)
+	{
+		const int32 ChildBoxCount = Section.LevelBoxCounts[Level + 1];
+		for(int32 BoxIndex = 0; BoxIndex < Section.LevelBoxCounts[Level]; ++BoxIndex)
+		{
+			const int32 StartChildIndex = BoxIndex * BranchFactor;
+			const int32 EndChildIndex = FMath::Min(StartChildIndex + BranchFactor, ChildBoxCount);
+			for(int32 AtomIndex = 0; AtomIndex < AtomCount; ++AtomIndex)
+			{
+				float MinValue = FLT_MAX;
+				float MaxValue = -FLT_MAX;
+				for(int32 ChildIndex = StartChildIndex; ChildIndex < EndChildIndex; ++ChildIndex)
+				{
+					MinValue = FMath::Min(MinValue, GetBoxExtent(Level + 1, ChildIndex, AtomIndex, false));
+					MaxValue = FMath::Max(MaxValue, GetBoxExtent(Level + 1, ChildIndex, AtomIndex, true));
+				}
+
+				GetBoxExtent(Level, BoxIndex, AtomIndex, false) = MinValue;
+				GetBoxExtent(Level, BoxIndex, AtomIndex, true) = MaxValue;
+			}
+		}
+	}
+}
+
+int32 FPoseAABBHierarchy::SelectLeafSize(const FPoseMatrix& InSearchMatrix, const int32 InStartIndex, const int32 InEndIndex,
+	const int32 InMaxLevelCount)
+{
+	const int32 PoseCount = InEndIndex - InStartIndex;
+	const int32 AtomCount = InSearchMatrix.AtomCount;
+	if(PoseCount <= PoseAABBHierarchy::CandidateLeafSizes[0])
+	{
+		return PoseAABBHierarchy::CandidateLeafSizes[0];
+	}
+
+	const float* PoseArray = InSearchMatrix.PoseArray.GetData();
+
+	//Weight each atom by the inverse of its standard deviation within the section in place of the runtime calibration
+	TArray<double> Means;
+	TArray<double> Variances;
+	Means.SetNumZeroed(AtomCount);
+	Variances.SetNumZeroed(AtomCount);
+	for(int32 PoseIndex = InStartIndex; PoseIndex < InEndIndex; ++PoseIndex)
+	{
+		for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+		{
+			Means[AtomIndex] += PoseArray[PoseIndex * AtomCount + AtomIndex];
+		}
+	}
+
+	for(int32 PoseIndex = InStartIndex; PoseIndex < InEndIndex; ++PoseIndex)
+	{
+		for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+		{
+			Variances[AtomIndex] += FMath::Square(PoseArray[PoseIndex * AtomCount + AtomIndex] - Means[AtomIndex] / PoseCount);
+		}
+	}
+
+	TArray<float> Weights;
+	Weights.SetNumZeroed(AtomCount - 1);
+	for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+	{
+		const double StandardDeviation = FMath::Sqrt(Variances[AtomIndex] / PoseCount);
+		Weights[AtomIndex - 1] = FMath::IsNearlyZero(StandardDeviation) ? 0.0f : static_cast<float>(1.0 / StandardDeviation);
+	}
+
+	//Sample queries half way between two poses half a section apart so that queries do not exactly match a pose
+	const int32 QueryCount = FMath::Min(PoseCount, PoseAABBHierarchy::MaxSampleQueryCount);
+	TArray<float> Queries;
+	Queries.SetNumZeroed(QueryCount * AtomCount);
+	for(int32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+	{
+		const int32 PoseA = QueryIndex * PoseCount / QueryCount;
+		const int32 PoseB = (PoseA + PoseCount / 2) % PoseCount;
+		const float* RowA = PoseArray + (InStartIndex + PoseA) * AtomCount;
+		const float* RowB = PoseArray + (InStartIndex + PoseB) * AtomCount;
+		for(int32 AtomIndex = 0; AtomIndex < AtomCount; ++AtomIndex)
+		{
+			Queries[QueryIndex * AtomCount + AtomIndex] = (RowA[AtomIndex] + RowB[AtomIndex]) * 0.5f;
+		}
+	}
+
+	int32 BestLeafSize = PoseAABBHierarchy::CandidateLeafSizes[0];
+	float BestWork = UE_MAX_FLT;
+	for(const int32 LeafSize : PoseAABBHierarchy::CandidateLeafSizes)
+	{
+		if(LeafSize > PoseCount)
+		{
+			break;
+		}
+
+		FPoseAABBHierarchy Candidate;
+		Candidate.AtomCount = AtomCount;
+		Candidate.AddSection(InSearchMatrix, InStartIndex, InEndIndex, LeafSize, InMaxLevelCount);
+
+		float Work = 0.0f;
+		for(int32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+		{
+			const FPoseSearchQuery Query(Queries.GetData() + QueryIndex * AtomCount, Weights.GetData(), InStartIndex, InEndIndex);
+			FPoseSearchResult Result;
+			FMotionMatchingSearch::SearchAABBHierarchy(Candidate, PoseArray, Query, Result);
+
+			int32 BoxesChecked = 0;
+			for(int32 Level = 0; Level < MaxLevelCount; ++Level)
+			{
+				BoxesChecked += Result.LevelBoxesChecked[Level];
+			}
+
+			Work += Result.PosesChecked + PoseAABBHierarchy::GroupTestCost * BoxesChecked / BranchFactor;
+		}
+
+		if(Work < BestWork)
+		{
+			BestWork = Work;
+			BestLeafSize = LeafSize;
+		}
+	}
+
+	return BestLeafSize;
+}
@@ -0,0 +1,60 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/PoseHotTable.h"
+#include "Data/PoseMotionData.h"
+
+void FPoseHotTable::Build(TConstArrayView<FPoseMotionData> InPoses, TConstArrayView<FGameplayTagContainer> InMotionTagList)
+{
+	Empty();
+
+	const int32 PoseCount = InPoses.Num();
+	AnimIds.SetNumUninitialized(PoseCount);
+	Times.SetNumUninitialized(PoseCount);
+	NextPoseIds.SetNumUninitialized(PoseCount);
+	LastPoseIds.SetNumUninitialized(PoseCount);
+	Flags.SetNumUninitialized(PoseCount);
+	TagSectionIndices.SetNumUninitialized(PoseCount);
+
+	int32 LastSectionIndex = INDEX_NONE;
+	for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+	{
+		const FPoseMotionData& Pose = InPoses[PoseIndex];
+		AnimIds[PoseIndex] = Pose.AnimId;
+		Times[PoseIndex] = Pose.Time;
+		NextPoseIds[PoseIndex] = Pose.NextPoseId;
+		LastPoseIds[PoseIndex] = Pose.LastPoseId;
+		Flags[PoseIndex] = (static_cast<uint8>(Pose.SearchFlag) & SearchFlagMask)
+			| ((static_cast<uint8>(Pose.AnimType) << AnimTypeShift) & AnimTypeMask)
+			| (Pose.bMirrored ? MirroredBit : 0);
+
+		//Consecutive poses almost always share the tags of the previous pose, so check its section first
+		if(!InMotionTagList.IsValidIndex(LastSectionIndex)
+			|| InMotionTagList[LastSectionIndex] != Pose.MotionTags)
+		{
+			LastSectionIndex = InMotionTagList.IndexOfByKey(Pose.MotionTags);
+		}
+
+		TagSectionIndices[PoseIndex] = InMotionTagList.IsValidIndex(LastSectionIndex) && LastSectionIndex < InvalidTagSection
+			? static_cast<uint16>(LastSectionIndex) : InvalidTagSection;
+	}
+}
+
+void FPoseHotTable::Empty()
+{
+	AnimIds.Empty();
+	Times.Empty();
+	NextPoseIds.Empty();
+	LastPoseIds.Empty();
+	Flags.Empty();
+	TagSectionIndices.Empty();
+}
+
+bool FPoseHotTable::IsValid(const int32 InPoseCount) const
+{
+	return AnimIds.Num() == InPoseCount
+		&& Times.Num() == InPoseCount
+		&& NextPoseIds.Num() == InPoseCount
+		&& LastPoseIds.Num() == InPoseCount
+		&& Flags.Num() == InPoseCount
+		&& TagSectionIndices.Num() == InPoseCount;
+}
@@ -0,0 +1,318 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/PoseLookupTable.h"
+#include "Data/PoseMatrix.h"
+#include "Data/CalibrationData.h"
+#include "Objects/Assets/MotionMatchConfig.h"
+#include "Utility/MotionMatchingSearch.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Unique.h"
+
+namespace PoseLookupClustering
+{
+	/** The maximum number of k-means iterations. Clustering stops earlier if no pose changes cluster */
+	static constexpr int32 MaxIterations = 16;
+
+	/** The number of cluster members (in addition to the cluster center) used to gather the candidates of a cluster */
+	static constexpr int32 MaxRepresentatives = 8;
+
+	float ComputeDistance(const float* RowA, const float* RowB, const float* Weights, const int32 AtomCount)
+	{
+		//Skip the pose favour atom
+		return FMotionMatchingSearch::ComputeWeightedL1(RowA + 1, RowB + 1, Weights, AtomCount - 1);
+	}
+
+	int32 FindNearestCentroid(const float* Row, const TArray<float>& Centroids, const float* Weights, const int32 AtomCount)
+	{
+		int32 NearestIndex = 0;
+		float NearestDistance = UE_MAX_FLT;
+		for(int32 CentroidIndex = 0; CentroidIndex * AtomCount < Centroids.Num(); ++CentroidIndex)
+		{
+			const float Distance = ComputeDistance(Row, Centroids.GetData() + CentroidIndex * AtomCount, Weights, AtomCount);
+			if(Distance < NearestDistance)
+			{
+				NearestDistance = Distance;
+				NearestIndex = CentroidIndex;
+			}
+		}
+
+		return NearestIndex;
+	}
+
+	/** Clusters the poses [StartPoseIndex, EndPoseIndex) of a matrix into (up to) K clusters with k-means under the weighted
+	 * L1 distance. Initial centers are chosen by farthest point sampling from the first pose so the result is deterministic */
+	void Cluster(const FPoseMatrix& InMatrix, const int32 StartPoseIndex, const int32 EndPoseIndex, const float* Weights,
+		const int32 InK, TArray<float>& OutCentroids, TArray<int32>& OutAssignments)
+	{
+		const int32 AtomCount = InMatrix.AtomCount;
+		const int32 PoseCount = EndPoseIndex - StartPoseIndex;
+		const int32 K = FMath::Clamp(InK, 1, PoseCount);
+		const float* PoseArray = InMatrix.PoseArray.GetData() + StartPoseIndex * AtomCount;
+
+		OutCentroids.SetNumUninitialized(K * AtomCount);
+		OutAssignments.Init(INDEX_NONE, PoseCount);
+
+		TArray<float> MinDistances;
+		MinDistances.Init(UE_MAX_FLT, PoseCount);
+		int32 NextPoseIndex = 0;
+		for(int32 CentroidIndex = 0; CentroidIndex < K; ++CentroidIndex)
+		{
+			float* Centroid = OutCentroids.GetData() + CentroidIndex * AtomCount;
+			FMemory::Memcpy(Centroid, PoseArray + NextPoseIndex * AtomCount, AtomCount * sizeof(float));
+
+			ParallelFor(PoseCount, [&](const int32 PoseIndex)
+			{
+				MinDistances[PoseIndex] = FMath::Min(MinDistances[PoseIndex],
+					ComputeDistance(PoseArray + PoseIndex * AtomCount, Centroid, Weights, AtomCount));
+			});
+
+			float FarthestDistance = -1.0f;
+			for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+			{
+				if(MinDistances[PoseIndex] > FarthestDistance)
+				{
+					FarthestDistance = MinDistances[PoseIndex];
+					NextPoseIndex = PoseIndex;
+				}
+			}
+		}
+
+		TArray<int32> NewAssignments;
+		NewAssignments.SetNumUninitialized(PoseCount);
+		TArray<int32> ClusterSizes;
+		for(int32 Iteration = 0; Iteration < MaxIterations; ++Iteration)
+		{
+			ParallelFor(PoseCount, [&](const int32 PoseIndex)
+			{
+				NewAssignments[PoseIndex] = FindNearestCentroid(PoseArray + PoseIndex * AtomCount, OutCentroids, Weights, AtomCount);
+			});
+
+			if(NewAssignments == OutAssignments)
+			{
+				break;
+			}
+
+			OutAssignments = NewAssignments;
+
+			//Move each center to the mean of its poses. Empty clusters keep their center
+			ClusterSizes.Init(0, K);
+			for(const int32 Assignment : OutAssignments)
+			{
+				++ClusterSizes[Assignment];
+			}
+
+			for(int32 CentroidIndex = 0; CentroidIndex < K; ++CentroidIndex)
+			{
+				if(ClusterSizes[CentroidIndex] > 0)
+				{
+					FMemory::Memzero(OutCentroids.GetData() + CentroidIndex * AtomCount, AtomCount * sizeof(float));
+				}
+			}
+
+			for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+			{
+				float* Centroid = OutCentroids.GetData() + OutAssignments[PoseIndex] * AtomCount;
+				const float* PoseRow = PoseArray + PoseIndex * AtomCount;
+				const float Scale = 1.0f / ClusterSizes[OutAssignments[PoseIndex]];
+				for(int32 AtomIndex = 0; AtomIndex < AtomCount; ++AtomIndex)
+				{
+					Centroid[AtomIndex] += PoseRow[AtomIndex] * Scale;
+				}
+			}
+		}
+	}
+}
+
+FPoseLookupTable::FPoseLookupTable()
+	: SourceSearchStructureHash(0),
+	DatabasePoseCount(0)
+{
+}
+
+void FPoseLookupTable::Build(const uint32 InSearchStructureHash, const FPoseMatrix& InLookupMatrix,
+	const FPoseMatrix& InSearchMatrix, TConstArrayView<FPoseMatrixSection> InSections,
+	TConstArrayView<FCalibrationData> InSectionWeights, const UMotionMatchConfig* InMMConfig, const int32 InResponseClusterCount,
+	const int32 InCandidateSetCount)
+{
+	Empty();
+
+	const int32 AtomCount = InSearchMatrix.AtomCount;
+	if(!InMMConfig
+		|| AtomCount <= 1
+		|| InLookupMatrix.AtomCount != AtomCount
+		|| InSectionWeights.Num() != InSections.Num())
+	{
+		return;
+	}
+
+	//Find which atoms belong to quality features and which belong to response features
+	TArray<bool> ResponseAtoms;
+	ResponseAtoms.Reserve(AtomCount - 1);
+	for(const TObjectPtr<UMatchFeatureBase> Feature : InMMConfig->Features)
+	{
+		const int32 FeatureSize = Feature ? Feature->Size() : 0;
+		for(int32 i = 0; i < FeatureSize; ++i)
+		{
+			ResponseAtoms.Add(Feature->PoseCategory == EPoseCategory::Responsiveness);
+		}
+	}
+
+	if(ResponseAtoms.Num() != AtomCount - 1)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FPoseLookupTable: Failed to build the pose lookup table because the motion config does not match the pose matrix."));
+		return;
+	}
+
+	SourceSearchStructureHash = InSearchStructureHash;
+	DatabasePoseCount = InLookupMatrix.PoseCount;
+	PoseCandidateSets.Init(INDEX_NONE, InSections.Num() * DatabasePoseCount);
+	CandidateSetOffsets.Add(0);
+
+	TArray<float> QualityWeights;
+	TArray<float> ResponseWeights;
+	TArray<float> QualityCentroids;
+	TArray<float> ResponseCentroids;
+	TArray<int32> QualityAssignments;
+	TArray<int32> ResponseAssignments;
+	for(int32 SectionIndex = 0; SectionIndex < InSections.Num(); ++SectionIndex)
+	{
+		const int32 StartPoseIndex = FMath::Clamp(InSections[SectionIndex].StartIndex, 0, InSearchMatrix.PoseCount);
+		const int32 EndPoseIndex = FMath::Clamp(InSections[SectionIndex].EndIndex, StartPoseIndex, InSearchMatrix.PoseCount);
+		const TArray<float>& SectionWeights = InSectionWeights[SectionIndex].Weights;
+		if(StartPoseIndex == EndPoseIndex
+			|| SectionWeights.Num() != AtomCount - 1)
+		{
+			continue;
+		}
+
+		QualityWeights.SetNumUninitialized(AtomCount - 1);
+		ResponseWeights.SetNumUninitialized(AtomCount - 1);
+		for(int32 i = 0; i < AtomCount - 1; ++i)
+		{
+			QualityWeights[i] = ResponseAtoms[i] ? 0.0f : SectionWeights[i];
+			ResponseWeights[i] = ResponseAtoms[i] ? SectionWeights[i] : 0.0f;
+		}
+
+		PoseLookupClustering::Cluster(InSearchMatrix, StartPoseIndex, EndPoseIndex, ResponseWeights.GetData(),
+			InResponseClusterCount, ResponseCentroids, ResponseAssignments);
+		PoseLookupClustering::Cluster(InSearchMatrix, StartPoseIndex, EndPoseIndex, QualityWeights.GetData(),
+			InCandidateSetCount, QualityCentroids, QualityAssignments);
+
+		const int32 PoseCount = EndPoseIndex - StartPoseIndex;
+		const int32 ResponseClusterCount = ResponseCentroids.Num() / AtomCount;
+		const int32 QualityClusterCount = QualityCentroids.Num() / AtomCount;
+		const float* PoseArray = InSearchMatrix.PoseArray.GetData() + StartPoseIndex * AtomCount;
+
+		TArray<TArray<int32>> ClusterMembers;
+		ClusterMembers.SetNum(QualityClusterCount);
+		for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+		{
+			ClusterMembers[QualityAssignments[PoseIndex]].Add(PoseIndex);
+		}
+
+		//Gather the best pose of every response cluster for the center and some members of each quality cluster
+		TArray<TArray<int32>> CandidateSets;
+		CandidateSets.SetNum(QualityClusterCount);
+		ParallelFor(QualityClusterCount, [&](const int32 ClusterIndex)
+		{
+			const TArray<int32>& Members = ClusterMembers[ClusterIndex];
+			TArray<const float*, TInlineAllocator<PoseLookupClustering::MaxRepresentatives + 1>> Representatives;
+			Representatives.Add(QualityCentroids.GetData() + ClusterIndex * AtomCount);
+
+			const int32 MemberStep = FMath::Max(1, Members.Num() / PoseLookupClustering::MaxRepresentatives);
+			for(int32 i = 0; i < Members.Num() && Representatives.Num() <= PoseLookupClustering::MaxRepresentatives; i += MemberStep)
+			{
+				Representatives.Add(PoseArray + Members[i] * AtomCount);
+			}
+
+			TArray<float> BestCosts;
+			TArray<int32> BestPoses;
+			TArray<int32>& CandidateSet = CandidateSets[ClusterIndex];
+			for(const float* Representative : Representatives)
+			{
+				BestCosts.Init(UE_MAX_FLT, ResponseClusterCount);
+				BestPoses.Init(INDEX_NONE, ResponseClusterCount);
+				for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+				{
+					const float* PoseRow = PoseArray + PoseIndex * AtomCount;
+					const float Cost = PoseLookupClustering::ComputeDistance(Representative, PoseRow, QualityWeights.GetData(),
+						AtomCount) * PoseRow[0];
+
+					const int32 ResponseCluster = ResponseAssignments[PoseIndex];
+					if(Cost < BestCosts[ResponseCluster])
+					{
+						BestCosts[ResponseCluster] = Cost;
+						BestPoses[ResponseCluster] = PoseIndex + StartPoseIndex;
+					}
+				}
+
+				for(const int32 BestPose : BestPoses)
+				{
+					if(BestPose != INDEX_NONE)
+					{
+						CandidateSet.Add(BestPose);
+					}
+				}
+			}
+
+			CandidateSet.Sort();
+			CandidateSet.SetNum(Algo::Unique(CandidateSet));
+		});
+
+		const int32 FirstSetIndex = CandidateSetOffsets.Num() - 1;
+		for(const TArray<int32>& CandidateSet : CandidateSets)
+		{
+			CandidateIndices.Append(CandidateSet);
+			CandidateSetOffsets.Add(CandidateIndices.Num());
+		}
+
+		//Every database pose (including non-searchable poses) can be the current pose so they all need a candidate set
+		int32* SectionPoseCandidateSets = PoseCandidateSets.GetData() + SectionIndex * DatabasePoseCount;
+		ParallelFor(DatabasePoseCount, [&](const int32 PoseId)
+		{
+			SectionPoseCandidateSets[PoseId] = FirstSetIndex + PoseLookupClustering::FindNearestCentroid(
+				InLookupMatrix.PoseArray.GetData() + PoseId * AtomCount, QualityCentroids, QualityWeights.GetData(), AtomCount);
+		});
+	}
+}
+
+void FPoseLookupTable::Empty()
+{
+	SourceSearchStructureHash = 0;
+	DatabasePoseCount = 0;
+	PoseCandidateSets.Empty();
+	CandidateSetOffsets.Empty();
+	CandidateIndices.Empty();
+}
+
+bool FPoseLookupTable::IsValid(const uint32 InSearchStructureHash, const int32 InDatabasePoseCount, const int32 InSectionCount) const
+{
+	return CandidateSetOffsets.Num() > 1
+		&& SourceSearchStructureHash == InSearchStructureHash
+		&& DatabasePoseCount == InDatabasePoseCount
+		&& PoseCandidateSets.Num() == InSectionCount * InDatabasePoseCount;
+}
+
+TConstArrayView<int32> FPoseLookupTable::GetCandidates(const int32 SectionIndex, const int32 DatabasePoseId) const
+{
+	if(DatabasePoseId < 0
+		|| DatabasePoseId >= DatabasePoseCount)
+	{
+		return TConstArrayView<int32>();
+	}
+
+	const int32 CandidateSetIndex = PoseCandidateSets.IsValidIndex(SectionIndex * DatabasePoseCount + DatabasePoseId)
+		? PoseCandidateSets[SectionIndex * DatabasePoseCount + DatabasePoseId] : INDEX_NONE;
+	if(CandidateSetIndex == INDEX_NONE)
+	{
+		return TConstArrayView<int32>();
+	}
+
+	const int32 StartIndex = CandidateSetOffsets[CandidateSetIndex];
+	return TConstArrayView<int32>(CandidateIndices.GetData() + StartIndex, CandidateSetOffsets[CandidateSetIndex + 1] - StartIndex);
+}
+
+int32 FPoseLookupTable::GetCandidateSetCount() const
+{
+	return FMath::Max(CandidateSetOffsets.Num() - 1, 0);
+}
@@ -31,7 +31,7 @@ FPoseAABBMatrix::FPoseAABBMatrix(const FPoseMatrix& InSearchMatrix, const int32
 	for (int32 AABBIndex = 0; AABBIndex < AABBCount; ++AABBIndex)
 	{
 		const int32 StartPoseIndex = AABBIndex * InBoxSize;
-		const int32 EndPoseIndex = FMath::Min(StartPoseIndex + InBoxSize, PoseCount - 1);
+		const int32 EndPoseIndex = FMath::Min(StartPoseIndex + InBoxSize, static_cast<int32>(PoseCount));
 		const float AABBPoseIndex = AABBIndex * InBoxSize;
 
 		//Iterate through Poses
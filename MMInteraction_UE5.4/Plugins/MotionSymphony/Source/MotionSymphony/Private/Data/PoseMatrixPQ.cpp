@@ -0,0 +1,236 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/PoseMatrixPQ.h"
+#include "Data/PoseMatrix.h"
+#include "Async/ParallelFor.h"
+
+namespace PoseMatrixPQ
+{
+	/** The maximum number of centroids per subspace so that codes fit in a byte */
+	static constexpr int32 MaxCentroidCount = 256;
+
+	/** The maximum number of poses used to train the codebooks. Larger data sets are sub-sampled evenly */
+	static constexpr int32 MaxTrainingPoseCount = 16384;
+
+	static constexpr int32 TrainingIterations = 8;
+
+	float ComputeDistance(const float* A, const float* B, const float* Weights, const int32 Count)
+	{
+		float Distance = 0.0f;
+		for(int32 i = 0; i < Count; ++i)
+		{
+			Distance += FMath::Abs(A[i] - B[i]) * Weights[i];
+		}
+
+		return Distance;
+	}
+
+	int32 FindNearestCentroid(const float* Values, const float* Centroids, const int32 InCentroidCount, const int32 SubspaceSize,
+		const int32 Count, const float* Weights)
+	{
+		int32 NearestIndex = 0;
+		float NearestDistance = UE_MAX_FLT;
+		for(int32 CentroidIndex = 0; CentroidIndex < InCentroidCount; ++CentroidIndex)
+		{
+			const float Distance = ComputeDistance(Values, Centroids + CentroidIndex * SubspaceSize, Weights, Count);
+			if(Distance < NearestDistance)
+			{
+				NearestDistance = Distance;
+				NearestIndex = CentroidIndex;
+			}
+		}
+
+		return NearestIndex;
+	}
+}
+
+FPoseMatrixPQ::FPoseMatrixPQ()
+	: AtomCount(0),
+	PoseCount(0),
+	SubspaceSize(0),
+	CentroidCount(0)
+{
+}
+
+void FPoseMatrixPQ::Build(const FPoseMatrix& InSearchMatrix, const int32 InSubspaceSize)
+{
+	Empty();
+
+	if(InSearchMatrix.AtomCount <= 1
+		|| InSearchMatrix.PoseCount == 0)
+	{
+		return;
+	}
+
+	AtomCount = InSearchMatrix.AtomCount;
+	PoseCount = InSearchMatrix.PoseCount;
+	SubspaceSize = FMath::Clamp(InSubspaceSize, 1, AtomCount - 1);
+	CentroidCount = FMath::Min(PoseCount, PoseMatrixPQ::MaxCentroidCount);
+
+	const int32 FeatureCount = AtomCount - 1;
+	const int32 SubspaceCount = GetSubspaceCount();
+	const float* PoseArray = InSearchMatrix.PoseArray.GetData();
+
+	//Normalize each atom by its standard deviation so that the codebooks are not dominated by large value atoms
+	TArray<double> Means;
+	TArray<double> Variances;
+	Means.SetNumZeroed(FeatureCount);
+	Variances.SetNumZeroed(FeatureCount);
+	for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+	{
+		for(int32 i = 0; i < FeatureCount; ++i)
+		{
+			Means[i] += PoseArray[PoseIndex * AtomCount + i + 1];
+		}
+	}
+
+	for(double& Mean : Means)
+	{
+		Mean /= PoseCount;
+	}
+
+	for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+	{
+		for(int32 i = 0; i < FeatureCount; ++i)
+		{
+			Variances[i] += FMath::Square(PoseArray[PoseIndex * AtomCount + i + 1] - Means[i]);
+		}
+	}
+
+	TArray<float> TrainingWeights;
+	TrainingWeights.SetNumZeroed(SubspaceCount * SubspaceSize);
+	for(int32 i = 0; i < FeatureCount; ++i)
+	{
+		const double StandardDeviation = FMath::Sqrt(Variances[i] / PoseCount);
+		TrainingWeights[i] = FMath::IsNearlyZero(StandardDeviation) ? 0.0f : static_cast<float>(1.0 / StandardDeviation);
+	}
+
+	//Evenly sub-sample the poses used for training
+	const int32 TrainingPoseCount = FMath::Min(PoseCount, PoseMatrixPQ::MaxTrainingPoseCount);
+	TArray<int32> TrainingPoses;
+	TrainingPoses.SetNumUninitialized(TrainingPoseCount);
+	for(int32 i = 0; i < TrainingPoseCount; ++i)
+	{
+		TrainingPoses[i] = static_cast<int32>(static_cast<int64>(i) * PoseCount / TrainingPoseCount);
+	}
+
+	Codebooks.SetNumZeroed(SubspaceCount * CentroidCount * SubspaceSize);
+	Codes.SetNumUninitialized(PoseCount * SubspaceCount);
+	PoseFavours.SetNumUninitialized(PoseCount);
+	for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+	{
+		PoseFavours[PoseIndex] = PoseArray[PoseIndex * AtomCount];
+	}
+
+	ParallelFor(SubspaceCount, [&](const int32 SubspaceIndex)
+	{
+		const int32 FirstAtomIndex = SubspaceIndex * SubspaceSize + 1;
+		const int32 Count = FMath::Min(SubspaceSize, AtomCount - FirstAtomIndex);
+		const float* Weights = TrainingWeights.GetData() + SubspaceIndex * SubspaceSize;
+		float* Centroids = Codebooks.GetData() + SubspaceIndex * CentroidCount * SubspaceSize;
+
+		//Initialize the centroids from evenly spaced training poses
+		for(int32 CentroidIndex = 0; CentroidIndex < CentroidCount; ++CentroidIndex)
+		{
+			const int32 PoseIndex = TrainingPoses[CentroidIndex * TrainingPoseCount / CentroidCount];
+			FMemory::Memcpy(Centroids + CentroidIndex * SubspaceSize, PoseArray + PoseIndex * AtomCount + FirstAtomIndex,
+				Count * sizeof(float));
+		}
+
+		TArray<int32> ClusterSizes;
+		TArray<float> ClusterSums;
+		for(int32 Iteration = 0; Iteration < PoseMatrixPQ::TrainingIterations; ++Iteration)
+		{
+			ClusterSizes.Init(0, CentroidCount);
+			ClusterSums.Init(0.0f, CentroidCount * SubspaceSize);
+			for(const int32 PoseIndex : TrainingPoses)
+			{
+				const float* Values = PoseArray + PoseIndex * AtomCount + FirstAtomIndex;
+				const int32 CentroidIndex = PoseMatrixPQ::FindNearestCentroid(Values, Centroids, CentroidCount, SubspaceSize, Count, Weights);
+
+				++ClusterSizes[CentroidIndex];
+				for(int32 i = 0; i < Count; ++i)
+				{
+					ClusterSums[CentroidIndex * SubspaceSize + i] += Values[i];
+				}
+			}
+
+			//Empty clusters keep their centroid
+			for(int32 CentroidIndex = 0; CentroidIndex < CentroidCount; ++CentroidIndex)
+			{
+				if(ClusterSizes[CentroidIndex] > 0)
+				{
+					for(int32 i = 0; i < Count; ++i)
+					{
+						Centroids[CentroidIndex * SubspaceSize + i] = ClusterSums[CentroidIndex * SubspaceSize + i] / ClusterSizes[CentroidIndex];
+					}
+				}
+			}
+		}
+
+		for(int32 PoseIndex = 0; PoseIndex < PoseCount; ++PoseIndex)
+		{
+			Codes[PoseIndex * SubspaceCount + SubspaceIndex] = static_cast<uint8>(PoseMatrixPQ::FindNearestCentroid(
+				PoseArray + PoseIndex * AtomCount + FirstAtomIndex, Centroids, CentroidCount, SubspaceSize, Count, Weights));
+		}
+	});
+}
+
+void FPoseMatrixPQ::Empty()
+{
+	AtomCount = 0;
+	PoseCount = 0;
+	SubspaceSize = 0;
+	CentroidCount = 0;
+	Codebooks.Empty();
+	Codes.Empty();
+	PoseFavours.Empty();
+}
+
+bool FPoseMatrixPQ::IsValid(const int32 InAtomCount, const int32 InPoseCount) const
+{
+	return AtomCount == InAtomCount
+		&& PoseCount == InPoseCount
+		&& SubspaceSize > 0
+		&& Codebooks.Num() == GetSubspaceCount() * CentroidCount * SubspaceSize
+		&& Codes.Num() == PoseCount * GetSubspaceCount()
+		&& PoseFavours.Num() == PoseCount;
+}
+
+int32 FPoseMatrixPQ::GetSubspaceCount() const
+{
+	return SubspaceSize > 0 ? FMath::DivideAndRoundUp(AtomCount - 1, SubspaceSize) : 0;
+}
+
+void FPoseMatrixPQ::ComputeDistanceTable(const float* QueryPoseArray, const float* CalibrationArray, float* OutDistanceTable) const
+{
+	const int32 SubspaceCount = GetSubspaceCount();
+	for(int32 SubspaceIndex = 0; SubspaceIndex < SubspaceCount; ++SubspaceIndex)
+	{
+		const int32 FirstAtomIndex = SubspaceIndex * SubspaceSize + 1;
+		const int32 Count = FMath::Min(SubspaceSize, AtomCount - FirstAtomIndex);
+		const float* Query = QueryPoseArray + FirstAtomIndex;
+		const float* Weights = CalibrationArray + FirstAtomIndex - 1;
+		const float* Centroids = Codebooks.GetData() + SubspaceIndex * CentroidCount * SubspaceSize;
+
+		float* SubspaceTable = OutDistanceTable + SubspaceIndex * CentroidCount;
+		for(int32 CentroidIndex = 0; CentroidIndex < CentroidCount; ++CentroidIndex)
+		{
+			SubspaceTable[CentroidIndex] = PoseMatrixPQ::ComputeDistance(Query, Centroids + CentroidIndex * SubspaceSize, Weights, Count);
+		}
+	}
+}
+
+float FPoseMatrixPQ::ComputeCoarseCost(const int32 PoseIndex, const float* DistanceTable) const
+{
+	const int32 SubspaceCount = GetSubspaceCount();
+	const uint8* PoseCodes = Codes.GetData() + PoseIndex * SubspaceCount;
+
+	float Cost = 0.0f;
+	for(int32 SubspaceIndex = 0; SubspaceIndex < SubspaceCount; ++SubspaceIndex)
+	{
+		Cost += DistanceTable[SubspaceIndex * CentroidCount + PoseCodes[SubspaceIndex]];
+	}
+
+	return Cost;
+}
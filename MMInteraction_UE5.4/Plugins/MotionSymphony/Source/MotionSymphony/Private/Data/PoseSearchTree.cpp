@@ -0,0 +1,177 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/PoseSearchTree.h"
+#include "Data/PoseMatrix.h"
+#include "Algo/Sort.h"
+
+FPoseSearchTreeNode::FPoseSearchTreeNode()
+	: ChildIndex(INDEX_NONE),
+	StartIndex(0),
+	PoseCount(0)
+{
+}
+
+FPoseSearchTreeNode::FPoseSearchTreeNode(int32 InStartIndex, int32 InPoseCount)
+	: ChildIndex(INDEX_NONE),
+	StartIndex(InStartIndex),
+	PoseCount(InPoseCount)
+{
+}
+
+FPoseSearchTree::FPoseSearchTree()
+	: AtomCount(0)
+{
+}
+
+void FPoseSearchTree::Build(const FPoseMatrix& InSearchMatrix, TConstArrayView<FPoseMatrixSection> InSections,
+	const int32 InLeafSize)
+{
+	Empty();
+
+	AtomCount = InSearchMatrix.AtomCount;
+	if(AtomCount <= 1)
+	{
+		return;
+	}
+
+	const int32 LeafSize = FMath::Max(InLeafSize, 1);
+	PoseIndices.Reserve(InSearchMatrix.PoseCount);
+	SectionRootNodes.Reserve(InSections.Num());
+
+	//Each section gets its own tree since a search never spans more than one section
+	TArray<float> SectionExtents;
+	for(const FPoseMatrixSection& Section : InSections)
+	{
+		const int32 StartPoseIndex = FMath::Clamp(Section.StartIndex, 0, InSearchMatrix.PoseCount);
+		const int32 EndPoseIndex = FMath::Clamp(Section.EndIndex, StartPoseIndex, InSearchMatrix.PoseCount);
+		if(StartPoseIndex == EndPoseIndex)
+		{
+			SectionRootNodes.Add(INDEX_NONE);
+			continue;
+		}
+
+		const int32 StartIndex = PoseIndices.Num();
+		for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
+		{
+			PoseIndices.Add(PoseIndex);
+		}
+
+		const int32 RootNodeIndex = AddNode(InSearchMatrix, StartIndex, EndPoseIndex - StartPoseIndex);
+		SectionRootNodes.Add(RootNodeIndex);
+
+		//The node extents array may be re-allocated while splitting so the section extents need to be copied
+		SectionExtents.Reset();
+		SectionExtents.Append(GetNodeExtents(RootNodeIndex), AtomCount * 2);
+		SplitNode(InSearchMatrix, RootNodeIndex, SectionExtents.GetData(), LeafSize);
+	}
+
+	Nodes.Shrink();
+	ExtentsArray.Shrink();
+}
+
+void FPoseSearchTree::Empty()
+{
+	AtomCount = 0;
+	Nodes.Empty();
+	ExtentsArray.Empty();
+	PoseIndices.Empty();
+	SectionRootNodes.Empty();
+}
+
+bool FPoseSearchTree::IsValid(const int32 InAtomCount, const int32 InSectionCount) const
+{
+	return AtomCount == InAtomCount
+		&& SectionRootNodes.Num() == InSectionCount
+		&& ExtentsArray.Num() == Nodes.Num() * AtomCount * 2;
+}
+
+int32 FPoseSearchTree::GetSectionRootNode(const int32 SectionIndex) const
+{
+	return SectionRootNodes.IsValidIndex(SectionIndex) ? SectionRootNodes[SectionIndex] : INDEX_NONE;
+}
+
+const float* FPoseSearchTree::GetNodeExtents(const int32 NodeIndex) const
+{
+	return ExtentsArray.GetData() + NodeIndex * AtomCount * 2;
+}
+
+int32 FPoseSearchTree::AddNode(const FPoseMatrix& InSearchMatrix, const int32 InStartIndex, const int32 InPoseCount)
+{
+	const int32 NodeIndex = Nodes.Emplace(InStartIndex, InPoseCount);
+
+	//Initialize the extents so that the first pose checked becomes the node bounds
+	const int32 ExtentsStartIndex = ExtentsArray.AddUninitialized(AtomCount * 2);
+	float* Extents = ExtentsArray.GetData() + ExtentsStartIndex;
+	for(int32 i = 0; i < AtomCount * 2; i += 2)
+	{
+		Extents[i] = FLT_MAX; //Minimum Extent
+		Extents[i + 1] = -FLT_MAX; //Maximum Extent
+	}
+
+	for(int32 i = InStartIndex; i < InStartIndex + InPoseCount; ++i)
+	{
+		const float* PoseRow = InSearchMatrix.PoseArray.GetData() + PoseIndices[i] * AtomCount;
+		for(int32 AtomIndex = 0; AtomIndex < AtomCount; ++AtomIndex)
+		{
+			Extents[AtomIndex * 2] = FMath::Min(Extents[AtomIndex * 2], PoseRow[AtomIndex]);
+			Extents[AtomIndex * 2 + 1] = FMath::Max(Extents[AtomIndex * 2 + 1], PoseRow[AtomIndex]);
+		}
+	}
+
+	return NodeIndex;
+}
+
+void FPoseSearchTree::SplitNode(const FPoseMatrix& InSearchMatrix, const int32 NodeIndex, const float* SectionExtents,
+	const int32 InLeafSize)
+{
+	const int32 StartIndex = Nodes[NodeIndex].StartIndex;
+	const int32 PoseCount = Nodes[NodeIndex].PoseCount;
+	TArrayView<int32> NodePoseIndices(PoseIndices.GetData() + StartIndex, PoseCount);
+
+	//Find the atom with the largest spread relative to the section. The pose favour (atom 0) is never split on
+	int32 SplitAtomIndex = INDEX_NONE;
+	if(PoseCount > InLeafSize)
+	{
+		const float* NodeExtents = GetNodeExtents(NodeIndex);
+		float BestSpread = 0.0f;
+		for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+		{
+			const float SectionSpread = SectionExtents[AtomIndex * 2 + 1] - SectionExtents[AtomIndex * 2];
+			if(SectionSpread <= UE_KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			const float Spread = (NodeExtents[AtomIndex * 2 + 1] - NodeExtents[AtomIndex * 2]) / SectionSpread;
+			if(Spread > BestSpread)
+			{
+				BestSpread = Spread;
+				SplitAtomIndex = AtomIndex;
+			}
+		}
+	}
+
+	if(SplitAtomIndex == INDEX_NONE)
+	{
+		//Leaf poses are kept in search matrix order so that they are read from memory in order
+		Algo::Sort(NodePoseIndices);
+		return;
+	}
+
+	//Split at the median. Ties are broken by pose id so that the tree is deterministic
+	const float* PoseArray = InSearchMatrix.PoseArray.GetData();
+	Algo::Sort(NodePoseIndices, [PoseArray, SplitAtomIndex, this](const int32 A, const int32 B)
+	{
+		const float ValueA = PoseArray[A * AtomCount + SplitAtomIndex];
+		const float ValueB = PoseArray[B * AtomCount + SplitAtomIndex];
+		return ValueA < ValueB || (ValueA == ValueB && A < B);
+	});
+
+	const int32 LeftPoseCount = PoseCount / 2;
+	const int32 ChildIndex = AddNode(InSearchMatrix, StartIndex, LeftPoseCount);
+	AddNode(InSearchMatrix, StartIndex + LeftPoseCount, PoseCount - LeftPoseCount);
+	Nodes[NodeIndex].ChildIndex = ChildIndex;
+
+	SplitNode(InSearchMatrix, ChildIndex, SectionExtents, InLeafSize);
+	SplitNode(InSearchMatrix, ChildIndex + 1, SectionExtents, InLeafSize);
+}
@@ -0,0 +1,230 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Data/QuantizedPoseMatrix.h"
+#include "Data/PoseMatrix.h"
+
+namespace QuantizedPoseMatrix
+{
+	enum class ERounding : uint8
+	{
+		Nearest,
+		Down,
+		Up
+	};
+
+	/** The number of int8 steps the range of an atom is padded by on each side so that conservatively rounded extents are
+	 * always representable */
+	static constexpr float Int8RangePadding = 1.0f;
+	static constexpr float Int8MaxValue = 255.0f;
+
+	/** Conservative rounding keeps this margin from the source value so that a decoded value can never be on the wrong
+	 * side of it, even if the decode (Offset + Scale * Value) is contracted into a fused multiply add */
+	float ComputeMargin(const float Value)
+	{
+		return (FMath::Abs(Value) + 1.0f) * 4.0f * FLT_EPSILON;
+	}
+
+	uint8 EncodeInt8(const float Value, const float Offset, const float Scale, const ERounding Rounding)
+	{
+		const float Normalized = (Value - Offset) / Scale;
+		if(Rounding == ERounding::Nearest)
+		{
+			return static_cast<uint8>(FMath::Clamp(FMath::RoundToFloat(Normalized), 0.0f, Int8MaxValue));
+		}
+
+		const float Margin = ComputeMargin(Value);
+		if(Rounding == ERounding::Down)
+		{
+			int32 Quantized = FMath::Clamp(FMath::FloorToInt32(Normalized), 0, 255);
+			while(Quantized > 0 && Offset + Scale * Quantized > Value - Margin)
+			{
+				--Quantized;
+			}
+
+			return static_cast<uint8>(Quantized);
+		}
+
+		int32 Quantized = FMath::Clamp(FMath::CeilToInt32(Normalized), 0, 255);
+		while(Quantized < 255 && Offset + Scale * Quantized < Value + Margin)
+		{
+			++Quantized;
+		}
+
+		return static_cast<uint8>(Quantized);
+	}
+
+	/** Steps a half precision value to the next representable value towards negative or positive infinity */
+	uint16 StepHalf(const uint16 Encoded, const bool bDown)
+	{
+		const bool bNegative = (Encoded & 0x8000) != 0;
+		const uint16 Magnitude = Encoded & 0x7fff;
+		if(Magnitude == 0)
+		{
+			return bDown ? 0x8001 : 0x0001; //Smallest sub-normal either side of zero
+		}
+
+		return bNegative == bDown ? Encoded + 1 : Encoded - 1;
+	}
+
+	FFloat16 EncodeHalf(const float Value, const float Offset, const float Scale, const ERounding Rounding)
+	{
+		FFloat16 Quantized((Value - Offset) / Scale);
+		if(Rounding == ERounding::Nearest)
+		{
+			return Quantized;
+		}
+
+		const float Margin = ComputeMargin(Value);
+		for(int32 Step = 0; Step < 8; ++Step)
+		{
+			const float Decoded = Offset + Scale * Quantized.GetFloat();
+			const bool bConservative = Rounding == ERounding::Down ? Decoded <= Value - Margin : Decoded >= Value + Margin;
+			if(bConservative)
+			{
+				break;
+			}
+
+			Quantized.Encoded = StepHalf(Quantized.Encoded, Rounding == ERounding::Down);
+		}
+
+		return Quantized;
+	}
+}
+
+FQuantizedPoseMatrix::FQuantizedPoseMatrix()
+	: Precision(EPoseMatrixPrecision::Float),
+	ColumnCount(0),
+	RowCount(0)
+{
+}
+
+void FQuantizedPoseMatrix::ComputeAtomQuantization(const FPoseMatrix& InPoseMatrix, const EPoseMatrixPrecision InPrecision,
+	TArray<float>& OutOffsets, TArray<float>& OutScales)
+{
+	const int32 AtomCount = InPoseMatrix.AtomCount;
+	OutOffsets.SetNumZeroed(AtomCount);
+	OutScales.Init(1.0f, AtomCount);
+
+	if(InPoseMatrix.PoseCount == 0)
+	{
+		return;
+	}
+
+	for(int32 AtomIndex = 0; AtomIndex < AtomCount; ++AtomIndex)
+	{
+		float MinValue = UE_MAX_FLT;
+		float MaxValue = -UE_MAX_FLT;
+		for(int32 PoseIndex = 0; PoseIndex < InPoseMatrix.PoseCount; ++PoseIndex)
+		{
+			const float Value = InPoseMatrix.PoseArray[PoseIndex * AtomCount + AtomIndex];
+			MinValue = FMath::Min(MinValue, Value);
+			MaxValue = FMath::Max(MaxValue, Value);
+		}
+
+		const float Range = MaxValue - MinValue;
+		if(InPrecision == EPoseMatrixPrecision::Int8)
+		{
+			//Pad the range so that extents can be rounded outwards past the smallest and largest values
+			const float Scale = Range > UE_SMALL_NUMBER ? Range / (QuantizedPoseMatrix::Int8MaxValue - 2.0f * QuantizedPoseMatrix::Int8RangePadding) : 1.0f;
+			OutScales[AtomIndex] = Scale;
+			OutOffsets[AtomIndex] = MinValue - Scale * QuantizedPoseMatrix::Int8RangePadding;
+		}
+		else
+		{
+			//Map the range to [-1, 1] where half precision has the most resolution
+			OutScales[AtomIndex] = Range > UE_SMALL_NUMBER ? Range * 0.5f : 1.0f;
+			OutOffsets[AtomIndex] = (MinValue + MaxValue) * 0.5f;
+		}
+	}
+}
+
+void FQuantizedPoseMatrix::Quantize(TConstArrayView<float> InValues, const int32 InColumnCount, const EPoseMatrixPrecision InPrecision,
+	TConstArrayView<float> InColumnOffsets, TConstArrayView<float> InColumnScales, const bool bInConservativeExtents)
+{
+	Empty();
+
+	if(InPrecision == EPoseMatrixPrecision::Float
+		|| InColumnCount <= 0
+		|| InColumnOffsets.Num() != InColumnCount
+		|| InColumnScales.Num() != InColumnCount)
+	{
+		return;
+	}
+
+	Precision = InPrecision;
+	ColumnCount = InColumnCount;
+	RowCount = InValues.Num() / InColumnCount;
+	ColumnOffsets = InColumnOffsets;
+	ColumnScales = InColumnScales;
+
+	const int32 ValueCount = RowCount * ColumnCount;
+	if(Precision == EPoseMatrixPrecision::Int8)
+	{
+		Data.SetNumUninitialized(ValueCount * sizeof(uint8));
+	}
+	else
+	{
+		Data.SetNumUninitialized(ValueCount * sizeof(FFloat16));
+	}
+
+	for(int32 ValueIndex = 0; ValueIndex < ValueCount; ++ValueIndex)
+	{
+		const int32 Column = ValueIndex % ColumnCount;
+		const QuantizedPoseMatrix::ERounding Rounding = !bInConservativeExtents ? QuantizedPoseMatrix::ERounding::Nearest
+			: (Column % 2 == 0 ? QuantizedPoseMatrix::ERounding::Down : QuantizedPoseMatrix::ERounding::Up);
+
+		if(Precision == EPoseMatrixPrecision::Int8)
+		{
+			Data[ValueIndex] = QuantizedPoseMatrix::EncodeInt8(InValues[ValueIndex], ColumnOffsets[Column], ColumnScales[Column], Rounding);
+		}
+		else
+		{
+			reinterpret_cast<FFloat16*>(Data.GetData())[ValueIndex] = QuantizedPoseMatrix::EncodeHalf(InValues[ValueIndex],
+				ColumnOffsets[Column], ColumnScales[Column], Rounding);
+		}
+	}
+}
+
+void FQuantizedPoseMatrix::Dequantize(TArray<float>& OutValues) const
+{
+	OutValues.SetNumUninitialized(RowCount * ColumnCount);
+	for(int32 Row = 0; Row < RowCount; ++Row)
+	{
+		for(int32 Column = 0; Column < ColumnCount; ++Column)
+		{
+			OutValues[Row * ColumnCount + Column] = GetValue(Row, Column);
+		}
+	}
+}
+
+void FQuantizedPoseMatrix::Empty()
+{
+	Precision = EPoseMatrixPrecision::Float;
+	ColumnCount = 0;
+	RowCount = 0;
+	ColumnOffsets.Empty();
+	ColumnScales.Empty();
+	Data.Empty();
+}
+
+bool FQuantizedPoseMatrix::IsValid(const EPoseMatrixPrecision InPrecision, const int32 InColumnCount, const int32 InRowCount) const
+{
+	const int32 StorageSize = Precision == EPoseMatrixPrecision::Int8 ? sizeof(uint8) : sizeof(FFloat16);
+	return Precision == InPrecision
+		&& Precision != EPoseMatrixPrecision::Float
+		&& ColumnCount == InColumnCount
+		&& RowCount == InRowCount
+		&& ColumnOffsets.Num() == ColumnCount
+		&& ColumnScales.Num() == ColumnCount
+		&& Data.Num() == RowCount * ColumnCount * StorageSize;
+}
+
+float FQuantizedPoseMatrix::GetValue(const int32 Row, const int32 Column) const
+{
+	const int32 ValueIndex = Row * ColumnCount + Column;
+	const float Normalized = Precision == EPoseMatrixPrecision::Int8
+		? TPoseMatrixStorage<uint8>::Decode(Data[ValueIndex])
+		: TPoseMatrixStorage<FFloat16>::Decode(reinterpret_cast<const FFloat16*>(Data.GetData())[ValueIndex]);
+
+	return ColumnOffsets[Column] + ColumnScales[Column] * Normalized;
+}
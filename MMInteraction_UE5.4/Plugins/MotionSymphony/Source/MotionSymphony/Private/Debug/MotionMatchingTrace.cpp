@@ -0,0 +1,235 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Debug/MotionMatchingTrace.h"
+#include "Animation/AnimNodeBase.h"
+#include "Animation/AnimTrace.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "ObjectTrace.h"
+#include "Objects/Assets/MotionDataAsset.h"
+#include "Utility/MotionMatchingSearch.h"
+
+DEFINE_STAT(STAT_MMPoseSearch_Performance);
+DEFINE_STAT(STAT_MMPoseSearch_Quality);
+DEFINE_STAT(STAT_MMPoseSearch_Brute);
+DEFINE_STAT(STAT_MMPoseSearch_Tree);
+DEFINE_STAT(STAT_MMPoseSearch_CandidateLookup);
+DEFINE_STAT(STAT_MMPoseSearch_Compressed);
+DEFINE_STAT(STAT_MMPreProcess);
+
+DEFINE_STAT(STAT_MMPoseSearches);
+DEFINE_STAT(STAT_MMPosesEvaluated);
+DEFINE_STAT(STAT_MMOuterAABBsChecked);
+DEFINE_STAT(STAT_MMOuterAABBsPassed);
+DEFINE_STAT(STAT_MMInnerAABBsChecked);
+DEFINE_STAT(STAT_MMInnerAABBsPassed);
+DEFINE_STAT(STAT_MMNextNaturalWins);
+DEFINE_STAT(STAT_MMToleranceSkips);
+DEFINE_STAT(STAT_MMTransitions);
+
+#if MOTIONSYMPHONY_TRACE_ENABLED
+UE_TRACE_CHANNEL_DEFINE(MotionSymphonyChannel)
+
+UE_TRACE_EVENT_BEGIN(MotionSymphony, PoseSearch)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, AnimInstanceId)
+	UE_TRACE_EVENT_FIELD(int32, NodeId)
+	UE_TRACE_EVENT_FIELD(uint64, SearchCycles)
+	UE_TRACE_EVENT_FIELD(int32, PosesChecked)
+	UE_TRACE_EVENT_FIELD(int32, OuterAABBsChecked)
+	UE_TRACE_EVENT_FIELD(int32, OuterAABBsPassed)
+	UE_TRACE_EVENT_FIELD(int32, InnerAABBsChecked)
+	UE_TRACE_EVENT_FIELD(int32, InnerAABBsPassed)
+	UE_TRACE_EVENT_FIELD(uint8, Quality)
+	UE_TRACE_EVENT_FIELD(uint8, Outcome)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(MotionSymphony, PreProcess)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint64, MotionDataId)
+	UE_TRACE_EVENT_FIELD(uint64, PreProcessCycles)
+	UE_TRACE_EVENT_FIELD(int32, PoseCount)
+	UE_TRACE_EVENT_FIELD(int32, SearchPoseCount)
+UE_TRACE_EVENT_END()
+#endif
+
+namespace MotionMatchingTrace
+{
+	FName GetOutcomeName(const EMotionMatchingSearchOutcome InOutcome)
+	{
+		switch(InOutcome)
+		{
+			case EMotionMatchingSearchOutcome::ToleranceSkip: return FName("ToleranceSkip");
+			case EMotionMatchingSearchOutcome::Deferred: return FName("Deferred");
+			case EMotionMatchingSearchOutcome::NextNatural: return FName("NextNatural");
+			case EMotionMatchingSearchOutcome::SamePose: return FName("SamePose");
+			case EMotionMatchingSearchOutcome::Transition: return FName("Transition");
+			default: return NAME_None;
+		}
+	}
+
+	uint64 GetObjectId(const UObject* InObject)
+	{
+#if OBJECT_TRACE_ENABLED
+		return FObjectTrace::GetObjectId(InObject);
+#else
+		return 0;
+#endif
+	}
+}
+
+FMotionMatchingSearchTrace::FMotionMatchingSearchTrace()
+	: SearchCycles(0),
+	SearchCount(0),
+	NaturalPoseId(INDEX_NONE),
+	PosesChecked(0),
+	OuterAABBsChecked(0),
+	OuterAABBsPassed(0),
+	InnerAABBsChecked(0),
+	InnerAABBsPassed(0),
+	Quality(EMotionMatchingSearchQuality::Performance),
+	Outcome(EMotionMatchingSearchOutcome::None)
+{
+}
+
+void FMotionMatchingSearchTrace::Reset(const EMotionMatchingSearchQuality InQuality)
+{
+	*this = FMotionMatchingSearchTrace();
+	Quality = InQuality;
+}
+
+void FMotionMatchingSearchTrace::AddResult(const FPoseSearchResult& InSearchResult)
+{
+	PosesChecked += InSearchResult.PosesChecked;
+	OuterAABBsChecked += InSearchResult.OuterAABBsChecked;
+	OuterAABBsPassed += InSearchResult.OuterAABBsPassed;
+	InnerAABBsChecked += InSearchResult.InnerAABBsChecked;
+	InnerAABBsPassed += InSearchResult.InnerAABBsPassed;
+}
+
+void FMotionMatchingSearchTrace::AddDeferredSearch(const EMotionMatchingSearchQuality InQuality, const uint64 InSearchCycles)
+{
+	SearchCycles += InSearchCycles;
+	++SearchCount;
+
+#if STATS
+	//The worker time is added to the stat of the consuming thread since the submitting scope only timed the submission
+	FThreadStats::AddMessage(FMotionMatchingTrace::GetSearchStatId(InQuality).GetName(), EStatOperation::Add,
+		static_cast<int64>(InSearchCycles), true);
+#endif
+}
+
+TStatId FMotionMatchingTrace::GetSearchStatId(const EMotionMatchingSearchQuality InQuality)
+{
+	switch(InQuality)
+	{
+		case EMotionMatchingSearchQuality::Quality: return GET_STATID(STAT_MMPoseSearch_Quality);
+		case EMotionMatchingSearchQuality::Brute: return GET_STATID(STAT_MMPoseSearch_Brute);
+		case EMotionMatchingSearchQuality::Tree: return GET_STATID(STAT_MMPoseSearch_Tree);
+		case EMotionMatchingSearchQuality::CandidateLookup: return GET_STATID(STAT_MMPoseSearch_CandidateLookup);
+		case EMotionMatchingSearchQuality::Compressed: return GET_STATID(STAT_MMPoseSearch_Compressed);
+		default: return GET_STATID(STAT_MMPoseSearch_Performance);
+	}
+}
+
+#if MOTIONSYMPHONY_TRACE_ENABLED && COUNTERSTRACE_ENABLED
+void FMotionMatchingNodeTraceCounters::Output(const FAnimationBaseContext& InContext, const FMotionMatchingSearchTrace& InSearch)
+{
+	if(SearchTimeId == 0)
+	{
+		const FString CounterPrefix = FString::Printf(TEXT("MotionSymphony/%s/Node %d/"), *GetNameSafe(InContext.AnimInstanceProxy
+			? InContext.AnimInstanceProxy->GetAnimInstanceObject() : nullptr), InContext.GetCurrentNodeId());
+
+		SearchTimeId = FCountersTrace::OutputInitCounter(*(CounterPrefix + TEXT("Search Time (ms)")), TraceCounterType_Float,
+			TraceCounterDisplayHint_None);
+		PosesEvaluatedId = FCountersTrace::OutputInitCounter(*(CounterPrefix + TEXT("Poses Evaluated")), TraceCounterType_Int,
+			TraceCounterDisplayHint_None);
+		OuterAABBPassRateId = FCountersTrace::OutputInitCounter(*(CounterPrefix + TEXT("Outer AABB Pass Rate")), TraceCounterType_Float,
+			TraceCounterDisplayHint_None);
+		InnerAABBPassRateId = FCountersTrace::OutputInitCounter(*(CounterPrefix + TEXT("Inner AABB Pass Rate")), TraceCounterType_Float,
+			TraceCounterDisplayHint_None);
+	}
+
+	FCountersTrace::OutputSetValue(SearchTimeId, FPlatformTime::ToMilliseconds64(InSearch.SearchCycles));
+	FCountersTrace::OutputSetValue(PosesEvaluatedId, static_cast<int64>(InSearch.PosesChecked));
+	FCountersTrace::OutputSetValue(OuterAABBPassRateId, InSearch.OuterAABBsChecked > 0
+		? InSearch.OuterAABBsPassed / static_cast<double>(InSearch.OuterAABBsChecked) : 0.0);
+	FCountersTrace::OutputSetValue(InnerAABBPassRateId, InSearch.InnerAABBsChecked > 0
+		? InSearch.InnerAABBsPassed / static_cast<double>(InSearch.InnerAABBsChecked) : 0.0);
+}
+#endif
+
+void FMotionMatchingTrace::OutputSearch(const FAnimationBaseContext& InContext, const FMotionMatchingSearchTrace& InSearch,
+	FMotionMatchingNodeTraceCounters& InOutCounters)
+{
+	if(InSearch.Outcome == EMotionMatchingSearchOutcome::None
+		&& InSearch.SearchCount == 0)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT_BY(STAT_MMPoseSearches, InSearch.SearchCount);
+
+	INC_DWORD_STAT_BY(STAT_MMPosesEvaluated, InSearch.PosesChecked);
+	INC_DWORD_STAT_BY(STAT_MMOuterAABBsChecked, InSearch.OuterAABBsChecked);
+	INC_DWORD_STAT_BY(STAT_MMOuterAABBsPassed, InSearch.OuterAABBsPassed);
+	INC_DWORD_STAT_BY(STAT_MMInnerAABBsChecked, InSearch.InnerAABBsChecked);
+	INC_DWORD_STAT_BY(STAT_MMInnerAABBsPassed, InSearch.InnerAABBsPassed);
+	INC_DWORD_STAT_BY(STAT_MMNextNaturalWins, InSearch.Outcome == EMotionMatchingSearchOutcome::NextNatural ? 1 : 0);
+	INC_DWORD_STAT_BY(STAT_MMToleranceSkips, InSearch.Outcome == EMotionMatchingSearchOutcome::ToleranceSkip ? 1 : 0);
+	INC_DWORD_STAT_BY(STAT_MMTransitions, InSearch.Outcome == EMotionMatchingSearchOutcome::Transition ? 1 : 0);
+
+#if MOTIONSYMPHONY_TRACE_ENABLED
+#if COUNTERSTRACE_ENABLED
+	if(UE_TRACE_CHANNELEXPR_IS_ENABLED(CountersChannel))
+	{
+		InOutCounters.Output(InContext, InSearch);
+	}
+#endif
+
+	if(!UE_TRACE_CHANNELEXPR_IS_ENABLED(MotionSymphonyChannel))
+	{
+		return;
+	}
+
+	UE_TRACE_LOG(MotionSymphony, PoseSearch, MotionSymphonyChannel)
+		<< PoseSearch.Cycle(FPlatformTime::Cycles64())
+		<< PoseSearch.AnimInstanceId(MotionMatchingTrace::GetObjectId(InContext.AnimInstanceProxy
+			? InContext.AnimInstanceProxy->GetAnimInstanceObject() : nullptr))
+		<< PoseSearch.NodeId(InContext.GetCurrentNodeId())
+		<< PoseSearch.SearchCycles(InSearch.SearchCycles)
+		<< PoseSearch.PosesChecked(InSearch.PosesChecked)
+		<< PoseSearch.OuterAABBsChecked(InSearch.OuterAABBsChecked)
+		<< PoseSearch.OuterAABBsPassed(InSearch.OuterAABBsPassed)
+		<< PoseSearch.InnerAABBsChecked(InSearch.InnerAABBsChecked)
+		<< PoseSearch.InnerAABBsPassed(InSearch.InnerAABBsPassed)
+		<< PoseSearch.Quality(static_cast<uint8>(InSearch.Quality))
+		<< PoseSearch.Outcome(static_cast<uint8>(InSearch.Outcome));
+
+	//Node values are shown per node in Animation Insights when the animation channel is also enabled
+	TRACE_ANIM_NODE_VALUE(InContext, TEXT("Search Outcome"), MotionMatchingTrace::GetOutcomeName(InSearch.Outcome));
+	TRACE_ANIM_NODE_VALUE(InContext, TEXT("Search Time (ms)"), static_cast<float>(FPlatformTime::ToMilliseconds64(InSearch.SearchCycles)));
+	TRACE_ANIM_NODE_VALUE(InContext, TEXT("Poses Evaluated"), InSearch.PosesChecked);
+	TRACE_ANIM_NODE_VALUE(InContext, TEXT("Outer AABB Pass Rate"), InSearch.OuterAABBsChecked > 0
+		? InSearch.OuterAABBsPassed / static_cast<float>(InSearch.OuterAABBsChecked) : 0.0f);
+	TRACE_ANIM_NODE_VALUE(InContext, TEXT("Inner AABB Pass Rate"), InSearch.InnerAABBsChecked > 0
+		? InSearch.InnerAABBsPassed / static_cast<float>(InSearch.InnerAABBsChecked) : 0.0f);
+#endif
+}
+
+void FMotionMatchingTrace::OutputPreProcess(const UMotionDataAsset* InMotionData, const uint64 InCycles)
+{
+#if MOTIONSYMPHONY_TRACE_ENABLED
+	if(!InMotionData
+		|| !UE_TRACE_CHANNELEXPR_IS_ENABLED(MotionSymphonyChannel))
+	{
+		return;
+	}
+
+	UE_TRACE_LOG(MotionSymphony, PreProcess, MotionSymphonyChannel)
+		<< PreProcess.Cycle(FPlatformTime::Cycles64())
+		<< PreProcess.MotionDataId(MotionMatchingTrace::GetObjectId(InMotionData))
+		<< PreProcess.PreProcessCycles(InCycles)
+		<< PreProcess.PoseCount(InMotionData->Poses.Num())
+		<< PreProcess.SearchPoseCount(InMotionData->SearchPoseMatrix.PoseCount);
+#endif
+}
@@ -4,10 +4,15 @@
 #include "Kismet/KismetMathLibrary.h"
 #include "MotionAnimObject.h"
 #include "Utility/MotionMatchingUtils.h"
+#include "Utility/MotionMatchingSearch.h"
 #include "Utility/MMPreProcessUtils.h"
 #include "Data/AnimChannelState.h"
 #include "Animation/AnimNotifyQueue.h"
 #include "Misc/ScopedSlowTask.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/ArchiveCrc32.h"
+#include "UObject/ObjectSaveContext.h"
+#include "Data/MotionSymphonyCustomVersion.h"
 #include "Animation/BlendSpace.h"
 #include "Tags/TagSection.h"
 #include "Tags/Tag_Interaction.h"
@@ -15,15 +20,32 @@
 #include "Utility/MMBlueprintFunctionLibrary.h"
 #include "Animation/MirrorDataTable.h"
 #include "Data/MotionAnimAsset.h"
+#include "Debug/MotionMatchingTrace.h"
 
 #if WITH_EDITOR
 #include "AnimationEditorUtils.h"
+#include "Animation/AnimData/IAnimationDataModel.h"
 #include "Misc/MessageDialog.h"
 #endif
 
 
 #define LOCTEXT_NAMESPACE "MotionPreProcessEditor"
 
+static TAutoConsoleVariable<int32> CVarMotionDataParallelPreProcess(
+	TEXT("a.MoSymph.PreProcess.Parallel"),
+	1,
+	TEXT("Evaluates pose features in parallel when pre-processing motion data.\n")
+	TEXT("0: Single threaded\n")
+	TEXT("1: Parallel\n"));
+
+static TAutoConsoleVariable<int32> CVarMotionDataIncrementalPreProcess(
+	TEXT("a.MoSymph.PreProcess.Incremental"),
+	1,
+	TEXT("Re-uses the evaluated poses of animations that have not changed since the last pre-process.\n")
+	TEXT("Turn this off to force every pose to be evaluated, e.g. after changing match feature code.\n")
+	TEXT("0: Off\n")
+	TEXT("1: On\n"));
+
 UMotionDataAsset::UMotionDataAsset(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer),
 	PoseInterval(0.1f),
@@ -390,56 +412,112 @@ void UMotionDataAsset::PreProcess()
 		return;
 	}
 
+	SCOPE_CYCLE_COUNTER(STAT_MMPreProcess);
+	const uint64 PreProcessStartCycles = FPlatformTime::Cycles64();
+
 	FScopedSlowTask MMPreProcessTask(3, LOCTEXT("Motion Matching PreProcessor", "Pre-Processing..."));
 	MMPreProcessTask.MakeDialog();
-
-	FScopedSlowTask MMPreAnimAnalyseTask(SourceMotionSequenceObjects.Num() + SourceBlendSpaceObjects.Num() + SourceCompositeObjects.Num(), LOCTEXT("Motion Matching PreProcessor", "Analyzing Animation Poses"));
-	MMPreAnimAnalyseTask.MakeDialog();
 	
 	MotionMatchConfig->Initialize();
 
-	//Setup mirroring data
+	if(PoseInterval < 0.01f)
+	{
+		PoseInterval = 0.01f;
+	}
+
+	Modify();
 	ClearPoses();
-	InitializePoseMatrix();
-	
-	MMPreProcessTask.EnterProgressFrame();
 
+	//Sample the poses of every animation first. This is cheap and assigns every pose its final pose id (and therefore
+	//its row in the pose matrix) in a deterministic order before any features are evaluated
+	TArray<FMotionPreProcessRange> PreProcessRanges;
+	
 	//Animation Sequences
 	for (int32 i = 0; i < SourceMotionSequenceObjects.Num(); ++i)
 	{
-		MMPreAnimAnalyseTask.EnterProgressFrame();
-
-		PreProcessAnim(i, false);
+		PreProcessAnim(i, false, PreProcessRanges);
 
 		if (MirrorDataTable != nullptr && SourceMotionSequenceObjects[i]->bEnableMirroring)
 		{
-			PreProcessAnim(i, true);
+			PreProcessAnim(i, true, PreProcessRanges);
 		}
 	}
 
 	//Blend Spaces
 	for (int32 i = 0; i < SourceBlendSpaceObjects.Num(); ++i)
 	{
-		MMPreAnimAnalyseTask.EnterProgressFrame();
-
-		PreProcessBlendSpace(i, false);
+		PreProcessBlendSpace(i, false, PreProcessRanges);
 
 		if(MirrorDataTable != nullptr && SourceBlendSpaceObjects[i]->bEnableMirroring)
 		{
-			PreProcessBlendSpace(i, true);
+			PreProcessBlendSpace(i, true, PreProcessRanges);
 		}
 	}
 
 	//Composites
 	for (int32 i = 0; i < SourceCompositeObjects.Num(); ++i)
 	{
-		MMPreAnimAnalyseTask.EnterProgressFrame();
-		
-		PreProcessComposite(i, false);
+		PreProcessComposite(i, false, PreProcessRanges);
 
 		if (MirrorDataTable != nullptr && SourceCompositeObjects[i]->bEnableMirroring)
 		{
-			PreProcessComposite(i, true);
+			PreProcessComposite(i, true, PreProcessRanges);
+		}
+	}
+
+	InitializePoseMatrix();
+	
+	MMPreProcessTask.EnterProgressFrame();
+
+	//Re-use the evaluated rows of animations that have not changed since the last pre-process
+	TArray<int32> DirtyPoseIds;
+	RestorePreProcessCache(PreProcessRanges, DirtyPoseIds);
+
+	//Evaluate the features of every remaining pose. Each pose only writes to its own row so poses are evaluated in parallel.
+	//The work is split into chunks so that progress can be reported and the user can cancel between chunks
+	const int32 DirtyPoseCount = DirtyPoseIds.Num();
+	const int32 ChunkSize = FMath::Max(256, FMath::DivideAndRoundUp(DirtyPoseCount, 100));
+	const int32 ChunkCount = FMath::DivideAndRoundUp(DirtyPoseCount, ChunkSize);
+	const bool bForceSingleThread = CVarMotionDataParallelPreProcess.GetValueOnGameThread() <= 0;
+
+	FScopedSlowTask MMPreAnimAnalyseTask(ChunkCount, LOCTEXT("Motion Matching PreProcessor", "Analyzing Animation Poses"));
+	MMPreAnimAnalyseTask.MakeDialog(true);
+
+	//Bone transforms are decompressed once per animation and sample time and then shared by all features
+	FMMPreProcessPoseCacheScope PoseCacheScope;
+
+	for(int32 ChunkIndex = 0; ChunkIndex < ChunkCount; ++ChunkIndex)
+	{
+		if(MMPreAnimAnalyseTask.ShouldCancel())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Motion Data pre-processing was cancelled. The motion data asset is no longer processed."));
+			ClearPoses();
+			LookupPoseMatrix.PoseCount = 0;
+			LookupPoseMatrix.PoseArray.Empty();
+			return;
+		}
+		
+		MMPreAnimAnalyseTask.EnterProgressFrame();
+
+		const int32 ChunkStart = ChunkIndex * ChunkSize;
+		const int32 ChunkEnd = FMath::Min(ChunkStart + ChunkSize, DirtyPoseCount);
+		ParallelFor(ChunkEnd - ChunkStart, [this, &DirtyPoseIds, ChunkStart](int32 Index)
+		{
+			EvaluatePoseFeatures(DirtyPoseIds[ChunkStart + Index]);
+		}, bForceSingleThread);
+	}
+
+	StorePreProcessCache(PreProcessRanges);
+
+	//Tags may modify poses and pose matrix rows so they are applied serially, in the same order that poses were sampled
+	for(const FMotionPreProcessRange& Range : PreProcessRanges)
+	{
+		switch(Range.AnimType)
+		{
+			case EMotionAnimAssetType::Sequence: PreProcessAnimTags(Range); break;
+			case EMotionAnimAssetType::BlendSpace: PreProcessBlendSpaceTags(Range); break;
+			case EMotionAnimAssetType::Composite: PreProcessCompositeTags(Range); break;
+			default: break;
 		}
 	}
 	
@@ -453,6 +531,17 @@ void UMotionDataAsset::PreProcess()
 	// 	UsedMotionTraits.AddUnique(Poses[i].Traits);
 	// }
 
+	MMPreProcessTask.EnterProgressFrame();
+	GenerateSearchData();
+
+	TRACE_MOTION_DATA_PRE_PROCESS(this, FPlatformTime::Cycles64() - PreProcessStartCycles);
+
+	MMPreProcessTask.EnterProgressFrame();
+#endif
+}
+
+void UMotionDataAsset::GenerateSearchData()
+{
 	TArray<FGameplayTagContainer> UsedMotionTags;
 	for(int32 i = 0; i < Poses.Num(); ++i)
 	{
@@ -469,27 +558,59 @@ void UMotionDataAsset::PreProcess()
 		MotionTagList.Emplace(Tags);
 		MotionTagMatrixSections.Emplace(FPoseMatrixSection());
 	}
+
+	MotionTagSectionTable.Build(MotionTagList);
 	
 	GenerateSearchPoseMatrix();
-	MMPreProcessTask.EnterProgressFrame();
 
 	//Standard deviations
 	FeatureStandardDeviations.Empty(TagSlack);
 	for (const FGameplayTagContainer& Tags : UsedMotionTags)
-	{;
+	{
 		FeatureStandardDeviations.Emplace(FCalibrationData(this));
 		FeatureStandardDeviations.Last().GenerateStandardDeviationWeights(this, Tags);
 	}
+
+	GenerateFinalCalibrationWeights();
+
+	FeatureEvaluationOrders.Empty(bOptimizeFeatureEvaluationOrder ? TagSlack : 0);
+	if(bOptimizeFeatureEvaluationOrder)
+	{
+		for(const FCalibrationData& FeatureStdDev : FeatureStandardDeviations)
+		{
+			FeatureEvaluationOrders.Emplace();
+			FeatureEvaluationOrders.Last().Generate(MotionMatchConfig, FeatureStdDev);
+		}
+	}
+
+	GeneratePoseLookupTable();
 	
+	PoseHotTable.Build(Poses, MotionTagList);
+
 	bIsProcessed = true;
+}
 
-	MMPreProcessTask.EnterProgressFrame();
-#endif
+void UMotionDataAsset::GeneratePoseLookupTable()
+{
+	PoseLookupTable.Empty();
+	if(!bGeneratePoseLookupTable)
+	{
+		return;
+	}
+
+	PoseLookupTable.Build(SearchStructureHash, LookupPoseMatrix, SearchPoseMatrix, MotionTagMatrixSections, FinalCalibrationWeights,
+		MotionMatchConfig, LookupTableResponseClusters, LookupTableCandidateSets);
+
+	UE_LOG(LogTemp, Log, TEXT("UMotionDataAsset: Built a pose lookup table for '%s' with %d candidate sets and an average of %.1f candidates per set (%d searchable poses)."),
+		*GetName(), PoseLookupTable.GetCandidateSetCount(),
+		PoseLookupTable.CandidateIndices.Num() / static_cast<float>(FMath::Max(PoseLookupTable.GetCandidateSetCount(), 1)),
+		SearchPoseMatrix.PoseCount);
 }
 
 void UMotionDataAsset::ClearPoses()
 {
 	Poses.Empty();
+	PoseHotTable.Empty();
 	bIsProcessed = false;
 }
 
@@ -626,85 +747,89 @@ float UMotionDataAsset::GetPoseFavour(const int32 PoseId) const
 
 int32 UMotionDataAsset::GetMotionTagIndex(const FGameplayTagContainer& MotionTags) const
 {
-	for(int32 TagContainerIndex = 0; TagContainerIndex < MotionTagList.Num(); ++TagContainerIndex)
-	{
-		if(MotionTagList[TagContainerIndex].HasAll(MotionTags))
-		{
-			return TagContainerIndex;
-		}
-	}
-	
-	return 0;
+	const int32 SectionIndex = ResolveMotionTags(MotionTags).SectionIndex;
+	return SectionIndex != INDEX_NONE ? SectionIndex : 0;
 }
 
 int32 UMotionDataAsset::GetMotionTagStartPoseIndex(const FGameplayTagContainer& MotionTags) const
 {
-	for(int32 TagContainerIndex = 0; TagContainerIndex < MotionTagList.Num(); ++TagContainerIndex)
-	{
-		if(MotionTagList[TagContainerIndex].HasAllExact(MotionTags))
-		{
-			return MotionTagMatrixSections[TagContainerIndex].StartIndex;
-		}
-	}
-	
-	return 0;
+	int32 StartIndex, EndIndex;
+	GetMotionTagStartAndEndPoseIndex(MotionTags, StartIndex, EndIndex);
+	return StartIndex;
 }
 
 int32 UMotionDataAsset::GetMotionTagEndPoseIndex(const FGameplayTagContainer& MotionTags) const
 {
-	for(int32 TagContainerIndex = 0; TagContainerIndex < MotionTagList.Num(); ++TagContainerIndex)
-	{
-		if(MotionTagList[TagContainerIndex].HasAllExact(MotionTags))
-		{
-			return MotionTagMatrixSections[TagContainerIndex].EndIndex;
-		}
-	}
-	
-	return SearchPoseMatrix.PoseCount - 1;
+	int32 StartIndex, EndIndex;
+	GetMotionTagStartAndEndPoseIndex(MotionTags, StartIndex, EndIndex);
+	return EndIndex;
 }
 
 void UMotionDataAsset::GetMotionTagStartAndEndPoseIndex(const FGameplayTagContainer& MotionTags, int32& OutStartIndex,
 	int32& OutEndIndex) const
 {
+	GetMotionTagSectionRange(ResolveMotionTags(MotionTags).ExactSectionIndex, OutStartIndex, OutEndIndex);
+}
+
+void UMotionDataAsset::FindMotionTagRangeIndices(const FGameplayTagContainer& MotionTags, int32& OutStartIndex,
+                                                 int32& OutEndIndex) const
+{
+	GetMotionTagSectionRange(ResolveMotionTags(MotionTags).SectionIndex, OutStartIndex, OutEndIndex);
+}
+
+FMotionTagSectionMatch UMotionDataAsset::ResolveMotionTags(const FGameplayTagContainer& MotionTags) const
+{
+	if(MotionTagSectionTable.IsValid(MotionTagList.Num()))
+	{
+		return MotionTagSectionTable.Resolve(MotionTags);
+	}
+
+	//Fallback for when the section table has not been compiled
+	FMotionTagSectionMatch Match;
 	for(int32 TagContainerIndex = 0; TagContainerIndex < MotionTagList.Num(); ++TagContainerIndex)
 	{
-		if(MotionTagList[TagContainerIndex].HasAllExact(MotionTags))
+		if(Match.SectionIndex == INDEX_NONE
+			&& MotionTagList[TagContainerIndex].HasAll(MotionTags))
 		{
-			OutStartIndex =  MotionTagMatrixSections[TagContainerIndex].StartIndex;
-			OutEndIndex = MotionTagMatrixSections[TagContainerIndex].EndIndex;
-			return;
+			Match.SectionIndex = TagContainerIndex;
+		}
+
+		if(Match.ExactSectionIndex == INDEX_NONE
+			&& MotionTagList[TagContainerIndex].HasAllExact(MotionTags))
+		{
+			Match.ExactSectionIndex = TagContainerIndex;
 		}
 	}
 
-	OutStartIndex = 0;
-	OutEndIndex = SearchPoseMatrix.PoseCount - 1;
+	return Match;
 }
 
-void UMotionDataAsset::FindMotionTagRangeIndices(const FGameplayTagContainer& MotionTags, int32& OutStartIndex,
-                                                 int32& OutEndIndex) const
+void UMotionDataAsset::GetMotionTagSectionRange(const int32 SectionIndex, int32& OutStartIndex, int32& OutEndIndex) const
 {
-	for(int32 TagContainerIndex = 0; TagContainerIndex < MotionTagList.Num(); ++TagContainerIndex)
+	if(MotionTagMatrixSections.IsValidIndex(SectionIndex))
 	{
-		if(MotionTagList[TagContainerIndex].HasAll(MotionTags))
-		{
-			const FPoseMatrixSection& Section = MotionTagMatrixSections[TagContainerIndex];
-			
-			OutStartIndex = Section.StartIndex;
-			OutEndIndex = Section.EndIndex;
-			
-			return;
-		}
+		const FPoseMatrixSection& Section = MotionTagMatrixSections[SectionIndex];
+
+		OutStartIndex = Section.StartIndex;
+		OutEndIndex = Section.EndIndex;
+		return;
 	}
-	
+
 	OutStartIndex = 0;
 	OutEndIndex = SearchPoseMatrix.PoseCount - 1;
 }
 
+void UMotionDataAsset::SearchPoseBatch(TConstArrayView<FPoseSearchQuery> Queries, TArrayView<FPoseSearchResult> InOutResults) const
+{
+	FMotionMatchingSearch::SearchAABBBatch(this, Queries, InOutResults);
+}
+
 int32 UMotionDataAsset::MatrixPoseIdToDatabasePoseId(int32 MatrixPoseId) const
 {
-	if(MatrixPoseId < PoseIdRemap.Num())
+	const TConstArrayView<int32> PoseIdRemapView = GetPoseIdRemap();
+	if(MatrixPoseId < PoseIdRemapView.Num())
 	{
-		return PoseIdRemap[MatrixPoseId];
+		return PoseIdRemapView[MatrixPoseId];
 	}
 	
 	//Todo: Failed, log here
@@ -713,9 +838,11 @@ int32 UMotionDataAsset::MatrixPoseIdToDatabasePoseId(int32 MatrixPoseId) const
 
 int32 UMotionDataAsset::DatabasePoseIdToMatrixPoseId(int32 DatabasePoseId) const
 {
-	if(const int32* MatrixPoseId = PoseIdRemapReverse.Find(DatabasePoseId))
+	const TConstArrayView<int32> PoseIdRemapReverseView = GetPoseIdRemapReverse();
+	if(PoseIdRemapReverseView.IsValidIndex(DatabasePoseId)
+		&& PoseIdRemapReverseView[DatabasePoseId] != INDEX_NONE)
 	{
-		return *MatrixPoseId;
+		return PoseIdRemapReverseView[DatabasePoseId];
 	}
 
 	//Todo: Failed, log here
@@ -727,114 +854,857 @@ bool UMotionDataAsset::IsSearchPoseMatrixGenerated() const
 	return SearchPoseMatrix.PoseCount > 0;
 }
 
-void UMotionDataAsset::PostLoad()
+bool UMotionDataAsset::IsSearchTreeValid() const
 {
-	Super::Super::PostLoad();
+	return SearchTree.IsValid(SearchPoseMatrix.AtomCount, MotionTagMatrixSections.Num());
+}
 
-	for (TObjectPtr<UMotionAnimObject> MotionAnim : SourceMotionSequenceObjects)
+bool UMotionDataAsset::IsPoseLookupTableValid() const
+{
+	return PoseLookupTable.IsValid(SearchStructureHash, Poses.Num(), MotionTagMatrixSections.Num());
+}
+
+bool UMotionDataAsset::IsSearchMatrixPQValid() const
+{
+	return SearchMatrixPQ.IsValid(SearchPoseMatrix.AtomCount, SearchPoseMatrix.PoseCount);
+}
+
+bool UMotionDataAsset::IsQuantizedSearchDataValid() const
+{
+	const int32 AtomCount = SearchPoseMatrix.AtomCount;
+	const int32 PoseCount = SearchPoseMatrix.PoseCount;
+	
+	return QuantizedSearchPoseMatrix.IsValid(SearchMatrixPrecision, AtomCount, PoseCount)
+		&& QuantizedOuterAABBExtents.IsValid(SearchMatrixPrecision, AtomCount * 2, FMath::DivideAndRoundUp(PoseCount, 64))
+		&& QuantizedInnerAABBExtents.IsValid(SearchMatrixPrecision, AtomCount * 2, FMath::DivideAndRoundUp(PoseCount, 16));
+}
+
+bool UMotionDataAsset::IsAABBHierarchyValid() const
+{
+	return AABBHierarchy.IsValid(SearchPoseMatrix.AtomCount, MotionTagMatrixSections);
+}
+
+bool UMotionDataAsset::IsFeatureMajorSearchMatrixValid() const
+{
+	return FeatureMajorSearchMatrix.IsValid(SearchPoseMatrix.AtomCount, SearchPoseMatrix.PoseCount);
+}
+
+bool UMotionDataAsset::IsPoseHotTableValid() const
+{
+	return PoseHotTable.IsValid(Poses.Num());
+}
+
+bool UMotionDataAsset::AreFinalCalibrationWeightsValid() const
+{
+	//The weights are baked from the config so they are out of date if its default calibration was changed since
+	if(FinalCalibrationWeights.Num() != FeatureStandardDeviations.Num()
+		|| FinalCalibrationConfigHash != ComputeCalibrationConfigHash())
 	{
-		if(MotionAnim)
-		{
-			MotionAnim->ParentMotionDataAsset = this;
-		}
+		return false;
 	}
 
-	for (TObjectPtr<UMotionAnimObject> MotionComposite : SourceCompositeObjects)
+	for(const FCalibrationData& FinalWeights : FinalCalibrationWeights)
 	{
-		if(MotionComposite)
+		if(FinalWeights.Weights.Num() != SearchPoseMatrix.AtomCount - 1)
 		{
-			MotionComposite->ParentMotionDataAsset = this;
+			return false;
 		}
 	}
 
-	for (TObjectPtr<UMotionAnimObject> MotionBlendSpace : SourceBlendSpaceObjects)
+	return true;
+}
+
+uint32 UMotionDataAsset::ComputeCalibrationConfigHash() const
+{
+	if(!MotionMatchConfig)
 	{
-		if(MotionBlendSpace)
-		{
-			MotionBlendSpace->ParentMotionDataAsset = this;
-		}
+		return 0;
 	}
 
-	/* This section is to take any legacy FMotionAnimAsset data and convert it into UMotionAnimObject Data
-	 * Once this has run once it will never have to be done again. This will be removed at a later date once
-	 * all users have had a fair chance to convert the data */
-	if(SourceMotionAnims.Num() > 0)
+	//Only serialized properties are hashed (the default weights of the features rather than the DefaultCalibrationArray)
+	//so that this is valid before the config has been initialized
+	uint32 Hash = GetTypeHash(MotionMatchConfig->DefaultQualityVsResponsivenessRatio);
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(MotionMatchConfig->bNormalizeWeightsByQuantity)));
+	for(const TArray<TObjectPtr<UMatchFeatureBase>>* FeatureList : {&MotionMatchConfig->InputResponseFeatures, &MotionMatchConfig->PoseQualityFeatures})
 	{
-		for(FMotionAnimSequence& MotionAnimSequence : SourceMotionAnims)
+		Hash = HashCombine(Hash, GetTypeHash(FeatureList->Num()));
+		for(const TObjectPtr<UMatchFeatureBase> Feature : *FeatureList)
 		{
-			SourceMotionSequenceObjects.Emplace(NewObject<UMotionSequenceObject>(this, UMotionSequenceObject::StaticClass()));
-			SourceMotionSequenceObjects.Last()->InitializeFromLegacy(&MotionAnimSequence);
+			if(!Feature
+				|| !Feature->IsSetupValid())
+			{
+				continue;
+			}
+
+			const int32 FeatureSize = Feature->Size();
+			for(int32 AtomIndex = 0; AtomIndex < FeatureSize; ++AtomIndex)
+			{
+				Hash = HashCombine(Hash, GetTypeHash(Feature->GetDefaultWeight(AtomIndex)));
+			}
 		}
-		
-		SourceMotionAnims.Empty(0);
-		Modify(true);
 	}
 
-	if(SourceBlendSpaces.Num() > 0)
+	return Hash;
+}
+
+void UMotionDataAsset::GenerateFinalCalibrationWeights()
+{
+	FinalCalibrationWeights.Empty(FeatureStandardDeviations.Num());
+
+	if(MotionMatchConfig)
 	{
-		for(FMotionBlendSpace& MotionBlendSpace : SourceBlendSpaces)
+		InitializeMotionMatchConfig();
+
+		for(const FCalibrationData& FeatureStdDev : FeatureStandardDeviations)
 		{
-			SourceBlendSpaceObjects.Emplace(NewObject<UMotionBlendSpaceObject>(this, UMotionBlendSpaceObject::StaticClass()));
-			SourceBlendSpaceObjects.Last()->InitializeFromLegacy(&MotionBlendSpace);
+			FinalCalibrationWeights.Emplace();
+			FinalCalibrationWeights.Last().GenerateFinalWeights(MotionMatchConfig, FeatureStdDev);
 		}
-		
-		SourceBlendSpaces.Empty(0);
-		Modify(true);
 	}
 
-	if(SourceComposites.Num() > 0)
+	FinalCalibrationConfigHash = ComputeCalibrationConfigHash();
+	CacheSectionCalibrationBuffer();
+}
+
+const float* UMotionDataAsset::GetSectionCalibrationWeights(const int32 SectionIndex) const
+{
+	if(SectionIndex < 0
+		|| SectionCalibrationStride == 0
+		|| (SectionIndex + 1) * SectionCalibrationStride > SectionCalibrationBuffer.Num())
 	{
-		for(FMotionComposite& MotionComposite : SourceComposites)
-		{
-			SourceCompositeObjects.Emplace(NewObject<UMotionCompositeObject>(this, UMotionCompositeObject::StaticClass()));
-			SourceCompositeObjects.Last()->InitializeFromLegacy(&MotionComposite);
-		}
-		
-		SourceComposites.Empty(0);
-		Modify(true);
+		return nullptr;
 	}
+
+	return SectionCalibrationBuffer.GetData() + SectionIndex * SectionCalibrationStride;
 }
 
-void UMotionDataAsset::Serialize(FArchive& Ar)
+void UMotionDataAsset::InitializeMotionMatchConfig()
 {
-	Super::Super::Serialize(Ar);
+	if(!MotionMatchConfig)
+	{
+		return;
+	}
+
+	//The config is in another package and its Features are not serialized, so it may not be set up yet during PostLoad
+	MotionMatchConfig->ConditionalPostLoad();
+	if(MotionMatchConfig->NeedsInitialization())
+	{
+		MotionMatchConfig->Initialize();
+	}
 }
 
-#if WITH_EDITOR
-void UMotionDataAsset::RemapTracksToNewSkeleton(USkeleton* NewSkeleton, bool bConvertSpaces)
+void UMotionDataAsset::CacheSectionCalibrationBuffer()
 {
-	//No remapping required (individual animations need to be remapped
+	SectionCalibrationBuffer.Empty();
+	SectionCalibrationStride = 0;
+	++SectionCalibrationSerial;
+
+	if(!AreFinalCalibrationWeightsValid()
+		|| FinalCalibrationWeights.Num() == 0)
+	{
+		return;
+	}
+
+	//Pad every set so that each one starts on a 16 byte boundary. The padding is zero so it never adds any cost
+	SectionCalibrationStride = Align(SearchPoseMatrix.AtomCount - 1, 4);
+	SectionCalibrationBuffer.SetNumZeroed(SectionCalibrationStride * FinalCalibrationWeights.Num());
+	for(int32 SectionIndex = 0; SectionIndex < FinalCalibrationWeights.Num(); ++SectionIndex)
+	{
+		const TArray<float>& Weights = FinalCalibrationWeights[SectionIndex].Weights;
+		FMemory::Memcpy(SectionCalibrationBuffer.GetData() + SectionIndex * SectionCalibrationStride,
+			Weights.GetData(), Weights.Num() * sizeof(float));
+	}
 }
-#endif
 
-void UMotionDataAsset::TickAssetPlayer(FAnimTickRecord& Instance, FAnimNotifyQueue& NotifyQueue, FAnimAssetTickContext& Context) const
+void UMotionDataAsset::ReorderSearchPoseMatrix()
 {
-	const float DeltaTime = Context.GetDeltaTime();
-	const bool bGenerateNotifies = NotifyTriggerMode != ENotifyTriggerMode::None;
+	TArray<int32> NewOrder;
+	FPoseAABBHierarchy::ComputeSpatialOrder(SearchPoseMatrix, MotionTagMatrixSections, NewOrder);
 
-	TArray<FAnimNotifyEventReference> Notifies;
-	
-	FAnimChannelState* ChannelState = reinterpret_cast<FAnimChannelState*>(Instance.BlendSpace.BlendSampleDataCache);
-	
-	switch (ChannelState->AnimType)
+	const int32 AtomCount = SearchPoseMatrix.AtomCount;
+	const TArray<int32> OldPoseIdRemap = PoseIdRemap;
+	TArray<float> ReorderedPoseArray = SearchPoseMatrix.PoseArray;
+	for(int32 NewPoseIndex = 0; NewPoseIndex < NewOrder.Num(); ++NewPoseIndex)
 	{
-		case EMotionAnimAssetType::Sequence: { TickAnimChannelForSequence(*ChannelState, Context, Notifies, DeltaTime, bGenerateNotifies); } break;
-		case EMotionAnimAssetType::BlendSpace: { TickAnimChannelForBlendSpace(*ChannelState, Context, Notifies, DeltaTime, bGenerateNotifies); } break;
-		case EMotionAnimAssetType::Composite: { TickAnimChannelForComposite(*ChannelState, Context, Notifies, DeltaTime, bGenerateNotifies); } break;
-		default: break;
+		const int32 OldPoseIndex = NewOrder[NewPoseIndex];
+		FMemory::Memcpy(ReorderedPoseArray.GetData() + NewPoseIndex * AtomCount,
+			SearchPoseMatrix.PoseArray.GetData() + OldPoseIndex * AtomCount, AtomCount * sizeof(float));
+
+		//The remaps need to follow the poses
+		PoseIdRemap[NewPoseIndex] = OldPoseIdRemap[OldPoseIndex];
+		DensePoseIdRemapReverse[PoseIdRemap[NewPoseIndex]] = NewPoseIndex;
 	}
-	
-	if (bGenerateNotifies)
+
+	SearchPoseMatrix.PoseArray = MoveTemp(ReorderedPoseArray);
+}
+
+void UMotionDataAsset::GenerateQuantizedSearchData()
+{
+	QuantizedSearchPoseMatrix.Empty();
+	QuantizedOuterAABBExtents.Empty();
+	QuantizedInnerAABBExtents.Empty();
+
+	if(SearchMatrixPrecision == EPoseMatrixPrecision::Float
+		|| !IsSearchPoseMatrixGenerated())
 	{
-		if (NotifyTriggerMode == ENotifyTriggerMode::HighestWeightedAnimation)
-		{
+		return;
+	}
 
-			float PreviousTime = ChannelState->AnimTime - DeltaTime;
+	TArray<float> AtomOffsets;
+	TArray<float> AtomScales;
+	FQuantizedPoseMatrix::ComputeAtomQuantization(SearchPoseMatrix, SearchMatrixPrecision, AtomOffsets, AtomScales);
+	QuantizedSearchPoseMatrix.Quantize(SearchPoseMatrix.PoseArray, SearchPoseMatrix.AtomCount, SearchMatrixPrecision,
+		AtomOffsets, AtomScales, false);
 
-			switch (ChannelState->AnimType)
-			{
-				case EMotionAnimAssetType::Sequence: 
-				{
+	//The AABBs are generated from the quantized poses so that they bound the values that are actually searched. The
+	//extents are then rounded outwards so that they still bound them after quantization
+	FPoseMatrix DequantizedMatrix = SearchPoseMatrix;
+	QuantizedSearchPoseMatrix.Dequantize(DequantizedMatrix.PoseArray);
+
+	TArray<float> ExtentOffsets;
+	TArray<float> ExtentScales;
+	ExtentOffsets.Reserve(AtomOffsets.Num() * 2);
+	ExtentScales.Reserve(AtomScales.Num() * 2);
+	for(int32 AtomIndex = 0; AtomIndex < AtomOffsets.Num(); ++AtomIndex)
+	{
+		ExtentOffsets.Add(AtomOffsets[AtomIndex]);
+		ExtentOffsets.Add(AtomOffsets[AtomIndex]);
+		ExtentScales.Add(AtomScales[AtomIndex]);
+		ExtentScales.Add(AtomScales[AtomIndex]);
+	}
+
+	const FPoseAABBMatrix OuterAABBMatrix(DequantizedMatrix, 64);
+	const FPoseAABBMatrix InnerAABBMatrix(DequantizedMatrix, 16);
+	QuantizedOuterAABBExtents.Quantize(OuterAABBMatrix.ExtentsArray, SearchPoseMatrix.AtomCount * 2, SearchMatrixPrecision,
+		ExtentOffsets, ExtentScales, true);
+	QuantizedInnerAABBExtents.Quantize(InnerAABBMatrix.ExtentsArray, SearchPoseMatrix.AtomCount * 2, SearchMatrixPrecision,
+		ExtentOffsets, ExtentScales, true);
+}
+
+int32 UMotionDataAsset::GetMotionTagSectionIndex(const int32 StartPoseIndex, const int32 EndPoseIndex) const
+{
+	for(int32 SectionIndex = 0; SectionIndex < MotionTagMatrixSections.Num(); ++SectionIndex)
+	{
+		const FPoseMatrixSection& Section = MotionTagMatrixSections[SectionIndex];
+		if(Section.StartIndex == StartPoseIndex
+			&& Section.EndIndex == EndPoseIndex)
+		{
+			return SectionIndex;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+bool UMotionDataAsset::HasBulkSearchData() const
+{
+	return PoseIdRemapBulkView.Num() > 0;
+}
+
+bool UMotionDataAsset::IsFullPrecisionSearchDataStripped() const
+{
+	return SearchMatrixPrecision != EPoseMatrixPrecision::Float
+		&& IsSearchPoseMatrixGenerated()
+		&& GetSearchPoseArray().Num() == 0
+		&& GetOuterAABBExtents().Num() == 0
+		&& GetInnerAABBExtents().Num() == 0;
+}
+
+TConstArrayView<float> UMotionDataAsset::GetSearchPoseArray() const
+{
+	return HasBulkSearchData() ? SearchPoseBulkView : TConstArrayView<float>(SearchPoseMatrix.PoseArray);
+}
+
+TConstArrayView<float> UMotionDataAsset::GetOuterAABBExtents() const
+{
+	return HasBulkSearchData() ? OuterAABBBulkView : TConstArrayView<float>(PoseAABBMatrix_Outer.ExtentsArray);
+}
+
+TConstArrayView<float> UMotionDataAsset::GetInnerAABBExtents() const
+{
+	return HasBulkSearchData() ? InnerAABBBulkView : TConstArrayView<float>(PoseAABBMatrix_Inner.ExtentsArray);
+}
+
+TConstArrayView<int32> UMotionDataAsset::GetPoseIdRemap() const
+{
+	return HasBulkSearchData() ? PoseIdRemapBulkView : TConstArrayView<int32>(PoseIdRemap);
+}
+
+TConstArrayView<int32> UMotionDataAsset::GetPoseIdRemapReverse() const
+{
+	return HasBulkSearchData() ? PoseIdRemapReverseBulkView : TConstArrayView<int32>(DensePoseIdRemapReverse);
+}
+
+namespace MotionDataPreProcessHash
+{
+	static uint32 HashObjectProperties(const UObject* Object, const uint32 Hash)
+	{
+		if(!Object)
+		{
+			return HashCombine(Hash, 0u);
+		}
+
+		FArchiveCrc32 Ar(Hash);
+		const_cast<UObject*>(Object)->SerializeScriptProperties(Ar);
+		return Ar.GetCrc();
+	}
+
+	/** Hashes the class, size and properties of the features in the order that UMotionMatchConfig::Initialize() adds
+	 * them. The serialized feature lists are used since the Features array only exists once the config is initialized */
+	static uint32 HashMatchFeatures(const UMotionMatchConfig* MMConfig, uint32 Hash)
+	{
+		if(!MMConfig)
+		{
+			return HashCombine(Hash, 0u);
+		}
+
+		for(const TArray<TObjectPtr<UMatchFeatureBase>>* FeatureList : {&MMConfig->InputResponseFeatures, &MMConfig->PoseQualityFeatures})
+		{
+			for(const TObjectPtr<UMatchFeatureBase> Feature : *FeatureList)
+			{
+				if(Feature)
+				{
+					Hash = HashCombine(Hash, GetTypeHash(Feature->GetClass()->GetPathName()));
+					Hash = HashCombine(Hash, GetTypeHash(Feature->Size()));
+					Hash = HashObjectProperties(Feature, Hash);
+				}
+			}
+		}
+
+		return Hash;
+	}
+
+	/** Hashes only the class and size of the features, which is all that the layout of the search structures depends on */
+	static uint32 HashMatchFeatureLayout(const UMotionMatchConfig* MMConfig, uint32 Hash)
+	{
+		if(!MMConfig)
+		{
+			return HashCombine(Hash, 0u);
+		}
+
+		for(const TArray<TObjectPtr<UMatchFeatureBase>>* FeatureList : {&MMConfig->InputResponseFeatures, &MMConfig->PoseQualityFeatures})
+		{
+			for(const TObjectPtr<UMatchFeatureBase> Feature : *FeatureList)
+			{
+				if(Feature)
+				{
+					Hash = HashCombine(Hash, GetTypeHash(Feature->GetClass()->GetFName()));
+					Hash = HashCombine(Hash, GetTypeHash(Feature->Size()));
+				}
+			}
+		}
+
+		return Hash;
+	}
+
+	//Increment this whenever the layout or generation of the search structures changes so that old data is rebuilt
+	static constexpr uint32 SearchStructureVersion = 4;
+}
+
+uint32 UMotionDataAsset::ComputeSearchStructureHash() const
+{
+	uint32 Hash = GetTypeHash(MotionDataPreProcessHash::SearchStructureVersion);
+	Hash = HashCombine(Hash, GetTypeHash(MotionMatchConfig ? MotionMatchConfig->TotalDimensionCount : INDEX_NONE));
+	Hash = MotionDataPreProcessHash::HashMatchFeatures(MotionMatchConfig, Hash);
+	Hash = HashCombine(Hash, GetTypeHash(LookupPoseMatrix.AtomCount));
+	Hash = HashCombine(Hash, GetTypeHash(LookupPoseMatrix.PoseCount));
+	Hash = FCrc::MemCrc32(LookupPoseMatrix.PoseArray.GetData(), LookupPoseMatrix.PoseArray.Num() * sizeof(float), Hash);
+	Hash = HashCombine(Hash, GetTypeHash(Poses.Num()));
+	Hash = HashCombine(Hash, GetTypeHash(MotionTagList.Num()));
+
+	//Tags are hashed by name since name indices are not stable between sessions. Poses are hashed by the index of their
+	//tags in the tag list, which also catches re-tagged poses with the same pose count
+	for(const FGameplayTagContainer& Tags : MotionTagList)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Tags.ToStringSimple()));
+	}
+
+	int32 TagIndex = INDEX_NONE;
+	for(const FPoseMotionData& Pose : Poses)
+	{
+		if(!MotionTagList.IsValidIndex(TagIndex)
+			|| MotionTagList[TagIndex] != Pose.MotionTags)
+		{
+			TagIndex = MotionTagList.IndexOfByKey(Pose.MotionTags);
+		}
+
+		Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(Pose.SearchFlag)));
+		Hash = HashCombine(Hash, GetTypeHash(TagIndex));
+	}
+
+	//Only hashed when not the default so that existing data does not need to be rebuilt
+	if(SearchPoseOrder != EPoseMatrixOrder::Animation)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(SearchPoseOrder));
+	}
+
+	//The search tree bounds the quantized poses when the precision is reduced
+	if(SearchMatrixPrecision != EPoseMatrixPrecision::Float)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(SearchMatrixPrecision));
+	}
+	
+	return Hash;
+}
+
+uint32 UMotionDataAsset::ComputeSearchStructureConfigHash() const
+{
+	uint32 Hash = GetTypeHash(MotionDataPreProcessHash::SearchStructureVersion);
+	Hash = HashCombine(Hash, GetTypeHash(MotionMatchConfig ? MotionMatchConfig->TotalDimensionCount : INDEX_NONE));
+	Hash = MotionDataPreProcessHash::HashMatchFeatureLayout(MotionMatchConfig, Hash);
+	Hash = HashCombine(Hash, GetTypeHash(LookupPoseMatrix.AtomCount));
+	Hash = HashCombine(Hash, GetTypeHash(LookupPoseMatrix.PoseCount));
+	Hash = HashCombine(Hash, GetTypeHash(Poses.Num()));
+	Hash = HashCombine(Hash, GetTypeHash(MotionTagList.Num()));
+	Hash = HashCombine(Hash, GetTypeHash(SearchPoseOrder));
+	Hash = HashCombine(Hash, GetTypeHash(SearchMatrixPrecision));
+	return Hash;
+}
+
+bool UMotionDataAsset::AreSearchStructuresValid() const
+{
+	//Assets saved before the config hash was stored have nothing to validate against and are rebuilt once
+	if(GetLinkerCustomVersion(FMotionSymphonyCustomVersion::GUID) < FMotionSymphonyCustomVersion::SearchStructureConfigHash
+		&& SearchStructureConfigHash == 0)
+	{
+		return false;
+	}
+
+	//Only the config and counts are checked here since this runs on every load. The full content hash is only computed
+	//when the search structures are generated
+	if(SearchStructureConfigHash != ComputeSearchStructureConfigHash()
+		|| !IsSearchPoseMatrixGenerated()
+		|| SearchPoseMatrix.AtomCount != LookupPoseMatrix.AtomCount
+		|| SearchPoseMatrix.PoseCount > Poses.Num())
+	{
+		return false;
+	}
+
+	const int32 AtomCount = SearchPoseMatrix.AtomCount;
+	const int32 PoseCount = SearchPoseMatrix.PoseCount;
+	const bool bFullPrecision = SearchMatrixPrecision == EPoseMatrixPrecision::Float;
+
+	//Cooked data with a reduced precision only has the quantized pose rows and AABB extents
+	if(bFullPrecision || !IsFullPrecisionSearchDataStripped())
+	{
+		if(GetSearchPoseArray().Num() != PoseCount * AtomCount
+			|| GetOuterAABBExtents().Num() != FMath::DivideAndRoundUp(PoseCount, 64) * AtomCount * 2
+			|| GetInnerAABBExtents().Num() != FMath::DivideAndRoundUp(PoseCount, 16) * AtomCount * 2)
+		{
+			return false;
+		}
+	}
+	
+	return GetPoseIdRemap().Num() >= PoseCount
+		&& GetPoseIdRemapReverse().Num() == Poses.Num()
+		&& MotionTagMatrixSections.Num() == MotionTagList.Num()
+		&& IsSearchTreeValid()
+		&& (!bCompressSearchMatrix || IsSearchMatrixPQValid())
+		&& (bFullPrecision || IsQuantizedSearchDataValid())
+		&& (!bGenerateAABBHierarchy || !bFullPrecision || IsAABBHierarchyValid())
+		&& (SearchMatrixLayout == ESearchMatrixLayout::PoseMajor || !bFullPrecision || IsFeatureMajorSearchMatrixValid());
+}
+
+void UMotionDataAsset::ValidateSearchStructures()
+{
+	if(!bIsProcessed
+		|| LookupPoseMatrix.PoseCount == 0)
+	{
+		return;
+	}
+
+	if(AreSearchStructuresValid())
+	{
+		return;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("UMotionDataAsset: Search structures for '%s' are missing or out of date and are being rebuilt. Re-save the asset to avoid this cost on load."),
+		*GetName());
+
+	//The feature major layout and search structure hash are generated from the config features
+	InitializeMotionMatchConfig();
+	GenerateSearchPoseMatrix();
+
+	//The calibration buffer is padded to the atom count of the search pose matrix
+	CacheSectionCalibrationBuffer();
+
+	//The lookup table is keyed on the search structure hash, so it has to follow the rebuilt search structures or the
+	//'Candidate Lookup' quality would silently fall back to a full search
+	if(bGeneratePoseLookupTable
+		&& !IsPoseLookupTableValid())
+	{
+		if(AreFinalCalibrationWeightsValid())
+		{
+			GeneratePoseLookupTable();
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("UMotionDataAsset: The pose lookup table of '%s' is out of date and could not be rebuilt on load. Re-process the motion data."),
+				*GetName());
+		}
+	}
+}
+
+void UMotionDataAsset::PostLoad()
+{
+	Super::Super::PostLoad();
+
+	for (TObjectPtr<UMotionAnimObject> MotionAnim : SourceMotionSequenceObjects)
+	{
+		if(MotionAnim)
+		{
+			MotionAnim->ParentMotionDataAsset = this;
+		}
+	}
+
+	for (TObjectPtr<UMotionAnimObject> MotionComposite : SourceCompositeObjects)
+	{
+		if(MotionComposite)
+		{
+			MotionComposite->ParentMotionDataAsset = this;
+		}
+	}
+
+	for (TObjectPtr<UMotionAnimObject> MotionBlendSpace : SourceBlendSpaceObjects)
+	{
+		if(MotionBlendSpace)
+		{
+			MotionBlendSpace->ParentMotionDataAsset = this;
+		}
+	}
+
+	/* This section is to take any legacy FMotionAnimAsset data and convert it into UMotionAnimObject Data
+	 * Once this has run once it will never have to be done again. This will be removed at a later date once
+	 * all users have had a fair chance to convert the data */
+	if(SourceMotionAnims.Num() > 0)
+	{
+		for(FMotionAnimSequence& MotionAnimSequence : SourceMotionAnims)
+		{
+			SourceMotionSequenceObjects.Emplace(NewObject<UMotionSequenceObject>(this, UMotionSequenceObject::StaticClass()));
+			SourceMotionSequenceObjects.Last()->InitializeFromLegacy(&MotionAnimSequence);
+		}
+		
+		SourceMotionAnims.Empty(0);
+		Modify(true);
+	}
+
+	if(SourceBlendSpaces.Num() > 0)
+	{
+		for(FMotionBlendSpace& MotionBlendSpace : SourceBlendSpaces)
+		{
+			SourceBlendSpaceObjects.Emplace(NewObject<UMotionBlendSpaceObject>(this, UMotionBlendSpaceObject::StaticClass()));
+			SourceBlendSpaceObjects.Last()->InitializeFromLegacy(&MotionBlendSpace);
+		}
+		
+		SourceBlendSpaces.Empty(0);
+		Modify(true);
+	}
+
+	if(SourceComposites.Num() > 0)
+	{
+		for(FMotionComposite& MotionComposite : SourceComposites)
+		{
+			SourceCompositeObjects.Emplace(NewObject<UMotionCompositeObject>(this, UMotionCompositeObject::StaticClass()));
+			SourceCompositeObjects.Last()->InitializeFromLegacy(&MotionComposite);
+		}
+		
+		SourceComposites.Empty(0);
+		Modify(true);
+	}
+
+	//Convert the legacy sparse reverse remap. Any pose which is missing from the map is not searchable
+	if(GetLinkerCustomVersion(FMotionSymphonyCustomVersion::GUID) < FMotionSymphonyCustomVersion::DensePoseIdRemapReverse
+		&& PoseIdRemapReverse_DEPRECATED.Num() > 0)
+	{
+		DensePoseIdRemapReverse.Init(INDEX_NONE, Poses.Num());
+		for(const TPair<int32, int32>& RemapPair : PoseIdRemapReverse_DEPRECATED)
+		{
+			if(DensePoseIdRemapReverse.IsValidIndex(RemapPair.Key))
+			{
+				DensePoseIdRemapReverse[RemapPair.Key] = RemapPair.Value;
+			}
+		}
+
+		PoseIdRemapReverse_DEPRECATED.Empty();
+	}
+	
+	LockBulkSearchData();
+
+	if(!MotionTagSectionTable.IsValid(MotionTagList.Num()))
+	{
+		MotionTagSectionTable.Build(MotionTagList);
+	}
+
+	if(!IsPoseHotTableValid())
+	{
+		PoseHotTable.Build(Poses, MotionTagList);
+	}
+
+	//Assets processed before final calibration weights were stored, or whose config calibration has changed since, generate
+	//them here
+	if(bIsProcessed
+		&& !AreFinalCalibrationWeightsValid())
+	{
+		GenerateFinalCalibrationWeights();
+	}
+	else
+	{
+		CacheSectionCalibrationBuffer();
+	}
+
+	//Search structures are serialized with the asset so this is only a cheap validation unless the data is out of date.
+	//This runs after the calibration weights are validated since a rebuilt pose lookup table is generated from them
+	ValidateSearchStructures();
+}
+
+bool UMotionDataAsset::IsPostLoadThreadSafe() const
+{
+	//Converting legacy anim data creates new objects, and rebuilding out of date search structures or generating missing
+	//calibration weights post-loads and initializes the motion match config, all of which must be done on the game thread
+	return SourceMotionAnims.Num() == 0
+		&& SourceBlendSpaces.Num() == 0
+		&& SourceComposites.Num() == 0
+		&& (!bIsProcessed || LookupPoseMatrix.PoseCount == 0 || AreSearchStructuresValid())
+		&& (!bIsProcessed || AreFinalCalibrationWeightsValid());
+}
+
+void UMotionDataAsset::PreSave(FObjectPreSaveContext ObjectSaveContext)
+{
+	Super::PreSave(ObjectSaveContext);
+
+	//Ensure that cooked data always contains valid search structures so that they never need to be built at runtime
+	ValidateSearchStructures();
+}
+
+void UMotionDataAsset::BeginDestroy()
+{
+	ReleaseBulkSearchData();
+	
+	Super::BeginDestroy();
+}
+
+namespace MotionDataBulkData
+{
+	//Each sub-stream within a bulk data stream starts on a page boundary so that it can be mapped on its own
+	static constexpr int64 PageSize = 4096;
+	
+	template<typename ElementType>
+	static TConstArrayView<uint8> AsBytes(const TArray<ElementType>& Array)
+	{
+		return MakeArrayView(reinterpret_cast<const uint8*>(Array.GetData()), Array.Num() * static_cast<int32>(sizeof(ElementType)));
+	}
+	
+	static void WriteBulkData(FByteBulkData& BulkData, TConstArrayView<uint8> FirstData, TConstArrayView<uint8> SecondData = {})
+	{
+		const int64 SecondOffset = SecondData.Num() > 0 ? Align(FirstData.Num(), PageSize) : FirstData.Num();
+		
+		BulkData.Lock(LOCK_READ_WRITE);
+		uint8* BulkDataPtr = static_cast<uint8*>(BulkData.Realloc(SecondOffset + SecondData.Num()));
+		FMemory::Memzero(BulkDataPtr, SecondOffset + SecondData.Num());
+		FMemory::Memcpy(BulkDataPtr, FirstData.GetData(), FirstData.Num());
+		FMemory::Memcpy(BulkDataPtr + SecondOffset, SecondData.GetData(), SecondData.Num());
+		BulkData.Unlock();
+
+		BulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload | BULKDATA_MemoryMappedPayload);
+	}
+
+	static TConstArrayView<uint8> LockBulkData(const FByteBulkData& BulkData)
+	{
+		const int64 BulkDataSize = BulkData.GetBulkDataSize();
+		if(BulkDataSize == 0)
+		{
+			return TConstArrayView<uint8>();
+		}
+
+		//The lock is held for the lifetime of the asset. Read only locks will map the payload where the platform supports it
+		const uint8* BulkDataPtr = static_cast<const uint8*>(BulkData.LockReadOnly());
+		return BulkDataPtr ? TConstArrayView<uint8>(BulkDataPtr, static_cast<int32>(BulkDataSize)) : TConstArrayView<uint8>();
+	}
+
+	template<typename ElementType>
+	static TConstArrayView<ElementType> SubView(TConstArrayView<uint8> Bytes, const int64 ByteOffset, const int64 Count)
+	{
+		if(Count < 0
+			|| ByteOffset + Count * static_cast<int64>(sizeof(ElementType)) > Bytes.Num())
+		{
+			return TConstArrayView<ElementType>();
+		}
+
+		return TConstArrayView<ElementType>(reinterpret_cast<const ElementType*>(Bytes.GetData() + ByteOffset), static_cast<int32>(Count));
+	}
+}
+
+void UMotionDataAsset::Serialize(FArchive& Ar)
+{
+	Ar.UsingCustomVersion(FMotionSymphonyCustomVersion::GUID);
+
+	//When cooking with bulk search data the search arrays are stashed during property serialization so that they are only
+	//saved once, in the bulk data streams
+	const bool bSaveBulkSearchData = bUseBulkSearchData
+		&& Ar.IsSaving()
+		&& Ar.IsCooking()
+		&& IsSearchPoseMatrixGenerated()
+		&& !HasBulkSearchData();
+
+	//Cooked data with a reduced precision is only ever searched through the quantized copies, so the full precision pose
+	//rows and AABB extents are not saved at all
+	const bool bStripFullPrecisionSearchData = Ar.IsSaving()
+		&& Ar.IsCooking()
+		&& SearchMatrixPrecision != EPoseMatrixPrecision::Float
+		&& IsQuantizedSearchDataValid();
+	
+	TArray<float> StashedSearchPoseArray;
+	TArray<float> StashedOuterExtents;
+	TArray<float> StashedInnerExtents;
+	TArray<int32> StashedPoseIdRemap;
+	TArray<int32> StashedPoseIdRemapReverse;
+	if(bSaveBulkSearchData
+		|| bStripFullPrecisionSearchData)
+	{
+		StashedSearchPoseArray = MoveTemp(SearchPoseMatrix.PoseArray);
+		StashedOuterExtents = MoveTemp(PoseAABBMatrix_Outer.ExtentsArray);
+		StashedInnerExtents = MoveTemp(PoseAABBMatrix_Inner.ExtentsArray);
+	}
+
+	if(bSaveBulkSearchData)
+	{
+		StashedPoseIdRemap = MoveTemp(PoseIdRemap);
+		StashedPoseIdRemapReverse = MoveTemp(DensePoseIdRemapReverse);
+
+		if(!bStripFullPrecisionSearchData)
+		{
+			MotionDataBulkData::WriteBulkData(SearchPoseBulkData, MotionDataBulkData::AsBytes(StashedSearchPoseArray));
+			MotionDataBulkData::WriteBulkData(AABBExtentsBulkData, MotionDataBulkData::AsBytes(StashedOuterExtents),
+				MotionDataBulkData::AsBytes(StashedInnerExtents));
+		}
+		else
+		{
+			SearchPoseBulkData.RemoveBulkData();
+			AABBExtentsBulkData.RemoveBulkData();
+		}
+		
+		MotionDataBulkData::WriteBulkData(PoseRemapBulkData, MotionDataBulkData::AsBytes(StashedPoseIdRemap),
+			MotionDataBulkData::AsBytes(StashedPoseIdRemapReverse));
+	}
+	
+	Super::Super::Serialize(Ar);
+
+	if(bSaveBulkSearchData
+		|| bStripFullPrecisionSearchData)
+	{
+		SearchPoseMatrix.PoseArray = MoveTemp(StashedSearchPoseArray);
+		PoseAABBMatrix_Outer.ExtentsArray = MoveTemp(StashedOuterExtents);
+		PoseAABBMatrix_Inner.ExtentsArray = MoveTemp(StashedInnerExtents);
+	}
+
+	if(bSaveBulkSearchData)
+	{
+		PoseIdRemap = MoveTemp(StashedPoseIdRemap);
+		DensePoseIdRemapReverse = MoveTemp(StashedPoseIdRemapReverse);
+	}
+
+	if(Ar.CustomVer(FMotionSymphonyCustomVersion::GUID) >= FMotionSymphonyCustomVersion::BulkSearchData)
+	{
+		SerializeBulkSearchData(Ar, bSaveBulkSearchData);
+	}
+}
+
+void UMotionDataAsset::SerializeBulkSearchData(FArchive& Ar, const bool bSaveBulkSearchData)
+{
+	bool bHasBulkSearchData = bSaveBulkSearchData;
+	Ar << bHasBulkSearchData;
+
+	if(!bHasBulkSearchData)
+	{
+		return;
+	}
+
+	SearchPoseBulkData.Serialize(Ar, this);
+	AABBExtentsBulkData.Serialize(Ar, this);
+	PoseRemapBulkData.Serialize(Ar, this);
+}
+
+void UMotionDataAsset::LockBulkSearchData()
+{
+	if(HasBulkSearchData()
+		|| PoseRemapBulkData.GetBulkDataSize() == 0)
+	{
+		return;
+	}
+
+	const int32 AtomCount = SearchPoseMatrix.AtomCount;
+	const int32 PoseCount = SearchPoseMatrix.PoseCount;
+	const int64 OuterExtentsCount = FMath::DivideAndRoundUp(PoseCount, 64) * AtomCount * 2;
+	const int64 InnerExtentsCount = FMath::DivideAndRoundUp(PoseCount, 16) * AtomCount * 2;
+	const int64 InnerExtentsOffset = Align(OuterExtentsCount * static_cast<int64>(sizeof(float)), MotionDataBulkData::PageSize);
+
+	//The search pose and AABB streams are empty if the full precision search data was stripped when cooking
+	const TConstArrayView<uint8> AABBExtentsBytes = MotionDataBulkData::LockBulkData(AABBExtentsBulkData);
+	OuterAABBBulkView = MotionDataBulkData::SubView<float>(AABBExtentsBytes, 0, OuterExtentsCount);
+	InnerAABBBulkView = MotionDataBulkData::SubView<float>(AABBExtentsBytes, InnerExtentsOffset, InnerExtentsCount);
+
+	const TConstArrayView<uint8> SearchPoseBytes = MotionDataBulkData::LockBulkData(SearchPoseBulkData);
+	SearchPoseBulkView = MotionDataBulkData::SubView<float>(SearchPoseBytes, 0, static_cast<int64>(PoseCount) * AtomCount);
+
+	//The pose id remap view is set last since it is what marks the bulk search data as available
+	const TConstArrayView<uint8> PoseRemapBytes = MotionDataBulkData::LockBulkData(PoseRemapBulkData);
+	const int64 PoseIdRemapReverseOffset = Align(static_cast<int64>(PoseCount) * sizeof(int32), MotionDataBulkData::PageSize);
+	PoseIdRemapReverseBulkView = MotionDataBulkData::SubView<int32>(PoseRemapBytes, PoseIdRemapReverseOffset, Poses.Num());
+	PoseIdRemapBulkView = MotionDataBulkData::SubView<int32>(PoseRemapBytes, 0, PoseCount);
+}
+
+void UMotionDataAsset::ReleaseBulkSearchData()
+{
+	SearchPoseBulkView = TConstArrayView<float>();
+	OuterAABBBulkView = TConstArrayView<float>();
+	InnerAABBBulkView = TConstArrayView<float>();
+	PoseIdRemapBulkView = TConstArrayView<int32>();
+	PoseIdRemapReverseBulkView = TConstArrayView<int32>();
+
+	for(FByteBulkData* BulkData : { &SearchPoseBulkData, &AABBExtentsBulkData, &PoseRemapBulkData })
+	{
+		if(BulkData->IsLocked())
+		{
+			BulkData->Unlock();
+		}
+	}
+}
+
+#if WITH_EDITOR
+void UMotionDataAsset::RemapTracksToNewSkeleton(USkeleton* NewSkeleton, bool bConvertSpaces)
+{
+	//No remapping required (individual animations need to be remapped
+}
+#endif
+
+void UMotionDataAsset::TickAssetPlayer(FAnimTickRecord& Instance, FAnimNotifyQueue& NotifyQueue, FAnimAssetTickContext& Context) const
+{
+	const float DeltaTime = Context.GetDeltaTime();
+	const bool bGenerateNotifies = NotifyTriggerMode != ENotifyTriggerMode::None;
+
+	TArray<FAnimNotifyEventReference> Notifies;
+	
+	FAnimChannelState* ChannelState = reinterpret_cast<FAnimChannelState*>(Instance.BlendSpace.BlendSampleDataCache);
+	
+	switch (ChannelState->AnimType)
+	{
+		case EMotionAnimAssetType::Sequence: { TickAnimChannelForSequence(*ChannelState, Context, Notifies, DeltaTime, bGenerateNotifies); } break;
+		case EMotionAnimAssetType::BlendSpace: { TickAnimChannelForBlendSpace(*ChannelState, Context, Notifies, DeltaTime, bGenerateNotifies); } break;
+		case EMotionAnimAssetType::Composite: { TickAnimChannelForComposite(*ChannelState, Context, Notifies, DeltaTime, bGenerateNotifies); } break;
+		default: break;
+	}
+	
+	if (bGenerateNotifies)
+	{
+		if (NotifyTriggerMode == ENotifyTriggerMode::HighestWeightedAnimation)
+		{
+
+			float PreviousTime = ChannelState->AnimTime - DeltaTime;
+
+			switch (ChannelState->AnimType)
+			{
+				case EMotionAnimAssetType::Sequence: 
+				{
 					if(TObjectPtr<const UMotionSequenceObject> MotionAnim = GetSourceSequenceAtIndex(ChannelState->AnimId))
 					{
 						if (!MotionAnim->bLoop)
@@ -1301,53 +2171,14 @@ void UMotionDataAsset::InitializePoseMatrix()
 	}
 	LookupPoseMatrix.AtomCount = AtomCount;
 
-	//Get Pose Count from sequences
-	int32 PoseCount = 0;
-	for(TObjectPtr<UMotionSequenceObject> MotionAnimSequence : SourceMotionSequenceObjects)
-	{
-		if(MotionAnimSequence)
-		{
-			const int32 PoseCountThisAnim = FMath::FloorToInt32(MotionAnimSequence->GetPlayLength() / (PoseInterval * MotionAnimSequence->PlayRate)) + 1;
-			PoseCount += MotionAnimSequence->bEnableMirroring ? PoseCountThisAnim * 2 : PoseCountThisAnim;
-		}
-	}
-
-	//Get pose count from composites
-	for(TObjectPtr<UMotionCompositeObject> MotionComposite : SourceCompositeObjects)
-	{
-		if(MotionComposite)
-		{
-			const int32 PoseCountThisAnim = FMath::FloorToInt32(MotionComposite->GetPlayLength() / (PoseInterval * MotionComposite->PlayRate)) + 1;
-			PoseCount += MotionComposite->bEnableMirroring ? PoseCountThisAnim * 2 : PoseCountThisAnim;
-		}
-	}
-
-	//Get pose count from blend spaces
-	for(TObjectPtr<UMotionBlendSpaceObject> MotionBlendSpace : SourceBlendSpaceObjects)
-	{
-		if(MotionBlendSpace)
-		{
-			const FBlendParameter XAxisParameter = MotionBlendSpace->BlendSpace->GetBlendParameter(0);
-			const FBlendParameter YAxisParameter = MotionBlendSpace->BlendSpace->GetBlendParameter(1);
-		
-			const int32 BSSampleCount = FMath::Floor((XAxisParameter.Max - XAxisParameter.Min) / MotionBlendSpace->SampleSpacing.X)
-				* FMath::Floor((YAxisParameter.Max - XAxisParameter.Min) / MotionBlendSpace->SampleSpacing.Y);
-
-			const int32 PoseCountThisAnim = (FMath::FloorToInt32(MotionBlendSpace->GetPlayLength()
-				/ (PoseInterval * MotionBlendSpace->PlayRate)) + 1) * BSSampleCount;
-		
-			PoseCount += MotionBlendSpace->bEnableMirroring ? PoseCountThisAnim * 2 : PoseCountThisAnim;
-		}
-	}
-
+	//The poses have already been sampled so the pose count is exact
+	const int32 PoseCount = Poses.Num();
 	LookupPoseMatrix.PoseCount = PoseCount;
 	LookupPoseMatrix.PoseArray.Empty(AtomCount * PoseCount + 1);
 	LookupPoseMatrix.PoseArray.SetNumZeroed(AtomCount * PoseCount);
-
-	Poses.Empty(PoseCount + 1);
 }
 
-void UMotionDataAsset::PreProcessAnim(const int32 SourceAnimIndex, const bool bMirror /*= false*/)
+void UMotionDataAsset::PreProcessAnim(const int32 SourceAnimIndex, const bool bMirror, TArray<FMotionPreProcessRange>& OutRanges)
 {
 #if WITH_EDITOR
 	TObjectPtr<UMotionSequenceObject> MotionAnim = SourceMotionSequenceObjects[SourceAnimIndex];
@@ -1365,19 +2196,12 @@ void UMotionDataAsset::PreProcessAnim(const int32 SourceAnimIndex, const bool bM
 		return;
 	}
 
-	Modify();
-
 	MotionAnim->AnimId = SourceAnimIndex;
 
 	const float AnimLength = Sequence->GetPlayLength();
 	const float PlayRate = MotionAnim->GetPlayRate();
 	float CurrentTime = 0.0f;
 	const float TimeHorizon = 1.0f * PlayRate;
-	
-	if(PoseInterval < 0.01f)
-	{
-		PoseInterval = 0.01f;
-	}
 
 	const int32 StartPoseId = Poses.Num();
 	while (CurrentTime <= AnimLength)
@@ -1393,35 +2217,218 @@ void UMotionDataAsset::PreProcessAnim(const int32 SourceAnimIndex, const bool bM
 			bDoNotUse = false;
 		}
 
-		const int32 LookupIndex = PoseId * LookupPoseMatrix.AtomCount;
-		const int32 MaxLookupIndex = LookupIndex + LookupPoseMatrix.AtomCount - 1;
-		if(MaxLookupIndex < 0 || MaxLookupIndex >= LookupPoseMatrix.PoseArray.Num())
-		{
-			break;
-		}
-
-		LookupPoseMatrix.PoseArray[LookupIndex] = MotionAnim->CostMultiplier; //This is the pose cost multiplier, defaults to 1.0f and is overridem otherwise by tags
+		Poses.Emplace(FPoseMotionData(PoseId, EMotionAnimAssetType::Sequence, SourceAnimIndex, CurrentTime,
+			bDoNotUse ? EPoseSearchFlag::DoNotUse : EPoseSearchFlag::Searchable, bMirror, MotionAnim->MotionTags));
 		
-		int32 CurrentFeatureOffset = 1; //Current Feature offset starts at 1 because we need to skip the first float used for pose favour
-		for (UMatchFeatureBase* MatchFeature : MotionMatchConfig->Features)
+		CurrentTime += PoseInterval * PlayRate;
+	}
+
+	if(Poses.Num() > StartPoseId)
+	{
+		OutRanges.Emplace(EMotionAnimAssetType::Sequence, SourceAnimIndex, bMirror, StartPoseId, Poses.Num());
+	}
+#endif
+}
+
+void UMotionDataAsset::PreProcessBlendSpace(const int32 SourceBlendSpaceIndex, const bool bMirror, TArray<FMotionPreProcessRange>& OutRanges)
+{
+#if WITH_EDITOR
+	TObjectPtr<UMotionBlendSpaceObject> MotionBlendSpace = SourceBlendSpaceObjects[SourceBlendSpaceIndex];
+
+	if(!MotionBlendSpace)
+	{
+		return;
+	}
+	
+	UBlendSpace* BlendSpace = MotionBlendSpace->BlendSpace;
+
+	if (!BlendSpace)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to pre-process blend space. The animation blend space is null and has been skipped. Check that all your animations are valid."));
+		return;
+	}
+
+	MotionBlendSpace->AnimId = SourceBlendSpaceIndex;
+
+	//Determine initial values to begin pre-processing
+	const bool TwoDBlendSpace = Cast<UBlendSpace>(BlendSpace) == nullptr ? false : true;
+	const FBlendParameter XAxisParameter = BlendSpace->GetBlendParameter(0);
+	const float XAxisStart = XAxisParameter.Min;
+	const float XAxisEnd = XAxisParameter.Max;
+	const float XAxisStep = FMath::Abs((XAxisEnd - XAxisStart) * MotionBlendSpace->SampleSpacing.X);
+	float YAxisStart = 0.0f;
+	float YAxisEnd = 0.1f;
+	float YAxisStep = 0.2f;
+
+	if (TwoDBlendSpace)
+	{
+		const FBlendParameter YAxisParameter = BlendSpace->GetBlendParameter(1);
+		YAxisStart = YAxisParameter.Min;
+		YAxisEnd = YAxisParameter.Max;
+		YAxisStep = FMath::Abs((YAxisEnd - YAxisStart) * MotionBlendSpace->SampleSpacing.Y);
+	}
+
+	FVector BlendSpacePosition = FVector(XAxisStart, YAxisStart, 0.0f);
+
+	const float AnimLength = MotionBlendSpace->GetPlayLength();
+	const float PlayRate = MotionBlendSpace->GetPlayRate();
+	float CurrentTime = 0.0f;
+
+	const int32 StartPoseId = Poses.Num();
+
+	for (float YAxisValue = YAxisStart; YAxisValue <= YAxisEnd; YAxisValue += YAxisStep)
+	{
+		BlendSpacePosition.Y = YAxisValue;
+
+		for (float XAxisValue = XAxisStart; XAxisValue <= XAxisEnd; XAxisValue += XAxisStep)
 		{
-			if (MatchFeature)
+			BlendSpacePosition.X = XAxisValue;
+
+			CurrentTime = 0.0f;
+			while (CurrentTime <= AnimLength)
 			{
-				float* ResultLocation = &LookupPoseMatrix.PoseArray[LookupIndex + CurrentFeatureOffset];
-				MatchFeature->EvaluatePreProcess(ResultLocation, MotionAnim->Sequence, CurrentTime, PoseInterval, bMirror, MirrorDataTable, MotionAnim);
+				const int32 PoseId = Poses.Num();
+				
+				FPoseMotionData NewPoseData = FPoseMotionData(PoseId, EMotionAnimAssetType::BlendSpace, SourceBlendSpaceIndex,
+					CurrentTime, EPoseSearchFlag::Searchable, bMirror, MotionBlendSpace->MotionTags);
 
-				CurrentFeatureOffset += MatchFeature->Size();
+				NewPoseData.BlendSpacePosition = FVector2D(BlendSpacePosition.X, BlendSpacePosition.Y);
+				
+				Poses.Add(NewPoseData);
+				CurrentTime += PoseInterval * PlayRate;
 			}
 		}
+	}
 
-		Poses.Emplace(FPoseMotionData(PoseId, EMotionAnimAssetType::Sequence, SourceAnimIndex, CurrentTime,
-			bDoNotUse ? EPoseSearchFlag::DoNotUse : EPoseSearchFlag::Searchable, bMirror, MotionAnim->MotionTags));
+	if(Poses.Num() > StartPoseId)
+	{
+		OutRanges.Emplace(EMotionAnimAssetType::BlendSpace, SourceBlendSpaceIndex, bMirror, StartPoseId, Poses.Num());
+	}
+#endif
+}
+
+void UMotionDataAsset::PreProcessComposite(const int32 SourceCompositeIndex, const bool bMirror, TArray<FMotionPreProcessRange>& OutRanges)
+{
+#if WITH_EDITOR
+	TObjectPtr<UMotionCompositeObject> MotionComposite = SourceCompositeObjects[SourceCompositeIndex];
+
+	if(!MotionComposite)
+	{
+		return;
+	}
+	
+	const UAnimComposite* Composite = MotionComposite->AnimComposite;
+
+	if (!Composite)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to pre-process composite. The animation composite is null and has been skipped. Check that all your animations are valid."));
+		return;
+	}
+
+	MotionComposite->AnimId = SourceCompositeIndex;
+
+	const float AnimLength = Composite->GetPlayLength();
+	const float PlayRate = MotionComposite->GetPlayRate();
+	float CurrentTime = 0.0f;
+	const float TimeHorizon = 1.0f * PlayRate;
+
+	const int32 StartPoseId = Poses.Num();
+	while (CurrentTime <= AnimLength)
+	{
+		const int32 PoseId = Poses.Num();
+
+		const bool bDoNotUse = ((CurrentTime < TimeHorizon) && (MotionComposite->PastTrajectory == ETrajectoryPreProcessMethod::IgnoreEdges))
+		                       || ((CurrentTime > AnimLength - TimeHorizon) && (MotionComposite->FutureTrajectory == ETrajectoryPreProcessMethod::IgnoreEdges))
+			                       ? true : false;
+		
+		Poses.Emplace(FPoseMotionData(PoseId, EMotionAnimAssetType::Composite, SourceCompositeIndex, CurrentTime,
+			bDoNotUse ? EPoseSearchFlag::DoNotUse : EPoseSearchFlag::Searchable, bMirror, MotionComposite->MotionTags));
 		
 		CurrentTime += PoseInterval * PlayRate;
 	}
 
-	// compute EndPoseId
-	int32 EndPoseId = StartPoseId + FMath::RoundHalfToEven((CurrentTime / PlayRate) / PoseInterval);
+	if(Poses.Num() > StartPoseId)
+	{
+		OutRanges.Emplace(EMotionAnimAssetType::Composite, SourceCompositeIndex, bMirror, StartPoseId, Poses.Num());
+	}
+#endif
+}
+
+void UMotionDataAsset::EvaluatePoseFeatures(const int32 PoseId)
+{
+#if WITH_EDITOR
+	const FPoseMotionData& Pose = Poses[PoseId];
+	float* PoseRow = &LookupPoseMatrix.PoseArray[PoseId * LookupPoseMatrix.AtomCount];
+
+	switch(Pose.AnimType)
+	{
+		case EMotionAnimAssetType::Sequence:
+		{
+			UMotionSequenceObject* MotionAnim = SourceMotionSequenceObjects[Pose.AnimId];
+			PoseRow[0] = MotionAnim->CostMultiplier; //This is the pose cost multiplier, defaults to 1.0f and is overridem otherwise by tags
+
+			int32 CurrentFeatureOffset = 1; //Current Feature offset starts at 1 because we need to skip the first float used for pose favour
+			for (UMatchFeatureBase* MatchFeature : MotionMatchConfig->Features)
+			{
+				if (MatchFeature)
+				{
+					MatchFeature->EvaluatePreProcess(PoseRow + CurrentFeatureOffset, MotionAnim->Sequence, Pose.Time, PoseInterval,
+						Pose.bMirrored, MirrorDataTable, MotionAnim);
+
+					CurrentFeatureOffset += MatchFeature->Size();
+				}
+			}
+		} break;
+		case EMotionAnimAssetType::BlendSpace:
+		{
+			UMotionBlendSpaceObject* MotionBlendSpace = SourceBlendSpaceObjects[Pose.AnimId];
+			PoseRow[0] = MotionBlendSpace->CostMultiplier; //This is the pose favour, defaults to 1.0f and is set otherwise by tags
+
+			int32 CurrentFeatureOffset = 1;
+			for (UMatchFeatureBase* MatchFeature : MotionMatchConfig->Features)
+			{
+				if (MatchFeature)
+				{
+					MatchFeature->EvaluatePreProcess(PoseRow + CurrentFeatureOffset, MotionBlendSpace->BlendSpace, Pose.Time, PoseInterval,
+						Pose.bMirrored, MirrorDataTable, Pose.BlendSpacePosition, MotionBlendSpace);
+
+					CurrentFeatureOffset += MatchFeature->Size();
+				}
+			}
+		} break;
+		case EMotionAnimAssetType::Composite:
+		{
+			UMotionCompositeObject* MotionComposite = SourceCompositeObjects[Pose.AnimId];
+			PoseRow[0] = MotionComposite->CostMultiplier; //This is the pose favour, defaults to 1.0f and is set otherwise by tags
+
+			int32 CurrentFeatureOffset = 1;
+			for (UMatchFeatureBase* MatchFeature : MotionMatchConfig->Features)
+			{
+				if (MatchFeature)
+				{
+					MatchFeature->EvaluatePreProcess(PoseRow + CurrentFeatureOffset, MotionComposite->AnimComposite, Pose.Time, PoseInterval,
+						Pose.bMirrored, MirrorDataTable, MotionComposite);
+
+					CurrentFeatureOffset += MatchFeature->Size();
+				}
+			}
+		} break;
+		default: break;
+	}
+#endif
+}
+
+void UMotionDataAsset::PreProcessAnimTags(const FMotionPreProcessRange& Range)
+{
+#if WITH_EDITOR
+	UMotionSequenceObject* MotionAnim = SourceMotionSequenceObjects[Range.AnimId];
+	const float PlayRate = MotionAnim->GetPlayRate();
+	const int32 StartPoseId = Range.StartPoseId;
+	const int32 LastPoseId = Range.EndPoseId - 1; //Tags can only ever affect the poses of their own animation
+
+	// compute EndPoseId (the time after the last sampled pose)
+	const float CurrentTime = Poses[LastPoseId].Time + PoseInterval * PlayRate;
+	const int32 EndPoseId = FMath::Min(StartPoseId + FMath::RoundHalfToEven((CurrentTime / PlayRate) / PoseInterval), Range.EndPoseId);
 
 	//PreProcess Tags 
 	for (FAnimNotifyEvent& NotifyEvent : MotionAnim->Tags)
@@ -1438,8 +2445,8 @@ void UMotionDataAsset::PreProcessAnim(const int32 SourceAnimIndex, const bool bM
 			int32 TagStartPoseId = StartPoseId + FMath::RoundHalfToEven(TagStartTime / PoseInterval);
 			int32 TagEndPoseId = StartPoseId + FMath::RoundHalfToEven(TagEndTime / PoseInterval);
 
-			TagStartPoseId = FMath::Clamp(TagStartPoseId, 0, Poses.Num() - 1);
-			TagEndPoseId = FMath::Clamp(TagEndPoseId, 0, Poses.Num() - 1);
+			TagStartPoseId = FMath::Clamp(TagStartPoseId, 0, LastPoseId);
+			TagEndPoseId = FMath::Clamp(TagEndPoseId, 0, LastPoseId);
 			
 			/*-----------------XC: InteractPointPreprocess--------------------*/
 			if (UTag_Interaction* TagInteract = Cast<UTag_Interaction>(TagSection)) {
@@ -1476,13 +2483,60 @@ void UMotionDataAsset::PreProcessAnim(const int32 SourceAnimIndex, const bool bM
 					TagInteract->PreProcessPose(Poses[PoseIndex], MotionAnim, this, TagStartTime, TagEndTime);
 				}
 
-				continue;
-			}
+				continue;
+			}
+
+			//Apply the tags pre-processing to all poses in this range
+			for (int32 PoseIndex = TagStartPoseId; PoseIndex < TagEndPoseId; ++PoseIndex)
+			{
+				TagSection->PreProcessPose(Poses[PoseIndex], MotionAnim, this, TagStartTime, TagEndTime);
+			}
+
+			continue; //Don't check for a tag point if we already know its a tag section
+		}
+
+		if (UTagPoint* TagPoint = Cast<UTagPoint>(NotifyEvent.Notify))
+		{
+			const float TagTime = NotifyEvent.GetTriggerTime() / PlayRate;
+			int32 TagClosestPoseId = StartPoseId + FMath::RoundHalfToEven(TagTime / PoseInterval);
+			TagClosestPoseId = FMath::Clamp(TagClosestPoseId, 0, LastPoseId);
+
+			TagPoint->PreProcessTag(Poses[TagClosestPoseId], MotionAnim, this, TagTime);
+		}
+	}
+#endif
+}
+
+void UMotionDataAsset::PreProcessBlendSpaceTags(const FMotionPreProcessRange& Range)
+{
+#if WITH_EDITOR
+	UMotionBlendSpaceObject* MotionBlendSpace = SourceBlendSpaceObjects[Range.AnimId];
+	const float PlayRate = MotionBlendSpace->GetPlayRate();
+	const int32 StartPoseId = Range.StartPoseId;
+	const int32 LastPoseId = Range.EndPoseId - 1;
+
+	//PreProcess Tags 
+	for (FAnimNotifyEvent& NotifyEvent : MotionBlendSpace->Tags)
+	{
+		if (UTagSection* TagSection = Cast<UTagSection>(NotifyEvent.NotifyStateClass))
+		{
+			const float TagStartTime = NotifyEvent.GetTriggerTime() / PlayRate;
+			const float TagEndTime = TagStartTime + (NotifyEvent.GetDuration() / PlayRate);
+
+			//Pre-process the tag itself
+			TagSection->PreProcessTag(MotionBlendSpace, this, TagStartTime, TagStartTime + NotifyEvent.Duration);
+
+			//Find the range of poses affected by this tag
+			int32 TagStartPoseId = StartPoseId + FMath::RoundHalfToEven(TagStartTime / PoseInterval);
+			int32 TagEndPoseId = StartPoseId + FMath::RoundHalfToEven(TagEndTime / PoseInterval);
+
+			TagStartPoseId = FMath::Clamp(TagStartPoseId, 0, LastPoseId);
+			TagEndPoseId = FMath::Clamp(TagEndPoseId, 0, LastPoseId);
 
 			//Apply the tags pre-processing to all poses in this range
 			for (int32 PoseIndex = TagStartPoseId; PoseIndex < TagEndPoseId; ++PoseIndex)
 			{
-				TagSection->PreProcessPose(Poses[PoseIndex], MotionAnim, this, TagStartTime, TagEndTime);
+				TagSection->PreProcessPose(Poses[PoseIndex], MotionBlendSpace, this, TagStartTime, TagEndTime);
 			}
 
 			continue; //Don't check for a tag point if we already know its a tag section
@@ -1492,121 +2546,24 @@ void UMotionDataAsset::PreProcessAnim(const int32 SourceAnimIndex, const bool bM
 		{
 			const float TagTime = NotifyEvent.GetTriggerTime() / PlayRate;
 			int32 TagClosestPoseId = StartPoseId + FMath::RoundHalfToEven(TagTime / PoseInterval);
-			TagClosestPoseId = FMath::Clamp(TagClosestPoseId, 0, Poses.Num() - 1);
+			TagClosestPoseId = FMath::Clamp(TagClosestPoseId, 0, LastPoseId);
 
-			TagPoint->PreProcessTag(Poses[TagClosestPoseId], MotionAnim, this, TagTime);
+			TagPoint->PreProcessTag(Poses[TagClosestPoseId], MotionBlendSpace, this, TagTime);
 		}
 	}
 #endif
 }
 
-void UMotionDataAsset::PreProcessBlendSpace(const int32 SourceBlendSpaceIndex, const bool bMirror /*= false*/)
+void UMotionDataAsset::PreProcessCompositeTags(const FMotionPreProcessRange& Range)
 {
 #if WITH_EDITOR
-	TObjectPtr<UMotionBlendSpaceObject> MotionBlendSpace = SourceBlendSpaceObjects[SourceBlendSpaceIndex];
-
-	if(!MotionBlendSpace)
-	{
-		return;
-	}
-	
-	UBlendSpace* BlendSpace = MotionBlendSpace->BlendSpace;
-
-	if (!BlendSpace)
-	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to pre-process blend space. The animation blend space is null and has been skipped. Check that all your animations are valid."));
-		return;
-	}
-
-	Modify();
-
-	MotionBlendSpace->AnimId = SourceBlendSpaceIndex;
-
-	//Determine initial values to begin pre-processing
-	const bool TwoDBlendSpace = Cast<UBlendSpace>(BlendSpace) == nullptr ? false : true;
-	const FBlendParameter XAxisParameter = BlendSpace->GetBlendParameter(0);
-	const float XAxisStart = XAxisParameter.Min;
-	const float XAxisEnd = XAxisParameter.Max;
-	const float XAxisStep = FMath::Abs((XAxisEnd - XAxisStart) * MotionBlendSpace->SampleSpacing.X);
-	float YAxisStart = 0.0f;
-	float YAxisEnd = 0.1f;
-	float YAxisStep = 0.2f;
-
-	if (TwoDBlendSpace)
-	{
-		const FBlendParameter YAxisParameter = BlendSpace->GetBlendParameter(1);
-		YAxisStart = YAxisParameter.Min;
-		YAxisEnd = YAxisParameter.Max;
-		YAxisStep = FMath::Abs((YAxisEnd - YAxisStart) * MotionBlendSpace->SampleSpacing.Y);
-	}
-
-	FVector BlendSpacePosition = FVector(XAxisStart, YAxisStart, 0.0f);
-
-	const float AnimLength = MotionBlendSpace->GetPlayLength();
-	const float PlayRate = MotionBlendSpace->GetPlayRate();
-	float CurrentTime = 0.0f;
-	
-	if (PoseInterval < 0.01f)
-	{
-		PoseInterval = 0.01f;
-	}
-
-	const int32 StartPoseId = Poses.Num();
-
-	for (float YAxisValue = YAxisStart; YAxisValue <= YAxisEnd; YAxisValue += YAxisStep)
-	{
-		BlendSpacePosition.Y = YAxisValue;
-
-		for (float XAxisValue = XAxisStart; XAxisValue <= XAxisEnd; XAxisValue += XAxisStep)
-		{
-			BlendSpacePosition.X = XAxisValue;
-
-			//Evaluate blend space sample data here
-			TArray<FBlendSampleData> BlendSampleData;
-			
-			int32 CachedTriangulationIndex = -1; //Workaround. Caching for performance during pre-processing is not necessary
-			BlendSpace->GetSamplesFromBlendInput(BlendSpacePosition, BlendSampleData, CachedTriangulationIndex, false);
-
-			CurrentTime = 0.0f;
-			while (CurrentTime <= AnimLength)
-			{
-				const int32 PoseId = Poses.Num();
-
-				const int32 LookupIndex = PoseId * LookupPoseMatrix.AtomCount;
-				const int32 MaxLookupIndex = LookupIndex + LookupPoseMatrix.AtomCount - 1;
-				if(MaxLookupIndex < 0 || MaxLookupIndex >= LookupPoseMatrix.PoseArray.Num())
-				{
-					break;
-				}
-				
-				LookupPoseMatrix.PoseArray[LookupIndex] = MotionBlendSpace->CostMultiplier; //This is the pose favour, defaults to 1.0f and is set otherwise by tags
-		
-				int32 CurrentFeatureOffset = 1; //Current Feature offset starts at 1 because we need to skip the first float used for pose favour
-				for(UMatchFeatureBase* MatchFeature : MotionMatchConfig->Features)
-				{
-					if(MatchFeature)
-					{
-						float* ResultLocation = &LookupPoseMatrix.PoseArray[PoseId * LookupPoseMatrix.AtomCount + CurrentFeatureOffset];
-						MatchFeature->EvaluatePreProcess(ResultLocation, MotionBlendSpace->BlendSpace, CurrentTime, PoseInterval,
-						                                 bMirror, MirrorDataTable, FVector2D(BlendSpacePosition.X, BlendSpacePosition.Y), MotionBlendSpace);
-						
-						CurrentFeatureOffset += MatchFeature->Size();
-					}
-				}
-				
-				FPoseMotionData NewPoseData = FPoseMotionData(PoseId, EMotionAnimAssetType::BlendSpace, SourceBlendSpaceIndex,
-					CurrentTime, EPoseSearchFlag::Searchable, bMirror, MotionBlendSpace->MotionTags);
-
-				NewPoseData.BlendSpacePosition = FVector2D(BlendSpacePosition.X, BlendSpacePosition.Y);
-				
-				Poses.Add(NewPoseData);
-				CurrentTime += PoseInterval * PlayRate;
-			}
-		}
-	}
+	UMotionCompositeObject* MotionComposite = SourceCompositeObjects[Range.AnimId];
+	const float PlayRate = MotionComposite->GetPlayRate();
+	const int32 StartPoseId = Range.StartPoseId;
+	const int32 LastPoseId = Range.EndPoseId - 1;
 
 	//PreProcess Tags 
-	for (FAnimNotifyEvent& NotifyEvent : MotionBlendSpace->Tags)
+	for (FAnimNotifyEvent& NotifyEvent : MotionComposite->Tags)
 	{
 		if (UTagSection* TagSection = Cast<UTagSection>(NotifyEvent.NotifyStateClass))
 		{
@@ -1614,19 +2571,19 @@ void UMotionDataAsset::PreProcessBlendSpace(const int32 SourceBlendSpaceIndex, c
 			const float TagEndTime = TagStartTime + (NotifyEvent.GetDuration() / PlayRate);
 
 			//Pre-process the tag itself
-			TagSection->PreProcessTag(MotionBlendSpace, this, TagStartTime, TagStartTime + NotifyEvent.Duration);
+			TagSection->PreProcessTag(MotionComposite, this, TagStartTime, TagStartTime + NotifyEvent.Duration);
 
 			//Find the range of poses affected by this tag
 			int32 TagStartPoseId = StartPoseId + FMath::RoundHalfToEven(TagStartTime / PoseInterval);
 			int32 TagEndPoseId = StartPoseId + FMath::RoundHalfToEven(TagEndTime / PoseInterval);
 
-			TagStartPoseId = FMath::Clamp(TagStartPoseId, 0, Poses.Num() - 1);
-			TagEndPoseId = FMath::Clamp(TagEndPoseId, 0, Poses.Num() - 1);
+			TagStartPoseId = FMath::Clamp(TagStartPoseId, 0, LastPoseId);
+			TagEndPoseId = FMath::Clamp(TagEndPoseId, 0, LastPoseId);
 
 			//Apply the tags pre-processing to all poses in this range
 			for (int32 PoseIndex = TagStartPoseId; PoseIndex < TagEndPoseId; ++PoseIndex)
 			{
-				TagSection->PreProcessPose(Poses[PoseIndex], MotionBlendSpace, this, TagStartTime, TagEndTime);
+				TagSection->PreProcessPose(Poses[PoseIndex], MotionComposite, this, TagStartTime, TagEndTime);
 			}
 
 			continue; //Don't check for a tag point if we already know its a tag section
@@ -1636,121 +2593,214 @@ void UMotionDataAsset::PreProcessBlendSpace(const int32 SourceBlendSpaceIndex, c
 		{
 			const float TagTime = NotifyEvent.GetTriggerTime() / PlayRate;
 			int32 TagClosestPoseId = StartPoseId + FMath::RoundHalfToEven(TagTime / PoseInterval);
-			TagClosestPoseId = FMath::Clamp(TagClosestPoseId, 0, Poses.Num() - 1);
+			TagClosestPoseId = FMath::Clamp(TagClosestPoseId, 0, LastPoseId);
 
-			TagPoint->PreProcessTag(Poses[TagClosestPoseId], MotionBlendSpace, this, TagTime);
+			TagPoint->PreProcessTag(Poses[TagClosestPoseId], MotionComposite, this, TagTime);
 		}
 	}
-	
 #endif
 }
 
-void UMotionDataAsset::PreProcessComposite(const int32 SourceCompositeIndex, const bool bMirror /*= false*/)
+#if WITH_EDITOR
+namespace MotionDataPreProcessHash
+{
+	static uint32 HashAnimationData(const UAnimationAsset* AnimAsset, uint32 Hash)
+	{
+		if(!AnimAsset)
+		{
+			return HashCombine(Hash, 0u);
+		}
+
+		Hash = HashCombine(Hash, GetTypeHash(AnimAsset->GetPathName()));
+
+		if(const UAnimSequence* Sequence = Cast<UAnimSequence>(AnimAsset))
+		{
+			if(const IAnimationDataModel* DataModel = Sequence->GetDataModel())
+			{
+				Hash = HashCombine(Hash, GetTypeHash(DataModel->GenerateGuid()));
+			}
+
+			return Hash;
+		}
+
+		//Blend spaces and composites are hashed by their own properties and the data of every animation they reference
+		Hash = HashObjectProperties(AnimAsset, Hash);
+		if(const UBlendSpace* BlendSpace = Cast<UBlendSpace>(AnimAsset))
+		{
+			for(const FBlendSample& Sample : BlendSpace->GetBlendSamples())
+			{
+				Hash = HashAnimationData(Sample.Animation.Get(), Hash);
+			}
+		}
+		else if(const UAnimComposite* Composite = Cast<UAnimComposite>(AnimAsset))
+		{
+			for(const FAnimSegment& Segment : Composite->AnimationTrack.AnimSegments)
+			{
+				Hash = HashAnimationData(Segment.GetAnimReference().Get(), Hash);
+			}
+		}
+
+		return Hash;
+	}
+}
+#endif
+
+uint32 UMotionDataAsset::ComputePreProcessConfigHash() const
 {
 #if WITH_EDITOR
-	TObjectPtr<UMotionCompositeObject> MotionComposite = SourceCompositeObjects[SourceCompositeIndex];
+	using namespace MotionDataPreProcessHash;
 
-	if(!MotionComposite)
+	uint32 Hash = GetTypeHash(PoseInterval);
+	Hash = HashObjectProperties(MirrorDataTable, Hash);
+	Hash = HashObjectProperties(MotionMatchConfig, Hash);
+
+	if(MotionMatchConfig)
 	{
-		return;
+		for(const UMatchFeatureBase* MatchFeature : MotionMatchConfig->Features)
+		{
+			Hash = HashObjectProperties(MatchFeature, Hash);
+		}
 	}
-	
-	const UAnimComposite* Composite = MotionComposite->AnimComposite;
 
-	if (!Composite)
+	return Hash;
+#else
+	return 0;
+#endif
+}
+
+uint32 UMotionDataAsset::ComputePreProcessRangeHash(const FMotionPreProcessRange& Range, const uint32 ConfigHash) const
+{
+#if WITH_EDITOR
+	using namespace MotionDataPreProcessHash;
+	
+	const UMotionAnimObject* MotionAnim = nullptr;
+	const UAnimationAsset* AnimAsset = nullptr;
+	uint32 Hash = HashCombine(ConfigHash, GetTypeHash(static_cast<uint8>(Range.AnimType)));
+	
+	switch(Range.AnimType)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to pre-process composite. The animation composite is null and has been skipped. Check that all your animations are valid."));
-		return;
+		case EMotionAnimAssetType::Sequence:
+		{
+			const UMotionSequenceObject* MotionSequence = SourceMotionSequenceObjects[Range.AnimId];
+			MotionAnim = MotionSequence;
+			AnimAsset = MotionSequence->Sequence;
+		} break;
+		case EMotionAnimAssetType::BlendSpace:
+		{
+			const UMotionBlendSpaceObject* MotionBlendSpace = SourceBlendSpaceObjects[Range.AnimId];
+			MotionAnim = MotionBlendSpace;
+			AnimAsset = MotionBlendSpace->BlendSpace;
+			Hash = HashCombine(Hash, GetTypeHash(MotionBlendSpace->SampleSpacing));
+		} break;
+		case EMotionAnimAssetType::Composite:
+		{
+			const UMotionCompositeObject* MotionComposite = SourceCompositeObjects[Range.AnimId];
+			MotionAnim = MotionComposite;
+			AnimAsset = MotionComposite->AnimComposite;
+		} break;
+		default: return Hash;
 	}
 
-	Modify();
+	Hash = HashCombine(Hash, GetTypeHash(Range.bMirrored));
+	Hash = HashCombine(Hash, GetTypeHash(Range.EndPoseId - Range.StartPoseId));
+	Hash = HashAnimationData(AnimAsset, Hash);
 
-	MotionComposite->AnimId = SourceCompositeIndex;
+	//Motion anim settings. The anim id is deliberately not hashed so that re-ordering animations does not dirty them
+	Hash = HashCombine(Hash, GetTypeHash(MotionAnim->bLoop));
+	Hash = HashCombine(Hash, GetTypeHash(MotionAnim->PlayRate));
+	Hash = HashCombine(Hash, GetTypeHash(MotionAnim->bFlattenTrajectory));
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(MotionAnim->PastTrajectory)));
+	Hash = HashAnimationData(MotionAnim->PrecedingMotion.Get(), Hash);
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(MotionAnim->FutureTrajectory)));
+	Hash = HashAnimationData(MotionAnim->FollowingMotion.Get(), Hash);
+	Hash = HashCombine(Hash, GetTypeHash(MotionAnim->CostMultiplier));
 
-	const float AnimLength = Composite->GetPlayLength();
-	const float PlayRate = MotionComposite->GetPlayRate();
-	float CurrentTime = 0.0f;
-	const float TimeHorizon = 1.0f * PlayRate;
+	for(const FGameplayTag& MotionTag : MotionAnim->MotionTags)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(MotionTag));
+	}
 
-	if (PoseInterval < 0.01f)
+	for(const TObjectPtr<UAnimSequence>& InteractionAnim : MotionAnim->InteractionAnims)
 	{
-		PoseInterval = 0.05f;
+		Hash = HashAnimationData(InteractionAnim.Get(), Hash);
 	}
 
-	const int32 StartPoseId = Poses.Num();
-	while (CurrentTime <= AnimLength)
+	//Some features read tags (e.g. distance markers) so every tag is part of the hash too
+	for(const FAnimNotifyEvent& NotifyEvent : MotionAnim->Tags)
 	{
-		const int32 PoseId = Poses.Num();
+		Hash = HashCombine(Hash, GetTypeHash(NotifyEvent.GetTriggerTime()));
+		Hash = HashCombine(Hash, GetTypeHash(NotifyEvent.GetDuration()));
+		Hash = HashObjectProperties(NotifyEvent.Notify, Hash);
+		Hash = HashObjectProperties(NotifyEvent.NotifyStateClass, Hash);
+	}
 
-		const bool bDoNotUse = ((CurrentTime < TimeHorizon) && (MotionComposite->PastTrajectory == ETrajectoryPreProcessMethod::IgnoreEdges))
-		                       || ((CurrentTime > AnimLength - TimeHorizon) && (MotionComposite->FutureTrajectory == ETrajectoryPreProcessMethod::IgnoreEdges))
-			                       ? true : false;
+	return Hash;
+#else
+	return 0;
+#endif
+}
 
+void UMotionDataAsset::RestorePreProcessCache(TArray<FMotionPreProcessRange>& Ranges, TArray<int32>& OutDirtyPoseIds)
+{
+#if WITH_EDITOR
+	const uint32 ConfigHash = ComputePreProcessConfigHash();
+	for(FMotionPreProcessRange& Range : Ranges)
+	{
+		Range.ContentHash = ComputePreProcessRangeHash(Range, ConfigHash);
+	}
 
-		const int32 LookupIndex = PoseId * LookupPoseMatrix.AtomCount;
-		const int32 MaxLookupIndex = LookupIndex + LookupPoseMatrix.AtomCount - 1;
-		if(MaxLookupIndex < 0 || MaxLookupIndex >= LookupPoseMatrix.PoseArray.Num())
-		{
-			break;
-		}
-		
-		LookupPoseMatrix.PoseArray[LookupIndex] = MotionComposite->CostMultiplier;; //This is the pose favour, defaults to 1.0f and is set otherwise by tags
-		
-		int32 CurrentFeatureOffset = 1; //Current Feature offset starts at 1 because we need to skip the first float used for pose favour
-		for(UMatchFeatureBase* MatchFeature : MotionMatchConfig->Features)
+	const int32 AtomCount = LookupPoseMatrix.AtomCount;
+	TMap<uint32, int32> CachedRangeMap;
+	if(CVarMotionDataIncrementalPreProcess.GetValueOnGameThread() > 0
+		&& PreProcessCacheAtomCount == AtomCount)
+	{
+		CachedRangeMap.Reserve(PreProcessCacheRanges.Num());
+		for(int32 i = 0; i < PreProcessCacheRanges.Num(); ++i)
 		{
-			if(MatchFeature)
-			{
-				float* ResultLocation = &LookupPoseMatrix.PoseArray[PoseId * LookupPoseMatrix.AtomCount + CurrentFeatureOffset];
-				MatchFeature->EvaluatePreProcess(ResultLocation, MotionComposite->AnimComposite, CurrentTime, PoseInterval,
-				                                 bMirror, MirrorDataTable, MotionComposite);
-				CurrentFeatureOffset += MatchFeature->Size();
-			}
+			CachedRangeMap.FindOrAdd(PreProcessCacheRanges[i].ContentHash, i);
 		}
-		
-		Poses.Emplace(FPoseMotionData(PoseId, EMotionAnimAssetType::Composite, SourceCompositeIndex, CurrentTime,
-			bDoNotUse ? EPoseSearchFlag::DoNotUse : EPoseSearchFlag::Searchable, bMirror, MotionComposite->MotionTags));
-		
-		CurrentTime += PoseInterval * PlayRate;
 	}
 
-	//PreProcess Tags 
-	for (FAnimNotifyEvent& NotifyEvent : MotionComposite->Tags)
+	OutDirtyPoseIds.Empty(Poses.Num());
+	int32 ReusedPoseCount = 0;
+	for(const FMotionPreProcessRange& Range : Ranges)
 	{
-		if (UTagSection* TagSection = Cast<UTagSection>(NotifyEvent.NotifyStateClass))
-		{
-			const float TagStartTime = NotifyEvent.GetTriggerTime() / PlayRate;
-			const float TagEndTime = TagStartTime + (NotifyEvent.GetDuration() / PlayRate);
-
-			//Pre-process the tag itself
-			TagSection->PreProcessTag(MotionComposite, this, TagStartTime, TagStartTime + NotifyEvent.Duration);
-
-			//Find the range of poses affected by this tag
-			int32 TagStartPoseId = StartPoseId + FMath::RoundHalfToEven(TagStartTime / PoseInterval);
-			int32 TagEndPoseId = StartPoseId + FMath::RoundHalfToEven(TagEndTime / PoseInterval);
+		const int32 PoseCount = Range.EndPoseId - Range.StartPoseId;
+		const int32* CachedRangeIndex = CachedRangeMap.Find(Range.ContentHash);
 
-			TagStartPoseId = FMath::Clamp(TagStartPoseId, 0, Poses.Num() - 1);
-			TagEndPoseId = FMath::Clamp(TagEndPoseId, 0, Poses.Num() - 1);
+		if(CachedRangeIndex && PreProcessCacheRanges[*CachedRangeIndex].PoseCount == PoseCount)
+		{
+			const FMotionPreProcessCachedRange& CachedRange = PreProcessCacheRanges[*CachedRangeIndex];
+			FMemory::Memcpy(&LookupPoseMatrix.PoseArray[Range.StartPoseId * AtomCount],
+				&PreProcessCachePoseArray[CachedRange.StartPoseId * AtomCount], PoseCount * AtomCount * sizeof(float));
 
-			//Apply the tags pre-processing to all poses in this range
-			for (int32 PoseIndex = TagStartPoseId; PoseIndex < TagEndPoseId; ++PoseIndex)
+			ReusedPoseCount += PoseCount;
+		}
+		else
+		{
+			for(int32 PoseId = Range.StartPoseId; PoseId < Range.EndPoseId; ++PoseId)
 			{
-				TagSection->PreProcessPose(Poses[PoseIndex], MotionComposite, this, TagStartTime, TagEndTime);
+				OutDirtyPoseIds.Add(PoseId);
 			}
-
-			continue; //Don't check for a tag point if we already know its a tag section
 		}
+	}
 
-		if (UTagPoint* TagPoint = Cast<UTagPoint>(NotifyEvent.Notify))
-		{
-			const float TagTime = NotifyEvent.GetTriggerTime() / PlayRate;
-			int32 TagClosestPoseId = StartPoseId + FMath::RoundHalfToEven(TagTime / PoseInterval);
-			TagClosestPoseId = FMath::Clamp(TagClosestPoseId, 0, Poses.Num() - 1);
+	UE_LOG(LogTemp, Display, TEXT("Motion Data pre-process re-used %d of %d poses from the previous pre-process."),
+		ReusedPoseCount, Poses.Num());
+#endif
+}
 
-			TagPoint->PreProcessTag(Poses[TagClosestPoseId], MotionComposite, this, TagTime);
-		}
-	}
+void UMotionDataAsset::StorePreProcessCache(const TArray<FMotionPreProcessRange>& Ranges)
+{
+#if WITH_EDITOR
+	PreProcessCacheAtomCount = LookupPoseMatrix.AtomCount;
+	PreProcessCachePoseArray = LookupPoseMatrix.PoseArray;
 
+	PreProcessCacheRanges.Empty(Ranges.Num());
+	for(const FMotionPreProcessRange& Range : Ranges)
+	{
+		PreProcessCacheRanges.Add({Range.ContentHash, Range.StartPoseId, Range.EndPoseId - Range.StartPoseId});
+	}
 #endif
 }
 
@@ -1881,6 +2931,9 @@ void UMotionDataAsset::MarkEdgePoses(float InMaxAnimBlendTime)
 
 void UMotionDataAsset::GenerateSearchPoseMatrix()
 {
+	//Generated search structures are always held in the property arrays
+	ReleaseBulkSearchData();
+	
 	//Find the total number of valid poses to search
 	int32 ValidPoseCount = 0;
 	for(int32 i = 0; i < Poses.Num(); ++i)
@@ -1893,7 +2946,8 @@ void UMotionDataAsset::GenerateSearchPoseMatrix()
 
 	//Create the SearchPoseMatrix based on the number of valid poses. Prepare the remap arrays
 	PoseIdRemap.SetNumZeroed(ValidPoseCount);
-	PoseIdRemapReverse.Empty(ValidPoseCount+1);
+	DensePoseIdRemapReverse.Init(INDEX_NONE, Poses.Num());
+	PoseIdRemapReverse_DEPRECATED.Empty();
 	SearchPoseMatrix.AtomCount = LookupPoseMatrix.AtomCount;
 	SearchPoseMatrix.PoseCount = ValidPoseCount;
 	SearchPoseMatrix.PoseArray.SetNumZeroed(ValidPoseCount * LookupPoseMatrix.AtomCount);
@@ -1923,8 +2977,8 @@ void UMotionDataAsset::GenerateSearchPoseMatrix()
 
 			const int32 MaxSearchIndex = ValidStartIndex + SearchPoseMatrix.AtomCount;
 			const int32 MaxLookupIndex = BaseStartIndex + SearchPoseMatrix.AtomCount;
-			if(MaxSearchIndex >= SearchPoseMatrix.PoseArray.Num()
-				|| MaxLookupIndex >= LookupPoseMatrix.PoseArray.Num())
+			if(MaxSearchIndex > SearchPoseMatrix.PoseArray.Num()
+				|| MaxLookupIndex > LookupPoseMatrix.PoseArray.Num())
 			{
 				break;
 			}
@@ -1936,7 +2990,7 @@ void UMotionDataAsset::GenerateSearchPoseMatrix()
 
 			//We need to add a valid pose id to the remap because the pose database now no longer matches the pose matrix
 			PoseIdRemap[ValidPoseId] = i;
-			PoseIdRemapReverse.Add(i, ValidPoseId);
+			DensePoseIdRemapReverse[i] = ValidPoseId;
 
 			++ValidPoseId;
 		}
@@ -1946,9 +3000,65 @@ void UMotionDataAsset::GenerateSearchPoseMatrix()
 
 	SearchPoseMatrix.PoseCount = ValidPoseId;
 
+	if(SearchPoseOrder == EPoseMatrixOrder::Spatial)
+	{
+		ReorderSearchPoseMatrix();
+	}
+
 	//Create AABB data structures
 	PoseAABBMatrix_Outer = FPoseAABBMatrix(SearchPoseMatrix, 64);
 	PoseAABBMatrix_Inner = FPoseAABBMatrix(SearchPoseMatrix, 16);
+
+	//Like the feature major matrix, the hierarchy bounds the full precision rows and is never searched at reduced precision
+	if(bGenerateAABBHierarchy
+		&& SearchMatrixPrecision == EPoseMatrixPrecision::Float)
+	{
+		AABBHierarchy.Build(SearchPoseMatrix, MotionTagMatrixSections, AABBHierarchyLeafSize, AABBHierarchyMaxLevels);
+	}
+	else
+	{
+		AABBHierarchy.Empty();
+	}
+
+	//The feature major matrix is a full precision copy, which is never searched when the precision is reduced
+	if(SearchMatrixLayout == ESearchMatrixLayout::FeatureMajor
+		&& SearchMatrixPrecision == EPoseMatrixPrecision::Float)
+	{
+		FeatureMajorSearchMatrix.Build(SearchPoseMatrix, MotionMatchConfig);
+	}
+	else
+	{
+		FeatureMajorSearchMatrix.Empty();
+	}
+
+	GenerateQuantizedSearchData();
+
+	//The tree leaves are evaluated at the searched precision, so the tree must bound the quantized poses for its
+	//pruning to stay exact
+	if(QuantizedSearchPoseMatrix.IsValid(SearchMatrixPrecision, SearchPoseMatrix.AtomCount, SearchPoseMatrix.PoseCount))
+	{
+		FPoseMatrix DequantizedMatrix;
+		DequantizedMatrix.AtomCount = SearchPoseMatrix.AtomCount;
+		DequantizedMatrix.PoseCount = SearchPoseMatrix.PoseCount;
+		QuantizedSearchPoseMatrix.Dequantize(DequantizedMatrix.PoseArray);
+		SearchTree.Build(DequantizedMatrix, MotionTagMatrixSections);
+	}
+	else
+	{
+		SearchTree.Build(SearchPoseMatrix, MotionTagMatrixSections);
+	}
+
+	if(bCompressSearchMatrix)
+	{
+		SearchMatrixPQ.Build(SearchPoseMatrix, CompressedSubspaceSize);
+	}
+	else
+	{
+		SearchMatrixPQ.Empty();
+	}
+
+	SearchStructureHash = ComputeSearchStructureHash();
+	SearchStructureConfigHash = ComputeSearchStructureConfigHash();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -1,6 +1,8 @@
 //Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
 
 #include "Objects/Assets/MotionMatchConfig.h"
+#include "Objects/Assets/MotionDataAsset.h"
+#include "UObject/UObjectIterator.h"
 
 #define LOCTEXT_NAMESPACE "MotionMatchConfig"
 
@@ -201,4 +203,26 @@ int32 UMotionMatchConfig::ComputeQualityArraySize()
 	return Count;
 }
 
+#if WITH_EDITORONLY_DATA
+void UMotionMatchConfig::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	Initialize();
+
+	//Motion data bakes its final calibration weights from this config, so loaded motion data regenerates them here rather
+	//than waiting for a re-process
+	for(TObjectIterator<UMotionDataAsset> It; It; ++It)
+	{
+		UMotionDataAsset* MotionData = *It;
+		if(MotionData->MotionMatchConfig == this
+			&& MotionData->bIsProcessed
+			&& !MotionData->AreFinalCalibrationWeightsValid())
+		{
+			MotionData->GenerateFinalCalibrationWeights();
+		}
+	}
+}
+#endif
+
 #undef LOCTEXT_NAMESPACE
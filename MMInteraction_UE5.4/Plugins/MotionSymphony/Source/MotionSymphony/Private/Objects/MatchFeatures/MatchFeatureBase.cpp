@@ -4,7 +4,8 @@
 #include "MMPreProcessUtils.h"
 
 UMatchFeatureBase::UMatchFeatureBase()
-	: DefaultWeight(1.0f)
+	: DefaultWeight(1.0f),
+	SearchStage(EMatchFeatureSearchStage::Auto)
 {
 }
 
@@ -104,6 +105,32 @@ bool UMatchFeatureBase::CanBeResponseFeature() const
 	return false;
 }
 
+EMatchFeatureSearchStage UMatchFeatureBase::GetResolvedSearchStage() const
+{
+	if(SearchStage != EMatchFeatureSearchStage::Auto)
+	{
+		return SearchStage;
+	}
+
+	return PoseCategory == EPoseCategory::Responsiveness ? EMatchFeatureSearchStage::Coarse : EMatchFeatureSearchStage::Refine;
+}
+
+bool UMatchFeatureBase::HasRefinementCost() const
+{
+	return false;
+}
+
+float UMatchFeatureBase::ComputeRefinementCost(const float* QueryFeature, const float* PoseFeature,
+	const float* FeatureWeights, const float DeltaTime) const
+{
+	return 0.0f;
+}
+
+float UMatchFeatureBase::GetRefinementCostWeight(const UMotionMatchConfig* InMMConfig) const
+{
+	return 1.0f;
+}
+
 FName UMatchFeatureBase::GetFeatureName() const
 {
 	return FName();
@@ -5,6 +5,7 @@
 #include "MotionAnimAsset.h"
 #include "MotionAnimObject.h"
 #include "MotionDataAsset.h"
+#include "MotionMatchConfig.h"
 #include "Animation/AnimInstanceProxy.h"
 
 #if WITH_EDITOR
@@ -329,6 +330,36 @@ bool UMatchFeature_BoneLocationAndVelocity::CanBeQualityFeature() const
 	return true;
 }
 
+bool UMatchFeature_BoneLocationAndVelocity::HasRefinementCost() const
+{
+	return true;
+}
+
+float UMatchFeature_BoneLocationAndVelocity::ComputeRefinementCost(const float* QueryFeature, const float* PoseFeature,
+	const float* FeatureWeights, const float DeltaTime) const
+{
+	if(DeltaTime <= UE_KINDA_SMALL_NUMBER)
+	{
+		return 0.0f;
+	}
+
+	//Atoms 0-2 are the bone location and atoms 3-5 the bone velocity. The resultant velocity is the velocity the bone
+	//would need to move from the query location to the pose location in one update
+	float Cost = 0.0f;
+	for(int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		const float ResultantVelocity = (PoseFeature[Axis] - QueryFeature[Axis]) / DeltaTime;
+		Cost += FMath::Abs(ResultantVelocity - QueryFeature[Axis + 3]) * FeatureWeights[Axis + 3];
+	}
+
+	return Cost;
+}
+
+float UMatchFeature_BoneLocationAndVelocity::GetRefinementCostWeight(const UMotionMatchConfig* InMMConfig) const
+{
+	return InMMConfig ? InMMConfig->ResultantVelocityWeight : 1.0f;
+}
+
 FName UMatchFeature_BoneLocationAndVelocity::GetFeatureName() const
 {
 	FString FeatureName = TEXT("LV_") + BoneReference.BoneName.ToString();
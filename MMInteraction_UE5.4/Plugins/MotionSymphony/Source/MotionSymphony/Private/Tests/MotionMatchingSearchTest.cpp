@@ -0,0 +1,107 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Utility/MotionMatchingSearch.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace MotionMatchingSearchTest
+{
+	/** Odd counts past several 8 atom blocks so that every combination of 8 wide, 4 wide and scalar tail is covered */
+	static constexpr int32 MaxCount = 67;
+
+	/** The arrays are also read from unaligned starts since the kernels use unaligned loads */
+	static constexpr int32 MaxOffset = 3;
+
+	uint32 GetBits(const float Value)
+	{
+		uint32 Bits;
+		FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+		return Bits;
+	}
+
+	/** Random values of very different magnitudes so that summing in a different order changes the low bits */
+	void FillArray(FRandomStream& RandomStream, TArray<float>& OutArray, const float MinValue, const float MaxValue)
+	{
+		OutArray.SetNumUninitialized(MaxCount + MaxOffset + 1);
+		for(float& Value : OutArray)
+		{
+			Value = RandomStream.FRandRange(MinValue, MaxValue) * FMath::Pow(10.0f, static_cast<float>(RandomStream.RandRange(-3, 3)));
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMotionMatchingCostKernelTest, "MotionSymphony.Search.CostKernelsMatchScalarReference",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMotionMatchingCostKernelTest::RunTest(const FString& Parameters)
+{
+	using namespace MotionMatchingSearchTest;
+
+	FRandomStream RandomStream(2);
+	TArray<float> A;
+	TArray<float> B;
+	TArray<float> Weights;
+	FillArray(RandomStream, A, -1.0f, 1.0f);
+	FillArray(RandomStream, B, -1.0f, 1.0f);
+	FillArray(RandomStream, Weights, 0.0f, 1.0f);
+
+	const float BaseCost = 1.5f;
+	const float PoseFavour = 0.95f;
+
+	int32 MismatchCount = 0;
+	for(int32 Offset = 0; Offset <= MaxOffset; ++Offset)
+	{
+		const float* OffsetA = A.GetData() + Offset;
+		const float* OffsetB = B.GetData() + Offset;
+		const float* OffsetWeights = Weights.GetData() + Offset;
+
+		for(int32 Count = 0; Count <= MaxCount; ++Count)
+		{
+			//The vectorized kernel must give exactly the scalar reference
+			const float Reference = FMotionMatchingSearch::ComputeWeightedL1_Scalar(OffsetA, OffsetB, OffsetWeights, Count);
+			const float Vectorized = FMotionMatchingSearch::ComputeWeightedL1(OffsetA, OffsetB, OffsetWeights, Count);
+			if(GetBits(Vectorized) != GetBits(Reference))
+			{
+				AddError(FString::Printf(TEXT("ComputeWeightedL1 (offset %d, count %d) returned %.9g but the scalar reference is %.9g"),
+					Offset, Count, Vectorized, Reference));
+				++MismatchCount;
+			}
+
+			//A bounded evaluation that is never abandoned must give exactly BaseCost + ComputeWeightedL1
+			const float Bounded = FMotionMatchingSearch::ComputeWeightedL1Bounded(OffsetA, OffsetB, OffsetWeights, Count,
+				BaseCost, 1.0f, UE_MAX_FLT);
+			if(GetBits(Bounded) != GetBits(BaseCost + Reference))
+			{
+				AddError(FString::Printf(TEXT("ComputeWeightedL1Bounded (offset %d, count %d) returned %.9g but expected %.9g"),
+					Offset, Count, Bounded, BaseCost + Reference));
+				++MismatchCount;
+			}
+
+			//The pose cost skips the pose favour atom of the rows but not of the calibration weights
+			const int32 AtomCount = Count + 1;
+			const float PoseReference = FMotionMatchingSearch::ComputeWeightedL1_Scalar(OffsetA + 1, OffsetB + 1, OffsetWeights, Count);
+			const float PoseCost = FMotionMatchingSearch::ComputePoseCost(OffsetA, OffsetB, OffsetWeights, AtomCount);
+			if(GetBits(PoseCost) != GetBits(PoseReference))
+			{
+				AddError(FString::Printf(TEXT("ComputePoseCost (offset %d, atom count %d) returned %.9g but the scalar reference is %.9g"),
+					Offset, AtomCount, PoseCost, PoseReference));
+				++MismatchCount;
+			}
+
+			const float PoseCostBounded = FMotionMatchingSearch::ComputePoseCostBounded(OffsetA, OffsetB, OffsetWeights, AtomCount,
+				PoseFavour, UE_MAX_FLT);
+			if(GetBits(PoseCostBounded) != GetBits(PoseReference * PoseFavour))
+			{
+				AddError(FString::Printf(TEXT("ComputePoseCostBounded (offset %d, atom count %d) returned %.9g but expected %.9g"),
+					Offset, AtomCount, PoseCostBounded, PoseReference * PoseFavour));
+				++MismatchCount;
+			}
+		}
+	}
+
+	return MismatchCount == 0;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -8,6 +8,115 @@
 #include "Enumerations/EMotionMatchingEnums.h"
 #include "Animation/MirrorDataTable.h"
 #include "Animation/Skeleton.h"
+#include <atomic>
+
+namespace MMPreProcessPoseCache
+{
+	/** The number of (animation, time) poses cached per thread. A pose evaluation only samples a handful of times, but blend
+	 * spaces sample every blend sample animation at each of those times */
+	static constexpr int32 MaxCachedPoses = 32;
+
+	struct FCachedPose
+	{
+		const UAnimSequence* AnimSequence = nullptr;
+		float Time = 0.0f;
+		uint64 LastUsed = 0;
+		TArray<FTransform> BoneTransforms;
+		TBitArray<> ValidBones;
+	};
+
+	struct FThreadCache
+	{
+		uint32 Generation = 0;
+		uint64 UseCounter = 0;
+		TArray<FCachedPose> Poses;
+	};
+
+	static std::atomic<int32> ActiveScopeCount(0);
+	static std::atomic<uint32> Generation(1);
+	static thread_local FThreadCache ThreadCache;
+
+	static FCachedPose& FindOrAddPose(const UAnimSequence* AnimSequence, const float Time, const int32 BoneCount)
+	{
+		FThreadCache& Cache = ThreadCache;
+
+		const uint32 CurrentGeneration = Generation.load(std::memory_order_relaxed);
+		if(Cache.Generation != CurrentGeneration)
+		{
+			Cache.Poses.Reset();
+			Cache.Generation = CurrentGeneration;
+		}
+
+		++Cache.UseCounter;
+
+		int32 LeastRecentIndex = INDEX_NONE;
+		for(int32 i = 0; i < Cache.Poses.Num(); ++i)
+		{
+			FCachedPose& CachedPose = Cache.Poses[i];
+			if(CachedPose.AnimSequence == AnimSequence && CachedPose.Time == Time)
+			{
+				CachedPose.LastUsed = Cache.UseCounter;
+				return CachedPose;
+			}
+
+			if(LeastRecentIndex == INDEX_NONE || CachedPose.LastUsed < Cache.Poses[LeastRecentIndex].LastUsed)
+			{
+				LeastRecentIndex = i;
+			}
+		}
+
+		FCachedPose& NewPose = Cache.Poses.Num() < MaxCachedPoses ? Cache.Poses.AddDefaulted_GetRef() : Cache.Poses[LeastRecentIndex];
+		NewPose.AnimSequence = AnimSequence;
+		NewPose.Time = Time;
+		NewPose.LastUsed = Cache.UseCounter;
+		NewPose.BoneTransforms.SetNumUninitialized(BoneCount, EAllowShrinking::No);
+		NewPose.ValidBones.Init(false, BoneCount);
+
+		return NewPose;
+	}
+}
+
+void FMMPreProcessPoseCache::GetBoneTransform(FTransform& OutTransform, const UAnimSequence* AnimSequence,
+	const int32 BoneIndex, const float Time)
+{
+	const int32 BoneCount = AnimSequence->GetSkeleton()->GetReferenceSkeleton().GetNum();
+	if(!IsActive() || BoneIndex < 0 || BoneIndex >= BoneCount)
+	{
+		AnimSequence->GetBoneTransform(OutTransform, FSkeletonPoseBoneIndex(BoneIndex), Time, true);
+		return;
+	}
+
+	MMPreProcessPoseCache::FCachedPose& CachedPose = MMPreProcessPoseCache::FindOrAddPose(AnimSequence, Time, BoneCount);
+	if(!CachedPose.ValidBones[BoneIndex])
+	{
+		AnimSequence->GetBoneTransform(CachedPose.BoneTransforms[BoneIndex], FSkeletonPoseBoneIndex(BoneIndex), Time, true);
+		CachedPose.ValidBones[BoneIndex] = true;
+	}
+
+	OutTransform = CachedPose.BoneTransforms[BoneIndex];
+}
+
+void FMMPreProcessPoseCache::Invalidate()
+{
+	MMPreProcessPoseCache::Generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool FMMPreProcessPoseCache::IsActive()
+{
+	return MMPreProcessPoseCache::ActiveScopeCount.load(std::memory_order_relaxed) > 0;
+}
+
+FMMPreProcessPoseCacheScope::FMMPreProcessPoseCacheScope()
+{
+	FMMPreProcessPoseCache::Invalidate();
+	MMPreProcessPoseCache::ActiveScopeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+FMMPreProcessPoseCacheScope::~FMMPreProcessPoseCacheScope()
+{
+	MMPreProcessPoseCache::ActiveScopeCount.fetch_sub(1, std::memory_order_relaxed);
+	FMMPreProcessPoseCache::Invalidate();
+}
 
 void FMMPreProcessUtils::ExtractRootMotionParams(FRootMotionMovementParams& OutRootMotion, 
 	const TArray<FBlendSampleData>& BlendSampleData, const float BaseTime, const float DeltaTime, const bool AllowLooping)
@@ -896,11 +1005,11 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform & OutJointTra
 		return;
 	}
 
-	const FReferenceSkeleton RefSkeleton = AnimSequence->GetSkeleton()->GetReferenceSkeleton();
+	const FReferenceSkeleton& RefSkeleton = AnimSequence->GetSkeleton()->GetReferenceSkeleton();
 
 	if (RefSkeleton.IsValidIndex(JointId))
 	{
-		AnimSequence->GetBoneTransform(OutJointTransform, FSkeletonPoseBoneIndex(JointId), Time, true);
+		FMMPreProcessPoseCache::GetBoneTransform(OutJointTransform, AnimSequence, JointId, Time);
 		int32 CurrentJointId = JointId;
 
 		while (RefSkeleton.GetRawParentIndex(CurrentJointId) != 0)
@@ -909,7 +1018,7 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform & OutJointTra
 			const int32 ParentJointId = RefSkeleton.GetRawParentIndex(CurrentJointId);
 			
 			FTransform ParentTransform;
-			AnimSequence->GetBoneTransform(ParentTransform, FSkeletonPoseBoneIndex(ParentJointId), Time, true);
+			FMMPreProcessPoseCache::GetBoneTransform(ParentTransform, AnimSequence, ParentJointId, Time);
 
 			OutJointTransform = OutJointTransform * ParentTransform;
 			CurrentJointId = ParentJointId;
@@ -948,7 +1057,7 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform& OutJointTran
 		const ScalarRegister VSampleWeight(Sample.GetClampedWeight());
 		
 		FTransform AnimJointTransform;
-		Sample.Animation->GetBoneTransform(AnimJointTransform, FSkeletonPoseBoneIndex(JointId), Time, true);
+		FMMPreProcessPoseCache::GetBoneTransform(AnimJointTransform, Sample.Animation, JointId, Time);
 
 		int32 CurrentJointId = JointId;
 
@@ -962,7 +1071,7 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform& OutJointTran
 		while (ParentJointId != 0)
 		{
 			FTransform ParentTransform;
-			Sample.Animation->GetBoneTransform(ParentTransform, FSkeletonPoseBoneIndex(ParentJointId), Time, true);
+			FMMPreProcessPoseCache::GetBoneTransform(ParentTransform, Sample.Animation, ParentJointId, Time);
 
 			AnimJointTransform = AnimJointTransform * ParentTransform;
 			CurrentJointId = ParentJointId;
@@ -1010,11 +1119,11 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform& OutJointTran
 		return;
 	}
 
-	const FReferenceSkeleton RefSkeleton = Sequence->GetSkeleton()->GetReferenceSkeleton();
+	const FReferenceSkeleton& RefSkeleton = Sequence->GetSkeleton()->GetReferenceSkeleton();
 
 	if (RefSkeleton.IsValidIndex(JointId))
 	{
-		Sequence->GetBoneTransform(OutJointTransform, FSkeletonPoseBoneIndex(JointId), Time, true);
+		FMMPreProcessPoseCache::GetBoneTransform(OutJointTransform, Sequence, JointId, Time);
 		int32 CurrentJointId = JointId;
 
 		while (RefSkeleton.GetRawParentIndex(CurrentJointId) != 0)
@@ -1023,7 +1132,7 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform& OutJointTran
 			const int32 ParentJointId = RefSkeleton.GetRawParentIndex(CurrentJointId);
 
 			FTransform ParentTransform;
-			Sequence->GetBoneTransform(ParentTransform, FSkeletonPoseBoneIndex(ParentJointId), NewTime, true);
+			FMMPreProcessPoseCache::GetBoneTransform(ParentTransform, Sequence, ParentJointId, NewTime);
 
 			OutJointTransform = OutJointTransform * ParentTransform;
 			CurrentJointId = ParentJointId;
@@ -1055,7 +1164,7 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform& OutTransform
 			return;
 		}
 
-		AnimSequence->GetBoneTransform(BoneTransform, FSkeletonPoseBoneIndex(ConvertedBoneIndex), Time, true);
+		FMMPreProcessPoseCache::GetBoneTransform(BoneTransform, AnimSequence, ConvertedBoneIndex, Time);
 
 		OutTransform = OutTransform * BoneTransform;
 	}
@@ -1095,7 +1204,7 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform& OutJointTran
 				return;
 			}
 
-			Sample.Animation->GetBoneTransform(BoneTransform, FSkeletonPoseBoneIndex(ConvertedBoneIndex), Time, true);
+			FMMPreProcessPoseCache::GetBoneTransform(BoneTransform, Sample.Animation, ConvertedBoneIndex, Time);
 
 			AnimJointTransform = AnimJointTransform * BoneTransform;
 		}
@@ -1157,7 +1266,7 @@ void FMMPreProcessUtils::GetJointTransform_RootRelative(FTransform& OutTransform
 			return;
 		}
 
-		Sequence->GetBoneTransform(BoneTransform, FSkeletonPoseBoneIndex(ConvertedBoneIndex), NewTime, true);
+		FMMPreProcessPoseCache::GetBoneTransform(BoneTransform, Sequence, ConvertedBoneIndex, NewTime);
 
 		OutTransform = OutTransform * BoneTransform;
 	}
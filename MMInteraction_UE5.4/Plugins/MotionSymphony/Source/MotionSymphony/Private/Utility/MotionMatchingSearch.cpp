@@ -0,0 +1,1661 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Utility/MotionMatchingSearch.h"
+#include "Objects/Assets/MotionDataAsset.h"
+#include "Objects/Assets/MotionMatchConfig.h"
+#include "Objects/MatchFeatures/MatchFeatureBase.h"
+#include "Math/VectorRegister.h"
+
+//Note: The vectorized kernels deliberately use separate multiply and add instructions (rather than VectorMultiplyAdd)
+//so that FMA contraction cannot change the rounding compared to the scalar reference implementation.
+
+FPoseFeatureSegment::FPoseFeatureSegment()
+	: Offset(0),
+	Size(0)
+{
+}
+
+FPoseFeatureSegment::FPoseFeatureSegment(int32 InOffset, int32 InSize)
+	: Offset(InOffset),
+	Size(InSize)
+{
+}
+
+FPoseRefinementFeature::FPoseRefinementFeature()
+	: Feature(nullptr),
+	Weight(1.0f)
+{
+}
+
+FPoseRefinementFeature::FPoseRefinementFeature(const UMatchFeatureBase* InFeature, const FPoseFeatureSegment& InSegment,
+	const float InWeight)
+	: Feature(InFeature),
+	Segment(InSegment),
+	Weight(InWeight)
+{
+}
+
+void FPoseSearchStages::Build(const UMotionMatchConfig* InMMConfig, TConstArrayView<FPoseFeatureSegment> FeatureSegments)
+{
+	CoarseSegments.Reset();
+	RefineSegments.Reset();
+	RefinementFeatures.Reset();
+
+	if(!InMMConfig)
+	{
+		return;
+	}
+
+	const TArray<TObjectPtr<UMatchFeatureBase>>& Features = InMMConfig->Features;
+	for(int32 FeatureIndex = 0; FeatureIndex < FeatureSegments.Num() && FeatureIndex < Features.Num(); ++FeatureIndex)
+	{
+		const FPoseFeatureSegment& Segment = FeatureSegments[FeatureIndex];
+		const UMatchFeatureBase* Feature = Features[FeatureIndex];
+		if(!Feature
+			|| Segment.Size <= 0)
+		{
+			continue;
+		}
+
+		if(Feature->GetResolvedSearchStage() == EMatchFeatureSearchStage::Coarse)
+		{
+			CoarseSegments.Add(Segment);
+		}
+		else
+		{
+			RefineSegments.Add(Segment);
+		}
+
+		if(Feature->HasRefinementCost())
+		{
+			RefinementFeatures.Emplace(Feature, Segment, Feature->GetRefinementCostWeight(InMMConfig));
+		}
+	}
+
+	if(CoarseSegments.Num() == 0)
+	{
+		Swap(CoarseSegments, RefineSegments);
+	}
+}
+
+bool FPoseSearchStages::IsValid(const int32 AtomCount) const
+{
+	if(CoarseSegments.Num() == 0)
+	{
+		return false;
+	}
+
+	TBitArray<> CoveredAtoms(false, AtomCount);
+	for(const TArray<FPoseFeatureSegment>* Segments : { &CoarseSegments, &RefineSegments })
+	{
+		for(const FPoseFeatureSegment& Segment : *Segments)
+		{
+			if(Segment.Offset < 1
+				|| Segment.Size <= 0
+				|| Segment.Offset + Segment.Size > AtomCount)
+			{
+				return false;
+			}
+
+			for(int32 AtomIndex = Segment.Offset; AtomIndex < Segment.Offset + Segment.Size; ++AtomIndex)
+			{
+				if(CoveredAtoms[AtomIndex])
+				{
+					return false;
+				}
+
+				CoveredAtoms[AtomIndex] = true;
+			}
+		}
+	}
+
+	for(const FPoseRefinementFeature& RefinementFeature : RefinementFeatures)
+	{
+		if(!RefinementFeature.Feature
+			|| RefinementFeature.Segment.Offset < 1
+			|| RefinementFeature.Segment.Offset + RefinementFeature.Segment.Size > AtomCount)
+		{
+			return false;
+		}
+	}
+
+	return CoveredAtoms.CountSetBits() == AtomCount - 1;
+}
+
+FPoseSearchCandidate::FPoseSearchCandidate()
+	: PoseId(INDEX_NONE),
+	Cost(UE_MAX_FLT),
+	PoseFavour(1.0f)
+{
+}
+
+FPoseSearchCandidate::FPoseSearchCandidate(int32 InPoseId, float InCost, float InPoseFavour)
+	: PoseId(InPoseId),
+	Cost(InCost),
+	PoseFavour(InPoseFavour)
+{
+}
+
+FPoseSearchQuery::FPoseSearchQuery()
+	: QueryPoseArray(nullptr),
+	CalibrationArray(nullptr),
+	StartPoseIndex(0),
+	EndPoseIndex(0)
+{
+}
+
+FPoseSearchQuery::FPoseSearchQuery(const float* InQueryPoseArray, const float* InCalibrationArray,
+	int32 InStartPoseIndex, int32 InEndPoseIndex)
+	: QueryPoseArray(InQueryPoseArray),
+	CalibrationArray(InCalibrationArray),
+	StartPoseIndex(InStartPoseIndex),
+	EndPoseIndex(InEndPoseIndex)
+{
+}
+
+FPoseSearchTopK::FPoseSearchTopK()
+	: Capacity(0)
+{
+}
+
+FPoseSearchTopK::FPoseSearchTopK(int32 InCapacity)
+	: Capacity(FMath::Clamp(InCapacity, 0, MaxPoseSearchTopK))
+{
+}
+
+void FPoseSearchTopK::Add(int32 InPoseId, float InCost, float InPoseFavour)
+{
+	auto CostGreater = [](const FPoseSearchCandidate& A, const FPoseSearchCandidate& B) { return A.Cost > B.Cost; };
+
+	if(!IsFull())
+	{
+		Heap.HeapPush(FPoseSearchCandidate(InPoseId, InCost, InPoseFavour), CostGreater);
+	}
+	else if(InCost < Heap.HeapTop().Cost)
+	{
+		Heap.HeapPopDiscard(CostGreater, EAllowShrinking::No);
+		Heap.HeapPush(FPoseSearchCandidate(InPoseId, InCost, InPoseFavour), CostGreater);
+	}
+}
+
+void FPoseSearchTopK::Reset()
+{
+	Heap.Reset();
+}
+
+void FPoseSearchTopK::GetSorted(FPoseSearchTopKArray& OutCandidates) const
+{
+	OutCandidates = Heap;
+	OutCandidates.Sort([](const FPoseSearchCandidate& A, const FPoseSearchCandidate& B) { return A.Cost < B.Cost; });
+}
+
+FPoseSearchResult::FPoseSearchResult()
+	: PoseId(INDEX_NONE),
+	Cost(UE_MAX_FLT),
+	PruneCost(UE_MAX_FLT),
+	PosesChecked(0),
+	OuterAABBsChecked(0),
+	OuterAABBsPassed(0),
+	InnerAABBsChecked(0),
+	InnerAABBsPassed(0),
+	TreeNodesChecked(0),
+	TreeNodesPassed(0),
+	CoarsePosesChecked(0),
+	bTopKPrunes(true)
+{
+	FMemory::Memzero(LevelBoxesChecked);
+	FMemory::Memzero(LevelBoxesPassed);
+}
+
+FPoseSearchResult::FPoseSearchResult(float InCostToBeat, int32 InTopKCapacity, bool bInTopKPrunes)
+	: PoseId(INDEX_NONE),
+	Cost(InCostToBeat),
+	PruneCost(InTopKCapacity > 0 && bInTopKPrunes ? UE_MAX_FLT : InCostToBeat),
+	PosesChecked(0),
+	OuterAABBsChecked(0),
+	OuterAABBsPassed(0),
+	InnerAABBsChecked(0),
+	InnerAABBsPassed(0),
+	TreeNodesChecked(0),
+	TreeNodesPassed(0),
+	CoarsePosesChecked(0),
+	TopK(InTopKCapacity),
+	bTopKPrunes(bInTopKPrunes)
+{
+	FMemory::Memzero(LevelBoxesChecked);
+	FMemory::Memzero(LevelBoxesPassed);
+}
+
+FPoseSearchQualitySettings::FPoseSearchQualitySettings()
+	: Quality(EMotionMatchingSearchQuality::Performance),
+	TreeEpsilon(0.0f),
+	CompressedRerankCount(32),
+	Stages(nullptr),
+	StagedCandidateCount(32),
+	DeltaTime(0.0f)
+{
+}
+
+void FMotionMatchingSearch::BuildFeatureSegments(const UMotionMatchConfig* InMMConfig, TArray<FPoseFeatureSegment>& OutSegments)
+{
+	OutSegments.Reset();
+
+	if(!InMMConfig)
+	{
+		return;
+	}
+
+	int32 FeatureOffset = 1; //Start at offset 1 to skip the pose favour atom
+	for(const TObjectPtr<UMatchFeatureBase> Feature : InMMConfig->Features)
+	{
+		const int32 FeatureSize = Feature ? Feature->Size() : 0;
+		OutSegments.Emplace(FeatureOffset, FeatureSize);
+		FeatureOffset += FeatureSize;
+	}
+}
+
+bool FMotionMatchingSearch::AreFeatureSegmentsValid(TConstArrayView<FPoseFeatureSegment> Segments, const int32 AtomCount)
+{
+	int32 ExpectedOffset = 1; //The first feature starts after the pose favour atom
+	for(const FPoseFeatureSegment& Segment : Segments)
+	{
+		if(Segment.Offset != ExpectedOffset
+			|| Segment.Size < 0)
+		{
+			return false;
+		}
+
+		ExpectedOffset += Segment.Size;
+	}
+
+	return ExpectedOffset == AtomCount;
+}
+
+float FMotionMatchingSearch::ComputeWeightedL1(const float* A, const float* B, const float* Weights, const int32 Count)
+{
+#if PLATFORM_ENABLE_VECTORINTRINSICS || PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	VectorRegister4Float Acc0 = VectorZeroFloat();
+	VectorRegister4Float Acc1 = VectorZeroFloat();
+
+	int32 Index = 0;
+	for(; Index + 8 <= Count; Index += 8)
+	{
+		const VectorRegister4Float Diff0 = VectorAbs(VectorSubtract(VectorLoad(A + Index), VectorLoad(B + Index)));
+		const VectorRegister4Float Diff1 = VectorAbs(VectorSubtract(VectorLoad(A + Index + 4), VectorLoad(B + Index + 4)));
+
+		Acc0 = VectorAdd(Acc0, VectorMultiply(Diff0, VectorLoad(Weights + Index)));
+		Acc1 = VectorAdd(Acc1, VectorMultiply(Diff1, VectorLoad(Weights + Index + 4)));
+	}
+
+	if(Index + 4 <= Count)
+	{
+		const VectorRegister4Float Diff0 = VectorAbs(VectorSubtract(VectorLoad(A + Index), VectorLoad(B + Index)));
+		Acc0 = VectorAdd(Acc0, VectorMultiply(Diff0, VectorLoad(Weights + Index)));
+		Index += 4;
+	}
+
+	float Tail = 0.0f;
+	for(; Index < Count; ++Index)
+	{
+		const float WeightedDiff = FMath::Abs(A[Index] - B[Index]) * Weights[Index];
+		Tail += WeightedDiff;
+	}
+
+	alignas(16) float Lanes[4];
+	VectorStoreAligned(VectorAdd(Acc0, Acc1), Lanes);
+
+	return ((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) + Tail;
+#else
+	return ComputeWeightedL1_Scalar(A, B, Weights, Count);
+#endif
+}
+
+float FMotionMatchingSearch::ComputeWeightedL1_Scalar(const float* A, const float* B, const float* Weights, const int32 Count)
+{
+	float Acc0[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float Acc1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	int32 Index = 0;
+	for(; Index + 8 <= Count; Index += 8)
+	{
+		for(int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const float WeightedDiff0 = FMath::Abs(A[Index + Lane] - B[Index + Lane]) * Weights[Index + Lane];
+			const float WeightedDiff1 = FMath::Abs(A[Index + Lane + 4] - B[Index + Lane + 4]) * Weights[Index + Lane + 4];
+			Acc0[Lane] += WeightedDiff0;
+			Acc1[Lane] += WeightedDiff1;
+		}
+	}
+
+	if(Index + 4 <= Count)
+	{
+		for(int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const float WeightedDiff = FMath::Abs(A[Index + Lane] - B[Index + Lane]) * Weights[Index + Lane];
+			Acc0[Lane] += WeightedDiff;
+		}
+		Index += 4;
+	}
+
+	float Tail = 0.0f;
+	for(; Index < Count; ++Index)
+	{
+		const float WeightedDiff = FMath::Abs(A[Index] - B[Index]) * Weights[Index];
+		Tail += WeightedDiff;
+	}
+
+	float Lanes[4];
+	for(int32 Lane = 0; Lane < 4; ++Lane)
+	{
+		Lanes[Lane] = Acc0[Lane] + Acc1[Lane];
+	}
+
+	return ((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) + Tail;
+}
+
+float FMotionMatchingSearch::ComputeWeightedL1Bounded(const float* A, const float* B, const float* Weights, const int32 Count,
+	const float BaseCost, const float Scale, const float CostToBeat)
+{
+	//The accumulation order must match ComputeWeightedL1 exactly. Bound checks only read the accumulators.
+#if PLATFORM_ENABLE_VECTORINTRINSICS || PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	VectorRegister4Float Acc0 = VectorZeroFloat();
+	VectorRegister4Float Acc1 = VectorZeroFloat();
+	alignas(16) float Lanes[4];
+
+	int32 Index = 0;
+	for(; Index + 8 <= Count; Index += 8)
+	{
+		const VectorRegister4Float Diff0 = VectorAbs(VectorSubtract(VectorLoad(A + Index), VectorLoad(B + Index)));
+		const VectorRegister4Float Diff1 = VectorAbs(VectorSubtract(VectorLoad(A + Index + 4), VectorLoad(B + Index + 4)));
+
+		Acc0 = VectorAdd(Acc0, VectorMultiply(Diff0, VectorLoad(Weights + Index)));
+		Acc1 = VectorAdd(Acc1, VectorMultiply(Diff1, VectorLoad(Weights + Index + 4)));
+
+		if((Index + 8) % BoundCheckInterval == 0
+			&& Index + 8 < Count)
+		{
+			VectorStoreAligned(VectorAdd(Acc0, Acc1), Lanes);
+			const float PartialCost = BaseCost + ((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]));
+
+			if(PartialCost * Scale >= CostToBeat)
+			{
+				return PartialCost;
+			}
+		}
+	}
+
+	if(Index + 4 <= Count)
+	{
+		const VectorRegister4Float Diff0 = VectorAbs(VectorSubtract(VectorLoad(A + Index), VectorLoad(B + Index)));
+		Acc0 = VectorAdd(Acc0, VectorMultiply(Diff0, VectorLoad(Weights + Index)));
+		Index += 4;
+	}
+
+	float Tail = 0.0f;
+	for(; Index < Count; ++Index)
+	{
+		const float WeightedDiff = FMath::Abs(A[Index] - B[Index]) * Weights[Index];
+		Tail += WeightedDiff;
+	}
+
+	VectorStoreAligned(VectorAdd(Acc0, Acc1), Lanes);
+
+	return BaseCost + (((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) + Tail);
+#else
+	float Acc0[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float Acc1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	int32 Index = 0;
+	for(; Index + 8 <= Count; Index += 8)
+	{
+		for(int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const float WeightedDiff0 = FMath::Abs(A[Index + Lane] - B[Index + Lane]) * Weights[Index + Lane];
+			const float WeightedDiff1 = FMath::Abs(A[Index + Lane + 4] - B[Index + Lane + 4]) * Weights[Index + Lane + 4];
+			Acc0[Lane] += WeightedDiff0;
+			Acc1[Lane] += WeightedDiff1;
+		}
+
+		if((Index + 8) % BoundCheckInterval == 0
+			&& Index + 8 < Count)
+		{
+			const float PartialCost = BaseCost + (((Acc0[0] + Acc1[0]) + (Acc0[1] + Acc1[1]))
+				+ ((Acc0[2] + Acc1[2]) + (Acc0[3] + Acc1[3])));
+
+			if(PartialCost * Scale >= CostToBeat)
+			{
+				return PartialCost;
+			}
+		}
+	}
+
+	if(Index + 4 <= Count)
+	{
+		for(int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const float WeightedDiff = FMath::Abs(A[Index + Lane] - B[Index + Lane]) * Weights[Index + Lane];
+			Acc0[Lane] += WeightedDiff;
+		}
+		Index += 4;
+	}
+
+	float Tail = 0.0f;
+	for(; Index < Count; ++Index)
+	{
+		const float WeightedDiff = FMath::Abs(A[Index] - B[Index]) * Weights[Index];
+		Tail += WeightedDiff;
+	}
+
+	return BaseCost + ((((Acc0[0] + Acc1[0]) + (Acc0[1] + Acc1[1])) + ((Acc0[2] + Acc1[2]) + (Acc0[3] + Acc1[3]))) + Tail);
+#endif
+}
+
+float FMotionMatchingSearch::ComputePoseCost(const float* PoseRow, const float* QueryPoseArray,
+	const float* CalibrationArray, const int32 AtomCount)
+{
+	//Skip the pose favour atom. Calibration weights do not include the pose favour so they are not offset
+	return ComputeWeightedL1(PoseRow + 1, QueryPoseArray + 1, CalibrationArray, AtomCount - 1);
+}
+
+float FMotionMatchingSearch::ComputePoseCostBounded(const float* PoseRow, const float* QueryPoseArray,
+	const float* CalibrationArray, const int32 AtomCount, const float PoseFavour, const float CostToBeat)
+{
+	return ComputeWeightedL1Bounded(PoseRow + 1, QueryPoseArray + 1, CalibrationArray, AtomCount - 1,
+		0.0f, PoseFavour, CostToBeat) * PoseFavour;
+}
+
+float FMotionMatchingSearch::ComputePoseCostOrdered(const float* PoseRow, const float* QueryPoseArray,
+	const float* CalibrationArray, TConstArrayView<FPoseFeatureSegment> EvaluationOrder, const float PoseFavour,
+	const float CostToBeat)
+{
+	float Cost = 0.0f;
+	for(const FPoseFeatureSegment& Segment : EvaluationOrder)
+	{
+		Cost = ComputeWeightedL1Bounded(PoseRow + Segment.Offset, QueryPoseArray + Segment.Offset,
+			CalibrationArray + Segment.Offset - 1, Segment.Size, Cost, PoseFavour, CostToBeat);
+
+		//Also check between segments since small features never reach a bound check inside the kernel
+		if(Cost * PoseFavour >= CostToBeat)
+		{
+			break;
+		}
+	}
+
+	return Cost * PoseFavour;
+}
+
+float FMotionMatchingSearch::ComputeAABBCost(const float* ExtentsRow, const float* QueryPoseArray, const float* CalibrationArray,
+	const int32 AtomCount)
+{
+	int32 DimIndex = 1;
+	float AABBCost = 0.0f;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS || PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	//Extents are interleaved (min, max) per dimension so de-interleave 4 dimensions at a time
+	VectorRegister4Float Acc = VectorZeroFloat();
+	for(; DimIndex + 4 <= AtomCount; DimIndex += 4)
+	{
+		const VectorRegister4Float Extents0 = VectorLoad(ExtentsRow + DimIndex * 2);
+		const VectorRegister4Float Extents1 = VectorLoad(ExtentsRow + DimIndex * 2 + 4);
+		const VectorRegister4Float Mins = VectorShuffle(Extents0, Extents1, 0, 2, 0, 2);
+		const VectorRegister4Float Maxs = VectorShuffle(Extents0, Extents1, 1, 3, 1, 3);
+
+		const VectorRegister4Float Query = VectorLoad(QueryPoseArray + DimIndex);
+		const VectorRegister4Float ClosestPoint = VectorMin(VectorMax(Query, Mins), Maxs);
+		const VectorRegister4Float Diff = VectorAbs(VectorSubtract(Query, ClosestPoint));
+
+		Acc = VectorAdd(Acc, VectorMultiply(Diff, VectorLoad(CalibrationArray + DimIndex - 1)));
+	}
+
+	alignas(16) float Lanes[4];
+	VectorStoreAligned(Acc, Lanes);
+	AABBCost = (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+#endif
+
+	for(; DimIndex < AtomCount; ++DimIndex)
+	{
+		const int32 ExtentsIndex = DimIndex * 2;
+		const float ClosestPoint = FMath::Clamp(QueryPoseArray[DimIndex], ExtentsRow[ExtentsIndex], ExtentsRow[ExtentsIndex + 1]);
+
+		AABBCost += FMath::Abs(QueryPoseArray[DimIndex] - ClosestPoint) * CalibrationArray[DimIndex - 1];
+	}
+
+	return AABBCost;
+}
+
+void FMotionMatchingSearch::ComputeAABBGroupCost(const float* GroupExtents, const float* QueryPoseArray,
+	const float* CalibrationArray, const int32 AtomCount, float* OutCosts)
+{
+	static_assert(FPoseAABBHierarchy::BranchFactor == 4, "AABB groups are tested as a single vector register");
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS || PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	//Every atom of a group holds the minimums of the 4 boxes followed by their maximums so the 4 boxes are clamped at once
+	VectorRegister4Float Acc = VectorZeroFloat();
+	for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+	{
+		const float* AtomExtents = GroupExtents + AtomIndex * 8;
+		const VectorRegister4Float Query = VectorSetFloat1(QueryPoseArray[AtomIndex]);
+		const VectorRegister4Float ClosestPoint = VectorMin(VectorMax(Query, VectorLoad(AtomExtents)), VectorLoad(AtomExtents + 4));
+		const VectorRegister4Float Diff = VectorAbs(VectorSubtract(Query, ClosestPoint));
+
+		Acc = VectorAdd(Acc, VectorMultiply(Diff, VectorSetFloat1(CalibrationArray[AtomIndex - 1])));
+	}
+
+	VectorStore(Acc, OutCosts);
+#else
+	for(int32 Lane = 0; Lane < 4; ++Lane)
+	{
+		OutCosts[Lane] = 0.0f;
+	}
+
+	for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+	{
+		const float* AtomExtents = GroupExtents + AtomIndex * 8;
+		for(int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			const float ClosestPoint = FMath::Clamp(QueryPoseArray[AtomIndex], AtomExtents[Lane], AtomExtents[Lane + 4]);
+			OutCosts[Lane] += FMath::Abs(QueryPoseArray[AtomIndex] - ClosestPoint) * CalibrationArray[AtomIndex - 1];
+		}
+	}
+#endif
+}
+
+void FMotionMatchingSearch::ComputeFeatureCosts(const float* PoseRow, const float* QueryPoseArray, const float* CalibrationArray,
+	TConstArrayView<FPoseFeatureSegment> Segments, float* OutFeatureCosts)
+{
+	for(int32 SegmentIndex = 0; SegmentIndex < Segments.Num(); ++SegmentIndex)
+	{
+		const FPoseFeatureSegment& Segment = Segments[SegmentIndex];
+
+		OutFeatureCosts[SegmentIndex] = ComputeWeightedL1(PoseRow + Segment.Offset, QueryPoseArray + Segment.Offset,
+			CalibrationArray + Segment.Offset - 1, Segment.Size);
+	}
+}
+
+namespace QuantizedPoseSearch
+{
+	/** Returns a single decoded value of a quantized row */
+	template<typename StorageType>
+	FORCEINLINE float Dequantize(const StorageType* Values, const float* Offsets, const float* Scales, const int32 Index)
+	{
+		const float Scaled = Scales[Index] * TPoseMatrixStorage<StorageType>::Decode(Values[Index]);
+		return Offsets[Index] + Scaled;
+	}
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS || PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+	/** Loads 4 consecutive values of a quantized row and decodes them with the offset and scale of their columns */
+	template<typename StorageType>
+	VectorRegister4Float LoadDequantized4(const StorageType* Values, const float* Offsets, const float* Scales);
+
+	template<>
+	FORCEINLINE VectorRegister4Float LoadDequantized4<uint8>(const uint8* Values, const float* Offsets, const float* Scales)
+	{
+		const VectorRegister4Float Scaled = VectorMultiply(VectorLoad(Scales), VectorLoadByte4(Values));
+		return VectorAdd(VectorLoad(Offsets), Scaled);
+	}
+
+	template<>
+	FORCEINLINE VectorRegister4Float LoadDequantized4<FFloat16>(const FFloat16* Values, const float* Offsets, const float* Scales)
+	{
+		//Uses the hardware half conversion (e.g. F16C or NEON) on platforms which have it. The conversion is exact
+		alignas(16) float Normalized[4];
+		FPlatformMath::VectorLoadHalf(Normalized, reinterpret_cast<const uint16*>(Values));
+
+		const VectorRegister4Float Scaled = VectorMultiply(VectorLoad(Scales), VectorLoadAligned(Normalized));
+		return VectorAdd(VectorLoad(Offsets), Scaled);
+	}
+#endif
+
+	/** Decodes a single row of a quantized matrix into floats, e.g. for the AABB cost or refinement features */
+	template<typename StorageType>
+	void DecodeRow(const FQuantizedPoseMatrix& Matrix, const int32 Row, float* OutRow)
+	{
+		const int32 ColumnCount = Matrix.ColumnCount;
+		const StorageType* Values = Matrix.GetData<StorageType>() + Row * ColumnCount;
+		const float* Offsets = Matrix.ColumnOffsets.GetData();
+		const float* Scales = Matrix.ColumnScales.GetData();
+
+		int32 Column = 0;
+#if PLATFORM_ENABLE_VECTORINTRINSICS || PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		for(; Column + 4 <= ColumnCount; Column += 4)
+		{
+			VectorStore(LoadDequantized4<StorageType>(Values + Column, Offsets + Column, Scales + Column), OutRow + Column);
+		}
+#endif
+
+		for(; Column < ColumnCount; ++Column)
+		{
+			OutRow[Column] = Dequantize(Values, Offsets, Scales, Column);
+		}
+	}
+
+	/** Dequantizes Count values of a quantized row and sums their weighted distance to B onto BaseCost, abandoning the
+	 * evaluation once the cost scaled by Scale reaches CostToBeat. The values are decoded in registers as they are
+	 * accumulated and the accumulation order matches FMotionMatchingSearch::ComputeWeightedL1Bounded exactly, so the cost
+	 * is the same as that of the decoded row */
+	template<typename StorageType>
+	float ComputeWeightedL1Bounded(const StorageType* Values, const float* Offsets, const float* Scales, const float* B,
+		const float* Weights, const int32 Count, const float BaseCost, const float Scale, const float CostToBeat)
+	{
+		constexpr int32 BoundCheckInterval = FMotionMatchingSearch::BoundCheckInterval;
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS || PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+		VectorRegister4Float Acc0 = VectorZeroFloat();
+		VectorRegister4Float Acc1 = VectorZeroFloat();
+		alignas(16) float Lanes[4];
+
+		int32 Index = 0;
+		for(; Index + 8 <= Count; Index += 8)
+		{
+			const VectorRegister4Float A0 = LoadDequantized4<StorageType>(Values + Index, Offsets + Index, Scales + Index);
+			const VectorRegister4Float A1 = LoadDequantized4<StorageType>(Values + Index + 4, Offsets + Index + 4, Scales + Index + 4);
+			const VectorRegister4Float Diff0 = VectorAbs(VectorSubtract(A0, VectorLoad(B + Index)));
+			const VectorRegister4Float Diff1 = VectorAbs(VectorSubtract(A1, VectorLoad(B + Index + 4)));
+
+			Acc0 = VectorAdd(Acc0, VectorMultiply(Diff0, VectorLoad(Weights + Index)));
+			Acc1 = VectorAdd(Acc1, VectorMultiply(Diff1, VectorLoad(Weights + Index + 4)));
+
+			if((Index + 8) % BoundCheckInterval == 0
+				&& Index + 8 < Count)
+			{
+				VectorStoreAligned(VectorAdd(Acc0, Acc1), Lanes);
+				const float PartialCost = BaseCost + ((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]));
+
+				if(PartialCost * Scale >= CostToBeat)
+				{
+					return PartialCost;
+				}
+			}
+		}
+
+		if(Index + 4 <= Count)
+		{
+			const VectorRegister4Float A0 = LoadDequantized4<StorageType>(Values + Index, Offsets + Index, Scales + Index);
+			const VectorRegister4Float Diff0 = VectorAbs(VectorSubtract(A0, VectorLoad(B + Index)));
+			Acc0 = VectorAdd(Acc0, VectorMultiply(Diff0, VectorLoad(Weights + Index)));
+			Index += 4;
+		}
+
+		float Tail = 0.0f;
+		for(; Index < Count; ++Index)
+		{
+			const float WeightedDiff = FMath::Abs(Dequantize(Values, Offsets, Scales, Index) - B[Index]) * Weights[Index];
+			Tail += WeightedDiff;
+		}
+
+		VectorStoreAligned(VectorAdd(Acc0, Acc1), Lanes);
+
+		return BaseCost + (((Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3])) + Tail);
+#else
+		float Acc0[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float Acc1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		int32 Index = 0;
+		for(; Index + 8 <= Count; Index += 8)
+		{
+			for(int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				const float WeightedDiff0 = FMath::Abs(Dequantize(Values, Offsets, Scales, Index + Lane) - B[Index + Lane]) * Weights[Index + Lane];
+				const float WeightedDiff1 = FMath::Abs(Dequantize(Values, Offsets, Scales, Index + Lane + 4) - B[Index + Lane + 4]) * Weights[Index + Lane + 4];
+				Acc0[Lane] += WeightedDiff0;
+				Acc1[Lane] += WeightedDiff1;
+			}
+
+			if((Index + 8) % BoundCheckInterval == 0
+				&& Index + 8 < Count)
+			{
+				const float PartialCost = BaseCost + (((Acc0[0] + Acc1[0]) + (Acc0[1] + Acc1[1]))
+					+ ((Acc0[2] + Acc1[2]) + (Acc0[3] + Acc1[3])));
+
+				if(PartialCost * Scale >= CostToBeat)
+				{
+					return PartialCost;
+				}
+			}
+		}
+
+		if(Index + 4 <= Count)
+		{
+			for(int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				const float WeightedDiff = FMath::Abs(Dequantize(Values, Offsets, Scales, Index + Lane) - B[Index + Lane]) * Weights[Index + Lane];
+				Acc0[Lane] += WeightedDiff;
+			}
+			Index += 4;
+		}
+
+		float Tail = 0.0f;
+		for(; Index < Count; ++Index)
+		{
+			const float WeightedDiff = FMath::Abs(Dequantize(Values, Offsets, Scales, Index) - B[Index]) * Weights[Index];
+			Tail += WeightedDiff;
+		}
+
+		return BaseCost + ((((Acc0[0] + Acc1[0]) + (Acc0[1] + Acc1[1])) + ((Acc0[2] + Acc1[2]) + (Acc0[3] + Acc1[3]))) + Tail);
+#endif
+	}
+
+	/** Returns true if the search should use the quantized copies of the search data instead of the full precision data */
+	bool ShouldSearchQuantized(const UMotionDataAsset* InMotionData)
+	{
+		return InMotionData->SearchMatrixPrecision != EPoseMatrixPrecision::Float
+			&& InMotionData->IsQuantizedSearchDataValid();
+	}
+}
+
+namespace PoseSearchRows
+{
+	/** Reads the pose rows and outer / inner AABB extents of the full precision search data */
+	class FFullPrecisionRows
+	{
+	public:
+		explicit FFullPrecisionRows(const UMotionDataAsset* InMotionData)
+			: AtomCount(InMotionData->SearchPoseMatrix.AtomCount),
+			PoseArray(InMotionData->GetSearchPoseArray().GetData()),
+			OuterAABBArray(InMotionData->GetOuterAABBExtents().GetData()),
+			InnerAABBArray(InMotionData->GetInnerAABBExtents().GetData())
+		{
+		}
+
+		int32 GetAtomCount() const { return AtomCount; }
+
+		const float* GetRow(const int32 PoseIndex) const { return PoseArray + PoseIndex * AtomCount; }
+
+		float GetPoseFavour(const int32 PoseIndex) const
+		{
+			return PoseArray[PoseIndex * AtomCount]; //Pose cost multiplier is the first atom of a pose array
+		}
+
+		float ComputePoseCost(const int32 PoseIndex, const FPoseSearchQuery& Query, const float PoseFavour, const float CostToBeat) const
+		{
+			const float* PoseRow = GetRow(PoseIndex);
+			return Query.EvaluationOrder.Num() > 0
+				? FMotionMatchingSearch::ComputePoseCostOrdered(PoseRow, Query.QueryPoseArray, Query.CalibrationArray, Query.EvaluationOrder, PoseFavour, CostToBeat)
+				: FMotionMatchingSearch::ComputePoseCostBounded(PoseRow, Query.QueryPoseArray, Query.CalibrationArray, AtomCount, PoseFavour, CostToBeat);
+		}
+
+		/** Sums the weighted distance of the segments onto BaseCost but gives up once the favoured cost reaches CostToBeat */
+		float ComputeSegmentsCost(const int32 PoseIndex, TConstArrayView<FPoseFeatureSegment> Segments, float BaseCost,
+			const FPoseSearchQuery& Query, const float PoseFavour, const float CostToBeat) const
+		{
+			const float* PoseRow = GetRow(PoseIndex);
+			for(const FPoseFeatureSegment& Segment : Segments)
+			{
+				BaseCost = FMotionMatchingSearch::ComputeWeightedL1Bounded(PoseRow + Segment.Offset, Query.QueryPoseArray + Segment.Offset,
+					Query.CalibrationArray + Segment.Offset - 1, Segment.Size, BaseCost, PoseFavour, CostToBeat);
+
+				if(BaseCost * PoseFavour >= CostToBeat)
+				{
+					break;
+				}
+			}
+
+			return BaseCost;
+		}
+
+		float ComputeOuterAABBCost(const int32 AABBIndex, const FPoseSearchQuery& Query) const
+		{
+			return FMotionMatchingSearch::ComputeAABBCost(OuterAABBArray + AABBIndex * AtomCount * 2, Query.QueryPoseArray,
+				Query.CalibrationArray, AtomCount);
+		}
+
+		float ComputeInnerAABBCost(const int32 AABBIndex, const FPoseSearchQuery& Query) const
+		{
+			return FMotionMatchingSearch::ComputeAABBCost(InnerAABBArray + AABBIndex * AtomCount * 2, Query.QueryPoseArray,
+				Query.CalibrationArray, AtomCount);
+		}
+
+	private:
+		int32 AtomCount;
+		const float* PoseArray;
+		const float* OuterAABBArray;
+		const float* InnerAABBArray;
+	};
+
+	/** Reads the pose rows and outer / inner AABB extents of the quantized search data. Pose costs are dequantized as they
+	 * are accumulated. Rows that are needed as floats (e.g. AABB extents) are decoded into a buffer which is only valid
+	 * until the next call */
+	template<typename StorageType>
+	class TQuantizedRows
+	{
+	public:
+		explicit TQuantizedRows(const UMotionDataAsset* InMotionData)
+			: PoseMatrix(InMotionData->QuantizedSearchPoseMatrix),
+			OuterAABBMatrix(InMotionData->QuantizedOuterAABBExtents),
+			InnerAABBMatrix(InMotionData->QuantizedInnerAABBExtents),
+			AtomCount(PoseMatrix.ColumnCount),
+			PoseValues(PoseMatrix.GetData<StorageType>()),
+			PoseOffsets(PoseMatrix.ColumnOffsets.GetData()),
+			PoseScales(PoseMatrix.ColumnScales.GetData())
+		{
+			RowBuffer.SetNumUninitialized(AtomCount * 2);
+		}
+
+		int32 GetAtomCount() const { return AtomCount; }
+
+		const float* GetRow(const int32 PoseIndex)
+		{
+			QuantizedPoseSearch::DecodeRow<StorageType>(PoseMatrix, PoseIndex, RowBuffer.GetData());
+			return RowBuffer.GetData();
+		}
+
+		float GetPoseFavour(const int32 PoseIndex) const
+		{
+			return QuantizedPoseSearch::Dequantize(PoseValues + PoseIndex * AtomCount, PoseOffsets, PoseScales, 0);
+		}
+
+		float ComputePoseCost(const int32 PoseIndex, const FPoseSearchQuery& Query, const float PoseFavour, const float CostToBeat) const
+		{
+			if(Query.EvaluationOrder.Num() > 0)
+			{
+				return ComputeSegmentsCost(PoseIndex, Query.EvaluationOrder, 0.0f, Query, PoseFavour, CostToBeat) * PoseFavour;
+			}
+
+			//Skip the pose favour atom. Calibration weights do not include the pose favour so they are not offset
+			return QuantizedPoseSearch::ComputeWeightedL1Bounded(PoseValues + PoseIndex * AtomCount + 1, PoseOffsets + 1,
+				PoseScales + 1, Query.QueryPoseArray + 1, Query.CalibrationArray, AtomCount - 1, 0.0f, PoseFavour, CostToBeat) * PoseFavour;
+		}
+
+		/** Sums the weighted distance of the segments onto BaseCost but gives up once the favoured cost reaches CostToBeat */
+		float ComputeSegmentsCost(const int32 PoseIndex, TConstArrayView<FPoseFeatureSegment> Segments, float BaseCost,
+			const FPoseSearchQuery& Query, const float PoseFavour, const float CostToBeat) const
+		{
+			const StorageType* PoseRow = PoseValues + PoseIndex * AtomCount;
+			for(const FPoseFeatureSegment& Segment : Segments)
+			{
+				BaseCost = QuantizedPoseSearch::ComputeWeightedL1Bounded(PoseRow + Segment.Offset, PoseOffsets + Segment.Offset,
+					PoseScales + Segment.Offset, Query.QueryPoseArray + Segment.Offset, Query.CalibrationArray + Segment.Offset - 1,
+					Segment.Size, BaseCost, PoseFavour, CostToBeat);
+
+				//Also check between segments since small features never reach a bound check inside the kernel
+				if(BaseCost * PoseFavour >= CostToBeat)
+				{
+					break;
+				}
+			}
+
+			return BaseCost;
+		}
+
+		float ComputeOuterAABBCost(const int32 AABBIndex, const FPoseSearchQuery& Query)
+		{
+			QuantizedPoseSearch::DecodeRow<StorageType>(OuterAABBMatrix, AABBIndex, RowBuffer.GetData());
+			return FMotionMatchingSearch::ComputeAABBCost(RowBuffer.GetData(), Query.QueryPoseArray, Query.CalibrationArray, AtomCount);
+		}
+
+		float ComputeInnerAABBCost(const int32 AABBIndex, const FPoseSearchQuery& Query)
+		{
+			QuantizedPoseSearch::DecodeRow<StorageType>(InnerAABBMatrix, AABBIndex, RowBuffer.GetData());
+			return FMotionMatchingSearch::ComputeAABBCost(RowBuffer.GetData(), Query.QueryPoseArray, Query.CalibrationArray, AtomCount);
+		}
+
+	private:
+		const FQuantizedPoseMatrix& PoseMatrix;
+		const FQuantizedPoseMatrix& OuterAABBMatrix;
+		const FQuantizedPoseMatrix& InnerAABBMatrix;
+		int32 AtomCount;
+		const StorageType* PoseValues;
+		const float* PoseOffsets;
+		const float* PoseScales;
+		TArray<float, TInlineAllocator<512>> RowBuffer;
+	};
+
+	/** Calls InSearch with the rows of the search data that the motion data is searched at, i.e. the quantized data if
+	 * the SearchMatrixPrecision is reduced (in which case cooked data has no full precision rows at all) */
+	template<typename SearchFunctionType>
+	void Visit(const UMotionDataAsset* InMotionData, SearchFunctionType&& InSearch)
+	{
+		if(QuantizedPoseSearch::ShouldSearchQuantized(InMotionData))
+		{
+			if(InMotionData->SearchMatrixPrecision == EPoseMatrixPrecision::Int8)
+			{
+				TQuantizedRows<uint8> Rows(InMotionData);
+				InSearch(Rows);
+			}
+			else
+			{
+				TQuantizedRows<FFloat16> Rows(InMotionData);
+				InSearch(Rows);
+			}
+
+			return;
+		}
+
+		FFullPrecisionRows Rows(InMotionData);
+		InSearch(Rows);
+	}
+
+	/** Evaluates the cost of a pose against the query and records the pose in the result if it beats the prune cost */
+	template<typename RowsType>
+	FORCEINLINE void EvaluatePose(const RowsType& Rows, const int32 PoseIndex, const float PoseFavour, const FPoseSearchQuery& Query,
+		FPoseSearchResult& InOutResult)
+	{
+		++InOutResult.PosesChecked;
+
+		const float Cost = Rows.ComputePoseCost(PoseIndex, Query, PoseFavour, InOutResult.PruneCost);
+		InOutResult.TryAddPose(PoseIndex, Cost, PoseFavour);
+	}
+
+	template<typename RowsType>
+	FORCEINLINE void EvaluatePose(const RowsType& Rows, const int32 PoseIndex, const FPoseSearchQuery& Query,
+		FPoseSearchResult& InOutResult)
+	{
+		EvaluatePose(Rows, PoseIndex, Rows.GetPoseFavour(PoseIndex), Query, InOutResult);
+	}
+}
+
+void FMotionMatchingSearch::SearchAABB(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	FPoseSearchResult& InOutResult)
+{
+	if(!InMotionData)
+	{
+		return;
+	}
+
+	if(!QuantizedPoseSearch::ShouldSearchQuantized(InMotionData))
+	{
+		if(InMotionData->SearchMatrixLayout == ESearchMatrixLayout::FeatureMajor
+			&& InMotionData->IsFeatureMajorSearchMatrixValid())
+		{
+			SearchFeatureMajor(InMotionData, Query, true, InOutResult);
+			return;
+		}
+
+		if(InMotionData->bGenerateAABBHierarchy
+			&& InMotionData->IsAABBHierarchyValid())
+		{
+			SearchAABBHierarchy(InMotionData->AABBHierarchy, InMotionData->GetSearchPoseArray().GetData(), Query, InOutResult);
+			return;
+		}
+	}
+
+	PoseSearchRows::Visit(InMotionData, [&](auto& Rows)
+	{
+		const int32 OuterAABBStartIndex = FMath::FloorToInt32(Query.StartPoseIndex / 64.0f);
+		const int32 OuterAABBEndIndex = FMath::CeilToInt32(Query.EndPoseIndex / 64.0f);
+		const int32 InnerAABBLimit = FMath::CeilToInt32(Query.EndPoseIndex / 16.0f);
+		for(int32 OuterAABBIndex = OuterAABBStartIndex; OuterAABBIndex < OuterAABBEndIndex; ++OuterAABBIndex)
+		{
+			++InOutResult.OuterAABBsChecked;
+
+			if(Rows.ComputeOuterAABBCost(OuterAABBIndex, Query) >= InOutResult.PruneCost)
+			{
+				continue;
+			}
+
+			++InOutResult.OuterAABBsPassed;
+
+			//We need to search the inner AABBs
+			const int32 InnerAABBStartIndex = OuterAABBIndex * 4;
+			const int32 InnerAABBEndIndex = FMath::Min(InnerAABBStartIndex + 4, InnerAABBLimit);
+			for(int32 InnerAABBIndex = InnerAABBStartIndex; InnerAABBIndex < InnerAABBEndIndex; ++InnerAABBIndex)
+			{
+				++InOutResult.InnerAABBsChecked;
+
+				if(Rows.ComputeInnerAABBCost(InnerAABBIndex, Query) >= InOutResult.PruneCost)
+				{
+					continue;
+				}
+
+				++InOutResult.InnerAABBsPassed;
+
+				const int32 StartPoseIndex = FMath::Max(InnerAABBIndex * 16, Query.StartPoseIndex);
+				const int32 EndPoseIndex = FMath::Min((InnerAABBIndex * 16) + 16, Query.EndPoseIndex);
+				for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
+				{
+					PoseSearchRows::EvaluatePose(Rows, PoseIndex, Query, InOutResult);
+				}
+			}
+		}
+	});
+}
+
+void FMotionMatchingSearch::SearchAABBBatch(const UMotionDataAsset* InMotionData, TConstArrayView<FPoseSearchQuery> Queries,
+	TArrayView<FPoseSearchResult> InOutResults)
+{
+	if(!InMotionData
+		|| Queries.Num() == 0
+		|| Queries.Num() != InOutResults.Num())
+	{
+		return;
+	}
+
+	int32 BatchStartPoseIndex = MAX_int32;
+	int32 BatchEndPoseIndex = 0;
+	for(const FPoseSearchQuery& Query : Queries)
+	{
+		BatchStartPoseIndex = FMath::Min(BatchStartPoseIndex, Query.StartPoseIndex);
+		BatchEndPoseIndex = FMath::Max(BatchEndPoseIndex, Query.EndPoseIndex);
+	}
+
+	PoseSearchRows::Visit(InMotionData, [&](auto& Rows)
+	{
+		//The queries which passed the current outer and inner AABB
+		TArray<int32, TInlineAllocator<64>> OuterQueries;
+		TArray<int32, TInlineAllocator<64>> InnerQueries;
+
+		const int32 OuterAABBStartIndex = FMath::FloorToInt32(BatchStartPoseIndex / 64.0f);
+		const int32 OuterAABBEndIndex = FMath::CeilToInt32(BatchEndPoseIndex / 64.0f);
+		for(int32 OuterAABBIndex = OuterAABBStartIndex; OuterAABBIndex < OuterAABBEndIndex; ++OuterAABBIndex)
+		{
+			const int32 OuterStartPoseIndex = OuterAABBIndex * 64;
+
+			OuterQueries.Reset();
+			for(int32 QueryIndex = 0; QueryIndex < Queries.Num(); ++QueryIndex)
+			{
+				const FPoseSearchQuery& Query = Queries[QueryIndex];
+				if(OuterStartPoseIndex + 64 <= Query.StartPoseIndex
+					|| OuterStartPoseIndex >= Query.EndPoseIndex)
+				{
+					continue;
+				}
+
+				FPoseSearchResult& Result = InOutResults[QueryIndex];
+				++Result.OuterAABBsChecked;
+
+				if(Rows.ComputeOuterAABBCost(OuterAABBIndex, Query) < Result.PruneCost)
+				{
+					++Result.OuterAABBsPassed;
+					OuterQueries.Add(QueryIndex);
+				}
+			}
+
+			if(OuterQueries.Num() == 0)
+			{
+				continue;
+			}
+
+			const int32 InnerAABBStartIndex = OuterAABBIndex * 4;
+			for(int32 InnerAABBIndex = InnerAABBStartIndex; InnerAABBIndex < InnerAABBStartIndex + 4; ++InnerAABBIndex)
+			{
+				const int32 InnerStartPoseIndex = InnerAABBIndex * 16;
+
+				InnerQueries.Reset();
+				for(const int32 QueryIndex : OuterQueries)
+				{
+					const FPoseSearchQuery& Query = Queries[QueryIndex];
+					if(InnerAABBIndex >= FMath::CeilToInt32(Query.EndPoseIndex / 16.0f))
+					{
+						continue;
+					}
+
+					FPoseSearchResult& Result = InOutResults[QueryIndex];
+					++Result.InnerAABBsChecked;
+
+					if(Rows.ComputeInnerAABBCost(InnerAABBIndex, Query) < Result.PruneCost)
+					{
+						++Result.InnerAABBsPassed;
+						InnerQueries.Add(QueryIndex);
+					}
+				}
+
+				//Evaluate each pose row for all queries before moving on to the next row
+				for(int32 PoseIndex = InnerStartPoseIndex; PoseIndex < InnerStartPoseIndex + 16 && InnerQueries.Num() > 0; ++PoseIndex)
+				{
+					const float PoseFavour = Rows.GetPoseFavour(PoseIndex);
+
+					for(const int32 QueryIndex : InnerQueries)
+					{
+						const FPoseSearchQuery& Query = Queries[QueryIndex];
+						if(PoseIndex < Query.StartPoseIndex
+							|| PoseIndex >= Query.EndPoseIndex)
+						{
+							continue;
+						}
+
+						PoseSearchRows::EvaluatePose(Rows, PoseIndex, PoseFavour, Query, InOutResults[QueryIndex]);
+					}
+				}
+			}
+		}
+	});
+}
+
+namespace PoseAABBHierarchySearch
+{
+	void SearchGroup(const FPoseAABBHierarchy& Hierarchy, const FPoseAABBHierarchySection& Section, const float* PoseArray,
+		const FPoseSearchQuery& Query, const int32 Level, const int32 GroupIndex, FPoseSearchResult& InOutResult)
+	{
+		constexpr int32 BranchFactor = FPoseAABBHierarchy::BranchFactor;
+		const int32 AtomCount = Hierarchy.AtomCount;
+		const int32 FirstBoxIndex = GroupIndex * BranchFactor;
+		const int32 BoxCount = FMath::Min(BranchFactor, Section.LevelBoxCounts[Level] - FirstBoxIndex);
+		const int32 BoxSize = Section.GetBoxSize(Level);
+		const bool bLeafLevel = Level == Section.GetLevelCount() - 1;
+
+		alignas(16) float BoxCosts[BranchFactor];
+		FMotionMatchingSearch::ComputeAABBGroupCost(Hierarchy.GetGroupExtents(Section.LevelGroupOffsets[Level] + GroupIndex),
+			Query.QueryPoseArray, Query.CalibrationArray, AtomCount, BoxCosts);
+
+		InOutResult.LevelBoxesChecked[Level] += BoxCount;
+
+		//Visit the boxes in order of increasing cost so that low costs are found early and more boxes are pruned
+		int32 BoxOrder[BranchFactor];
+		for(int32 i = 0; i < BoxCount; ++i)
+		{
+			int32 j = i;
+			for(; j > 0 && BoxCosts[BoxOrder[j - 1]] > BoxCosts[i]; --j)
+			{
+				BoxOrder[j] = BoxOrder[j - 1];
+			}
+
+			BoxOrder[j] = i;
+		}
+
+		for(int32 i = 0; i < BoxCount; ++i)
+		{
+			const int32 Lane = BoxOrder[i];
+			if(BoxCosts[Lane] >= InOutResult.PruneCost)
+			{
+				break; //All remaining boxes have a higher cost
+			}
+
+			const int32 BoxIndex = FirstBoxIndex + Lane;
+			const int32 BoxStartIndex = Section.StartIndex + BoxIndex * BoxSize;
+			const int32 StartPoseIndex = FMath::Max(BoxStartIndex, Query.StartPoseIndex);
+			const int32 EndPoseIndex = FMath::Min3(BoxStartIndex + BoxSize, Section.EndIndex, Query.EndPoseIndex);
+			if(StartPoseIndex >= EndPoseIndex)
+			{
+				continue;
+			}
+
+			++InOutResult.LevelBoxesPassed[Level];
+
+			if(!bLeafLevel)
+			{
+				SearchGroup(Hierarchy, Section, PoseArray, Query, Level + 1, BoxIndex, InOutResult);
+				continue;
+			}
+
+			for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
+			{
+				++InOutResult.PosesChecked;
+
+				const float* PoseRow = PoseArray + PoseIndex * AtomCount;
+				const float PoseFavour = PoseRow[0]; //Pose cost multiplier is the first atom of a pose array
+				const float Cost = Query.EvaluationOrder.Num() > 0
+					? FMotionMatchingSearch::ComputePoseCostOrdered(PoseRow, Query.QueryPoseArray, Query.CalibrationArray, Query.EvaluationOrder, PoseFavour, InOutResult.PruneCost)
+					: FMotionMatchingSearch::ComputePoseCostBounded(PoseRow, Query.QueryPoseArray, Query.CalibrationArray, AtomCount, PoseFavour, InOutResult.PruneCost);
+
+				InOutResult.TryAddPose(PoseIndex, Cost, PoseFavour);
+			}
+		}
+	}
+}
+
+void FMotionMatchingSearch::SearchAABBHierarchy(const FPoseAABBHierarchy& Hierarchy, const float* PoseArray,
+	const FPoseSearchQuery& Query, FPoseSearchResult& InOutResult)
+{
+	for(const FPoseAABBHierarchySection& Section : Hierarchy.Sections)
+	{
+		if(Section.GetLevelCount() == 0
+			|| Section.EndIndex <= Query.StartPoseIndex
+			|| Section.StartIndex >= Query.EndPoseIndex)
+		{
+			continue;
+		}
+
+		//The root level has more than one group if the section reached the level limit
+		const int32 RootGroupCount = FMath::DivideAndRoundUp(Section.LevelBoxCounts[0], FPoseAABBHierarchy::BranchFactor);
+		for(int32 GroupIndex = 0; GroupIndex < RootGroupCount; ++GroupIndex)
+		{
+			PoseAABBHierarchySearch::SearchGroup(Hierarchy, Section, PoseArray, Query, 0, GroupIndex, InOutResult);
+		}
+	}
+}
+
+void FMotionMatchingSearch::SearchFeatureMajor(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	const bool bUseAABBs, FPoseSearchResult& InOutResult)
+{
+	if(!InMotionData)
+	{
+		return;
+	}
+
+	const FFeatureMajorPoseMatrix& Matrix = InMotionData->FeatureMajorSearchMatrix;
+	const int32 AtomCount = Matrix.AtomCount;
+	const float* OuterAABBArray = InMotionData->GetOuterAABBExtents().GetData();
+
+	//Use the evaluation order of the query if it covers every block, otherwise the block order
+	TArray<int32, TInlineAllocator<32>> BlockOrder;
+	for(const FPoseFeatureSegment& Segment : Query.EvaluationOrder)
+	{
+		const int32 BlockIndex = Matrix.FindBlock(Segment.Offset, Segment.Size);
+		if(BlockIndex != INDEX_NONE)
+		{
+			BlockOrder.Add(BlockIndex);
+		}
+	}
+
+	if(BlockOrder.Num() != Matrix.Blocks.Num())
+	{
+		BlockOrder.Reset();
+		for(int32 BlockIndex = 0; BlockIndex < Matrix.Blocks.Num(); ++BlockIndex)
+		{
+			BlockOrder.Add(BlockIndex);
+		}
+	}
+
+	//Chunks match the outer AABBs so that a whole chunk can be pruned by its outer AABB
+	constexpr int32 ChunkSize = 64;
+	int32 ChunkPoses[ChunkSize];
+	float ChunkCosts[ChunkSize];
+
+	for(int32 ChunkStartIndex = (Query.StartPoseIndex / ChunkSize) * ChunkSize; ChunkStartIndex < Query.EndPoseIndex; ChunkStartIndex += ChunkSize)
+	{
+		if(bUseAABBs)
+		{
+			++InOutResult.OuterAABBsChecked;
+
+			if(ComputeAABBCost(OuterAABBArray + (ChunkStartIndex / ChunkSize) * AtomCount * 2, Query.QueryPoseArray,
+				Query.CalibrationArray, AtomCount) >= InOutResult.PruneCost)
+			{
+				continue;
+			}
+
+			++InOutResult.OuterAABBsPassed;
+		}
+
+		const int32 StartPoseIndex = FMath::Max(ChunkStartIndex, Query.StartPoseIndex);
+		const int32 EndPoseIndex = FMath::Min(ChunkStartIndex + ChunkSize, Query.EndPoseIndex);
+		int32 AliveCount = EndPoseIndex - StartPoseIndex;
+		for(int32 i = 0; i < AliveCount; ++i)
+		{
+			ChunkPoses[i] = StartPoseIndex + i;
+			ChunkCosts[i] = 0.0f;
+		}
+
+		InOutResult.PosesChecked += AliveCount;
+
+		for(const int32 BlockIndex : BlockOrder)
+		{
+			const FFeatureMajorBlock& Block = Matrix.Blocks[BlockIndex];
+			const float* BlockQuery = Query.QueryPoseArray + Block.AtomOffset;
+			const float* BlockWeights = Query.CalibrationArray + Block.AtomOffset - 1;
+
+			//Costs only increase with each feature so poses which can no longer win are compacted out of the chunk
+			int32 SurvivorCount = 0;
+			for(int32 i = 0; i < AliveCount; ++i)
+			{
+				const int32 PoseIndex = ChunkPoses[i];
+				const float Cost = ChunkCosts[i] + ComputeWeightedL1(Matrix.GetBlockRow(BlockIndex, PoseIndex), BlockQuery,
+					BlockWeights, Block.AtomCount);
+
+				if(Cost * Matrix.PoseFavours[PoseIndex] < InOutResult.PruneCost)
+				{
+					ChunkPoses[SurvivorCount] = PoseIndex;
+					ChunkCosts[SurvivorCount] = Cost;
+					++SurvivorCount;
+				}
+			}
+
+			AliveCount = SurvivorCount;
+			if(AliveCount == 0)
+			{
+				break;
+			}
+		}
+
+		for(int32 i = 0; i < AliveCount; ++i)
+		{
+			const int32 PoseIndex = ChunkPoses[i];
+			const float PoseFavour = Matrix.PoseFavours[PoseIndex];
+			const float Cost = ChunkCosts[i] * PoseFavour;
+			InOutResult.TryAddPose(PoseIndex, Cost, PoseFavour);
+		}
+	}
+}
+
+void FMotionMatchingSearch::SearchTree(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	const int32 SectionIndex, const float Epsilon, FPoseSearchResult& InOutResult)
+{
+	if(!InMotionData)
+	{
+		return;
+	}
+
+	const FPoseSearchTree& Tree = InMotionData->SearchTree;
+	const int32 RootNodeIndex = Tree.GetSectionRootNode(SectionIndex);
+	if(RootNodeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 AtomCount = InMotionData->SearchPoseMatrix.AtomCount;
+	const float* QueryPoseArray = Query.QueryPoseArray;
+	const float* CalibrationArray = Query.CalibrationArray;
+	const float PruneScale = 1.0f + FMath::Max(Epsilon, 0.0f);
+
+	//The lower bound of a node is the AABB cost scaled by the lowest pose favour within the node
+	auto ComputeNodeBound = [&](const int32 NodeIndex)
+	{
+		const float* Extents = Tree.GetNodeExtents(NodeIndex);
+		return ComputeAABBCost(Extents, QueryPoseArray, CalibrationArray, AtomCount) * FMath::Max(Extents[0], 0.0f) * PruneScale;
+	};
+
+	PoseSearchRows::Visit(InMotionData, [&](auto& Rows)
+	{
+		//Nodes are stacked with their lower bound since the best cost may have improved by the time they are popped
+		TArray<TPair<int32, float>, TInlineAllocator<64>> NodeStack;
+		NodeStack.Emplace(RootNodeIndex, ComputeNodeBound(RootNodeIndex));
+		++InOutResult.TreeNodesChecked;
+
+		while(NodeStack.Num() > 0)
+		{
+			const TPair<int32, float> StackEntry = NodeStack.Pop(EAllowShrinking::No);
+			if(StackEntry.Value >= InOutResult.PruneCost)
+			{
+				continue;
+			}
+
+			++InOutResult.TreeNodesPassed;
+
+			const FPoseSearchTreeNode& Node = Tree.Nodes[StackEntry.Key];
+			if(!Node.IsLeaf())
+			{
+				//Push the further child first so that the nearer child is searched first and tightens the cost to beat
+				const float LeftBound = ComputeNodeBound(Node.ChildIndex);
+				const float RightBound = ComputeNodeBound(Node.ChildIndex + 1);
+				InOutResult.TreeNodesChecked += 2;
+
+				if(LeftBound < RightBound)
+				{
+					NodeStack.Emplace(Node.ChildIndex + 1, RightBound);
+					NodeStack.Emplace(Node.ChildIndex, LeftBound);
+				}
+				else
+				{
+					NodeStack.Emplace(Node.ChildIndex, LeftBound);
+					NodeStack.Emplace(Node.ChildIndex + 1, RightBound);
+				}
+
+				continue;
+			}
+
+			for(int32 i = Node.StartIndex; i < Node.StartIndex + Node.PoseCount; ++i)
+			{
+				const int32 PoseIndex = Tree.PoseIndices[i];
+				if(PoseIndex < Query.StartPoseIndex || PoseIndex >= Query.EndPoseIndex)
+				{
+					continue;
+				}
+
+				PoseSearchRows::EvaluatePose(Rows, PoseIndex, Query, InOutResult);
+			}
+		}
+	});
+}
+
+void FMotionMatchingSearch::SearchCandidates(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	TConstArrayView<int32> Candidates, FPoseSearchResult& InOutResult)
+{
+	if(!InMotionData)
+	{
+		return;
+	}
+
+	PoseSearchRows::Visit(InMotionData, [&](auto& Rows)
+	{
+		for(const int32 PoseIndex : Candidates)
+		{
+			if(PoseIndex < Query.StartPoseIndex || PoseIndex >= Query.EndPoseIndex)
+			{
+				continue;
+			}
+
+			PoseSearchRows::EvaluatePose(Rows, PoseIndex, Query, InOutResult);
+		}
+	});
+}
+
+void FMotionMatchingSearch::SearchCompressed(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	const int32 RerankCount, FPoseSearchScratch& Scratch, FPoseSearchResult& InOutResult)
+{
+	if(!InMotionData
+		|| RerankCount <= 0)
+	{
+		return;
+	}
+
+	const FPoseMatrixPQ& SearchMatrixPQ = InMotionData->SearchMatrixPQ;
+	Scratch.DistanceTable.SetNumUninitialized(SearchMatrixPQ.GetSubspaceCount() * SearchMatrixPQ.CentroidCount, EAllowShrinking::No);
+	SearchMatrixPQ.ComputeDistanceTable(Query.QueryPoseArray, Query.CalibrationArray, Scratch.DistanceTable.GetData());
+
+	//Keep the best coarse candidates in a max heap so that the worst of them can be replaced
+	auto CoarseCostGreater = [](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key > B.Key; };
+	TArray<TPair<float, int32>>& Candidates = Scratch.Candidates;
+	Candidates.Reset();
+
+	const float* DistanceTable = Scratch.DistanceTable.GetData();
+	const float* PoseFavours = SearchMatrixPQ.PoseFavours.GetData();
+	for(int32 PoseIndex = Query.StartPoseIndex; PoseIndex < Query.EndPoseIndex; ++PoseIndex)
+	{
+		++InOutResult.CoarsePosesChecked;
+
+		const float CoarseCost = SearchMatrixPQ.ComputeCoarseCost(PoseIndex, DistanceTable) * PoseFavours[PoseIndex];
+		if(Candidates.Num() < RerankCount)
+		{
+			Candidates.HeapPush(TPair<float, int32>(CoarseCost, PoseIndex), CoarseCostGreater);
+		}
+		else if(CoarseCost < Candidates.HeapTop().Key)
+		{
+			Candidates.HeapPopDiscard(CoarseCostGreater, EAllowShrinking::No);
+			Candidates.HeapPush(TPair<float, int32>(CoarseCost, PoseIndex), CoarseCostGreater);
+		}
+	}
+
+	//Re-rank from the lowest coarse cost so that the bounded kernels can give up on the remaining candidates early
+	Candidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+
+	PoseSearchRows::Visit(InMotionData, [&](auto& Rows)
+	{
+		for(const TPair<float, int32>& Candidate : Candidates)
+		{
+			const int32 PoseIndex = Candidate.Value;
+			PoseSearchRows::EvaluatePose(Rows, PoseIndex, Query, InOutResult);
+		}
+	});
+}
+
+void FMotionMatchingSearch::SearchStaged(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	const FPoseSearchStages& Stages, const int32 CandidateCount, const float DeltaTime, FPoseSearchScratch& Scratch,
+	FPoseSearchResult& InOutResult)
+{
+	if(!InMotionData
+		|| CandidateCount <= 0
+		|| Stages.CoarseSegments.Num() == 0)
+	{
+		return;
+	}
+
+	//Keep the best coarse candidates in a max heap so that the worst of them can be replaced. The favoured coarse cost
+	//is a lower bound of the favoured full cost, as is the AABB cost of the boxes, since every term is positive
+	auto CoarseCostGreater = [](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key > B.Key; };
+	TArray<TPair<float, int32>>& Candidates = Scratch.Candidates;
+	Candidates.Reset();
+
+	PoseSearchRows::Visit(InMotionData, [&](auto& Rows)
+	{
+		const int32 OuterAABBStartIndex = FMath::FloorToInt32(Query.StartPoseIndex / 64.0f);
+		const int32 OuterAABBEndIndex = FMath::CeilToInt32(Query.EndPoseIndex / 64.0f);
+		const int32 InnerAABBLimit = FMath::CeilToInt32(Query.EndPoseIndex / 16.0f);
+		for(int32 OuterAABBIndex = OuterAABBStartIndex; OuterAABBIndex < OuterAABBEndIndex; ++OuterAABBIndex)
+		{
+			++InOutResult.OuterAABBsChecked;
+
+			if(Rows.ComputeOuterAABBCost(OuterAABBIndex, Query) >= InOutResult.PruneCost)
+			{
+				continue;
+			}
+
+			++InOutResult.OuterAABBsPassed;
+
+			const int32 InnerAABBStartIndex = OuterAABBIndex * 4;
+			const int32 InnerAABBEndIndex = FMath::Min(InnerAABBStartIndex + 4, InnerAABBLimit);
+			for(int32 InnerAABBIndex = InnerAABBStartIndex; InnerAABBIndex < InnerAABBEndIndex; ++InnerAABBIndex)
+			{
+				++InOutResult.InnerAABBsChecked;
+
+				if(Rows.ComputeInnerAABBCost(InnerAABBIndex, Query) >= InOutResult.PruneCost)
+				{
+					continue;
+				}
+
+				++InOutResult.InnerAABBsPassed;
+
+				const int32 StartPoseIndex = FMath::Max(InnerAABBIndex * 16, Query.StartPoseIndex);
+				const int32 EndPoseIndex = FMath::Min((InnerAABBIndex * 16) + 16, Query.EndPoseIndex);
+				for(int32 PoseIndex = StartPoseIndex; PoseIndex < EndPoseIndex; ++PoseIndex)
+				{
+					++InOutResult.CoarsePosesChecked;
+
+					const bool bCandidatesFull = Candidates.Num() >= CandidateCount;
+					const float CoarseCostToBeat = bCandidatesFull
+						? FMath::Min(InOutResult.PruneCost, Candidates.HeapTop().Key) : InOutResult.PruneCost;
+
+					const float PoseFavour = Rows.GetPoseFavour(PoseIndex);
+					const float CoarseCost = Rows.ComputeSegmentsCost(PoseIndex, Stages.CoarseSegments, 0.0f, Query, PoseFavour,
+						CoarseCostToBeat) * PoseFavour;
+
+					if(CoarseCost >= CoarseCostToBeat)
+					{
+						continue;
+					}
+
+					if(bCandidatesFull)
+					{
+						Candidates.HeapPopDiscard(CoarseCostGreater, EAllowShrinking::No);
+					}
+
+					Candidates.HeapPush(TPair<float, int32>(CoarseCost, PoseIndex), CoarseCostGreater);
+				}
+			}
+		}
+
+		//Refine from the lowest coarse cost so that the remaining candidates can be skipped once they cannot win
+		Candidates.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+
+		for(const TPair<float, int32>& Candidate : Candidates)
+		{
+			if(Candidate.Key >= InOutResult.PruneCost)
+			{
+				break;
+			}
+
+			++InOutResult.PosesChecked;
+
+			const int32 PoseIndex = Candidate.Value;
+			const float PoseFavour = Rows.GetPoseFavour(PoseIndex);
+
+			float Cost = Rows.ComputeSegmentsCost(PoseIndex, Stages.CoarseSegments, 0.0f, Query, PoseFavour, InOutResult.PruneCost);
+			Cost = Rows.ComputeSegmentsCost(PoseIndex, Stages.RefineSegments, Cost, Query, PoseFavour, InOutResult.PruneCost);
+			if(Cost * PoseFavour >= InOutResult.PruneCost)
+			{
+				continue;
+			}
+
+			float RefinementCost = 0.0f;
+			if(Stages.RefinementFeatures.Num() > 0)
+			{
+				const float* PoseRow = Rows.GetRow(PoseIndex);
+				for(const FPoseRefinementFeature& RefinementFeature : Stages.RefinementFeatures)
+				{
+					const int32 Offset = RefinementFeature.Segment.Offset;
+					const float FeatureCost = RefinementFeature.Feature->ComputeRefinementCost(Query.QueryPoseArray + Offset,
+						PoseRow + Offset, Query.CalibrationArray + Offset - 1, DeltaTime);
+					const float WeightedCost = FeatureCost * RefinementFeature.Weight;
+					RefinementCost += WeightedCost;
+				}
+			}
+
+			Cost = (Cost + RefinementCost) * PoseFavour;
+			InOutResult.TryAddPose(PoseIndex, Cost, PoseFavour);
+		}
+	});
+}
+
+void FMotionMatchingSearch::SearchBrute(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+	FPoseSearchResult& InOutResult)
+{
+	if(!InMotionData)
+	{
+		return;
+	}
+
+	if(!QuantizedPoseSearch::ShouldSearchQuantized(InMotionData)
+		&& InMotionData->SearchMatrixLayout == ESearchMatrixLayout::FeatureMajor
+		&& InMotionData->IsFeatureMajorSearchMatrixValid())
+	{
+		SearchFeatureMajor(InMotionData, Query, false, InOutResult);
+		return;
+	}
+
+	PoseSearchRows::Visit(InMotionData, [&](auto& Rows)
+	{
+		for(int32 PoseIndex = Query.StartPoseIndex; PoseIndex < Query.EndPoseIndex; ++PoseIndex)
+		{
+			PoseSearchRows::EvaluatePose(Rows, PoseIndex, Query, InOutResult);
+		}
+	});
+}
+
+EMotionMatchingSearchQuality FMotionMatchingSearch::SearchWithQuality(const UMotionDataAsset* InMotionData,
+	const FPoseSearchQuery& Query, const FPoseSearchQualitySettings& Settings, const int32 SectionIndex,
+	const int32 CurrentPoseId, FPoseSearchScratch& Scratch, FPoseSearchResult& InOutResult)
+{
+	switch(Settings.Quality)
+	{
+		case EMotionMatchingSearchQuality::Quality:
+		{
+			if(Settings.Stages)
+			{
+				SearchStaged(InMotionData, Query, *Settings.Stages, Settings.StagedCandidateCount, Settings.DeltaTime, Scratch,
+					InOutResult);
+				return EMotionMatchingSearchQuality::Quality;
+			}
+			break;
+		}
+		case EMotionMatchingSearchQuality::Brute:
+		{
+			SearchBrute(InMotionData, Query, InOutResult);
+			return EMotionMatchingSearchQuality::Brute;
+		}
+		case EMotionMatchingSearchQuality::Tree:
+		{
+			if(SectionIndex != INDEX_NONE
+				&& InMotionData->IsSearchTreeValid())
+			{
+				SearchTree(InMotionData, Query, SectionIndex, Settings.TreeEpsilon, InOutResult);
+				return EMotionMatchingSearchQuality::Tree;
+			}
+			break;
+		}
+		case EMotionMatchingSearchQuality::CandidateLookup:
+		{
+			if(SectionIndex != INDEX_NONE
+				&& InMotionData->IsPoseLookupTableValid())
+			{
+				const TConstArrayView<int32> Candidates = InMotionData->PoseLookupTable.GetCandidates(SectionIndex, CurrentPoseId);
+				if(Candidates.Num() > 0)
+				{
+					SearchCandidates(InMotionData, Query, Candidates, InOutResult);
+					return EMotionMatchingSearchQuality::CandidateLookup;
+				}
+			}
+			break;
+		}
+		case EMotionMatchingSearchQuality::Compressed:
+		{
+			if(InMotionData->IsSearchMatrixPQValid())
+			{
+				SearchCompressed(InMotionData, Query, Settings.CompressedRerankCount, Scratch, InOutResult);
+				return EMotionMatchingSearchQuality::Compressed;
+			}
+			break;
+		}
+		default: break;
+	}
+
+	SearchAABB(InMotionData, Query, InOutResult);
+	return EMotionMatchingSearchQuality::Performance;
+}
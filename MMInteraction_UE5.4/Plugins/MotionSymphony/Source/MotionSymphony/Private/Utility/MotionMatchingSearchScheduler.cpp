@@ -0,0 +1,383 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "Utility/MotionMatchingSearchScheduler.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Objects/Assets/MotionDataAsset.h"
+
+static TAutoConsoleVariable<int32> CVarMMSearchBudgetMicroseconds(
+	TEXT("a.AnimNode.MoSymph.MMSearch.BudgetMicroseconds"),
+	0,
+	TEXT("The total time in microseconds that motion matching searches may use per frame before non forced searches are deferred. \n")
+	TEXT("<=0: No time budget \n"));
+
+static TAutoConsoleVariable<int32> CVarMMSearchBudgetPoses(
+	TEXT("a.AnimNode.MoSymph.MMSearch.BudgetPoses"),
+	0,
+	TEXT("The total number of poses that motion matching searches may check per frame before non forced searches are deferred. \n")
+	TEXT("<=0: No pose budget \n"));
+
+static TAutoConsoleVariable<float> CVarMMSearchLowPriorityBudget(
+	TEXT("a.AnimNode.MoSymph.MMSearch.LowPriorityBudget"),
+	0.5f,
+	TEXT("The fraction of the frame budget available to low priority (off screen or distant) searches. \n"));
+
+static TAutoConsoleVariable<int32> CVarMMSearchMaxDeferFrames(
+	TEXT("a.AnimNode.MoSymph.MMSearch.MaxDeferFrames"),
+	4,
+	TEXT("The maximum number of consecutive frames a search can be deferred before it is granted regardless of the budget. \n"));
+
+static TAutoConsoleVariable<float> CVarMMSearchHighPriorityDistance(
+	TEXT("a.AnimNode.MoSymph.MMSearch.HighPriorityDistance"),
+	3000.0f,
+	TEXT("Visible characters closer than this distance to a camera have high search priority. \n"));
+
+static TAutoConsoleVariable<int32> CVarMMSearchBatchResultFrames(
+	TEXT("a.AnimNode.MoSymph.MMSearch.BatchResultFrames"),
+	8,
+	TEXT("The number of frames that a batched search result which was not retrieved is kept for, e.g. for nodes with a reduced update rate. \n"));
+
+FPoseSearchQuery FBatchedPoseSearchRequest::GetQuery() const
+{
+	FPoseSearchQuery Query(QueryPoseArray.GetData(), CalibrationArray.GetData(), StartPoseIndex, EndPoseIndex);
+	Query.EvaluationOrder = EvaluationOrder;
+	return Query;
+}
+
+UMotionMatchingSearchScheduler::UMotionMatchingSearchScheduler()
+	: FrameSearchesRequested(0),
+	FrameSearchesGranted(0),
+	FrameSearchesForced(0),
+	FrameSearchesDeferred(0),
+	FramePosesSearched(0),
+	FrameSearchCycles(0),
+	StaggerCounter(0),
+	PendingBatchSerial(1),
+	InFlightBatchSerial(0)
+{
+}
+
+UMotionMatchingSearchScheduler* UMotionMatchingSearchScheduler::Get(const UWorld* InWorld)
+{
+	return InWorld ? InWorld->GetSubsystem<UMotionMatchingSearchScheduler>() : nullptr;
+}
+
+float UMotionMatchingSearchScheduler::AcquireStaggerPhase()
+{
+	//The golden ratio sequence spreads any number of successive phases evenly over [0, 1)
+	const uint32 StaggerIndex = StaggerCounter.fetch_add(1, std::memory_order_relaxed);
+	return FMath::Frac(static_cast<float>(StaggerIndex) * 0.618034f);
+}
+
+EMotionMatchingSearchPriority UMotionMatchingSearchScheduler::ComputePriority(const USkeletalMeshComponent* InSkelMeshComponent) const
+{
+	if(!InSkelMeshComponent)
+	{
+		return EMotionMatchingSearchPriority::High;
+	}
+
+	if(!InSkelMeshComponent->WasRecentlyRendered(0.2f))
+	{
+		return EMotionMatchingSearchPriority::Low;
+	}
+
+	if(CameraLocations.Num() == 0)
+	{
+		return EMotionMatchingSearchPriority::High;
+	}
+
+	const float HighPriorityDistance = CVarMMSearchHighPriorityDistance.GetValueOnAnyThread();
+	const FVector CharacterLocation = InSkelMeshComponent->GetComponentLocation();
+	for(const FVector& CameraLocation : CameraLocations)
+	{
+		if(FVector::DistSquared(CameraLocation, CharacterLocation) < HighPriorityDistance * HighPriorityDistance)
+		{
+			return EMotionMatchingSearchPriority::High;
+		}
+	}
+
+	return EMotionMatchingSearchPriority::Low;
+}
+
+bool UMotionMatchingSearchScheduler::RequestSearch(const EMotionMatchingSearchPriority InPriority, const int32 FramesDeferred)
+{
+	FrameSearchesRequested.fetch_add(1, std::memory_order_relaxed);
+
+	if(InPriority == EMotionMatchingSearchPriority::Forced)
+	{
+		FrameSearchesForced.fetch_add(1, std::memory_order_relaxed);
+		FrameSearchesGranted.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	bool bWithinBudget = FramesDeferred >= CVarMMSearchMaxDeferFrames.GetValueOnAnyThread();
+	if(!bWithinBudget)
+	{
+		const float BudgetScale = InPriority == EMotionMatchingSearchPriority::High ? 1.0f
+			: FMath::Clamp(CVarMMSearchLowPriorityBudget.GetValueOnAnyThread(), 0.0f, 1.0f);
+
+		bWithinBudget = true;
+
+		const int32 BudgetMicroseconds = CVarMMSearchBudgetMicroseconds.GetValueOnAnyThread();
+		if(BudgetMicroseconds > 0)
+		{
+			const double SpentMicroseconds = FPlatformTime::ToMilliseconds64(FrameSearchCycles.load(std::memory_order_relaxed)) * 1000.0;
+			bWithinBudget &= SpentMicroseconds < BudgetMicroseconds * BudgetScale;
+		}
+
+		const int32 BudgetPoses = CVarMMSearchBudgetPoses.GetValueOnAnyThread();
+		if(BudgetPoses > 0)
+		{
+			bWithinBudget &= FramePosesSearched.load(std::memory_order_relaxed) < BudgetPoses * BudgetScale;
+		}
+	}
+
+	if(bWithinBudget)
+	{
+		FrameSearchesGranted.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		FrameSearchesDeferred.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return bWithinBudget;
+}
+
+void UMotionMatchingSearchScheduler::ReportSearch(const uint64 InSearchCycles, const int32 InPosesSearched)
+{
+	FrameSearchCycles.fetch_add(InSearchCycles, std::memory_order_relaxed);
+	FramePosesSearched.fetch_add(InPosesSearched, std::memory_order_relaxed);
+}
+
+uint64 UMotionMatchingSearchScheduler::SubmitBatchedSearch(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& InQuery,
+	const float InCostToBeat)
+{
+	const int32 AtomCount = InMotionData->SearchPoseMatrix.AtomCount;
+
+	FBatchedPoseSearchRequest Request;
+	Request.MotionData = InMotionData;
+	Request.QueryPoseArray = TArray<float>(InQuery.QueryPoseArray, AtomCount);
+	Request.CalibrationArray = TArray<float>(InQuery.CalibrationArray, AtomCount - 1);
+	Request.EvaluationOrder = InQuery.EvaluationOrder;
+	Request.StartPoseIndex = InQuery.StartPoseIndex;
+	Request.EndPoseIndex = InQuery.EndPoseIndex;
+	Request.Result = FPoseSearchResult(InCostToBeat);
+
+	FScopeLock Lock(&BatchLock);
+	const int32 RequestIndex = PendingBatch.Add(MoveTemp(Request));
+	return (static_cast<uint64>(PendingBatchSerial) << 32) | static_cast<uint32>(RequestIndex);
+}
+
+bool UMotionMatchingSearchScheduler::RetrieveBatchedSearch(const uint64 InTicket, FPoseSearchResult& OutResult,
+	uint64& OutSearchCycles)
+{
+	const uint32 Serial = static_cast<uint32>(InTicket >> 32);
+	const int32 RequestIndex = static_cast<int32>(InTicket & 0xffffffff);
+
+	UE::Tasks::FTask Task;
+	{
+		FScopeLock Lock(&BatchLock);
+		if(Serial != InFlightBatchSerial)
+		{
+			//The batch was searched before the last dispatch so the result is complete
+			FRetainedBatchedSearchResult RetainedResult;
+			if(!RetainedResults.RemoveAndCopyValue(InTicket, RetainedResult))
+			{
+				return false;
+			}
+
+			OutResult = RetainedResult.Result;
+			OutSearchCycles = RetainedResult.SearchCycles;
+			return true;
+		}
+
+		if(!InFlightBatch.IsValidIndex(RequestIndex)
+			|| InFlightBatch[RequestIndex].bRetrieved)
+		{
+			return false;
+		}
+
+		InFlightBatch[RequestIndex].bRetrieved = true;
+		Task = BatchTask;
+	}
+
+	Task.Wait();
+	OutResult = InFlightBatch[RequestIndex].Result;
+	OutSearchCycles = InFlightBatch[RequestIndex].SearchCycles;
+	return true;
+}
+
+void UMotionMatchingSearchScheduler::CancelBatchedSearch(const uint64 InTicket)
+{
+	const uint32 Serial = static_cast<uint32>(InTicket >> 32);
+	const int32 RequestIndex = static_cast<int32>(InTicket & 0xffffffff);
+
+	FScopeLock Lock(&BatchLock);
+	if(Serial == InFlightBatchSerial)
+	{
+		if(InFlightBatch.IsValidIndex(RequestIndex))
+		{
+			InFlightBatch[RequestIndex].bRetrieved = true;
+		}
+	}
+	else
+	{
+		RetainedResults.Remove(InTicket);
+	}
+}
+
+void UMotionMatchingSearchScheduler::DispatchSearchBatch()
+{
+	//Nodes retrieve their results during the animation update, which has completed by now
+	BatchTask.Wait();
+
+	{
+		FScopeLock Lock(&BatchLock);
+
+		//Nodes which did not update this frame (e.g. update rate optimisations) retrieve their result in a later frame
+		const uint64 MaxResultFrames = static_cast<uint64>(FMath::Max(CVarMMSearchBatchResultFrames.GetValueOnAnyThread(), 0));
+		for(auto It = RetainedResults.CreateIterator(); It; ++It)
+		{
+			if(GFrameCounter - It.Value().DispatchFrame > MaxResultFrames)
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		if(MaxResultFrames > 0)
+		{
+			for(int32 RequestIndex = 0; RequestIndex < InFlightBatch.Num(); ++RequestIndex)
+			{
+				const FBatchedPoseSearchRequest& Request = InFlightBatch[RequestIndex];
+				if(!Request.bRetrieved)
+				{
+					const uint64 Ticket = (static_cast<uint64>(InFlightBatchSerial) << 32) | static_cast<uint32>(RequestIndex);
+					RetainedResults.Add(Ticket, FRetainedBatchedSearchResult{Request.Result, GFrameCounter, Request.SearchCycles});
+				}
+			}
+		}
+
+		InFlightBatch = MoveTemp(PendingBatch);
+		PendingBatch.Reset();
+		InFlightBatchSerial = PendingBatchSerial;
+		PendingBatchSerial = FMath::Max(PendingBatchSerial + 1, 1u); //Serial 0 is never used so that a zero ticket is invalid
+	}
+
+	LastFrameStats.SearchesBatched = InFlightBatch.Num();
+
+	InFlightMotionData.Reset();
+	for(const FBatchedPoseSearchRequest& Request : InFlightBatch)
+	{
+		InFlightMotionData.AddUnique(const_cast<UMotionDataAsset*>(Request.MotionData));
+	}
+
+	if(InFlightBatch.Num() == 0)
+	{
+		BatchTask = UE::Tasks::FTask();
+		return;
+	}
+
+	BatchTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]()
+	{
+		SearchBatch(InFlightBatch);
+	});
+}
+
+void UMotionMatchingSearchScheduler::SearchBatch(TArray<FBatchedPoseSearchRequest>& InOutRequests)
+{
+	TArray<bool> RequestsSearched;
+	RequestsSearched.SetNumZeroed(InOutRequests.Num());
+
+	TArray<int32> RequestIndices;
+	TArray<FPoseSearchQuery> Queries;
+	TArray<FPoseSearchResult> Results;
+	for(int32 FirstRequestIndex = 0; FirstRequestIndex < InOutRequests.Num(); ++FirstRequestIndex)
+	{
+		if(RequestsSearched[FirstRequestIndex])
+		{
+			continue;
+		}
+
+		//Gather all requests for the same motion data so that its search structures are only streamed through once
+		const UMotionDataAsset* MotionData = InOutRequests[FirstRequestIndex].MotionData;
+		RequestIndices.Reset();
+		Queries.Reset();
+		Results.Reset();
+		for(int32 RequestIndex = FirstRequestIndex; RequestIndex < InOutRequests.Num(); ++RequestIndex)
+		{
+			if(!RequestsSearched[RequestIndex]
+				&& InOutRequests[RequestIndex].MotionData == MotionData)
+			{
+				RequestsSearched[RequestIndex] = true;
+				RequestIndices.Add(RequestIndex);
+				Queries.Add(InOutRequests[RequestIndex].GetQuery());
+				Results.Add(InOutRequests[RequestIndex].Result);
+			}
+		}
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		MotionData->SearchPoseBatch(Queries, Results);
+
+		//The queries share one pass over the search data so each is given an equal share of its time
+		const uint64 RequestCycles = (FPlatformTime::Cycles64() - StartCycles) / RequestIndices.Num();
+		for(int32 i = 0; i < RequestIndices.Num(); ++i)
+		{
+			InOutRequests[RequestIndices[i]].Result = Results[i];
+			InOutRequests[RequestIndices[i]].SearchCycles = RequestCycles;
+		}
+	}
+}
+
+FMotionMatchingSchedulerStats UMotionMatchingSearchScheduler::GetLastFrameStats() const
+{
+	return LastFrameStats;
+}
+
+bool UMotionMatchingSearchScheduler::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UMotionMatchingSearchScheduler::Deinitialize()
+{
+	BatchTask.Wait();
+	InFlightBatch.Empty();
+	PendingBatch.Empty();
+	RetainedResults.Empty();
+
+	Super::Deinitialize();
+}
+
+void UMotionMatchingSearchScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	//Animation updates have completed for this frame so the counters can be collected and reset for the next frame
+	LastFrameStats.SearchesRequested = FrameSearchesRequested.exchange(0, std::memory_order_relaxed);
+	LastFrameStats.SearchesGranted = FrameSearchesGranted.exchange(0, std::memory_order_relaxed);
+	LastFrameStats.SearchesForced = FrameSearchesForced.exchange(0, std::memory_order_relaxed);
+	LastFrameStats.SearchesDeferred = FrameSearchesDeferred.exchange(0, std::memory_order_relaxed);
+	LastFrameStats.PosesSearched = FramePosesSearched.exchange(0, std::memory_order_relaxed);
+	LastFrameStats.SearchMicroseconds = static_cast<float>(FPlatformTime::ToMilliseconds64(
+		FrameSearchCycles.exchange(0, std::memory_order_relaxed)) * 1000.0);
+
+	DispatchSearchBatch();
+
+	CameraLocations.Reset();
+	for(FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if(PlayerController && PlayerController->IsLocalController() && PlayerController->PlayerCameraManager)
+		{
+			CameraLocations.Add(PlayerController->PlayerCameraManager->GetCameraLocation());
+		}
+	}
+}
+
+TStatId UMotionMatchingSearchScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMotionMatchingSearchScheduler, STATGROUP_Tickables);
+}
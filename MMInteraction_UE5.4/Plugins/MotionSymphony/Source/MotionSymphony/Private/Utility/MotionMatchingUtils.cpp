@@ -5,6 +5,7 @@
 #include "AnimNode_MSMotionMatching.h"
 #include "Objects/Assets/MotionCalibration.h"
 #include "Data/CalibrationData.h"
+#include "Data/PoseHotTable.h"
 #include "BonePose.h"
 
 void FMotionMatchingUtils::LerpFloatArray(TArray<float>& OutLerpArray, const float* FromArrayPtr, const float* ToArrayPtr,
@@ -48,6 +49,21 @@ void FMotionMatchingUtils::LerpPose(FPoseMotionData& OutLerpPose, const FPoseMot
 	OutLerpPose.Time = FMath::Lerp(From.Time, To.Time, Progress);
 }
 
+void FMotionMatchingUtils::LerpPose(FPoseMotionData& OutLerpPose, const FPoseHotTable& PoseTable, const int32 FromPoseId,
+	const int32 ToPoseId, const float Progress)
+{
+	const int32 DominantPoseId = Progress < 0.5f ? FromPoseId : ToPoseId;
+	OutLerpPose.PoseId = DominantPoseId;
+	OutLerpPose.AnimType = PoseTable.GetAnimType(DominantPoseId);
+	OutLerpPose.AnimId = PoseTable.AnimIds[DominantPoseId];
+	OutLerpPose.bMirrored = PoseTable.IsMirrored(DominantPoseId);
+	OutLerpPose.SearchFlag = PoseTable.GetSearchFlag(DominantPoseId);
+
+	OutLerpPose.LastPoseId = FromPoseId;
+	OutLerpPose.NextPoseId = ToPoseId;
+	OutLerpPose.Time = FMath::Lerp(PoseTable.Times[FromPoseId], PoseTable.Times[ToPoseId], Progress);
+}
+
 void FMotionMatchingUtils::LerpLinearPoseData(TArray<float>& OutLerpPose, TArray<float> From, TArray<float> To,
                                               const float Progress)
 {
@@ -12,12 +12,60 @@
 #include "Data/PoseMotionData.h"
 #include "Data/Trajectory.h"
 #include "Debug/MotionMatchingDebugInfo.h"
+#include "Debug/MotionMatchingTrace.h"
 #include "Enumerations/EMotionMatchingEnums.h"
+#include "Utility/MotionMatchingSearch.h"
+#include "Tasks/Task.h"
+#include "UObject/GCObject.h"
 #include "AnimNode_MSMotionMatching.generated.h"
 
 struct FDistanceMatchPayload;
 struct FMotionActionPayload;
 struct FMotionTraitField;
+class UMotionMatchingSearchScheduler;
+
+/** A snapshot of a pose search which is searched on a worker task by motion matching nodes with the 'Async' search
+ * dispatch. The query arrays are copies so that the node can keep updating while the task runs and the snapshot is
+ * shared with the task so that it outlives the node if needed. The snapshot references the motion data so that it
+ * cannot be garbage collected while it is searched. */
+struct MOTIONSYMPHONY_API FAsyncPoseSearch : public FGCObject
+{
+	UE::Tasks::FTask Task;
+
+	TObjectPtr<const UMotionDataAsset> MotionData = nullptr;
+	TArray<float> QueryPoseArray;
+	TArray<float> CalibrationArray;
+	TArray<FPoseFeatureSegment> EvaluationOrder;
+	int32 StartPoseIndex = 0;
+	int32 EndPoseIndex = 0;
+
+	//The search settings of the node when the snapshot was taken
+	FPoseSearchQualitySettings SearchSettings;
+	int32 CurrentPoseId = 0;
+	int32 SectionIndex = INDEX_NONE;
+
+	//The exact motion tag section of the required motion tags, used to detect stale results
+	int32 TagSectionIndex = INDEX_NONE;
+
+	//The next natural pose (lookup matrix space) which the search has to beat
+	int32 NaturalPoseId = INDEX_NONE;
+
+	FPoseSearchScratch SearchScratch;
+	FPoseSearchResult Result;
+
+	//Timing of the snapshot and search for latency statistics
+	uint64 SubmitCycles = 0;
+	uint64 SubmitFrame = 0;
+	uint64 SearchCycles = 0;
+
+	/** Searches the snapshot with the same search dispatch as the node, without its debug comparisons */
+	void Search();
+
+	//FGCObject interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+	//End of FGCObject interface
+};
 
 /** An animation node which performs motion matching to synthesise animation. It is an asset player
 which uses MotionAnimData asset as it's source data. The node can be used with inertialization and 
@@ -84,17 +132,39 @@ public:
 	selection and synthesis of animation poses. */
 	UPROPERTY(EditAnywhere, Category = "Animation Data", meta = (PinShownByDefault))
 	TObjectPtr<UMotionCalibration> UserCalibration = nullptr;
-	
-	UPROPERTY()
-	TArray<FCalibrationData> FinalCalibrationSets;
 
 	/** There are two options for pose searches, performance mode and quality mode. Performance mode still gets good
 	 results, however, the quality mode performs additional calculations which slightly improve the quality at a
-	 small performance cost. Quality mode is 'experimental' and requires the last two 'Match Features' in your
-	 Motion Config to be of type 'Bone Location & Velocity'*/
+	 small performance cost. Quality mode searches in two stages: the 'coarse' match features of the Motion Config
+	 pick the best candidates and only those are evaluated with the remaining ('refine') features and any refinement
+	 costs (e.g. the resultant velocity of 'Bone Location & Velocity' features). */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinShownByDefault))
 	EMotionMatchingSearchQuality SearchQuality = EMotionMatchingSearchQuality::Performance;
 
+	/** The approximation allowed by the 'Tree' search quality. Parts of the tree are skipped if they cannot improve on the
+	 best pose found so far by more than this fraction, e.g. 0.1 means the chosen pose costs at most 10% more than the
+	 lowest cost pose. 0 gives an exact search. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinHiddenByDefault, ClampMin = 0.0f,
+		EditCondition = "SearchQuality == EMotionMatchingSearchQuality::Tree"))
+	float SearchTreeEpsilon;
+
+	/** The number of poses with the lowest compressed cost that are evaluated at full precision by the 'Compressed' search
+	 quality. Higher values are more likely to find the lowest cost pose but take longer. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinHiddenByDefault, ClampMin = 1,
+		EditCondition = "SearchQuality == EMotionMatchingSearchQuality::Compressed"))
+	int32 CompressedRerankCount;
+
+	/** The number of poses with the lowest coarse cost that are refined by the 'Quality' search quality. Higher values
+	 are more likely to find the lowest cost pose but take longer. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinHiddenByDefault, ClampMin = 1,
+		EditCondition = "SearchQuality == EMotionMatchingSearchQuality::Quality"))
+	int32 HighQualityCandidateCount;
+
+	/** The number of lowest cost poses kept by each inline pose search, which can be read with GetSearchCandidates. 0 (only
+	 the lowest cost pose) is the fastest. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinHiddenByDefault, ClampMin = 0, ClampMax = 32))
+	int32 SearchCandidateCount;
+
 	/** The method of transitioning between animations. This could either be instant, blended or inertialized. Inertialization is
 	the recommended method of blending with motion matching for both performance and quality. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options")
@@ -106,6 +176,18 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinHiddenByDefault))
 	EPastTrajectoryMode PastTrajectoryMode;
 
+	/** If true, pose searches are scheduled by the world's motion matching search scheduler. The scheduler staggers the
+	 * searches of nodes that initialize together and may defer non-forced searches by a few frames when the per frame
+	 * search budget is used up. Forced searches are never deferred. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinHiddenByDefault))
+	bool bUseSearchScheduler;
+
+	/** Where pose searches are run. Batched searches are only used with the 'Performance' search quality in game worlds
+	 * and async searches are used in game worlds with any search quality except 'Quality' and 'Brute'. Neither is used for forced
+	 * searches. Any other search is run inline. Batched and async results always arrive at least one frame late. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Options", meta = (PinHiddenByDefault))
+	EPoseSearchDispatch SearchDispatch;
+
 	/** If true, the desired will be blended with the current trajectory with a time falloff. This provides a very realistic 
 	trajectory but it can also reduce responsiveness. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Input Response")
@@ -174,9 +256,6 @@ public:
 	float CurrentActionTime;
 	float CurrentActionEndTime;
 
-	//Thread Safety
-	static FCriticalSection CheckValidCriticalSection;
-
 private:
 	float TimeSinceMotionUpdate;
 	float TimeSinceMotionChosen;
@@ -186,14 +265,98 @@ private:
 	int32 InputArraySize;
 	int32 MotionRecorderConfigIndex;
 
+	//The number of consecutive frames that a due search has been deferred by the search scheduler
+	int32 FramesSearchDeferred;
+
+	//The lowest cost poses of the last search (database pose ids, lowest cost first) if SearchCandidateCount > 0
+	TArray<FPoseSearchCandidate> SearchCandidates;
+
+	//The number of poses checked by the last pose search, reported to the search scheduler
+	int32 LastSearchPoseCount;
+
+	//The pending batched search (0 if there is none), the next natural pose id it has to beat (lookup matrix space) and
+	//the motion tag section that it searched
+	uint64 BatchedSearchTicket;
+	int32 BatchedSearchNaturalPoseId;
+	int32 BatchedSearchSectionIndex;
+
+	//Set when a batched result expired so that the next search runs inline rather than being submitted again
+	bool bBatchedSearchExpired;
+
+	//Accumulated comparison of candidate lookup searches against full searches (a.AnimNode.MoSymph.MMSearch.CompareLookupTable)
+	int32 LookupCompareSearchCount;
+	int32 LookupCompareMatchCount;
+	int64 LookupComparePosesChecked;
+	int64 LookupCompareFullPosesChecked;
+	double LookupCompareCostRatioSum;
+
+	//Accumulated per level statistics of AABB hierarchy searches (a.AnimNode.MoSymph.MMSearch.AABBLevelStats)
+	int32 AABBLevelStatsSearchCount;
+	int64 AABBLevelStatsPosesChecked;
+	int64 AABBLevelBoxesChecked[FPoseAABBHierarchy::MaxLevelCount];
+	int64 AABBLevelBoxesPassed[FPoseAABBHierarchy::MaxLevelCount];
+
+	//Accumulated latency of async searches (a.AnimNode.MoSymph.MMSearch.AsyncLatencyStats)
+	int32 AsyncStatsSearchCount;
+	int32 AsyncStatsStaleCount;
+	uint64 AsyncStatsFrames;
+	uint64 AsyncStatsLatencyCycles;
+	uint64 AsyncStatsSearchCycles;
+
+	FPoseSearchScratch SearchScratch;
+
+	//The pending async search. The snapshot is only re-used once its task has completed and its task is waited for
+	//whenever the node is reset or destroyed
+	TSharedPtr<FAsyncPoseSearch, ESPMode::ThreadSafe> AsyncSearch;
+	bool bAsyncSearchPending;
+
 	bool bValidToEvaluate;
 	bool bInitialized;
 	bool bTriggerTransition;
 
+	//The pose search of the current update, reported to the MotionSymphony stat group and trace channel
+	FMotionMatchingSearchTrace SearchTrace;
+	FMotionMatchingNodeTraceCounters SearchTraceCounters;
+
 	FPoseMotionData CurrentInterpolatedPose;
 	TArray<float> CurrentInterpolatedPoseArray;
-	TArray<float> CalibrationArray;
 	FAnimChannelState MMAnimState;
+
+	//The calibration weights used by pose searches. This points either to the cached weights of the current motion tag
+	//section in the motion data or to CustomCalibrationArray when a user calibration or ratio override is applied. It is
+	//looked up again by GenerateCalibrationArray before every search since pre-processing reallocates the cached weights
+	const float* CalibrationWeights;
+
+	//Calibration weights with the user calibration and quality vs responsiveness override applied. These are only
+	//regenerated when one of the inputs they were generated from changes, including the section weights of the motion data
+	TArray<float, TAlignedHeapAllocator<16>> CustomCalibrationArray;
+	const UMotionDataAsset* CustomCalibrationData;
+	int32 CustomCalibrationSection;
+	uint32 CustomCalibrationSerial;
+	const UMotionCalibration* CustomCalibrationUser;
+	float CustomCalibrationRatio;
+
+	//The offset and size of each match feature within a pose array. Generated in CheckValidToEvaluate
+	TArray<FPoseFeatureSegment> FeatureSegments;
+
+	//The coarse and refine stages of the 'Quality' search. Generated in CheckValidToEvaluate
+	FPoseSearchStages SearchStages;
+
+	//The feature segments of each calibration set in the order that they should be evaluated during a pose search. A set
+	//is empty if the motion data has no optimised evaluation order. Generated in CheckValidToEvaluate
+	TArray<TArray<FPoseFeatureSegment>> FeatureEvaluationOrderSets;
+	int32 CurrentCalibrationIndex;
+
+	//The motion tag sections of the last resolved RequiredMotionTags. These are only resolved again when the required tags
+	//or the motion data change
+	TArray<FGameplayTag> ResolvedMotionTags;
+	FMotionTagSectionMatch ResolvedMotionTagSections;
+	const UMotionDataAsset* ResolvedMotionTagData;
+
+	//The motion tag sections which have all of the required tags exactly and the section whose tags equal the required
+	//tags (or INDEX_NONE). Poses are checked against these through the tag section index of the pose hot table
+	TBitArray<> ResolvedExactTagSections;
+	int32 ResolvedRequiredTagSection;
 	
 	//Compact pose format of mirror bone map
 	TCustomBoneIndexArray<FCompactPoseBoneIndex, FCompactPoseBoneIndex> CompactPoseMirrorBones;
@@ -219,6 +382,10 @@ public:
 	FAnimNode_MSMotionMatching();
 	virtual ~FAnimNode_MSMotionMatching() override;
 
+	/** The lowest cost poses of the last pose search that searched the pose matrix, lowest cost first. Pose ids are
+	 * database pose ids. Empty unless SearchCandidateCount is greater than 0 */
+	TConstArrayView<FPoseSearchCandidate> GetSearchCandidates() const { return SearchCandidates; }
+
 	//FAnimNode_AssetPlayerBase interface
 	virtual float GetCurrentAssetTime() const override;
 	virtual float GetAccumulatedTime() const override;
@@ -241,20 +408,46 @@ private:
 	void InitializeMatchedTransition(const FAnimationUpdateContext& Context);
 	void UpdateMotionMatchingState(const float DeltaTime, const FAnimationUpdateContext& Context);
 	void UpdateMotionMatching(const float DeltaTime, const FAnimationUpdateContext& Context);
+	UMotionMatchingSearchScheduler* GetSearchScheduler(const FAnimationUpdateContext& Context) const;
+	static UMotionMatchingSearchScheduler* FindSearchScheduler(const FAnimationUpdateContext& Context);
 	void ComputeCurrentPose();
 	void ComputeCurrentPose(const TArray<float>* CurrentPoseArray);
 	void PoseSearch(const FAnimationUpdateContext& Context);
+	void TransitionToSearchedPose(const int32 LowestPoseId, const FAnimationUpdateContext& Context);
+	bool SubmitBatchedSearch(const FAnimationUpdateContext& Context);
+	void ConsumeBatchedSearch(const FAnimationUpdateContext& Context);
+	bool SubmitAsyncSearch(const FAnimationUpdateContext& Context);
+	void ConsumeAsyncSearch(const FAnimationUpdateContext& Context);
+	void WaitForAsyncSearch();
+	void RecordAsyncSearchLatency(const FAsyncPoseSearch& InSearch, const bool bInStale);
+	int32 ResolveDeferredSearchPoseId(const UMotionDataAsset* InMotionData, const FPoseSearchResult& InResult,
+		const int32 InNaturalPoseId) const;
+	bool IsDeferredSearchResultValid(const UMotionDataAsset* InMotionData, const int32 InSectionIndex, const int32 InPoseId);
+	bool ComputeNaturalCostToBeat(const UMotionDataAsset* InMotionData, int32& OutNaturalPoseId, float& OutCostToBeat,
+		FPoseSearchTopK* OutNextNaturalCandidates = nullptr);
 	void TransitionPoseSearch(const FAnimationUpdateContext& Context);
 	bool CheckForcePoseSearch(const UMotionDataAsset* InMotionData) const;
 	int32 GetLowestCostPoseId_Transition();
 	int32 GetLowestCostPoseId_Standard();
 	int32 GetLowestCostPoseId_HighQuality(const float DeltaTime);
-	int32 GetLowestCostNextNaturalId(int32 LowestPoseId_LM, float& OutLowestCost, TObjectPtr<const UMotionDataAsset> InMotionData);
+	int32 GetLowestCostNextNaturalId(int32 LowestPoseId_LM, float& OutLowestCost, TObjectPtr<const UMotionDataAsset> InMotionData,
+		FPoseSearchTopK* OutCandidates = nullptr);
 	/*----------XC: Brute Search---------*/
 	int32 GetLowestCostPoseId_Brute();
-	bool NextPoseToleranceTest(const FPoseMotionData& NextPose) const;
+	FPoseSearchQualitySettings GetSearchQualitySettings(const float DeltaTime) const;
+	void SearchPoseMatrix(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query, const float DeltaTime,
+		FPoseSearchResult& InOutResult);
+	FPoseSearchResult CreateSearchResult(const float CostToBeat) const;
+	void ResolveSearchCandidates(const UMotionDataAsset* InMotionData, const FPoseSearchResult& InSearchResult);
+	void CompareLookupTableSearch(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+		const FPoseSearchResult& InLookupResult, const float InCostToBeat);
+	void RecordAABBLevelStatistics(const UMotionDataAsset* InMotionData, const FPoseSearchResult& InSearchResult);
+	bool NextPoseToleranceTest(const int32 NextPoseId) const;
 	void ApplyTrajectoryBlending();
 	bool GenerateCalibrationArray();
+	const FMotionTagSectionMatch& ResolveRequiredMotionTags();
+	bool SectionHasRequiredMotionTags(const int32 InSectionIndex) const; //Requires the tags to have been resolved this update
+	TConstArrayView<FPoseFeatureSegment> GetFeatureEvaluationOrder() const;
 	
 	void TransitionToPose(const int32 PoseId, const FAnimationUpdateContext& Context, const float TimeOffset = 0.0f);
 	void JumpToPose(const int32 PoseIdDatabase, const float TimeOffset = 0.0f);
@@ -279,9 +472,11 @@ private:
 	void DrawAnimDebug(FAnimInstanceProxy* InAnimInstanceProxy) const;
 
 	void RecordHistoricalPoseSearch(int32 InPosesSearched);
+	void RecordSearchStatistics(const FPoseSearchResult& InSearchResult);
 
 	void FillCompactPoseAndComponentRefRotations(const FBoneContainer& BoneContainer);
 
-	void UpdateLowestPoses(TObjectPtr<const UMotionDataAsset> CurrentMotionData, int32 LowestPoseId, float PoseFavour, float Cost, TMap<FName, float>& FeatureCostMap, TArray<FPoseCostInfo>& LowestPoses);
+	void UpdateLowestPoses(TObjectPtr<const UMotionDataAsset> CurrentMotionData, const FPoseSearchTopK& NextNaturalCandidates,
+		const FPoseSearchTopK& MatrixCandidates);
 };
 
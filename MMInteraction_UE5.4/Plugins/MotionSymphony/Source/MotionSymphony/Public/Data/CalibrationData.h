@@ -38,4 +38,22 @@ public:
 	void GenerateStandardDeviationWeights(const UMotionDataAsset* SourceMotionData, const FGameplayTagContainer& MotionTags);
 	void GenerateStandardDeviationWeights(const TArray<float>& PoseMatrix, UMotionMatchConfig* InMMConfig);
 	void GenerateFinalWeights(UMotionMatchConfig* MotionMatchConfig, const FCalibrationData& StdDeviationNormalizers);
-};
\ No newline at end of file
+};
+
+/** The order in which the match features of a motion config should be evaluated during a pose search. Features which are
+expected to contribute the most cost per atom (high calibration weight and high variance) are evaluated first so that the
+pose search can give up on a pose as early as possible. There is one evaluation order per motion trait field. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FFeatureEvaluationOrder
+{
+	GENERATED_USTRUCT_BODY()
+
+public:
+	/** Indices into the motion config feature list, in evaluation order*/
+	UPROPERTY()
+	TArray<int32> FeatureIndices;
+
+public:
+	void Generate(UMotionMatchConfig* MotionMatchConfig, const FCalibrationData& StdDeviationNormalizers);
+	bool IsValidWithConfig(const UMotionMatchConfig* MotionConfig) const;
+};
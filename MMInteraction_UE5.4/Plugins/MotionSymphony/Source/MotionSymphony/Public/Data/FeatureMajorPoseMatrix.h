@@ -0,0 +1,81 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FeatureMajorPoseMatrix.generated.h"
+
+struct FPoseMatrix;
+class UMotionMatchConfig;
+
+/** The values of a single match feature for every pose of a feature major pose matrix */
+USTRUCT()
+struct MOTIONSYMPHONY_API FFeatureMajorBlock
+{
+	GENERATED_BODY()
+
+public:
+	/** The offset of the feature within a row of the row major pose matrix (i.e. including the pose favour atom) */
+	UPROPERTY()
+	int32 AtomOffset;
+
+	/** The number of atoms of the feature */
+	UPROPERTY()
+	int32 AtomCount;
+
+	/** The index of the first value of the block within the data array of the matrix */
+	UPROPERTY()
+	int32 DataOffset;
+
+public:
+	FFeatureMajorBlock();
+	FFeatureMajorBlock(int32 InAtomOffset, int32 InAtomCount, int32 InDataOffset);
+};
+
+/** A feature major (structure of arrays) copy of a search pose matrix. Each match feature of the config is stored as
+ * its own contiguous block of PoseCount * FeatureSize values, so a search can evaluate one feature for many poses and
+ * only read the next feature for the poses that can still beat the best cost. Blocks are ordered with the
+ * responsiveness (e.g. trajectory) features first since they usually discriminate the most between poses. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FFeatureMajorPoseMatrix
+{
+	GENERATED_BODY()
+
+public:
+	/** The number of atoms per pose of the row major matrix this was built from */
+	UPROPERTY()
+	int32 AtomCount;
+
+	UPROPERTY()
+	int32 PoseCount;
+
+	/** The pose favour (atom 0) of every pose */
+	UPROPERTY()
+	TArray<float> PoseFavours;
+
+	UPROPERTY()
+	TArray<FFeatureMajorBlock> Blocks;
+
+	UPROPERTY()
+	TArray<float> Data;
+
+public:
+	FFeatureMajorPoseMatrix();
+
+	/** Builds the matrix with one block per match feature of the config. If the features of the config do not match the
+	 * atoms of the search matrix, all atoms are stored in a single block */
+	void Build(const FPoseMatrix& InSearchMatrix, const UMotionMatchConfig* InMMConfig);
+
+	void Empty();
+
+	bool IsValid(const int32 InAtomCount, const int32 InPoseCount) const;
+
+	/** Returns the index of the block of the feature with the passed offset and size or INDEX_NONE */
+	int32 FindBlock(const int32 InAtomOffset, const int32 InAtomCount) const;
+
+	const float* GetBlockRow(const int32 BlockIndex, const int32 PoseIndex) const
+	{
+		const FFeatureMajorBlock& Block = Blocks[BlockIndex];
+		return Data.GetData() + Block.DataOffset + PoseIndex * Block.AtomCount;
+	}
+};
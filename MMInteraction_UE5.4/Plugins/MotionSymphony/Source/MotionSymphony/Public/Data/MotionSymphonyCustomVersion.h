@@ -0,0 +1,35 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/Guid.h"
+
+/** Custom serialization version for Motion Symphony assets which serialize data outside of their properties*/
+struct MOTIONSYMPHONY_API FMotionSymphonyCustomVersion
+{
+	enum Type
+	{
+		//Before any version changes were made
+		BeforeCustomVersionWasAdded = 0,
+
+		//Search structures can be stored in separate (optionally memory mapped) bulk data streams
+		BulkSearchData,
+
+		//The reverse pose id remap is a dense array rather than a map
+		DensePoseIdRemapReverse,
+
+		//Search structures are validated on load against a hash of the config rather than a hash of their source data
+		SearchStructureConfigHash,
+
+		// -----<new versions can be added above this line>-------------------------------------------------
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	//The GUID for this custom version number
+	const static FGuid GUID;
+
+private:
+	FMotionSymphonyCustomVersion() {}
+};
@@ -0,0 +1,80 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "MotionTagSectionTable.generated.h"
+
+/** The motion tag sections matching a set of required motion tags. INDEX_NONE means that no section matches */
+USTRUCT()
+struct MOTIONSYMPHONY_API FMotionTagSectionMatch
+{
+	GENERATED_BODY()
+
+public:
+	/** The first section which has all the required tags or children of them (FGameplayTagContainer::HasAll) */
+	UPROPERTY()
+	int32 SectionIndex;
+
+	/** The first section which has all the required tags exactly (FGameplayTagContainer::HasAllExact) */
+	UPROPERTY()
+	int32 ExactSectionIndex;
+
+public:
+	FMotionTagSectionMatch();
+	FMotionTagSectionMatch(int32 InSectionIndex, int32 InExactSectionIndex);
+};
+
+/** The motion tag containers of the motion tag sections compiled into bitmasks so that required motion tags can be
+ * resolved to sections without comparing tag containers at runtime. Every tag used by a section (and every parent of
+ * those tags) is assigned a bit. Required tags which exactly equal the tags of a section, which is the common case, are
+ * resolved with a single hash lookup. Any other combination is resolved by testing the section masks. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FMotionTagSectionTable
+{
+	GENERATED_BODY()
+
+public:
+	/** The bit of every tag used by a section and every parent of those tags */
+	UPROPERTY()
+	TMap<FGameplayTag, int32> TagBits;
+
+	/** The number of uint64 words per mask */
+	UPROPERTY()
+	int32 WordCount;
+
+	/** The tags of each section, WordCount words per section */
+	UPROPERTY()
+	TArray<uint64> SectionMasks;
+
+	/** The tags of each section and all of their parents, WordCount words per section */
+	UPROPERTY()
+	TArray<uint64> SectionParentMasks;
+
+	/** The pre-resolved match for the tags of each section, i.e. the result of Resolve(SectionTags[SectionIndex]) */
+	UPROPERTY()
+	TArray<FMotionTagSectionMatch> SectionMatches;
+
+	/** Maps the hash of a section mask to the index of the section */
+	UPROPERTY()
+	TMap<uint32, int32> SectionMaskLookup;
+
+public:
+	FMotionTagSectionTable();
+
+	void Build(TConstArrayView<FGameplayTagContainer> InSectionTags);
+	void Empty();
+	bool IsValid(const int32 InSectionCount) const;
+	int32 GetSectionCount() const { return SectionMatches.Num(); }
+
+	FMotionTagSectionMatch Resolve(const FGameplayTagContainer& InTags) const;
+
+private:
+	typedef TArray<uint64, TInlineAllocator<4>> FTagMask;
+
+	/** Returns false if any of the tags is not used by a section, in which case no section can match the tags */
+	bool BuildMask(const FGameplayTagContainer& InTags, FTagMask& OutMask) const;
+	bool SectionHasAll(const TArray<uint64>& InSectionMasks, const int32 InSectionIndex, const uint64* InMask) const;
+	static uint32 HashMask(const uint64* InMask, const int32 InWordCount);
+};
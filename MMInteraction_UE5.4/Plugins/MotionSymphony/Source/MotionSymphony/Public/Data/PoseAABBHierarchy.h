@@ -0,0 +1,105 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PoseAABBHierarchy.generated.h"
+
+struct FPoseMatrix;
+struct FPoseMatrixSection;
+
+/** The levels of boxes of a single motion tag section of a pose AABB hierarchy. Level 0 is the root level and the last
+ * level is the leaf level. Every box of the leaf level bounds LeafSize consecutive poses of the section and every box of
+ * a higher level bounds BranchFactor consecutive boxes of the level below it. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FPoseAABBHierarchySection
+{
+	GENERATED_BODY()
+
+public:
+	/** The range of the search pose matrix covered by this section [StartIndex, EndIndex) */
+	UPROPERTY()
+	int32 StartIndex;
+
+	UPROPERTY()
+	int32 EndIndex;
+
+	/** The number of poses in each box of the leaf level */
+	UPROPERTY()
+	int32 LeafSize;
+
+	/** The number of boxes of each level, root level first */
+	UPROPERTY()
+	TArray<int32> LevelBoxCounts;
+
+	/** The index of the first box group of each level within the group extents of the hierarchy */
+	UPROPERTY()
+	TArray<int32> LevelGroupOffsets;
+
+public:
+	FPoseAABBHierarchySection();
+
+	int32 GetLevelCount() const { return LevelBoxCounts.Num(); }
+
+	/** The number of poses bounded by each box of a level */
+	int32 GetBoxSize(const int32 Level) const;
+};
+
+/** An N-level AABB hierarchy over the search pose matrix with its own levels per motion tag section. Unlike the fixed
+ * outer (64) and inner (16) AABB matrices, the leaf box size and the number of levels are chosen per section so that
+ * small sections are not over-partitioned and large sections get enough levels to prune most poses early.
+ *
+ * Sibling boxes are stored together in groups of BranchFactor with their extents laid out structure of arrays (for
+ * every atom, the minimums of all boxes of the group followed by their maximums) so that all children of a box are
+ * tested against the query at once (see FMotionMatchingSearch::ComputeAABBGroupCost). */
+USTRUCT()
+struct MOTIONSYMPHONY_API FPoseAABBHierarchy
+{
+	GENERATED_BODY()
+
+public:
+	/** The number of children of every box, which is also the number of boxes tested at once */
+	static constexpr int32 BranchFactor = 4;
+
+	static constexpr int32 MaxLevelCount = 8;
+
+	UPROPERTY()
+	int32 AtomCount;
+
+	/** One entry per motion tag section, in the same order as the motion tag sections of the search pose matrix */
+	UPROPERTY()
+	TArray<FPoseAABBHierarchySection> Sections;
+
+	/** The extents of every box group, AtomCount * BranchFactor * 2 floats per group. Unused boxes of a group are zeroed */
+	UPROPERTY()
+	TArray<float> GroupExtents;
+
+public:
+	FPoseAABBHierarchy();
+
+	/** Builds the hierarchy for every section of the search matrix. If InLeafSize is 0, the leaf size of each section is
+	 * chosen by simulating searches for a few queries sampled from the section with each candidate leaf size. */
+	void Build(const FPoseMatrix& InSearchMatrix, TConstArrayView<FPoseMatrixSection> InSections, const int32 InLeafSize = 0,
+		const int32 InMaxLevelCount = 4);
+
+	void Empty();
+
+	bool IsValid(const int32 InAtomCount, TConstArrayView<FPoseMatrixSection> InSections) const;
+
+	int32 GetGroupStride() const { return AtomCount * BranchFactor * 2; }
+
+	const float* GetGroupExtents(const int32 GroupIndex) const;
+
+	/** Computes an order of the poses of every section in which poses with similar features are next to each other (the leaf
+	 * order of a KD-tree over the section). OutOrder[NewPoseIndex] is the current index of the pose. Poses stay within
+	 * their section so that the motion tag sections are still valid after re-ordering. */
+	static void ComputeSpatialOrder(const FPoseMatrix& InSearchMatrix, TConstArrayView<FPoseMatrixSection> InSections,
+		TArray<int32>& OutOrder);
+
+private:
+	void AddSection(const FPoseMatrix& InSearchMatrix, const int32 InStartIndex, const int32 InEndIndex, const int32 InLeafSize,
+		const int32 InMaxLevelCount);
+
+	static int32 SelectLeafSize(const FPoseMatrix& InSearchMatrix, const int32 InStartIndex, const int32 InEndIndex,
+		const int32 InMaxLevelCount);
+};
@@ -0,0 +1,82 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Enumerations/EMotionMatchingEnums.h"
+#include "PoseHotTable.generated.h"
+
+struct FPoseMotionData;
+
+/** A structure of arrays copy of the pose data that motion matching reads every update (animation, time, sequencing and
+ * flags), indexed by pose id. The full FPoseMotionData array remains the authoring data for everything else, e.g. the
+ * blend space position and the motion tags. Rather than a tag container per pose, the table stores the index of the
+ * motion tag section (i.e. the MotionTagList entry) of each pose, so checking the tags of a pose does not touch the
+ * tag containers at all. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FPoseHotTable
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	TArray<int32> AnimIds;
+
+	UPROPERTY()
+	TArray<float> Times;
+
+	UPROPERTY()
+	TArray<int32> NextPoseIds;
+
+	UPROPERTY()
+	TArray<int32> LastPoseIds;
+
+	/** The search flag (bits 0-1), the anim asset type (bits 2-3) and the mirror flag (bit 4) of each pose */
+	UPROPERTY()
+	TArray<uint8> Flags;
+
+	/** The index of the motion tag section of each pose, or InvalidTagSection if the tags are not in the tag list */
+	UPROPERTY()
+	TArray<uint16> TagSectionIndices;
+
+	static constexpr uint8 SearchFlagMask = 0x03;
+	static constexpr uint8 AnimTypeShift = 2;
+	static constexpr uint8 AnimTypeMask = 0x0C;
+	static constexpr uint8 MirroredBit = 0x10;
+	static constexpr uint16 InvalidTagSection = MAX_uint16;
+
+public:
+	void Build(TConstArrayView<FPoseMotionData> InPoses, TConstArrayView<FGameplayTagContainer> InMotionTagList);
+	void Empty();
+	bool IsValid(const int32 InPoseCount) const;
+	int32 Num() const { return AnimIds.Num(); }
+
+	FORCEINLINE EPoseSearchFlag GetSearchFlag(const int32 PoseId) const
+	{
+		return static_cast<EPoseSearchFlag>(Flags[PoseId] & SearchFlagMask);
+	}
+
+	FORCEINLINE EMotionAnimAssetType GetAnimType(const int32 PoseId) const
+	{
+		return static_cast<EMotionAnimAssetType>((Flags[PoseId] & AnimTypeMask) >> AnimTypeShift);
+	}
+
+	FORCEINLINE bool IsMirrored(const int32 PoseId) const
+	{
+		return (Flags[PoseId] & MirroredBit) != 0;
+	}
+
+	FORCEINLINE int32 GetTagSectionIndex(const int32 PoseId) const
+	{
+		const uint16 SectionIndex = TagSectionIndices[PoseId];
+		return SectionIndex == InvalidTagSection ? INDEX_NONE : SectionIndex;
+	}
+
+	/** Returns true if the pose plays the same animation (id, type and mirror) as the other pose */
+	FORCEINLINE bool IsSameAnim(const int32 PoseId, const int32 OtherPoseId) const
+	{
+		return AnimIds[PoseId] == AnimIds[OtherPoseId]
+			&& ((Flags[PoseId] ^ Flags[OtherPoseId]) & (AnimTypeMask | MirroredBit)) == 0;
+	}
+};
@@ -0,0 +1,67 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PoseLookupTable.generated.h"
+
+struct FPoseMatrix;
+struct FPoseMatrixSection;
+struct FCalibrationData;
+class UMotionMatchConfig;
+
+/** A pre-computed table of pose candidates to search from any current pose. This is a rewrite of the pose lookup table
+ * (multi-clustering) optimisation of earlier Motion Symphony versions for the flat pose matrices.
+ *
+ * For each motion tag section, the searchable poses are clustered twice with k-means: once by their response features
+ * (e.g. trajectory), which groups poses by the motion they lead into, and once by their quality features (e.g. bone
+ * locations and velocities), which groups poses that look alike. Each quality cluster gets a candidate set containing
+ * the best matching pose of every response cluster for the cluster center and a few of its members. At runtime only the
+ * candidate set of the current pose's quality cluster needs to be searched, since it contains a good continuation for
+ * any desired response. Candidate sets are stored as contiguous pose id lists in a single flat array. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FPoseLookupTable
+{
+	GENERATED_BODY()
+
+public:
+	/** The search structure hash of the motion data when the table was built. The table refers to search matrix pose ids
+	 * so it is stale if the search structures have been rebuilt since */
+	UPROPERTY()
+	uint32 SourceSearchStructureHash;
+
+	/** The number of poses in the pose database (lookup matrix) when the table was built */
+	UPROPERTY()
+	int32 DatabasePoseCount;
+
+	/** The candidate set of each database pose for each section, indexed [SectionIndex * DatabasePoseCount + PoseId].
+	 * INDEX_NONE if the section has no searchable poses */
+	UPROPERTY()
+	TArray<int32> PoseCandidateSets;
+
+	/** The start of each candidate set within CandidateIndices, with an additional entry for the end of the last set */
+	UPROPERTY()
+	TArray<int32> CandidateSetOffsets;
+
+	/** The search pose matrix pose ids of all candidate sets, ascending within each set */
+	UPROPERTY()
+	TArray<int32> CandidateIndices;
+
+public:
+	FPoseLookupTable();
+
+	/** Builds the table. InSectionWeights are the final calibration weights of each section (one per feature atom) and the
+	 * config is used to tell quality from response atoms. The build runs in parallel and may take a while for large data */
+	void Build(const uint32 InSearchStructureHash, const FPoseMatrix& InLookupMatrix, const FPoseMatrix& InSearchMatrix,
+		TConstArrayView<FPoseMatrixSection> InSections, TConstArrayView<FCalibrationData> InSectionWeights,
+		const UMotionMatchConfig* InMMConfig, const int32 InResponseClusterCount, const int32 InCandidateSetCount);
+
+	void Empty();
+
+	bool IsValid(const uint32 InSearchStructureHash, const int32 InDatabasePoseCount, const int32 InSectionCount) const;
+
+	/** Returns the candidates (search matrix pose ids) to search from a current pose (database pose id) within a section */
+	TConstArrayView<int32> GetCandidates(const int32 SectionIndex, const int32 DatabasePoseId) const;
+
+	int32 GetCandidateSetCount() const;
+};
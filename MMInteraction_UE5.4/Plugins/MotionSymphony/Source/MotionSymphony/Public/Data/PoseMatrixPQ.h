@@ -0,0 +1,71 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PoseMatrixPQ.generated.h"
+
+struct FPoseMatrix;
+
+/** A product quantized copy of a search pose matrix. The feature atoms of each pose (i.e. excluding the pose favour) are
+ * split into subspaces of SubspaceSize consecutive atoms and each subspace of each pose is replaced by the 8-bit index
+ * of the closest of up to 256 centroids learned for that subspace. A pose is then only SubspaceCount bytes instead of
+ * AtomCount floats so a coarse search over the codes touches a fraction of the memory of a full search.
+ *
+ * The coarse cost of a pose is computed with asymmetric distances: the query is not quantized, instead a table of the
+ * weighted cost of every centroid of every subspace is computed once per search (see ComputeDistanceTable) and the
+ * cost of a pose is the sum of one table lookup per subspace. The coarse cost is approximate so the best coarse
+ * candidates should be re-ranked against the full precision rows. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FPoseMatrixPQ
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	int32 AtomCount;
+
+	UPROPERTY()
+	int32 PoseCount;
+
+	/** The number of atoms per subspace. The last subspace may be smaller */
+	UPROPERTY()
+	int32 SubspaceSize;
+
+	/** The number of centroids per subspace (at most 256) */
+	UPROPERTY()
+	int32 CentroidCount;
+
+	/** The centroids of every subspace, SubspaceSize floats per centroid (zero padded for the last subspace) and
+	 * CentroidCount centroids per subspace */
+	UPROPERTY()
+	TArray<float> Codebooks;
+
+	/** The centroid index of every subspace of every pose, SubspaceCount bytes per pose */
+	UPROPERTY()
+	TArray<uint8> Codes;
+
+	/** The pose favour of every pose so that the coarse search does not need to touch the full precision rows */
+	UPROPERTY()
+	TArray<float> PoseFavours;
+
+public:
+	FPoseMatrixPQ();
+
+	/** Learns the codebooks from the search matrix and encodes every pose. The centroids are trained with k-means in a
+	 * space normalized by the standard deviation of each atom so that every atom is quantized with a similar error */
+	void Build(const FPoseMatrix& InSearchMatrix, const int32 InSubspaceSize = 4);
+
+	void Empty();
+
+	bool IsValid(const int32 InAtomCount, const int32 InPoseCount) const;
+
+	int32 GetSubspaceCount() const;
+
+	/** Computes the weighted L1 cost of every centroid of every subspace against the query. OutDistanceTable must have room
+	 * for GetSubspaceCount() * CentroidCount floats */
+	void ComputeDistanceTable(const float* QueryPoseArray, const float* CalibrationArray, float* OutDistanceTable) const;
+
+	/** Returns the approximate cost of a pose (excluding the pose favour) from a distance table */
+	float ComputeCoarseCost(const int32 PoseIndex, const float* DistanceTable) const;
+};
@@ -0,0 +1,84 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PoseSearchTree.generated.h"
+
+struct FPoseMatrix;
+struct FPoseMatrixSection;
+
+/** A single node of a pose search tree. Leaf nodes reference a contiguous range of the tree's pose index array while
+ * branch nodes always have exactly two children which are stored next to each other in the node array. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FPoseSearchTreeNode
+{
+	GENERATED_BODY()
+
+public:
+	/** The index of the first of the two child nodes or INDEX_NONE if this node is a leaf */
+	UPROPERTY()
+	int32 ChildIndex;
+
+	/** The range of the pose index array covered by this node */
+	UPROPERTY()
+	int32 StartIndex;
+
+	UPROPERTY()
+	int32 PoseCount;
+
+public:
+	FPoseSearchTreeNode();
+	FPoseSearchTreeNode(int32 InStartIndex, int32 InPoseCount);
+
+	bool IsLeaf() const { return ChildIndex == INDEX_NONE; }
+};
+
+/** A KD-tree over the search pose matrix with one root per motion tag section. Unlike the outer and inner AABB matrices,
+ * which bound fixed blocks of poses in database order, the tree groups poses which are close in feature space so that
+ * pruning does not depend on how the source animations happen to be laid out. Every node stores the AABB of its poses
+ * (including the pose favour atom) so that the tree can be searched with any calibration weights at runtime. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FPoseSearchTree
+{
+	GENERATED_BODY()
+
+public:
+	/** The number of atoms per pose that the tree was built with */
+	UPROPERTY()
+	int32 AtomCount;
+
+	UPROPERTY()
+	TArray<FPoseSearchTreeNode> Nodes;
+
+	/** The interleaved min / max extents of every node, AtomCount * 2 floats per node in the same order as Nodes */
+	UPROPERTY()
+	TArray<float> ExtentsArray;
+
+	/** Search pose matrix pose ids, ordered so that the poses of every node are contiguous */
+	UPROPERTY()
+	TArray<int32> PoseIndices;
+
+	/** The root node of each motion tag section or INDEX_NONE if the section has no poses */
+	UPROPERTY()
+	TArray<int32> SectionRootNodes;
+
+public:
+	FPoseSearchTree();
+
+	/** Builds the tree over each section of the search matrix. Nodes are split at the median of the atom with the
+	 * largest spread relative to its spread over the whole section, until they contain no more than InLeafSize poses */
+	void Build(const FPoseMatrix& InSearchMatrix, TConstArrayView<FPoseMatrixSection> InSections, const int32 InLeafSize = 16);
+
+	void Empty();
+
+	/** Returns true if the tree was built for a search matrix with this atom count and number of sections */
+	bool IsValid(const int32 InAtomCount, const int32 InSectionCount) const;
+
+	int32 GetSectionRootNode(const int32 SectionIndex) const;
+	const float* GetNodeExtents(const int32 NodeIndex) const;
+
+private:
+	int32 AddNode(const FPoseMatrix& InSearchMatrix, const int32 InStartIndex, const int32 InPoseCount);
+	void SplitNode(const FPoseMatrix& InSearchMatrix, const int32 NodeIndex, const float* SectionExtents, const int32 InLeafSize);
+};
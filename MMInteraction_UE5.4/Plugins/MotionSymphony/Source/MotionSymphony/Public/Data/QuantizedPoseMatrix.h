@@ -0,0 +1,86 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Enumerations/EMotionMatchingEnums.h"
+#include "QuantizedPoseMatrix.generated.h"
+
+struct FPoseMatrix;
+
+/** Storage traits of the quantized pose matrix types. Stored values are normalized and are decoded with
+ * Offset + Scale * Decode(Value) using the per column offset and scale of the matrix. */
+template<typename StorageType>
+struct TPoseMatrixStorage;
+
+template<>
+struct TPoseMatrixStorage<uint8>
+{
+	static constexpr EPoseMatrixPrecision Precision = EPoseMatrixPrecision::Int8;
+	static float Decode(const uint8 Value) { return static_cast<float>(Value); }
+};
+
+template<>
+struct TPoseMatrixStorage<FFloat16>
+{
+	static constexpr EPoseMatrixPrecision Precision = EPoseMatrixPrecision::Half;
+	static float Decode(const FFloat16 Value) { return Value.GetFloat(); }
+};
+
+/** A reduced precision copy of a row major float matrix (e.g. the search pose matrix or AABB extents). Every column
+ * (atom) has its own offset and scale derived from the range of that column so that the full precision of the storage
+ * type is used for every atom regardless of its units. */
+USTRUCT()
+struct MOTIONSYMPHONY_API FQuantizedPoseMatrix
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	EPoseMatrixPrecision Precision;
+
+	UPROPERTY()
+	int32 ColumnCount;
+
+	UPROPERTY()
+	int32 RowCount;
+
+	UPROPERTY()
+	TArray<float> ColumnOffsets;
+
+	UPROPERTY()
+	TArray<float> ColumnScales;
+
+	/** The quantized values, RowCount * ColumnCount values of the storage type of the precision */
+	UPROPERTY()
+	TArray<uint8> Data;
+
+public:
+	FQuantizedPoseMatrix();
+
+	/** Computes the per atom offset and scale to quantize the pose matrix with from the range of each atom */
+	static void ComputeAtomQuantization(const FPoseMatrix& InPoseMatrix, const EPoseMatrixPrecision InPrecision,
+		TArray<float>& OutOffsets, TArray<float>& OutScales);
+
+	/** Quantizes a row major matrix. Values are rounded to the nearest representable value, unless bInConservativeExtents
+	 * is true in which case the values are interleaved min / max extents and even columns are rounded down and odd columns
+	 * are rounded up, so that the decoded extents always contain the source extents. */
+	void Quantize(TConstArrayView<float> InValues, const int32 InColumnCount, const EPoseMatrixPrecision InPrecision,
+		TConstArrayView<float> InColumnOffsets, TConstArrayView<float> InColumnScales, const bool bInConservativeExtents);
+
+	/** Decodes the whole matrix back into floats */
+	void Dequantize(TArray<float>& OutValues) const;
+
+	void Empty();
+
+	bool IsValid(const EPoseMatrixPrecision InPrecision, const int32 InColumnCount, const int32 InRowCount) const;
+
+	template<typename StorageType>
+	const StorageType* GetData() const
+	{
+		check(TPoseMatrixStorage<StorageType>::Precision == Precision);
+		return reinterpret_cast<const StorageType*>(Data.GetData());
+	}
+
+	float GetValue(const int32 Row, const int32 Column) const;
+};
@@ -0,0 +1,121 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "Enumerations/EMotionMatchingEnums.h"
+
+struct FAnimationBaseContext;
+struct FPoseSearchResult;
+class UMotionDataAsset;
+
+#define MOTIONSYMPHONY_TRACE_ENABLED (UE_TRACE_ENABLED && !IS_PROGRAM && !UE_BUILD_SHIPPING)
+
+DECLARE_STATS_GROUP(TEXT("MotionSymphony"), STATGROUP_MotionSymphony, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pose Search (Performance)"), STAT_MMPoseSearch_Performance, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pose Search (Quality)"), STAT_MMPoseSearch_Quality, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pose Search (Brute)"), STAT_MMPoseSearch_Brute, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pose Search (Tree)"), STAT_MMPoseSearch_Tree, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pose Search (Candidate Lookup)"), STAT_MMPoseSearch_CandidateLookup, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Pose Search (Compressed)"), STAT_MMPoseSearch_Compressed, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Motion Data Pre-Process"), STAT_MMPreProcess, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pose Searches"), STAT_MMPoseSearches, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Poses Evaluated"), STAT_MMPosesEvaluated, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Outer AABBs Checked"), STAT_MMOuterAABBsChecked, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Outer AABBs Passed"), STAT_MMOuterAABBsPassed, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Inner AABBs Checked"), STAT_MMInnerAABBsChecked, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Inner AABBs Passed"), STAT_MMInnerAABBsPassed, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Next Natural Wins"), STAT_MMNextNaturalWins, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Tolerance Test Skips"), STAT_MMToleranceSkips, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Transitions"), STAT_MMTransitions, STATGROUP_MotionSymphony, MOTIONSYMPHONY_API);
+
+#if MOTIONSYMPHONY_TRACE_ENABLED
+UE_TRACE_CHANNEL_EXTERN(MotionSymphonyChannel, MOTIONSYMPHONY_API);
+#endif
+
+/** How the pose search of a motion matching update ended */
+enum class EMotionMatchingSearchOutcome : uint8
+{
+	None, //No search this update
+	ToleranceSkip, //The next pose passed the tolerance test so no search was run
+	Deferred, //The search was submitted as a batched or async search and is consumed next update
+	NextNatural, //The search chose the next natural pose
+	SamePose, //The search chose a pose at the same location of the playing animation
+	Transition //The search chose a new pose to transition to
+};
+
+/** The pose search of one motion matching update. This is accumulated by the node regardless of whether stats or the
+ * trace channel are enabled since it only costs a few integer adds per search */
+struct MOTIONSYMPHONY_API FMotionMatchingSearchTrace
+{
+	/** The game thread time of the search this update plus the worker time of any deferred search consumed this update */
+	uint64 SearchCycles;
+
+	/** The number of searches completed this update. Deferred searches are counted when their result is consumed */
+	int32 SearchCount;
+	int32 NaturalPoseId;
+	int32 PosesChecked;
+	int32 OuterAABBsChecked;
+	int32 OuterAABBsPassed;
+	int32 InnerAABBsChecked;
+	int32 InnerAABBsPassed;
+	EMotionMatchingSearchQuality Quality;
+	EMotionMatchingSearchOutcome Outcome;
+
+public:
+	FMotionMatchingSearchTrace();
+
+	void Reset(const EMotionMatchingSearchQuality InQuality);
+	void AddResult(const FPoseSearchResult& InSearchResult);
+
+	/** Adds a batched or async search, which was searched on a worker, to this update and to the cycle stat of its quality */
+	void AddDeferredSearch(const EMotionMatchingSearchQuality InQuality, const uint64 InSearchCycles);
+};
+
+/** The trace counters of one motion matching node. Counters are named after the anim instance and node id so that the
+ * Insights counters panel plots the search values of every node as separate tracks */
+struct MOTIONSYMPHONY_API FMotionMatchingNodeTraceCounters
+{
+#if MOTIONSYMPHONY_TRACE_ENABLED && COUNTERSTRACE_ENABLED
+	uint16 SearchTimeId = 0;
+	uint16 PosesEvaluatedId = 0;
+	uint16 OuterAABBPassRateId = 0;
+	uint16 InnerAABBPassRateId = 0;
+
+	/** Sets the counters of the node, registering them on first use. Only call this while the counters channel is enabled */
+	void Output(const FAnimationBaseContext& InContext, const FMotionMatchingSearchTrace& InSearch);
+#endif
+};
+
+/** Reports motion matching searches and pre-processing to the MotionSymphony stat group and trace channel */
+struct MOTIONSYMPHONY_API FMotionMatchingTrace
+{
+	/** Returns the cycle stat that searches of the passed quality are timed with */
+	static TStatId GetSearchStatId(const EMotionMatchingSearchQuality InQuality);
+
+	/** Adds the search to the frame counters and, if the trace channel is enabled, outputs a search event for the node.
+	 * The search values are also traced as node values and node counters so that they can be inspected and plotted per
+	 * node in Animation Insights */
+	static void OutputSearch(const FAnimationBaseContext& InContext, const FMotionMatchingSearchTrace& InSearch,
+		FMotionMatchingNodeTraceCounters& InOutCounters);
+
+	static void OutputPreProcess(const UMotionDataAsset* InMotionData, const uint64 InCycles);
+};
+
+#if MOTIONSYMPHONY_TRACE_ENABLED
+#define TRACE_MOTION_MATCHING_SEARCH(Context, Search, Counters) \
+	FMotionMatchingTrace::OutputSearch(Context, Search, Counters);
+
+#define TRACE_MOTION_DATA_PRE_PROCESS(MotionData, Cycles) \
+	FMotionMatchingTrace::OutputPreProcess(MotionData, Cycles);
+#else
+#define TRACE_MOTION_MATCHING_SEARCH(Context, Search, Counters) \
+	STAT(FMotionMatchingTrace::OutputSearch(Context, Search, Counters);)
+
+#define TRACE_MOTION_DATA_PRE_PROCESS(MotionData, Cycles)
+#endif
@@ -64,8 +64,45 @@ UENUM(BlueprintType)
 enum class EMotionMatchingSearchQuality : uint8
 {
 	Performance UMETA(ToolTip = "The standard motion matching search algorithm"),
-	Quality UMETA(DisplayName = "Quality (Experimental)", ToolTip = "Adds additional search complexity for better quality at a small performance cost. For this mode to work your Motion Config must contain two 'Bone Location and Velocity' featuers at the end of the list, preferably for the feet."),
-	Brute UMETA(ToolTip = "The brute motion matching search algorithm without any accelerator structure")
+	Quality UMETA(DisplayName = "Quality (Experimental)", ToolTip = "Searches in two stages for better quality at a small performance cost. The coarse match features of the Motion Config pick the best candidates which are then refined with the other match features and any refinement costs, e.g. the resultant velocity of 'Bone Location and Velocity' features."),
+	Brute UMETA(ToolTip = "The brute motion matching search algorithm without any accelerator structure"),
+	Tree UMETA(ToolTip = "The standard motion matching search algorithm but searching a KD-tree built over the pose data instead of the AABBs. This prunes better on large data sets with many different animations"),
+	CandidateLookup UMETA(ToolTip = "The standard motion matching search algorithm but only the pose candidates of the current pose are searched. This requires the motion data to be pre-processed with 'Generate Pose Lookup Table'"),
+	Compressed UMETA(ToolTip = "The standard motion matching search algorithm but searching the compressed pose data and only evaluating the best few poses at full precision. This requires the motion data to be pre-processed with 'Compress Search Matrix'")
+};
+
+/** The precision that the search pose matrix and AABB extents are searched at */
+UENUM(BlueprintType)
+enum class EPoseMatrixPrecision : uint8
+{
+	Float UMETA(ToolTip = "Search the full precision (32 bit) pose data"),
+	Half UMETA(ToolTip = "Search a 16 bit copy of the pose data. This halves the memory read by each search with very little loss of accuracy"),
+	Int8 UMETA(ToolTip = "Search an 8 bit copy of the pose data. This quarters the memory read by each search but costs are less accurate")
+};
+
+/** The order of the poses within each motion tag section of the search pose matrix */
+UENUM(BlueprintType)
+enum class EPoseMatrixOrder : uint8
+{
+	Animation UMETA(ToolTip = "Poses are kept in the order of the source animations"),
+	Spatial UMETA(ToolTip = "Poses are sorted so that poses with similar features are next to each other. This makes the AABBs tighter so that more poses are pruned during a search")
+};
+
+/** The memory layout of the search pose matrix */
+UENUM(BlueprintType)
+enum class ESearchMatrixLayout : uint8
+{
+	PoseMajor UMETA(ToolTip = "All atoms of a pose are stored together"),
+	FeatureMajor UMETA(ToolTip = "Each match feature is stored as its own block for all poses so that a search only reads the features of poses which can still beat the lowest cost")
+};
+
+/** Where the pose search of a motion matching node is run */
+UENUM(BlueprintType)
+enum class EPoseSearchDispatch : uint8
+{
+	Inline UMETA(ToolTip = "Search during the animation update of the node"),
+	Batched UMETA(ToolTip = "Submit the search to the world's search scheduler which searches the queries of all nodes sharing the same motion data together after the animation update of the frame. The result always arrives one frame late, or on the next update of the node if it skips updates. Only available in game and PIE worlds"),
+	Async UMETA(ToolTip = "Snapshot the query and search it on a worker task so that the search overlaps with other work. The result is used one frame later. Only available in game and PIE worlds")
 };
 
 /** An enumeration defining the different behaviour modes for trajectory generators */
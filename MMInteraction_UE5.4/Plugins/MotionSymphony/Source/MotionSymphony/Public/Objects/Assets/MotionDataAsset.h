@@ -8,6 +8,14 @@
 #include "Animation/BlendSpace.h"
 #include "Animation/AnimComposite.h"
 #include "Data/PoseMatrixAABB.h"
+#include "Data/PoseAABBHierarchy.h"
+#include "Data/FeatureMajorPoseMatrix.h"
+#include "Data/PoseSearchTree.h"
+#include "Data/PoseLookupTable.h"
+#include "Data/PoseMatrixPQ.h"
+#include "Data/QuantizedPoseMatrix.h"
+#include "Data/MotionTagSectionTable.h"
+#include "Data/PoseHotTable.h"
 #include "Enumerations/EMotionMatchingEnums.h"
 #include "Enumerations/EMMPreProcessEnums.h"
 #include "Data/PoseMotionData.h"
@@ -15,6 +23,7 @@
 #include "Data/MotionAnimAsset.h"
 #include "Objects/Assets/MotionMatchConfig.h"
 #include "Data/PoseMatrix.h"
+#include "Serialization/BulkData.h"
 #include "MotionDataAsset.generated.h"
 
 class UMotionAnimObject;
@@ -23,6 +32,34 @@ class UMotionSequenceObject;
 class UMotionBlendSpaceObject;
 class USkeleton;
 struct FAnimChannelState;
+struct FPoseSearchQuery;
+struct FPoseSearchResult;
+
+/** The range of pose ids [StartPoseId, EndPoseId) sampled from a single source animation (and mirror state) during
+ * pre-processing. */
+struct FMotionPreProcessRange
+{
+	EMotionAnimAssetType AnimType;
+	int32 AnimId;
+	bool bMirrored;
+	int32 StartPoseId;
+	int32 EndPoseId;
+
+	/** Hash of everything that the evaluated features of this range depend on (see ComputePreProcessRangeHash) */
+	uint32 ContentHash;
+
+	FMotionPreProcessRange(EMotionAnimAssetType InAnimType, int32 InAnimId, bool bInMirrored, int32 InStartPoseId, int32 InEndPoseId)
+		: AnimType(InAnimType), AnimId(InAnimId), bMirrored(bInMirrored), StartPoseId(InStartPoseId), EndPoseId(InEndPoseId), ContentHash(0) {}
+};
+
+/** A range of evaluated (but not yet tagged) pose rows kept from the last pre-process so that unchanged animations
+ * do not need to be evaluated again */
+struct FMotionPreProcessCachedRange
+{
+	uint32 ContentHash;
+	int32 StartPoseId;
+	int32 PoseCount;
+};
 
 /** This is a custom animation asset used for pre-processing and storing motion matching animation data.
  * It is used as the source asset to 'play' with the 'Motion Matching' animation node and is part of the
@@ -55,6 +92,80 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Motion Matching|Mirroring")
 	TObjectPtr<UMirrorDataTable> MirrorDataTable = nullptr;
 
+	/** If true, the pre-process stage will order the match features of each motion trait field so that the features
+	which are expected to contribute the most cost are evaluated first during a pose search. This allows poses to be
+	rejected earlier but the pose costs may differ from the unordered costs in the last few bits.*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	bool bOptimizeFeatureEvaluationOrder = false;
+
+	/** If true, the search pose matrix, AABB extents and pose remap are cooked into separate memory mapped bulk data
+	streams rather than property arrays. The streams are mapped directly from the cooked package and shared by every
+	user of the asset which reduces load time and resident memory for large motion libraries.*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	bool bUseBulkSearchData = false;
+
+	/** If true, the pre-process stage clusters the poses and builds a lookup table of pose candidates for every current pose.
+	The 'Candidate Lookup' search quality then only searches the candidates of the current pose which is much faster for large
+	data sets, but the chosen pose may not always be the lowest cost pose. This can take a while to pre-process.*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	bool bGeneratePoseLookupTable = false;
+
+	/** The number of clusters of poses with similar response features (e.g. trajectory). Every candidate set contains up to
+	one pose per response cluster for its center and each of a few of its members, so more clusters give better results
+	at the cost of larger candidate sets*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation", meta = (ClampMin = 1, EditCondition = "bGeneratePoseLookupTable"))
+	int32 LookupTableResponseClusters = 32;
+
+	/** The number of candidate sets per motion trait field, i.e. the number of clusters of poses with similar quality
+	features (e.g. bone locations and velocities)*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation", meta = (ClampMin = 1, EditCondition = "bGeneratePoseLookupTable"))
+	int32 LookupTableCandidateSets = 64;
+
+	/** If true, a product quantized copy of the search pose matrix is generated which the 'Compressed' search quality
+	searches instead of the full precision poses. Only the best few poses of the compressed search are evaluated at full
+	precision which greatly reduces the memory read by each search for large data sets.*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	bool bCompressSearchMatrix = false;
+
+	/** The number of atoms compressed into each byte of a compressed pose. Smaller values give more accurate compressed
+	costs at the cost of more memory*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation", meta = (ClampMin = 1, ClampMax = 16, EditCondition = "bCompressSearchMatrix"))
+	int32 CompressedSubspaceSize = 4;
+
+	/** The precision that the search pose matrix and AABB extents are searched at by every search quality. Lower precisions
+	read less memory per search which makes searching faster for large data sets at the cost of slightly less accurate pose
+	costs. Cooked data with a reduced precision only contains the quantized pose rows and AABB extents*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	EPoseMatrixPrecision SearchMatrixPrecision = EPoseMatrixPrecision::Float;
+
+	/** The order of the poses within each motion tag section of the search pose matrix. Spatial ordering groups similar
+	poses together which makes the AABBs of every search structure tighter*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	EPoseMatrixOrder SearchPoseOrder = EPoseMatrixOrder::Animation;
+
+	/** The memory layout that the standard and brute force searches read the search pose matrix in. With a feature major
+	layout, each match feature is evaluated for a block of poses at a time (responsiveness features first, or in the
+	optimised feature evaluation order) and poses which can no longer win are dropped before their other features are read.
+	The feature major layout is only used at full precision (i.e. it is not generated if SearchMatrixPrecision is reduced)*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	ESearchMatrixLayout SearchMatrixLayout = ESearchMatrixLayout::PoseMajor;
+
+	/** If true, a multi-level AABB hierarchy is generated for every motion tag section and is searched instead of the fixed
+	outer and inner AABBs. The hierarchy is only generated and searched at full precision (i.e. not if SearchMatrixPrecision
+	is reduced)*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation")
+	bool bGenerateAABBHierarchy = false;
+
+	/** The number of poses bounded by each box of the lowest level of the AABB hierarchy. If 0, the size is chosen for
+	each motion tag section by simulating searches with a few different sizes*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation", meta = (ClampMin = 0, ClampMax = 256, EditCondition = "bGenerateAABBHierarchy"))
+	int32 AABBHierarchyLeafSize = 0;
+
+	/** The maximum number of levels of the AABB hierarchy of each motion tag section. Each level has 4 times fewer boxes
+	than the level below it*/
+	UPROPERTY(EditAnywhere, Category = "Motion Matching|Optimisation", meta = (ClampMin = 1, ClampMax = 8, EditCondition = "bGenerateAABBHierarchy"))
+	int32 AABBHierarchyMaxLevels = 4;
+
 	/** Has the Motion Data been processed before the last time it's data was changed*/
 	UPROPERTY()
 	bool bIsProcessed;
@@ -86,10 +197,15 @@ public:
 	UPROPERTY()
 	TArray<int32> PoseIdRemap;
 
-	/** Remaps the pose Id in the pose array to the pose id in the pose database. This is the reverse of
-	 * PoseIdRemap so that remaps can be done in both directions */
+	/** Remaps the pose Id in the pose database to the pose id in the search pose matrix. This is the reverse of
+	 * PoseIdRemap so that remaps can be done in both directions. There is one entry per pose in the database and
+	 * poses which are not searchable are INDEX_NONE */
+	UPROPERTY()
+	TArray<int32> DensePoseIdRemapReverse;
+
+	/** Legacy sparse reverse remap. This is converted to DensePoseIdRemapReverse on load */
 	UPROPERTY()
-	TMap<int32, int32> PoseIdRemapReverse;
+	TMap<int32, int32> PoseIdRemapReverse_DEPRECATED;
 
 	UPROPERTY()
 	TArray<FGameplayTagContainer> MotionTagList;
@@ -97,30 +213,122 @@ public:
 	UPROPERTY()
 	TArray<FPoseMatrixSection> MotionTagMatrixSections;
 
+	/** The motion tag list compiled into bitmasks so that required motion tags are resolved to motion tag sections without
+	comparing tag containers*/
+	UPROPERTY()
+	FMotionTagSectionTable MotionTagSectionTable;
+
 	/**Map of calibration data for normalizing all atoms. This stores the standard deviation of all atoms throughout the data set
 	but separates them via motion trait. There is one feature standard deviation per motion trait field. */
 	UPROPERTY()
 	TArray<FCalibrationData> FeatureStandardDeviations;
+
+	/** The final calibration weights of each motion trait field (config default weights and default quality vs responsiveness
+	ratio combined with the feature standard deviations). These are generated on pre-process so that motion matching nodes
+	do not need to regenerate them at runtime*/
+	UPROPERTY()
+	TArray<FCalibrationData> FinalCalibrationWeights;
+
+	/** A hash of the config calibration settings that the final calibration weights were generated with*/
+	UPROPERTY()
+	uint32 FinalCalibrationConfigHash = 0;
+
+	/** The order to evaluate match features in during a pose search, one per motion trait field. This is only generated
+	if bOptimizeFeatureEvaluationOrder is true*/
+	UPROPERTY()
+	TArray<FFeatureEvaluationOrder> FeatureEvaluationOrders;
 	
 	/** A list of all poses generated during the pre-process stage. Each pose contains information
 	about an animation frame within the animation data set.*/
 	UPROPERTY()
 	TArray<FPoseMotionData> Poses;
+
+	/** The per pose data read by motion matching every update, split from the Poses array into a structure of arrays*/
+	UPROPERTY()
+	FPoseHotTable PoseHotTable;
 	
 	/** The pose matrix, all pose data represented in a single linear array of floats*/
 	UPROPERTY()
 	FPoseMatrix LookupPoseMatrix;
 
 	/** An AABB data structure used to assist with searching through the pose matrix*/
-	UPROPERTY(Transient)
+	UPROPERTY()
 	FPoseAABBMatrix PoseAABBMatrix_Outer;
 
-	UPROPERTY(Transient)
+	UPROPERTY()
 	FPoseAABBMatrix PoseAABBMatrix_Inner;
+
+	/** A multi-level AABB hierarchy over the search pose matrix. This is only generated if bGenerateAABBHierarchy is true
+	and the SearchMatrixPrecision is Float*/
+	UPROPERTY()
+	FPoseAABBHierarchy AABBHierarchy;
+
+	/** A feature major copy of the search pose matrix. This is only generated if the SearchMatrixLayout is FeatureMajor*/
+	UPROPERTY()
+	FFeatureMajorPoseMatrix FeatureMajorSearchMatrix;
 	
 	/** The searchable pose matrix, contains only pose data that is searchable with flagged poses removed*/
-	UPROPERTY(Transient)
+	UPROPERTY()
 	FPoseMatrix SearchPoseMatrix;
+
+	/** A KD-tree over the search pose matrix with one root per motion tag section. This is used by the 'Tree' search quality
+	as an alternative to the AABB matrices which works better for large data sets with many different animations*/
+	UPROPERTY()
+	FPoseSearchTree SearchTree;
+
+	/** The candidate poses to search from each current pose, used by the 'Candidate Lookup' search quality. This is only
+	generated if bGeneratePoseLookupTable is true*/
+	UPROPERTY()
+	FPoseLookupTable PoseLookupTable;
+
+	/** The product quantized search pose matrix used by the 'Compressed' search quality. This is only generated if
+	bCompressSearchMatrix is true*/
+	UPROPERTY()
+	FPoseMatrixPQ SearchMatrixPQ;
+
+	/** Reduced precision copies of the search pose matrix and AABB extents. These are only generated if the
+	SearchMatrixPrecision is not Float, in which case they replace the full precision data in cooked builds*/
+	UPROPERTY()
+	FQuantizedPoseMatrix QuantizedSearchPoseMatrix;
+
+	UPROPERTY()
+	FQuantizedPoseMatrix QuantizedOuterAABBExtents;
+
+	UPROPERTY()
+	FQuantizedPoseMatrix QuantizedInnerAABBExtents;
+
+	/** A hash of the data that the search structures (search pose matrix and AABBs) were generated from. This is only
+	computed when the search structures are generated and is used to detect out of date pose lookup tables*/
+	UPROPERTY()
+	uint32 SearchStructureHash = 0;
+
+	/** A cheap hash of the config and counts that the search structures were generated with. If this does not match on
+	load, the search structures are out of date and are rebuilt in PostLoad*/
+	UPROPERTY()
+	uint32 SearchStructureConfigHash = 0;
+
+private:
+	/** Bulk data streams for the search structures. These are only used by cooked data when bUseBulkSearchData is true*/
+	FByteBulkData SearchPoseBulkData;
+	FByteBulkData AABBExtentsBulkData;
+	FByteBulkData PoseRemapBulkData;
+
+	/** Views of the locked bulk data streams. These are empty if the search structures are held in property arrays*/
+	TConstArrayView<float> SearchPoseBulkView;
+	TConstArrayView<float> OuterAABBBulkView;
+	TConstArrayView<float> InnerAABBBulkView;
+	TConstArrayView<int32> PoseIdRemapBulkView;
+	TConstArrayView<int32> PoseIdRemapReverseBulkView;
+
+	/** The final calibration weights of every motion trait field copied into a single aligned buffer with each set padded
+	to a multiple of 4 floats. Searches read weights straight from this buffer so switching motion tags is a pointer swap*/
+	TArray<float, TAlignedHeapAllocator<16>> SectionCalibrationBuffer;
+	int32 SectionCalibrationStride = 0;
+
+	/** Incremented whenever SectionCalibrationBuffer is rebuilt so that users of the weights know to look them up again*/
+	uint32 SectionCalibrationSerial = 0;
+
+public:
 	
 #if WITH_EDITORONLY_DATA
 	UPROPERTY(Transient)
@@ -132,6 +340,13 @@ public:
 	int32 AnimPreviewIndex;
 
 	EMotionAnimAssetType AnimMetaPreviewType;
+
+private:
+	/** Evaluated pose rows from the last pre-process before tags were applied, used for incremental re-processing. This is
+	 * not saved so the first pre-process after loading the asset always evaluates every pose. */
+	TArray<FMotionPreProcessCachedRange> PreProcessCacheRanges;
+	TArray<float> PreProcessCachePoseArray;
+	int32 PreProcessCacheAtomCount = 0;
 #endif
 
 public:
@@ -168,6 +383,7 @@ public:
 	//General
 	bool CheckValidForPreProcess() const;
 	void PreProcess();
+	void GenerateSearchData(); //Generates the tag sections, search structures and calibration from the evaluated poses and LookupPoseMatrix
 	void ClearPoses();
 	bool IsSetupValid();
 	bool AreSequencesValid();
@@ -178,13 +394,47 @@ public:
 	int32 GetMotionTagEndPoseIndex(const FGameplayTagContainer& MotionTags) const;
 	void GetMotionTagStartAndEndPoseIndex(const FGameplayTagContainer& MotionTags, int32& OutStartIndex, int32& OutEndIndex) const;
 	void FindMotionTagRangeIndices(const FGameplayTagContainer& MotionTags, int32& OutStartIndex, int32& OutEndIndex) const;
+	FMotionTagSectionMatch ResolveMotionTags(const FGameplayTagContainer& MotionTags) const;
+	void GetMotionTagSectionRange(const int32 SectionIndex, int32& OutStartIndex, int32& OutEndIndex) const;
+	void SearchPoseBatch(TConstArrayView<FPoseSearchQuery> Queries, TArrayView<FPoseSearchResult> InOutResults) const; //One pass over the AABBs for all queries
 	int32 MatrixPoseIdToDatabasePoseId(int32 MatrixPoseId) const;
 	int32 DatabasePoseIdToMatrixPoseId(int32 DatabasePoseId) const;
 	bool IsSearchPoseMatrixGenerated() const;
+	bool IsSearchTreeValid() const;
+	bool IsPoseLookupTableValid() const;
+	bool IsSearchMatrixPQValid() const;
+	bool IsQuantizedSearchDataValid() const;
+	bool IsAABBHierarchyValid() const;
+	bool IsFeatureMajorSearchMatrixValid() const;
+	bool IsPoseHotTableValid() const;
+	bool AreFinalCalibrationWeightsValid() const;
+	uint32 ComputeCalibrationConfigHash() const;
+	void GenerateFinalCalibrationWeights();
+	const float* GetSectionCalibrationWeights(const int32 SectionIndex) const; //Returns nullptr if the section has no weights
+	uint32 GetSectionCalibrationSerial() const { return SectionCalibrationSerial; }
+	void ReorderSearchPoseMatrix();
+	void GenerateQuantizedSearchData();
+	int32 GetMotionTagSectionIndex(const int32 StartPoseIndex, const int32 EndPoseIndex) const;
+	bool HasBulkSearchData() const;
+	bool IsFullPrecisionSearchDataStripped() const; //True for cooked data with a reduced SearchMatrixPrecision
+
+	//Search structure accessors. These should be used instead of the property arrays since the data may be in bulk data
+	TConstArrayView<float> GetSearchPoseArray() const;
+	TConstArrayView<float> GetOuterAABBExtents() const;
+	TConstArrayView<float> GetInnerAABBExtents() const;
+	TConstArrayView<int32> GetPoseIdRemap() const;
+	TConstArrayView<int32> GetPoseIdRemapReverse() const;
+	uint32 ComputeSearchStructureHash() const;
+	uint32 ComputeSearchStructureConfigHash() const;
+	bool AreSearchStructuresValid() const;
+	void ValidateSearchStructures(); //Rebuilds the search structures only if they are missing or out of date
 	
 	
 	/** UObject Interface*/
 	virtual void PostLoad() override;
+	virtual bool IsPostLoadThreadSafe() const override;
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+	virtual void BeginDestroy() override;
 	/** End UObject Interface*/
 
 	/** UAnimationAsset interface */
@@ -229,13 +479,45 @@ public:
 private:
 	void AddAnimNotifiesToNotifyQueue(FAnimNotifyQueue& NotifyQueue, TArray<FAnimNotifyEventReference>& Notifies, float InstanceWeight) const;
 
-	/** Calculates the Atom count per pose and total pose count and then zero fills the pose matrix to fit all poses*/
+	/** Calculates the Atom count per pose and then zero fills the pose matrix to fit all sampled poses*/
 	void InitializePoseMatrix();
 
-	void PreProcessAnim(const int32 SourceAnimIndex, const bool bMirror = false);
-	void PreProcessBlendSpace(const int32 SourceBlendSpaceIndex, const bool bMirror = false);
-	void PreProcessComposite(const int32 SourceCompositeIndex, const bool bMirror = false);
+	/** Samples the poses (time, flags and tags) of a source animation and assigns them pose ids. Features are not evaluated here*/
+	void PreProcessAnim(const int32 SourceAnimIndex, const bool bMirror, TArray<FMotionPreProcessRange>& OutRanges);
+	void PreProcessBlendSpace(const int32 SourceBlendSpaceIndex, const bool bMirror, TArray<FMotionPreProcessRange>& OutRanges);
+	void PreProcessComposite(const int32 SourceCompositeIndex, const bool bMirror, TArray<FMotionPreProcessRange>& OutRanges);
+
+	/** Evaluates the pose favour and match features of a sampled pose into its row of the lookup pose matrix. Only that
+	 * row is written so this can be called in parallel for different poses*/
+	void EvaluatePoseFeatures(const int32 PoseId);
+
+	/** Applies the tags of a source animation to its sampled range of poses. Must be called after features are evaluated*/
+	void PreProcessAnimTags(const FMotionPreProcessRange& Range);
+	void PreProcessBlendSpaceTags(const FMotionPreProcessRange& Range);
+	void PreProcessCompositeTags(const FMotionPreProcessRange& Range);
+
+	/** Hash of the asset wide settings that every evaluated pose depends on (pose interval, mirroring and config) */
+	uint32 ComputePreProcessConfigHash() const;
+
+	/** Hash of the source animation, its settings and tags and the config hash for a sampled range of poses */
+	uint32 ComputePreProcessRangeHash(const FMotionPreProcessRange& Range, const uint32 ConfigHash) const;
+
+	/** Copies the evaluated rows of every range whose content hash matches the last pre-process into the lookup pose
+	 * matrix and outputs the ids of all poses that still need to be evaluated */
+	void RestorePreProcessCache(TArray<FMotionPreProcessRange>& Ranges, TArray<int32>& OutDirtyPoseIds);
+	void StorePreProcessCache(const TArray<FMotionPreProcessRange>& Ranges);
 	void GeneratePoseSequencing();
 	void MarkEdgePoses(float InMaxAnimBlendTime);
+
+	/** Builds the pose lookup table from the search structures and final calibration weights if bGeneratePoseLookupTable is set */
+	void GeneratePoseLookupTable();
+
+	/** Post-loads and initializes the motion match config so that its Features can be read */
+	void InitializeMotionMatchConfig();
+
+	void CacheSectionCalibrationBuffer();
+	void SerializeBulkSearchData(FArchive& Ar, const bool bSaveBulkSearchData);
+	void LockBulkSearchData();
+	void ReleaseBulkSearchData();
 	
 };
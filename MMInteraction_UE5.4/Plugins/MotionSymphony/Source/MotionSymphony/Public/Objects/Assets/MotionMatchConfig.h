@@ -79,4 +79,8 @@ public:
 	
 	int32 ComputeResponseArraySize();
 	int32 ComputeQualityArraySize();
+
+#if WITH_EDITORONLY_DATA
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
 };
\ No newline at end of file
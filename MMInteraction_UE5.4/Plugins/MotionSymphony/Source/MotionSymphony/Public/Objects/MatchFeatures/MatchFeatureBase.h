@@ -25,6 +25,15 @@ enum class EPoseCategory : uint8
 	Responsiveness
 };
 
+/** The stage of the 'Quality' search that a match feature is evaluated in */
+UENUM()
+enum class EMatchFeatureSearchStage : uint8
+{
+	Auto UMETA(ToolTip = "Response features are evaluated in the coarse stage and quality features in the refinement stage"),
+	Coarse UMETA(ToolTip = "Evaluated for every pose that is searched to pick the candidates for the refinement stage"),
+	Refine UMETA(ToolTip = "Only evaluated for the best candidates of the coarse stage")
+};
+
 UENUM()
 enum class EFeatureName : uint8
 {
@@ -57,6 +66,12 @@ public:
 
 	UPROPERTY();
 	EPoseCategory PoseCategory;
+
+	/** The stage of the 'Quality' search that this feature is evaluated in. Cheap features which discriminate well
+	 * between poses (e.g. trajectory) should be coarse so that the expensive features are only evaluated for the best
+	 * candidates. */
+	UPROPERTY(EditAnywhere, Category = "Match Feature")
+	EMatchFeatureSearchStage SearchStage;
 	
 
 public:
@@ -99,6 +114,21 @@ public:
 	virtual bool CanBeQualityFeature() const;
 	virtual bool CanBeResponseFeature() const;
 
+	/** Returns the 'Quality' search stage of the feature with 'Auto' resolved from the pose category */
+	EMatchFeatureSearchStage GetResolvedSearchStage() const;
+
+	/** Returns true if the feature adds a cost on top of its weighted distance in the refinement stage of the 'Quality'
+	 * search. If so, ComputeRefinementCost is called for every refined candidate */
+	virtual bool HasRefinementCost() const;
+
+	/** Computes the additional refinement cost of a candidate pose. The arrays point to the first atom of the feature in
+	 * the query and candidate pose arrays and to the calibration weights of those atoms */
+	virtual float ComputeRefinementCost(const float* QueryFeature, const float* PoseFeature, const float* FeatureWeights,
+		const float DeltaTime) const;
+
+	/** Returns the multiplier of the refinement cost of this feature in the passed config */
+	virtual float GetRefinementCostWeight(const UMotionMatchConfig* InMMConfig) const;
+
 	/*------------XC:Get Feature Name-----------*/
 	virtual FName GetFeatureName() const;
 
@@ -50,6 +50,13 @@ public:
 
 	virtual bool CanBeQualityFeature() const override;
 
+	/** The resultant velocity cost, i.e. how well the velocity implied by moving from the query bone location to the
+	 * candidate bone location matches the query bone velocity */
+	virtual bool HasRefinementCost() const override;
+	virtual float ComputeRefinementCost(const float* QueryFeature, const float* PoseFeature, const float* FeatureWeights,
+		const float DeltaTime) const override;
+	virtual float GetRefinementCostWeight(const UMotionMatchConfig* InMMConfig) const override; //The config's ResultantVelocityWeight
+
 	virtual FName GetFeatureName() const override;
 	
 #if WITH_EDITOR
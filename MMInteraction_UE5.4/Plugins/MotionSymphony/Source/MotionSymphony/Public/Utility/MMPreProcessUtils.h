@@ -16,6 +16,30 @@ struct FTrajectory;
 struct FTrajectoryPoint;
 struct FJointData;
 
+/** A thread local cache of decompressed local space bone transforms used while pre-processing. Every match feature samples
+ * the same bone chains at the same few times (Time, Time - PoseInterval / 2 and Time + PoseInterval / 2), so with the cache
+ * each bone is only decompressed once per animation and sample time no matter how many features use it. The cache is only
+ * used while an FMMPreProcessPoseCacheScope is alive, otherwise bones are decompressed directly. */
+class MOTIONSYMPHONY_API FMMPreProcessPoseCache
+{
+public:
+	/** Gets the local space transform of a bone from raw animation data, decompressing it only if it is not cached already */
+	static void GetBoneTransform(FTransform& OutTransform, const UAnimSequence* AnimSequence, const int32 BoneIndex, const float Time);
+
+	/** Discards the cached transforms of all threads. Cached transforms are never valid across pre-process passes as the
+	 * source animations may have been modified in between */
+	static void Invalidate();
+
+	static bool IsActive();
+};
+
+/** Enables the pre-process pose cache for its lifetime. The cache is invalidated on both construction and destruction */
+struct MOTIONSYMPHONY_API FMMPreProcessPoseCacheScope
+{
+	FMMPreProcessPoseCacheScope();
+	~FMMPreProcessPoseCacheScope();
+};
+
 /** Utility class holding functions for motion matching pre-processing */
 class MOTIONSYMPHONY_API FMMPreProcessUtils
 {
@@ -0,0 +1,343 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Data/PoseAABBHierarchy.h"
+#include "Enumerations/EMotionMatchingEnums.h"
+
+class UMotionDataAsset;
+class UMotionMatchConfig;
+class UMatchFeatureBase;
+
+/** A contiguous range of atoms within a pose array which belongs to a single match feature. The offset
+ * includes the pose favour atom, i.e. the first feature of a pose always starts at offset 1. */
+struct MOTIONSYMPHONY_API FPoseFeatureSegment
+{
+	int32 Offset;
+	int32 Size;
+
+	FPoseFeatureSegment();
+	FPoseFeatureSegment(int32 InOffset, int32 InSize);
+};
+
+/** A match feature which adds a refinement cost in the refinement stage of a staged search */
+struct MOTIONSYMPHONY_API FPoseRefinementFeature
+{
+	const UMatchFeatureBase* Feature;
+	FPoseFeatureSegment Segment;
+
+	/** The multiplier of the refinement cost of the feature (see UMatchFeatureBase::GetRefinementCostWeight) */
+	float Weight;
+
+	FPoseRefinementFeature();
+	FPoseRefinementFeature(const UMatchFeatureBase* InFeature, const FPoseFeatureSegment& InSegment, const float InWeight);
+};
+
+/** The feature segments of each stage of a staged ('Quality') search, built from the search stage of each match feature
+ * of a config. The coarse segments are evaluated for every pose that is searched and the refine segments only for the
+ * best coarse candidates. */
+struct MOTIONSYMPHONY_API FPoseSearchStages
+{
+	TArray<FPoseFeatureSegment> CoarseSegments;
+	TArray<FPoseFeatureSegment> RefineSegments;
+	TArray<FPoseRefinementFeature> RefinementFeatures;
+
+	/** Builds the stages from the feature segments of the config (see FMotionMatchingSearch::BuildFeatureSegments). If no
+	 * feature is coarse, every feature is evaluated in the coarse stage so that only refinement costs are refined */
+	void Build(const UMotionMatchConfig* InMMConfig, TConstArrayView<FPoseFeatureSegment> FeatureSegments);
+
+	/** Returns true if the stages have a coarse segment and, between them, cover every feature atom of a pose array with
+	 * the passed atom count exactly once */
+	bool IsValid(const int32 AtomCount) const;
+};
+
+/** A candidate pose found by a pose search. Candidates are cheap to copy. The pose id space (search matrix or lookup
+ * matrix) depends on where the candidate came from. */
+struct MOTIONSYMPHONY_API FPoseSearchCandidate
+{
+	int32 PoseId;
+	float Cost;
+	float PoseFavour;
+
+	FPoseSearchCandidate();
+	FPoseSearchCandidate(int32 InPoseId, float InCost, float InPoseFavour);
+};
+
+/** The number of candidates shown by the motion matching debug info */
+static constexpr int32 MaxPoseSearchCandidates = 5;
+
+/** The maximum number of lowest cost poses that a single pose search can keep */
+static constexpr int32 MaxPoseSearchTopK = 32;
+typedef TArray<FPoseSearchCandidate, TFixedAllocator<MaxPoseSearchTopK>> FPoseSearchTopKArray;
+
+/** A fixed capacity max heap of the lowest cost poses found by a pose search. The highest kept cost is at the top of the
+ * heap so that it is the cost to beat for any further pose once the heap is full. Only the pose id, cost and favour are
+ * kept; anything else (e.g. animation names or per feature costs) is resolved by the caller afterwards. */
+struct MOTIONSYMPHONY_API FPoseSearchTopK
+{
+	int32 Capacity;
+	FPoseSearchTopKArray Heap;
+
+	FPoseSearchTopK();
+	explicit FPoseSearchTopK(int32 InCapacity);
+
+	bool IsEnabled() const { return Capacity > 0; }
+	bool IsFull() const { return Heap.Num() >= Capacity; }
+
+	/** The cost a pose has to beat to be kept. There is no limit until the heap is full */
+	float GetCostToBeat() const { return IsEnabled() && IsFull() ? Heap.HeapTop().Cost : UE_MAX_FLT; }
+
+	/** Keeps the pose if there is room or if it beats the highest kept cost, which is then discarded */
+	void Add(int32 InPoseId, float InCost, float InPoseFavour);
+
+	void Reset();
+
+	/** Outputs the kept poses ordered from the lowest to highest cost */
+	void GetSorted(FPoseSearchTopKArray& OutCandidates) const;
+};
+
+/** Describes a single pose search over the search pose matrix. All pointers are owned by the caller and must
+ * remain valid for the duration of the search. */
+struct MOTIONSYMPHONY_API FPoseSearchQuery
+{
+	/** The full query pose array, including the (unused) pose favour atom at index 0 */
+	const float* QueryPoseArray;
+
+	/** The final calibration weights, one per feature atom (i.e. AtomCount - 1 weights) */
+	const float* CalibrationArray;
+
+	/** The range of poses in the search pose matrix to search [StartPoseIndex, EndPoseIndex) */
+	int32 StartPoseIndex;
+	int32 EndPoseIndex;
+
+	/** Optional order in which to evaluate the feature segments of each pose. If empty, atoms are evaluated in
+	 * pose array order, which gives exactly the same costs as ComputePoseCost */
+	TConstArrayView<FPoseFeatureSegment> EvaluationOrder;
+
+	FPoseSearchQuery();
+	FPoseSearchQuery(const float* InQueryPoseArray, const float* InCalibrationArray, int32 InStartPoseIndex, int32 InEndPoseIndex);
+};
+
+/** The result of a pose search. The result should be seeded with the cost to beat (e.g. from a next natural search)
+ * and PoseId will only be set if a pose in the search pose matrix beats it. Pose ids are in search matrix space.
+ *
+ * If the result has a top K capacity, the K lowest cost poses of the query range are also kept regardless of the cost
+ * to beat. Searches then prune against the K-th lowest cost instead of the lowest cost, so they check more poses. The
+ * kept poses are exact for the exhaustive searches. The 'Tree' search with an epsilon, the 'CandidateLookup' search
+ * and the 'Compressed' search are approximate, so they only keep the lowest cost poses that they evaluate.
+ *
+ * If the top K poses do not prune (e.g. poses kept only for debugging), the search prunes against the lowest cost as if
+ * no poses were kept and the top K only records the poses that lowered the cost. */
+struct MOTIONSYMPHONY_API FPoseSearchResult
+{
+	int32 PoseId;
+	float Cost;
+
+	/** The cost that poses and boxes have to beat to be evaluated any further. This equals Cost unless the result
+	 * keeps the top K poses, in which case it is the higher of Cost and the K-th lowest cost found so far */
+	float PruneCost;
+
+	//Search statistics
+	int32 PosesChecked;
+	int32 OuterAABBsChecked;
+	int32 OuterAABBsPassed;
+	int32 InnerAABBsChecked;
+	int32 InnerAABBsPassed;
+	int32 TreeNodesChecked;
+	int32 TreeNodesPassed;
+	int32 CoarsePosesChecked;
+
+	/** The boxes tested and passed at each level of an AABB hierarchy search, root level first */
+	int32 LevelBoxesChecked[FPoseAABBHierarchy::MaxLevelCount];
+	int32 LevelBoxesPassed[FPoseAABBHierarchy::MaxLevelCount];
+
+	/** The lowest cost poses of the search. Only kept if the result was created with a top K capacity */
+	FPoseSearchTopK TopK;
+
+	/** True if searches prune against the K-th lowest cost so that the top K poses are the lowest cost poses */
+	bool bTopKPrunes;
+
+	FPoseSearchResult();
+	explicit FPoseSearchResult(float InCostToBeat, int32 InTopKCapacity = 0, bool bInTopKPrunes = true);
+
+	bool IsValid() const { return PoseId != INDEX_NONE; }
+
+	/** Records an evaluated pose. Search kernels only call this for poses whose cost is lower than PruneCost */
+	FORCEINLINE void AddPose(int32 InPoseId, float InCost, float InPoseFavour)
+	{
+		if(InCost < Cost)
+		{
+			Cost = InCost;
+			PoseId = InPoseId;
+		}
+
+		if(TopK.IsEnabled())
+		{
+			TopK.Add(InPoseId, InCost, InPoseFavour);
+			PruneCost = bTopKPrunes ? FMath::Max(Cost, TopK.GetCostToBeat()) : Cost;
+		}
+		else
+		{
+			PruneCost = Cost;
+		}
+	}
+
+	/** Records an evaluated pose if its cost is lower than PruneCost */
+	FORCEINLINE void TryAddPose(int32 InPoseId, float InCost, float InPoseFavour)
+	{
+		if(InCost < PruneCost)
+		{
+			AddPose(InPoseId, InCost, InPoseFavour);
+		}
+	}
+};
+
+/** Scratch memory for compressed and staged searches so that the search itself does not allocate once the arrays have grown. This
+ * is owned by the caller and should be re-used between searches. */
+struct MOTIONSYMPHONY_API FPoseSearchScratch
+{
+	TArray<float> DistanceTable;
+	TArray<TPair<float, int32>> Candidates;
+};
+
+/** The search settings of a motion matching search quality, i.e. the settings of a motion matching node that pick and
+ * tune the search of its pose matrix (see FMotionMatchingSearch::SearchWithQuality) */
+struct MOTIONSYMPHONY_API FPoseSearchQualitySettings
+{
+	EMotionMatchingSearchQuality Quality;
+	float TreeEpsilon;
+	int32 CompressedRerankCount;
+
+	/** The stages of a 'Quality' search. These are owned by the caller and must be valid for the search pose matrix */
+	const FPoseSearchStages* Stages;
+	int32 StagedCandidateCount;
+	float DeltaTime;
+
+	FPoseSearchQualitySettings();
+};
+
+/** Allocation free pose search kernels that operate directly on the pose matrices of a motion data asset. These
+ * are shared by the motion matching node search paths so that all searches use the same cost function. */
+class MOTIONSYMPHONY_API FMotionMatchingSearch
+{
+public:
+	/** Builds the feature segments (offset and size of each match feature within a pose array) for a config */
+	static void BuildFeatureSegments(const UMotionMatchConfig* InMMConfig, TArray<FPoseFeatureSegment>& OutSegments);
+
+	/** Returns true if the feature segments are contiguous from the first feature atom and end at the last atom of a pose
+	 * array with the passed atom count */
+	static bool AreFeatureSegmentsValid(TConstArrayView<FPoseFeatureSegment> Segments, const int32 AtomCount);
+
+	/** Weighted L1 distance between two float arrays, i.e. Sum(|A[i] - B[i]| * Weights[i]). This is vectorized (two 4-wide
+	 * accumulators so that 8 atoms are processed per iteration) and does not require any alignment. */
+	static float ComputeWeightedL1(const float* A, const float* B, const float* Weights, const int32 Count);
+
+	/** Scalar reference implementation of ComputeWeightedL1. It accumulates in exactly the same lane order as the
+	 * vectorized kernel so the results of both are bit identical. Used as a fallback and to validate the kernel. */
+	static float ComputeWeightedL1_Scalar(const float* A, const float* B, const float* Weights, const int32 Count);
+
+	/** The number of atoms accumulated between each early termination check of the bounded kernels */
+	static constexpr int32 BoundCheckInterval = 16;
+
+	/** Same as ComputeWeightedL1 but added onto BaseCost, and evaluation is abandoned at the first BoundCheckInterval
+	 * boundary where (BaseCost + PartialSum) * Scale >= CostToBeat. Since every term is positive the partial sum can never
+	 * exceed the full sum, so an abandoned evaluation could never have beaten CostToBeat. If not abandoned, the result is
+	 * bit identical to BaseCost + ComputeWeightedL1. */
+	static float ComputeWeightedL1Bounded(const float* A, const float* B, const float* Weights, const int32 Count,
+		const float BaseCost, const float Scale, const float CostToBeat);
+
+	/** Computes the weighted cost of a single pose row against the query, excluding the pose favour */
+	static float ComputePoseCost(const float* PoseRow, const float* QueryPoseArray, const float* CalibrationArray, const int32 AtomCount);
+
+	/** Computes the weighted cost of a single pose row multiplied by the pose favour, but gives up early once the cost can
+	 * no longer beat CostToBeat. The returned cost is only exact if it is lower than CostToBeat. */
+	static float ComputePoseCostBounded(const float* PoseRow, const float* QueryPoseArray, const float* CalibrationArray,
+		const int32 AtomCount, const float PoseFavour, const float CostToBeat);
+
+	/** Same as ComputePoseCostBounded but the feature segments are evaluated in the passed order so that the most significant
+	 * features can be used to terminate early. Summing in a different order may change the last bit of the cost. */
+	static float ComputePoseCostOrdered(const float* PoseRow, const float* QueryPoseArray, const float* CalibrationArray,
+		TConstArrayView<FPoseFeatureSegment> EvaluationOrder, const float PoseFavour, const float CostToBeat);
+
+	/** Weighted L1 distance from the query to the closest point of an AABB. This is a lower bound of the cost of every
+	 * pose within the box. ExtentsRow is the interleaved min/max extents of a single box in an FPoseAABBMatrix. */
+	static float ComputeAABBCost(const float* ExtentsRow, const float* QueryPoseArray, const float* CalibrationArray, const int32 AtomCount);
+
+	/** Computes the AABB cost of every box of a group of an FPoseAABBHierarchy at once. GroupExtents is the structure of
+	 * arrays extents of the group and OutCosts must have room for FPoseAABBHierarchy::BranchFactor costs. The costs of
+	 * unused boxes of the group are undefined. */
+	static void ComputeAABBGroupCost(const float* GroupExtents, const float* QueryPoseArray, const float* CalibrationArray,
+		const int32 AtomCount, float* OutCosts);
+
+	/** Computes the weighted cost of each feature segment of a pose row against the query, excluding the pose favour.
+	 * OutFeatureCosts must have room for one float per segment. This is intended for debugging only. */
+	static void ComputeFeatureCosts(const float* PoseRow, const float* QueryPoseArray, const float* CalibrationArray,
+		TConstArrayView<FPoseFeatureSegment> Segments, float* OutFeatureCosts);
+
+	/** Searches the query range of the search pose matrix using the outer and inner AABB structures to prune poses. If the
+	 * motion data has a reduced SearchMatrixPrecision, the quantized pose matrix and AABB extents are searched instead.
+	 * Otherwise, if the motion data uses a feature major search matrix layout, the feature major matrix is searched and if the
+	 * motion data has an AABB hierarchy, the hierarchy is searched instead of the outer and inner AABBs */
+	static void SearchAABB(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query, FPoseSearchResult& InOutResult);
+
+	/** Searches several queries (e.g. of different characters) over the same motion data in a single pass over the outer
+	 * and inner AABBs. Every box and pose row is tested against all queries whose range contains it while it is still in
+	 * cache. Each result is exactly the same as an outer / inner AABB search of its query alone at the same precision.
+	 * Results must have one entry per query, seeded with the cost to beat of that query */
+	static void SearchAABBBatch(const UMotionDataAsset* InMotionData, TConstArrayView<FPoseSearchQuery> Queries,
+		TArrayView<FPoseSearchResult> InOutResults);
+
+	/** Searches the query range of a pose array using a multi-level AABB hierarchy built over it. Child boxes are visited
+	 * in order of increasing cost and are pruned against the lowest cost found so far */
+	static void SearchAABBHierarchy(const FPoseAABBHierarchy& Hierarchy, const float* PoseArray, const FPoseSearchQuery& Query,
+		FPoseSearchResult& InOutResult);
+
+	/** Searches the query range of the feature major search matrix of the motion data. Poses are evaluated in chunks of 64
+	 * (the size of an outer AABB, which prunes the chunk if bUseAABBs is true) one feature at a time, in the evaluation
+	 * order of the query if it has one. Poses which can no longer beat the lowest cost are discarded before their next
+	 * feature is read. */
+	static void SearchFeatureMajor(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query, const bool bUseAABBs,
+		FPoseSearchResult& InOutResult);
+
+	/** Searches a single motion tag section of the search pose matrix using the pose search tree of the motion data. The
+	 * query range must be the range of that section. With an Epsilon of 0 the search is exact (it finds the same lowest cost
+	 * as SearchBrute). With a positive Epsilon, nodes are also pruned if they cannot improve on the current best by more than
+	 * a factor of (1 + Epsilon), so the cost found is guaranteed to be within that factor of the lowest cost. */
+	static void SearchTree(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query, const int32 SectionIndex,
+		const float Epsilon, FPoseSearchResult& InOutResult);
+
+	/** Searches only the passed candidate poses (search matrix pose ids, e.g. from the pose lookup table). Candidates outside
+	 * of the query range are skipped */
+	static void SearchCandidates(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+		TConstArrayView<int32> Candidates, FPoseSearchResult& InOutResult);
+
+	/** Searches the query range of the product quantized search matrix of the motion data and re-ranks the RerankCount
+	 * poses with the lowest coarse cost exactly against the searched rows (the quantized rows if the SearchMatrixPrecision
+	 * is reduced). This is approximate: the lowest cost pose is only found if its coarse cost is among the best RerankCount
+	 * coarse costs. */
+	static void SearchCompressed(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query, const int32 RerankCount,
+		FPoseSearchScratch& Scratch, FPoseSearchResult& InOutResult);
+
+	/** Searches the query range of the search pose matrix in two stages. The coarse stage evaluates only the coarse
+	 * segments of the poses that pass the outer and inner AABBs and keeps the CandidateCount poses with the lowest coarse
+	 * cost. The refinement stage then evaluates the refine segments and refinement features of those candidates, from the
+	 * lowest coarse cost up. This is approximate: the lowest cost pose is only found if its coarse cost is among the best
+	 * CandidateCount coarse costs. The evaluation order of the query is not used. */
+	static void SearchStaged(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query, const FPoseSearchStages& Stages,
+		const int32 CandidateCount, const float DeltaTime, FPoseSearchScratch& Scratch, FPoseSearchResult& InOutResult);
+
+	/** Searches the query range with the search of a motion matching search quality. This is the search dispatch of the
+	 * motion matching node and is shared with anything that needs to search exactly like it (e.g. async searches and
+	 * benchmarks). SectionIndex is the motion tag section of the query range, needed by the 'Tree' and 'Candidate Lookup'
+	 * qualities, and CurrentPoseId is the lookup matrix pose id whose lookup candidates are searched. If the search
+	 * structures of the quality were not generated, or the current pose has no candidates, SearchAABB is used instead.
+	 * Returns the quality whose search was run, i.e. 'Performance' if the search fell back to SearchAABB. */
+	static EMotionMatchingSearchQuality SearchWithQuality(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query,
+		const FPoseSearchQualitySettings& Settings, const int32 SectionIndex, const int32 CurrentPoseId,
+		FPoseSearchScratch& Scratch, FPoseSearchResult& InOutResult);
+
+	/** Searches every pose in the query range of the search pose matrix without any AABB pruning. If the motion data has a
+	 * reduced SearchMatrixPrecision or a feature major search matrix layout, that data is searched instead */
+	static void SearchBrute(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& Query, FPoseSearchResult& InOutResult);
+};
@@ -0,0 +1,181 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "Utility/MotionMatchingSearch.h"
+#include <atomic>
+#include "MotionMatchingSearchScheduler.generated.h"
+
+class USkeletalMeshComponent;
+class UMotionDataAsset;
+
+/** The priority of a motion matching search request. Forced searches are always granted while high and low priority
+ * searches are deferred once the frame budget (or a fraction of it for low priority searches) has been used. */
+enum class EMotionMatchingSearchPriority : uint8
+{
+	Low,
+	High,
+	Forced
+};
+
+/** Statistics of a single frame of the motion matching search scheduler */
+USTRUCT(BlueprintType)
+struct MOTIONSYMPHONY_API FMotionMatchingSchedulerStats
+{
+	GENERATED_BODY()
+
+	/** The number of nodes that wanted to search this frame */
+	UPROPERTY(BlueprintReadOnly, Category = "MotionSymphony|Scheduler")
+	int32 SearchesRequested = 0;
+
+	/** The number of searches that were allowed to run, including forced searches */
+	UPROPERTY(BlueprintReadOnly, Category = "MotionSymphony|Scheduler")
+	int32 SearchesGranted = 0;
+
+	/** The number of forced searches (e.g. from trait changes or bUserForcePoseSearch) which bypass the budget */
+	UPROPERTY(BlueprintReadOnly, Category = "MotionSymphony|Scheduler")
+	int32 SearchesForced = 0;
+
+	/** The number of searches that were deferred to a later frame because the budget was used up */
+	UPROPERTY(BlueprintReadOnly, Category = "MotionSymphony|Scheduler")
+	int32 SearchesDeferred = 0;
+
+	/** The total number of poses checked by all granted searches */
+	UPROPERTY(BlueprintReadOnly, Category = "MotionSymphony|Scheduler")
+	int32 PosesSearched = 0;
+
+	/** The total time spent by all granted searches in microseconds */
+	UPROPERTY(BlueprintReadOnly, Category = "MotionSymphony|Scheduler")
+	float SearchMicroseconds = 0.0f;
+
+	/** The number of searches submitted to the batched search, which run together after the animation update */
+	UPROPERTY(BlueprintReadOnly, Category = "MotionSymphony|Scheduler")
+	int32 SearchesBatched = 0;
+};
+
+/** A pose search submitted to the batched search of the scheduler. The query pose, calibration weights and evaluation
+ * order are copied so that the submitting node can keep changing its own arrays while the search is pending */
+struct MOTIONSYMPHONY_API FBatchedPoseSearchRequest
+{
+	const UMotionDataAsset* MotionData;
+	TArray<float> QueryPoseArray;
+	TArray<float> CalibrationArray;
+	TArray<FPoseFeatureSegment> EvaluationOrder;
+	int32 StartPoseIndex;
+	int32 EndPoseIndex;
+	FPoseSearchResult Result;
+
+	/** This request's share of the worker time of the batch pass over its motion data */
+	uint64 SearchCycles = 0;
+
+	/** Set once the submitting node has retrieved or cancelled the result so that it is not retained */
+	bool bRetrieved = false;
+
+	FPoseSearchQuery GetQuery() const;
+};
+
+/** The result of a batched search which was not retrieved in the frame after it was submitted, e.g. because the
+ * submitting node skipped an animation update */
+struct FRetainedBatchedSearchResult
+{
+	FPoseSearchResult Result;
+	uint64 DispatchFrame = 0;
+	uint64 SearchCycles = 0;
+};
+
+/** A per world scheduler which spreads the pose searches of every motion matching node over frames. Nodes are given a
+ * stagger phase when they initialize so that characters spawned together do not search on the same frame, and every
+ * search has to be granted by the scheduler which enforces a per frame time and / or pose budget. Requests and reports
+ * are thread safe so that they can be made from parallel animation updates. The budget is configured with the
+ * a.AnimNode.MoSymph.MMSearch.Budget* console variables. */
+UCLASS()
+class MOTIONSYMPHONY_API UMotionMatchingSearchScheduler : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+private:
+	std::atomic<int32> FrameSearchesRequested;
+	std::atomic<int32> FrameSearchesGranted;
+	std::atomic<int32> FrameSearchesForced;
+	std::atomic<int32> FrameSearchesDeferred;
+	std::atomic<int32> FramePosesSearched;
+	std::atomic<uint64> FrameSearchCycles;
+	std::atomic<uint32> StaggerCounter;
+
+	/** The camera locations of all local players, cached on the game thread each frame for priority calculations */
+	TArray<FVector> CameraLocations;
+
+	FMotionMatchingSchedulerStats LastFrameStats;
+
+	/** Batched searches submitted during the animation update of this frame */
+	FCriticalSection BatchLock;
+	TArray<FBatchedPoseSearchRequest> PendingBatch;
+	uint32 PendingBatchSerial;
+
+	/** The batch of the last frame which is searched by BatchTask. Its results are retrieved during this frame's animation
+	 * update and any result which is not retrieved is moved to RetainedResults when the next batch is dispatched */
+	TArray<FBatchedPoseSearchRequest> InFlightBatch;
+	uint32 InFlightBatchSerial;
+	UE::Tasks::FTask BatchTask;
+
+	/** Results of older batches by ticket, kept until they are retrieved or cancelled or for at most
+	 * a.AnimNode.MoSymph.MMSearch.BatchResultFrames frames */
+	TMap<uint64, FRetainedBatchedSearchResult> RetainedResults;
+
+	/** Keeps the motion data of the in flight batch alive until it has been searched */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UObject>> InFlightMotionData;
+
+public:
+	UMotionMatchingSearchScheduler();
+
+	/** Returns the scheduler of a world or nullptr if the world has none (e.g. editor preview worlds) */
+	static UMotionMatchingSearchScheduler* Get(const UWorld* InWorld);
+
+	/** Returns a stagger phase between 0 and 1 for a node. Successive calls are spread evenly over the range */
+	float AcquireStaggerPhase();
+
+	/** Computes the priority of a non forced search from the visibility of the character and its distance to the
+	 * closest camera */
+	EMotionMatchingSearchPriority ComputePriority(const USkeletalMeshComponent* InSkelMeshComponent) const;
+
+	/** Asks for permission to search this frame. Deferred searches should be requested again next frame with an
+	 * incremented FramesDeferred so that they cannot be starved */
+	bool RequestSearch(const EMotionMatchingSearchPriority InPriority, const int32 FramesDeferred);
+
+	/** Reports the cost of a granted search so that it can count towards the frame budget */
+	void ReportSearch(const uint64 InSearchCycles, const int32 InPosesSearched);
+
+	/** Submits a pose search to the batch of this frame. The batch is searched on a worker task once the animation
+	 * update of the frame has completed, one pass over the AABBs per motion data for all of its queries. The result can
+	 * be retrieved from the next frame on with the returned ticket, i.e. it always arrives at least one frame late. The
+	 * query range is searched with the outer and inner AABBs regardless of the search structures of the motion data */
+	uint64 SubmitBatchedSearch(const UMotionDataAsset* InMotionData, const FPoseSearchQuery& InQuery, const float InCostToBeat);
+
+	/** Retrieves the result of a submitted search, waiting for the batch if it is still being searched. Results which
+	 * are not retrieved the frame after submission (e.g. the node skipped an animation update) are retained for a few
+	 * frames. OutSearchCycles is the worker time of the search. Returns false if the result has expired or was already
+	 * retrieved */
+	bool RetrieveBatchedSearch(const uint64 InTicket, FPoseSearchResult& OutResult, uint64& OutSearchCycles);
+
+	/** Drops the result of a submitted search that the node no longer needs, e.g. because a forced search superseded it */
+	void CancelBatchedSearch(const uint64 InTicket);
+
+	/** Returns the statistics of the last completed frame */
+	UFUNCTION(BlueprintCallable, Category = "MotionSymphony|Scheduler")
+	FMotionMatchingSchedulerStats GetLastFrameStats() const;
+
+	//UWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	//End of UWorldSubsystem interface
+
+private:
+	void DispatchSearchBatch();
+	static void SearchBatch(TArray<FBatchedPoseSearchRequest>& InOutRequests);
+};
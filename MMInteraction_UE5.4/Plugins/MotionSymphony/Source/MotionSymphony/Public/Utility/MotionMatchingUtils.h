@@ -16,6 +16,7 @@ class UMirroringProfile;
 class USkeletalMeshComponent;
 struct FAnimMirroringData;
 struct FCalibrationData;
+struct FPoseHotTable;
 
 class MOTIONSYMPHONY_API FMotionMatchingUtils
 {
@@ -24,6 +25,11 @@ public:
 	
 	static void LerpPose(FPoseMotionData& OutLerpPose, const FPoseMotionData& From, const FPoseMotionData& To, float Progress);
 
+	/** Interpolates between two poses of the pose hot table. Only the hot data is written, the blend space position and
+	 * motion tags of OutLerpPose are left untouched and should be read from the cold pose data by pose id if needed */
+	static void LerpPose(FPoseMotionData& OutLerpPose, const FPoseHotTable& PoseTable, const int32 FromPoseId,
+		const int32 ToPoseId, float Progress);
+
 	static void LerpLinearPoseData(TArray<float>& OutLerpPose, TArray<float> From, TArray<float> To, const float Progress);
 
 	static void LerpLinearPoseData(TArray<float>& OutLerpPose, float* From, float* To, const float Progress, const int32 PoseSize);
@@ -20,7 +20,8 @@ public class MotionSymphonyEditor : ModuleRules
                 "MotionSymphonyEditor/Private/AssetTools",
                 "MotionSymphonyEditor/Private/Factories",
                 "MotionSymphonyEditor/Private/Toolkits",
-                "MotionSymphonyEditor/Private/GUI"
+                "MotionSymphonyEditor/Private/GUI",
+                "MotionSymphonyEditor/Private/Commandlets"
 				// ... add other private include paths required here ...
 			}
 			);
@@ -70,7 +71,9 @@ public class MotionSymphonyEditor : ModuleRules
                 "TimeManagement",
                 "AnimationModifiers",
                 "AnimationBlueprintLibrary",
-                "ApplicationCore"
+                "ApplicationCore",
+                "GameplayTags",
+                "Json"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -0,0 +1,544 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "MotionSearchBenchmarkCommandlet.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "NativeGameplayTags.h"
+#include "Serialization/JsonWriter.h"
+#include "Objects/Assets/MotionDataAsset.h"
+#include "Objects/Assets/MotionMatchConfig.h"
+#include "Objects/MatchFeatures/MatchFeature_BoneLocation.h"
+#include "Utility/MotionMatchingSearch.h"
+
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section0, "MotionSymphony.Benchmark.Section0");
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section1, "MotionSymphony.Benchmark.Section1");
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section2, "MotionSymphony.Benchmark.Section2");
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section3, "MotionSymphony.Benchmark.Section3");
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section4, "MotionSymphony.Benchmark.Section4");
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section5, "MotionSymphony.Benchmark.Section5");
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section6, "MotionSymphony.Benchmark.Section6");
+UE_DEFINE_GAMEPLAY_TAG_STATIC(TAG_MotionSearchBenchmark_Section7, "MotionSymphony.Benchmark.Section7");
+
+namespace MotionSearchBenchmark
+{
+	static constexpr int32 MaxSectionCount = 8;
+	static constexpr int32 ClipLength = 64; //Poses per synthetic animation
+	static constexpr float PoseInterval = 0.05f;
+	static constexpr float QualityNoise = 2.0f;
+
+	/** Costs within this fraction of the brute force cost are treated as the same pose, e.g. a tie or a different
+	 * summation order in a SIMD kernel */
+	static constexpr float CostTolerance = 1e-4f;
+
+	FGameplayTag GetSectionTag(const int32 SectionIndex)
+	{
+		switch(SectionIndex)
+		{
+			case 1: return TAG_MotionSearchBenchmark_Section1;
+			case 2: return TAG_MotionSearchBenchmark_Section2;
+			case 3: return TAG_MotionSearchBenchmark_Section3;
+			case 4: return TAG_MotionSearchBenchmark_Section4;
+			case 5: return TAG_MotionSearchBenchmark_Section5;
+			case 6: return TAG_MotionSearchBenchmark_Section6;
+			case 7: return TAG_MotionSearchBenchmark_Section7;
+			default: return TAG_MotionSearchBenchmark_Section0;
+		}
+	}
+
+	/** The per atom curve of a synthetic animation. Every atom is a sine wave so that consecutive poses are similar */
+	struct FClipCurve
+	{
+		float Base;
+		float Amplitude;
+		float Frequency;
+		float Phase;
+	};
+
+	bool IsExactQuality(const EMotionMatchingSearchQuality Quality, const float TreeEpsilon)
+	{
+		return Quality == EMotionMatchingSearchQuality::Performance
+			|| Quality == EMotionMatchingSearchQuality::Brute
+			|| (Quality == EMotionMatchingSearchQuality::Tree && TreeEpsilon <= 0.0f);
+	}
+
+	bool IsSameCost(const float Cost, const float BruteCost)
+	{
+		return FMath::Abs(Cost - BruteCost) <= CostTolerance * FMath::Max(1.0f, FMath::Abs(BruteCost));
+	}
+
+	template<typename EnumType>
+	void ParseEnum(const FString& Params, const TCHAR* Match, EnumType& OutValue)
+	{
+		FString ValueName;
+		if(!FParse::Value(*Params, Match, ValueName))
+		{
+			return;
+		}
+
+		const int64 Value = StaticEnum<EnumType>()->GetValueByNameString(ValueName);
+		if(Value == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("MotionSearchBenchmark: Unknown value '%s' for '%s'."), *ValueName, Match);
+			return;
+		}
+
+		OutValue = static_cast<EnumType>(Value);
+	}
+
+	template<typename EnumType>
+	FString GetEnumName(const EnumType Value)
+	{
+		return StaticEnum<EnumType>()->GetNameStringByValue(static_cast<int64>(Value));
+	}
+}
+
+void FMotionSearchBenchmarkSettings::Parse(const FString& Params)
+{
+	FParse::Value(*Params, TEXT("Poses="), PoseCount);
+	FParse::Value(*Params, TEXT("Atoms="), FeatureAtomCount);
+	FParse::Value(*Params, TEXT("Sections="), SectionCount);
+	FParse::Value(*Params, TEXT("Queries="), QueryCount);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("TreeEpsilon="), TreeEpsilon);
+	FParse::Value(*Params, TEXT("RerankCount="), RerankCount);
+	FParse::Value(*Params, TEXT("CandidateCount="), CandidateCount);
+	bMirror = FParse::Param(*Params, TEXT("Mirror"));
+	bSpatialOrder = FParse::Param(*Params, TEXT("Spatial"));
+	bAABBHierarchy = FParse::Param(*Params, TEXT("Hierarchy"));
+	MotionSearchBenchmark::ParseEnum(Params, TEXT("Precision="), Precision);
+	MotionSearchBenchmark::ParseEnum(Params, TEXT("Layout="), Layout);
+
+	PoseCount = FMath::Max(PoseCount, 2);
+	FeatureAtomCount = FMath::Max(FeatureAtomCount, 6);
+	SectionCount = FMath::Clamp(SectionCount, 1, MotionSearchBenchmark::MaxSectionCount);
+	QueryCount = FMath::Max(QueryCount, 1);
+	Iterations = FMath::Max(Iterations, 1);
+	RerankCount = FMath::Max(RerankCount, 1);
+	CandidateCount = FMath::Max(CandidateCount, 1);
+
+	if(!FParse::Value(*Params, TEXT("Output="), OutputPath))
+	{
+		OutputPath = FPaths::ProjectSavedDir() / TEXT("MotionSymphony") / TEXT("PoseSearchBenchmark.json");
+	}
+}
+
+UMotionSearchBenchmarkCommandlet::UMotionSearchBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UMotionSearchBenchmarkCommandlet::Main(const FString& Params)
+{
+	FMotionSearchBenchmarkSettings Settings;
+	Settings.Parse(Params);
+
+	TArray<FMotionSearchBenchmarkResult> Results;
+	FString Report;
+	if(!RunBenchmark(Settings, Results, Report))
+	{
+		return 1;
+	}
+
+	if(!FFileHelper::SaveStringToFile(Report, *Settings.OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("MotionSearchBenchmark: Failed to write the report to '%s'."), *Settings.OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("MotionSearchBenchmark: Wrote the report to '%s'."), *Settings.OutputPath);
+
+	const bool bExactMismatch = Results.ContainsByPredicate([](const FMotionSearchBenchmarkResult& Result)
+	{
+		return Result.bExact && Result.DisagreementCount > 0;
+	});
+
+	return bExactMismatch ? 1 : 0;
+}
+
+bool UMotionSearchBenchmarkCommandlet::RunBenchmark(const FMotionSearchBenchmarkSettings& Settings,
+	TArray<FMotionSearchBenchmarkResult>& OutResults, FString& OutReport)
+{
+	OutResults.Reset();
+
+	FRandomStream RandomStream(Settings.Seed);
+	UMotionDataAsset* MotionData = CreateMotionData(Settings, RandomStream);
+	if(!MotionData
+		|| !MotionData->IsSearchPoseMatrixGenerated()
+		|| !MotionData->AreFinalCalibrationWeightsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("MotionSearchBenchmark: Failed to generate the synthetic motion data."));
+		return false;
+	}
+
+	TArray<float> QueryPoses;
+	TArray<int32> CurrentPoseIds;
+	TArray<int32> SectionIndices;
+	CreateQueries(MotionData, Settings.QueryCount, RandomStream, QueryPoses, CurrentPoseIds, SectionIndices);
+
+	const int32 QueryCount = CurrentPoseIds.Num();
+	if(QueryCount == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("MotionSearchBenchmark: The synthetic motion data has no searchable poses."));
+		return false;
+	}
+
+	const int32 AtomCount = MotionData->SearchPoseMatrix.AtomCount;
+
+	TArray<FPoseFeatureSegment> FeatureSegments;
+	FMotionMatchingSearch::BuildFeatureSegments(MotionData->MotionMatchConfig, FeatureSegments);
+	FPoseSearchStages SearchStages;
+	SearchStages.Build(MotionData->MotionMatchConfig, FeatureSegments);
+
+	FPoseSearchScratch SearchScratch;
+
+	FPoseSearchQualitySettings QualitySettings;
+	QualitySettings.TreeEpsilon = Settings.TreeEpsilon;
+	QualitySettings.CompressedRerankCount = Settings.RerankCount;
+	QualitySettings.Stages = SearchStages.IsValid(AtomCount) ? &SearchStages : nullptr;
+	QualitySettings.StagedCandidateCount = Settings.CandidateCount;
+	QualitySettings.DeltaTime = MotionSearchBenchmark::PoseInterval;
+
+	//Runs one query with the search dispatch of the motion matching node. Returns true if it fell back to another search
+	auto RunSearch = [&](const EMotionMatchingSearchQuality Quality, const int32 QueryIndex, FPoseSearchResult& OutResult)
+	{
+		const int32 SectionIndex = SectionIndices[QueryIndex];
+		const FPoseMatrixSection& Section = MotionData->MotionTagMatrixSections[SectionIndex];
+		const FPoseSearchQuery Query(QueryPoses.GetData() + QueryIndex * AtomCount,
+			MotionData->GetSectionCalibrationWeights(SectionIndex), Section.StartIndex, Section.EndIndex);
+
+		QualitySettings.Quality = Quality;
+		return FMotionMatchingSearch::SearchWithQuality(MotionData, Query, QualitySettings, SectionIndex,
+			CurrentPoseIds[QueryIndex], SearchScratch, OutResult) != Quality;
+	};
+
+	//The brute force search is the reference that every other quality is compared with
+	TArray<FPoseSearchResult> BruteResults;
+	BruteResults.Reserve(QueryCount);
+	for(int32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+	{
+		RunSearch(EMotionMatchingSearchQuality::Brute, QueryIndex, BruteResults.Emplace_GetRef(UE_MAX_FLT));
+	}
+
+	const UEnum* QualityEnum = StaticEnum<EMotionMatchingSearchQuality>();
+	int64 ResultChecksum = 0; //Keeps the timed searches from being optimised away
+	for(int32 QualityIndex = 0; QualityIndex < QualityEnum->NumEnums() - 1; ++QualityIndex)
+	{
+		FMotionSearchBenchmarkResult& Result = OutResults.AddDefaulted_GetRef();
+		Result.Quality = static_cast<EMotionMatchingSearchQuality>(QualityEnum->GetValueByIndex(QualityIndex));
+		Result.bExact = MotionSearchBenchmark::IsExactQuality(Result.Quality, Settings.TreeEpsilon);
+
+		switch(Result.Quality)
+		{
+			case EMotionMatchingSearchQuality::Quality: Result.bSupported = QualitySettings.Stages != nullptr; break;
+			case EMotionMatchingSearchQuality::Tree: Result.bSupported = MotionData->IsSearchTreeValid(); break;
+			case EMotionMatchingSearchQuality::CandidateLookup: Result.bSupported = MotionData->IsPoseLookupTableValid(); break;
+			case EMotionMatchingSearchQuality::Compressed: Result.bSupported = MotionData->IsSearchMatrixPQValid(); break;
+			default: Result.bSupported = true; break;
+		}
+
+		if(!Result.bSupported)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("MotionSearchBenchmark: Skipping '%s' because its search structures were not generated."),
+				*QualityEnum->GetNameStringByIndex(QualityIndex));
+			continue;
+		}
+
+		//The first pass warms the caches and is compared with the brute force search
+		int32 AgreementCount = 0;
+		int32 CostRatioCount = 0;
+		int64 PosesChecked = 0;
+		double CostRatioSum = 0.0;
+		for(int32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+		{
+			FPoseSearchResult SearchResult(UE_MAX_FLT);
+			Result.FallbackCount += RunSearch(Result.Quality, QueryIndex, SearchResult) ? 1 : 0;
+			PosesChecked += SearchResult.PosesChecked;
+
+			const FPoseSearchResult& BruteResult = BruteResults[QueryIndex];
+			if(!SearchResult.IsValid()
+				|| !BruteResult.IsValid())
+			{
+				continue;
+			}
+
+			if(SearchResult.PoseId == BruteResult.PoseId
+				|| MotionSearchBenchmark::IsSameCost(SearchResult.Cost, BruteResult.Cost))
+			{
+				++AgreementCount;
+			}
+
+			if(BruteResult.Cost > UE_KINDA_SMALL_NUMBER)
+			{
+				const double CostRatio = SearchResult.Cost / BruteResult.Cost;
+				CostRatioSum += CostRatio;
+				Result.MaxCostRatio = FMath::Max(Result.MaxCostRatio, CostRatio);
+				++CostRatioCount;
+			}
+		}
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for(int32 Iteration = 0; Iteration < Settings.Iterations; ++Iteration)
+		{
+			for(int32 QueryIndex = 0; QueryIndex < QueryCount; ++QueryIndex)
+			{
+				FPoseSearchResult SearchResult(UE_MAX_FLT);
+				RunSearch(Result.Quality, QueryIndex, SearchResult);
+				ResultChecksum += SearchResult.PoseId;
+			}
+		}
+		const uint64 SearchCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		const int32 SearchCount = QueryCount * Settings.Iterations;
+		Result.NanosecondsPerSearch = FPlatformTime::ToSeconds64(SearchCycles) * 1e9 / SearchCount;
+		Result.AveragePosesChecked = PosesChecked / static_cast<double>(QueryCount);
+		Result.Agreement = AgreementCount / static_cast<double>(QueryCount);
+		Result.MeanCostRatio = CostRatioCount > 0 ? CostRatioSum / CostRatioCount : 1.0;
+
+		UE_LOG(LogTemp, Display, TEXT("MotionSearchBenchmark: %-16s %10.1f ns/search %10.1f poses/search %6.2f%% agreement (mean cost ratio %.4f, max %.4f, %d fallbacks)"),
+			*QualityEnum->GetNameStringByIndex(QualityIndex), Result.NanosecondsPerSearch, Result.AveragePosesChecked,
+			Result.Agreement * 100.0, Result.MeanCostRatio, Result.MaxCostRatio, Result.FallbackCount);
+
+		Result.DisagreementCount = QueryCount - AgreementCount;
+		if(Result.bExact
+			&& Result.DisagreementCount > 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("MotionSearchBenchmark: '%s' disagreed with the brute force search on %d of %d queries."),
+				*QualityEnum->GetNameStringByIndex(QualityIndex), Result.DisagreementCount, QueryCount);
+		}
+	}
+
+	UE_LOG(LogTemp, Verbose, TEXT("MotionSearchBenchmark: Result checksum %lld"), ResultChecksum);
+
+	OutReport = WriteReport(Settings, MotionData, OutResults);
+	return true;
+}
+
+UMotionDataAsset* UMotionSearchBenchmarkCommandlet::CreateMotionData(const FMotionSearchBenchmarkSettings& InSettings,
+	FRandomStream& InRandomStream)
+{
+	//Bone location features are 3 atoms each. Half of them are response features so the staged and lookup searches work
+	const int32 FeatureCount = FMath::DivideAndRoundUp(InSettings.FeatureAtomCount, 3);
+	const int32 ResponseFeatureCount = FMath::Max(1, FeatureCount / 2);
+
+	UMotionMatchConfig* MMConfig = NewObject<UMotionMatchConfig>(GetTransientPackage());
+	for(int32 FeatureIndex = 0; FeatureIndex < FeatureCount; ++FeatureIndex)
+	{
+		UMatchFeature_BoneLocation* Feature = NewObject<UMatchFeature_BoneLocation>(MMConfig);
+		const bool bResponse = FeatureIndex < ResponseFeatureCount;
+		Feature->PoseCategory = bResponse ? EPoseCategory::Responsiveness : EPoseCategory::Quality;
+		(bResponse ? MMConfig->InputResponseFeatures : MMConfig->PoseQualityFeatures).Add(Feature);
+		MMConfig->Features.Add(Feature);
+	}
+
+	//The features have no bones so the config is set up here rather than with Initialize(). A uniform default calibration
+	//leaves the final calibration weights to the standard deviations of the synthetic data
+	MMConfig->ResponseDimensionCount = ResponseFeatureCount * 3;
+	MMConfig->QualityDimensionCount = (FeatureCount - ResponseFeatureCount) * 3;
+	MMConfig->TotalDimensionCount = FeatureCount * 3;
+	MMConfig->DefaultCalibrationArray.Init(1.0f, MMConfig->TotalDimensionCount);
+
+	const int32 AtomCount = MMConfig->TotalDimensionCount + 1; //+1 for the pose favour atom
+	const int32 SectionCount = InSettings.SectionCount;
+
+	UMotionDataAsset* MotionData = NewObject<UMotionDataAsset>(GetTransientPackage());
+	MotionData->MotionMatchConfig = MMConfig;
+	MotionData->PoseInterval = MotionSearchBenchmark::PoseInterval;
+	MotionData->bCompressSearchMatrix = true;
+	MotionData->bGeneratePoseLookupTable = true;
+	MotionData->bGenerateAABBHierarchy = InSettings.bAABBHierarchy;
+	MotionData->SearchPoseOrder = InSettings.bSpatialOrder ? EPoseMatrixOrder::Spatial : EPoseMatrixOrder::Animation;
+	MotionData->SearchMatrixPrecision = InSettings.Precision;
+	MotionData->SearchMatrixLayout = InSettings.Layout;
+
+	TArray<FGameplayTagContainer> SectionTags;
+	for(int32 SectionIndex = 0; SectionIndex < SectionCount; ++SectionIndex)
+	{
+		SectionTags.Emplace(MotionSearchBenchmark::GetSectionTag(SectionIndex));
+	}
+
+	MotionData->Poses.Reserve(InSettings.PoseCount);
+	MotionData->LookupPoseMatrix.AtomCount = AtomCount;
+	MotionData->LookupPoseMatrix.PoseArray.Reserve(InSettings.PoseCount * AtomCount);
+
+	//Every source animation is played once, or twice with the mirrored copy straight after it, in a round robin of sections
+	TArray<MotionSearchBenchmark::FClipCurve> ClipCurves;
+	int32 AnimId = 0;
+	while(MotionData->Poses.Num() < InSettings.PoseCount)
+	{
+		ClipCurves.SetNumUninitialized(AtomCount);
+		for(MotionSearchBenchmark::FClipCurve& Curve : ClipCurves)
+		{
+			Curve.Base = InRandomStream.FRandRange(-100.0f, 100.0f);
+			Curve.Amplitude = InRandomStream.FRandRange(5.0f, 50.0f);
+			Curve.Frequency = InRandomStream.FRandRange(0.5f, 4.0f);
+			Curve.Phase = InRandomStream.FRandRange(0.0f, UE_TWO_PI);
+		}
+
+		const FGameplayTagContainer& ClipTags = SectionTags[AnimId % SectionCount];
+		const int32 CopyCount = InSettings.bMirror ? 2 : 1;
+		for(int32 CopyIndex = 0; CopyIndex < CopyCount && MotionData->Poses.Num() < InSettings.PoseCount; ++CopyIndex)
+		{
+			const bool bMirrored = CopyIndex > 0;
+			const int32 FirstPoseId = MotionData->Poses.Num();
+			const int32 ClipPoseCount = FMath::Min(MotionSearchBenchmark::ClipLength, InSettings.PoseCount - FirstPoseId);
+			for(int32 ClipPoseIndex = 0; ClipPoseIndex < ClipPoseCount; ++ClipPoseIndex)
+			{
+				const int32 PoseId = FirstPoseId + ClipPoseIndex;
+				const float Time = ClipPoseIndex * MotionSearchBenchmark::PoseInterval;
+				const bool bLastPose = ClipPoseIndex == ClipPoseCount - 1;
+
+				FPoseMotionData& Pose = MotionData->Poses.Emplace_GetRef(PoseId, EMotionAnimAssetType::Sequence, AnimId, Time,
+					bLastPose ? EPoseSearchFlag::DoNotUse : EPoseSearchFlag::Searchable, bMirrored, ClipTags);
+				Pose.NextPoseId = bLastPose ? PoseId : PoseId + 1;
+				Pose.LastPoseId = ClipPoseIndex == 0 ? PoseId : PoseId - 1;
+
+				//Mirroring flips the x axis of every bone location
+				MotionData->LookupPoseMatrix.PoseArray.Add(1.0f);
+				for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+				{
+					const MotionSearchBenchmark::FClipCurve& Curve = ClipCurves[AtomIndex];
+					const float Value = Curve.Base + Curve.Amplitude * FMath::Sin(Curve.Frequency * Time + Curve.Phase);
+					MotionData->LookupPoseMatrix.PoseArray.Add(bMirrored && (AtomIndex - 1) % 3 == 0 ? -Value : Value);
+				}
+			}
+		}
+
+		++AnimId;
+	}
+
+	MotionData->LookupPoseMatrix.PoseCount = MotionData->Poses.Num();
+
+	//The motion tag sections, search structures and calibration are generated the same way as at the end of a pre-process
+	MotionData->GenerateSearchData();
+
+	return MotionData;
+}
+
+void UMotionSearchBenchmarkCommandlet::CreateQueries(const UMotionDataAsset* InMotionData, const int32 InQueryCount,
+	FRandomStream& InRandomStream, TArray<float>& OutQueryPoses, TArray<int32>& OutCurrentPoseIds,
+	TArray<int32>& OutSectionIndices)
+{
+	OutQueryPoses.Reset();
+	OutCurrentPoseIds.Reset();
+	OutSectionIndices.Reset();
+
+	TArray<int32> SearchableSections;
+	for(int32 SectionIndex = 0; SectionIndex < InMotionData->MotionTagMatrixSections.Num(); ++SectionIndex)
+	{
+		const FPoseMatrixSection& Section = InMotionData->MotionTagMatrixSections[SectionIndex];
+		if(Section.EndIndex > Section.StartIndex)
+		{
+			SearchableSections.Add(SectionIndex);
+		}
+	}
+
+	if(SearchableSections.Num() == 0)
+	{
+		return;
+	}
+
+	//The rows are read from the lookup pose matrix since the full precision search matrix is not kept at every precision
+	const int32 AtomCount = InMotionData->LookupPoseMatrix.AtomCount;
+	const int32 ResponseAtomEnd = InMotionData->MotionMatchConfig->ResponseDimensionCount + 1;
+	const float* PoseArray = InMotionData->LookupPoseMatrix.PoseArray.GetData();
+
+	OutQueryPoses.SetNumUninitialized(InQueryCount * AtomCount);
+	OutCurrentPoseIds.SetNumUninitialized(InQueryCount);
+	OutSectionIndices.SetNumUninitialized(InQueryCount);
+
+	//Each query is a pose of the data set (the current pose) with the response features moved towards another pose of the
+	//same section (the player input) and noise on the quality features
+	for(int32 QueryIndex = 0; QueryIndex < InQueryCount; ++QueryIndex)
+	{
+		const int32 SectionIndex = SearchableSections[InRandomStream.RandHelper(SearchableSections.Num())];
+		const FPoseMatrixSection& Section = InMotionData->MotionTagMatrixSections[SectionIndex];
+		const int32 CurrentPoseId = InMotionData->MatrixPoseIdToDatabasePoseId(InRandomStream.RandRange(Section.StartIndex, Section.EndIndex - 1));
+		const int32 InputPoseId = InMotionData->MatrixPoseIdToDatabasePoseId(InRandomStream.RandRange(Section.StartIndex, Section.EndIndex - 1));
+		const float InputWeight = InRandomStream.GetFraction();
+
+		const float* CurrentPose = PoseArray + CurrentPoseId * AtomCount;
+		const float* InputPose = PoseArray + InputPoseId * AtomCount;
+		float* QueryPose = OutQueryPoses.GetData() + QueryIndex * AtomCount;
+		QueryPose[0] = 1.0f;
+		for(int32 AtomIndex = 1; AtomIndex < AtomCount; ++AtomIndex)
+		{
+			QueryPose[AtomIndex] = AtomIndex < ResponseAtomEnd
+				? FMath::Lerp(CurrentPose[AtomIndex], InputPose[AtomIndex], InputWeight)
+				: CurrentPose[AtomIndex] + InRandomStream.FRandRange(-MotionSearchBenchmark::QualityNoise, MotionSearchBenchmark::QualityNoise);
+		}
+
+		OutCurrentPoseIds[QueryIndex] = CurrentPoseId;
+		OutSectionIndices[QueryIndex] = SectionIndex;
+	}
+}
+
+FString UMotionSearchBenchmarkCommandlet::WriteReport(const FMotionSearchBenchmarkSettings& InSettings,
+	const UMotionDataAsset* InMotionData, TConstArrayView<FMotionSearchBenchmarkResult> InResults)
+{
+	const UEnum* QualityEnum = StaticEnum<EMotionMatchingSearchQuality>();
+
+	FString Report;
+	TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Report);
+	JsonWriter->WriteObjectStart();
+	JsonWriter->WriteValue(TEXT("Version"), 2);
+	JsonWriter->WriteValue(TEXT("BuildConfiguration"), LexToString(FApp::GetBuildConfiguration()));
+	JsonWriter->WriteValue(TEXT("Platform"), FString(FPlatformProperties::IniPlatformName()));
+	JsonWriter->WriteValue(TEXT("CPU"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+
+	JsonWriter->WriteObjectStart(TEXT("Settings"));
+	JsonWriter->WriteValue(TEXT("Seed"), InSettings.Seed);
+	JsonWriter->WriteValue(TEXT("Poses"), InSettings.PoseCount);
+	JsonWriter->WriteValue(TEXT("FeatureAtoms"), InSettings.FeatureAtomCount);
+	JsonWriter->WriteValue(TEXT("Sections"), InSettings.SectionCount);
+	JsonWriter->WriteValue(TEXT("Mirror"), InSettings.bMirror);
+	JsonWriter->WriteValue(TEXT("SpatialOrder"), InSettings.bSpatialOrder);
+	JsonWriter->WriteValue(TEXT("AABBHierarchy"), InSettings.bAABBHierarchy);
+	JsonWriter->WriteValue(TEXT("Precision"), MotionSearchBenchmark::GetEnumName(InSettings.Precision));
+	JsonWriter->WriteValue(TEXT("Layout"), MotionSearchBenchmark::GetEnumName(InSettings.Layout));
+	JsonWriter->WriteValue(TEXT("Queries"), InSettings.QueryCount);
+	JsonWriter->WriteValue(TEXT("Iterations"), InSettings.Iterations);
+	JsonWriter->WriteValue(TEXT("TreeEpsilon"), InSettings.TreeEpsilon);
+	JsonWriter->WriteValue(TEXT("RerankCount"), InSettings.RerankCount);
+	JsonWriter->WriteValue(TEXT("CandidateCount"), InSettings.CandidateCount);
+	JsonWriter->WriteObjectEnd();
+
+	JsonWriter->WriteObjectStart(TEXT("MotionData"));
+	JsonWriter->WriteValue(TEXT("PoseCount"), InMotionData->Poses.Num());
+	JsonWriter->WriteValue(TEXT("SearchPoseCount"), InMotionData->SearchPoseMatrix.PoseCount);
+	JsonWriter->WriteValue(TEXT("AtomCount"), InMotionData->SearchPoseMatrix.AtomCount);
+	JsonWriter->WriteValue(TEXT("SectionCount"), InMotionData->MotionTagMatrixSections.Num());
+	JsonWriter->WriteValue(TEXT("SearchStructureHash"), static_cast<int64>(InMotionData->SearchStructureHash));
+	JsonWriter->WriteObjectEnd();
+
+	JsonWriter->WriteArrayStart(TEXT("Results"));
+	for(const FMotionSearchBenchmarkResult& Result : InResults)
+	{
+		JsonWriter->WriteObjectStart();
+		JsonWriter->WriteValue(TEXT("Quality"), QualityEnum->GetNameStringByValue(static_cast<int64>(Result.Quality)));
+		JsonWriter->WriteValue(TEXT("Supported"), Result.bSupported);
+		JsonWriter->WriteValue(TEXT("Exact"), Result.bExact);
+		if(Result.bSupported)
+		{
+			JsonWriter->WriteValue(TEXT("NsPerSearch"), Result.NanosecondsPerSearch);
+			JsonWriter->WriteValue(TEXT("PosesChecked"), Result.AveragePosesChecked);
+			JsonWriter->WriteValue(TEXT("Agreement"), Result.Agreement);
+			JsonWriter->WriteValue(TEXT("MeanCostRatio"), Result.MeanCostRatio);
+			JsonWriter->WriteValue(TEXT("MaxCostRatio"), Result.MaxCostRatio);
+			JsonWriter->WriteValue(TEXT("Fallbacks"), Result.FallbackCount);
+			JsonWriter->WriteValue(TEXT("Disagreements"), Result.DisagreementCount);
+		}
+		JsonWriter->WriteObjectEnd();
+	}
+	JsonWriter->WriteArrayEnd();
+
+	JsonWriter->WriteObjectEnd();
+	JsonWriter->Close();
+
+	return Report;
+}
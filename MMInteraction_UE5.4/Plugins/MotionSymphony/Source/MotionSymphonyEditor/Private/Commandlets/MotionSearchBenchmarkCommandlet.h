@@ -0,0 +1,96 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "Enumerations/EMotionMatchingEnums.h"
+#include "MotionSearchBenchmarkCommandlet.generated.h"
+
+class UMotionDataAsset;
+
+/** The synthetic data set and query stream of a benchmark run, parsed from the commandlet parameters */
+struct FMotionSearchBenchmarkSettings
+{
+	int32 PoseCount = 20000;
+	int32 FeatureAtomCount = 30;
+	int32 SectionCount = 4;
+	int32 QueryCount = 2000;
+	int32 Iterations = 5;
+	int32 Seed = 1;
+	bool bMirror = false;
+	bool bSpatialOrder = false;
+	bool bAABBHierarchy = false;
+	EPoseMatrixPrecision Precision = EPoseMatrixPrecision::Float;
+	ESearchMatrixLayout Layout = ESearchMatrixLayout::PoseMajor;
+	float TreeEpsilon = 0.0f;
+	int32 RerankCount = 32;
+	int32 CandidateCount = 32;
+	FString OutputPath;
+
+	void Parse(const FString& Params);
+};
+
+/** The results of running the benchmark query stream with one search quality */
+struct FMotionSearchBenchmarkResult
+{
+	EMotionMatchingSearchQuality Quality = EMotionMatchingSearchQuality::Performance;
+
+	/** False if the search structures required by the quality were not generated, e.g. no pose lookup table */
+	bool bSupported = false;
+
+	/** True if the quality is expected to always find the same cost as the brute force search */
+	bool bExact = false;
+
+	double NanosecondsPerSearch = 0.0;
+	double AveragePosesChecked = 0.0;
+
+	/** The fraction of searches which found the brute force pose, or a pose with the same cost */
+	double Agreement = 0.0;
+	double MeanCostRatio = 0.0;
+	double MaxCostRatio = 0.0;
+
+	/** The number of searches that fell back to the AABB search, e.g. a current pose with no lookup candidates */
+	int32 FallbackCount = 0;
+
+	/** The number of searches which found neither the brute force pose nor a pose with the same cost */
+	int32 DisagreementCount = 0;
+};
+
+/**
+ * Benchmarks every pose search quality on a synthetic motion data asset and compares the result of each search with
+ * the brute force search. The asset and the query stream are generated from a seed so that runs are deterministic and
+ * the JSON report can be compared across changes, e.g. on a build agent:
+ *
+ * UnrealEditor-Cmd <Project> -run=MotionSearchBenchmark -nullrhi -Poses=20000 -Atoms=30 -Sections=4 -Mirror
+ *		-Precision=Half -Layout=FeatureMajor -Queries=2000 -Iterations=5 -Seed=1 -Output=<Path.json>
+ *
+ * Every search goes through the search dispatch of the motion matching node (FMotionMatchingSearch::SearchWithQuality).
+ * Returns a non zero exit code if an exact search quality disagrees with the brute force search.
+ */
+UCLASS()
+class UMotionSearchBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMotionSearchBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	/** Generates the synthetic data set, runs the query stream with every search quality and writes the JSON report.
+	 * Returns false if the data set could not be generated. Used by the commandlet and the automation test */
+	static bool RunBenchmark(const FMotionSearchBenchmarkSettings& Settings, TArray<FMotionSearchBenchmarkResult>& OutResults,
+		FString& OutReport);
+
+private:
+	/** Creates a motion data asset and config with random animation like pose data and generates its search structures */
+	static UMotionDataAsset* CreateMotionData(const FMotionSearchBenchmarkSettings& InSettings, FRandomStream& InRandomStream);
+
+	/** Writes the query pose array, current database pose and motion tag section of every query to the output arrays */
+	static void CreateQueries(const UMotionDataAsset* InMotionData, const int32 InQueryCount, FRandomStream& InRandomStream,
+		TArray<float>& OutQueryPoses, TArray<int32>& OutCurrentPoseIds, TArray<int32>& OutSectionIndices);
+
+	static FString WriteReport(const FMotionSearchBenchmarkSettings& InSettings, const UMotionDataAsset* InMotionData,
+		TConstArrayView<FMotionSearchBenchmarkResult> InResults);
+};
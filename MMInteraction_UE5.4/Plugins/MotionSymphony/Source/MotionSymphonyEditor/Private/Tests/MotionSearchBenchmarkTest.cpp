@@ -0,0 +1,75 @@
+//Copyright 2020-2023 Kenneth Claassen. All Rights Reserved.
+
+#include "MotionSearchBenchmarkCommandlet.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMotionSearchBenchmarkExactTest, "MotionSymphony.Search.ExactQualitiesMatchBruteForce",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FMotionSearchBenchmarkExactTest::RunTest(const FString& Parameters)
+{
+	//A small data set with an odd atom count, mirroring and sections of different sizes, searched at every precision and
+	//layout. The exact qualities must find the brute force cost on every query
+	FMotionSearchBenchmarkSettings BaseSettings;
+	BaseSettings.PoseCount = 1500;
+	BaseSettings.FeatureAtomCount = 21;
+	BaseSettings.SectionCount = 3;
+	BaseSettings.QueryCount = 200;
+	BaseSettings.Iterations = 1;
+	BaseSettings.Seed = 7;
+	BaseSettings.bMirror = true;
+
+	struct FVariant
+	{
+		const TCHAR* Name;
+		EPoseMatrixPrecision Precision;
+		ESearchMatrixLayout Layout;
+		bool bSpatialOrder;
+		bool bAABBHierarchy;
+	};
+
+	const FVariant Variants[] =
+	{
+		{ TEXT("Float"), EPoseMatrixPrecision::Float, ESearchMatrixLayout::PoseMajor, false, false },
+		{ TEXT("Float Spatial Hierarchy"), EPoseMatrixPrecision::Float, ESearchMatrixLayout::PoseMajor, true, true },
+		{ TEXT("Float FeatureMajor"), EPoseMatrixPrecision::Float, ESearchMatrixLayout::FeatureMajor, false, false },
+		{ TEXT("Half"), EPoseMatrixPrecision::Half, ESearchMatrixLayout::PoseMajor, false, false },
+		{ TEXT("Int8"), EPoseMatrixPrecision::Int8, ESearchMatrixLayout::PoseMajor, false, false }
+	};
+
+	const UEnum* QualityEnum = StaticEnum<EMotionMatchingSearchQuality>();
+	for(const FVariant& Variant : Variants)
+	{
+		FMotionSearchBenchmarkSettings Settings = BaseSettings;
+		Settings.Precision = Variant.Precision;
+		Settings.Layout = Variant.Layout;
+		Settings.bSpatialOrder = Variant.bSpatialOrder;
+		Settings.bAABBHierarchy = Variant.bAABBHierarchy;
+
+		TArray<FMotionSearchBenchmarkResult> Results;
+		FString Report;
+		if(!TestTrue(FString::Printf(TEXT("%s: the synthetic motion data is generated"), Variant.Name),
+			UMotionSearchBenchmarkCommandlet::RunBenchmark(Settings, Results, Report)))
+		{
+			continue;
+		}
+
+		for(const FMotionSearchBenchmarkResult& Result : Results)
+		{
+			if(!Result.bSupported
+				|| !Result.bExact)
+			{
+				continue;
+			}
+
+			TestEqual(FString::Printf(TEXT("%s: '%s' disagreements with the brute force search"), Variant.Name,
+				*QualityEnum->GetNameStringByValue(static_cast<int64>(Result.Quality))), Result.DisagreementCount, 0);
+		}
+	}
+
+	return true;
+}
+
+#endif //WITH_DEV_AUTOMATION_TESTS
@@ -772,10 +772,7 @@ FText FMotionPreProcessToolkit::GetCompositeName(const int32 CompositeIndex)
 
 void FMotionPreProcessToolkit::SetCurrentAnimation(const int32 AnimIndex, const EMotionAnimAssetType AnimType, const bool bForceRefresh)
 {
-	if(!ActiveMotionDataAsset->IsSearchPoseMatrixGenerated())
-	{
-		ActiveMotionDataAsset->GenerateSearchPoseMatrix();
-	}
+	ActiveMotionDataAsset->ValidateSearchStructures();
 	
 	if (IsValidAnim(AnimIndex, AnimType)
 		&& ActiveMotionDataAsset->SetAnimPreviewIndex(AnimType, AnimIndex))